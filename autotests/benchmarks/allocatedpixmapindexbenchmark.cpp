@@ -0,0 +1,105 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../../core/allocatedpixmapindex_p.h"
+#include "../../core/observer.h"
+
+// Pretends the pages around the viewport are visible, like PageView does
+class VisiblePagesObserver : public Okular::DocumentObserver
+{
+public:
+    bool canUnloadPixmap(int page) const override
+    {
+        return qAbs(page - viewportPage) > 2;
+    }
+
+    int viewportPage = 0;
+};
+
+class AllocatedPixmapIndexBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void benchmarkEviction_data();
+    void benchmarkEviction();
+    void benchmarkReplace_data();
+    void benchmarkReplace();
+};
+
+static void fillIndex(Okular::AllocatedPixmapIndex *index, Okular::DocumentObserver *observer, Okular::DocumentObserver *thumbnails, int pages)
+{
+    for (int i = 0; i < pages; ++i) {
+        index->insert(new AllocatedPixmap(observer, i, 4 * 1000 * 1400));
+        index->insert(new AllocatedPixmap(thumbnails, i, 4 * 100 * 140));
+    }
+}
+
+void AllocatedPixmapIndexBenchmark::benchmarkEviction_data()
+{
+    QTest::addColumn<int>("pages");
+
+    QTest::newRow("300 pages") << 300;
+    QTest::newRow("3000 pages") << 3000;
+    QTest::newRow("30000 pages") << 30000;
+}
+
+// Scroll through the document evicting the farthest pixmap and adding the
+// one for the new viewport page, like cleanupPixmapMemory() + requestDone() do
+void AllocatedPixmapIndexBenchmark::benchmarkEviction()
+{
+    QFETCH(int, pages);
+
+    VisiblePagesObserver observer;
+    VisiblePagesObserver thumbnails;
+    Okular::AllocatedPixmapIndex index;
+    fillIndex(&index, &observer, &thumbnails, pages);
+
+    int step = 0;
+    QBENCHMARK {
+        const int viewportPage = step % pages;
+        observer.viewportPage = viewportPage;
+        thumbnails.viewportPage = viewportPage;
+
+        AllocatedPixmap *p = index.farthest(viewportPage, true);
+        QVERIFY(p);
+        index.take(p->observer, p->page);
+        delete p;
+        index.insert(new AllocatedPixmap(&observer, viewportPage, 4 * 1000 * 1400));
+        ++step;
+    }
+}
+
+void AllocatedPixmapIndexBenchmark::benchmarkReplace_data()
+{
+    benchmarkEviction_data();
+}
+
+// Replace the descriptor of an already cached page, like requestDone() does
+void AllocatedPixmapIndexBenchmark::benchmarkReplace()
+{
+    QFETCH(int, pages);
+
+    VisiblePagesObserver observer;
+    VisiblePagesObserver thumbnails;
+    Okular::AllocatedPixmapIndex index;
+    fillIndex(&index, &observer, &thumbnails, pages);
+
+    int step = 0;
+    QBENCHMARK {
+        const int page = (step * 7919) % pages;
+        delete index.take(&observer, page);
+        index.insert(new AllocatedPixmap(&observer, page, 4 * 1000 * 1400));
+        ++step;
+    }
+
+    QCOMPARE(index.count(), 2 * pages);
+}
+
+QTEST_GUILESS_MAIN(AllocatedPixmapIndexBenchmark)
+#include "allocatedpixmapindexbenchmark.moc"
@@ -0,0 +1,53 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../../core/area.h"
+
+class AreaBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void benchmarkSimplify_data();
+    void benchmarkSimplify();
+};
+
+void AreaBenchmark::benchmarkSimplify_data()
+{
+    QTest::addColumn<int>("lines");
+
+    QTest::newRow("1 line") << 1;
+    QTest::newRow("10 lines") << 10;
+    QTest::newRow("50 lines") << 50;
+}
+
+// A text selection over @p lines lines, one rect per character like TextPage gives them
+void AreaBenchmark::benchmarkSimplify()
+{
+    QFETCH(int, lines);
+
+    const int charactersPerLine = 90;
+    Okular::RegularAreaRect area;
+    for (int line = 0; line < lines; ++line) {
+        const double top = line / 60.0;
+        for (int column = 0; column < charactersPerLine; ++column) {
+            // neighbouring characters overlap a bit, like kerned glyphs do
+            const double left = column / double(charactersPerLine);
+            area.append(Okular::NormalizedRect(left, top, left + 1.1 / charactersPerLine, top + 1.0 / 60.0));
+        }
+    }
+
+    QBENCHMARK {
+        Okular::RegularAreaRect simplified = area;
+        simplified.simplify();
+        QVERIFY(simplified.count() <= lines);
+    }
+}
+
+QTEST_GUILESS_MAIN(AreaBenchmark)
+#include "areabenchmark.moc"
@@ -0,0 +1,277 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <KPluginFactory>
+#include <KPluginMetaData>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QMimeDatabase>
+#include <QStandardPaths>
+#include <QTest>
+#include <QTimer>
+
+#include <memory>
+#include <vector>
+
+#include "../../core/document.h"
+#include "../../core/generator.h"
+#include "../../core/generator_p.h"
+#include "../../core/observer.h"
+#include "../../core/page.h"
+#include "../../core/textpage.h"
+#include "../../core/textpage_p.h"
+#include "../settings_core.h"
+
+// Counts the pixmaps it gets and stops waiting once all the requested ones arrived
+class PixmapObserver : public Okular::DocumentObserver
+{
+public:
+    PixmapObserver()
+    {
+        timeout.setSingleShot(true);
+        QObject::connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+    }
+
+    void notifyPageChanged(int page, int flags) override
+    {
+        Q_UNUSED(page);
+        if (flags & Pixmap) {
+            ++received;
+            if (received == expected) {
+                loop.quit();
+            }
+        }
+    }
+
+    bool canUnloadPixmap(int page) const override
+    {
+        Q_UNUSED(page);
+        return unloadable;
+    }
+
+    // Requests all the pages of @p document @p width pixels wide and waits for them
+    void renderAllPages(Okular::Document *document, int width)
+    {
+        QList<Okular::PixmapRequest *> requests;
+        for (uint i = 0; i < document->pages(); ++i) {
+            const Okular::Page *page = document->page(i);
+            const int height = qRound(width * page->height() / page->width());
+            requests << new Okular::PixmapRequest(this, i, width, height, 1 /* dpr */, 1, Okular::PixmapRequest::Asynchronous);
+        }
+
+        received = 0;
+        expected = requests.count();
+        document->requestPixmaps(requests);
+        if (received < expected) {
+            timeout.start(60000);
+            loop.exec();
+            timeout.stop();
+        }
+    }
+
+    int received = 0;
+    int expected = 0;
+    bool unloadable = true;
+    QEventLoop loop;
+    QTimer timeout;
+};
+
+class DocumentBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanup();
+    void benchmarkRequestPixmaps_data();
+    void benchmarkRequestPixmaps();
+    void benchmarkCleanupPixmapMemory();
+    void benchmarkRequestTextPages_data();
+    void benchmarkRequestTextPages();
+    void benchmarkCorrectTextOrder_data();
+    void benchmarkCorrectTextOrder();
+};
+
+void DocumentBenchmark::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    Okular::SettingsCore::instance(QStringLiteral("documentbenchmark"));
+}
+
+void DocumentBenchmark::cleanup()
+{
+    Okular::SettingsCore::self()->setDefaults();
+}
+
+static void addDocuments()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("memoryLevel");
+
+    const QStringList fileNames = {QStringLiteral("file1.pdf"), QStringLiteral("simple-multipage.pdf"), QStringLiteral("pdf_with_internal_links.pdf"), QStringLiteral("tocreload.pdf")};
+    for (const QString &fileName : fileNames) {
+        QTest::addRow("%s thumbnails", qPrintable(fileName)) << fileName << 200 << int(Okular::SettingsCore::EnumMemoryLevel::Normal);
+        QTest::addRow("%s pages", qPrintable(fileName)) << fileName << 1000 << int(Okular::SettingsCore::EnumMemoryLevel::Normal);
+    }
+    // the low profile frees the cache before sending every request
+    QTest::addRow("simple-multipage.pdf pages, low memory") << QStringLiteral("simple-multipage.pdf") << 1000 << int(Okular::SettingsCore::EnumMemoryLevel::Low);
+}
+
+void DocumentBenchmark::benchmarkRequestPixmaps_data()
+{
+    addDocuments();
+}
+
+// From Document::requestPixmaps() to the observers getting notified, for every page
+void DocumentBenchmark::benchmarkRequestPixmaps()
+{
+    QFETCH(QString, fileName);
+    QFETCH(int, width);
+    QFETCH(int, memoryLevel);
+
+    // measure the generator, not the stored thumbnails of a previous run
+    Okular::SettingsCore::setThumbnailStoreSize(0);
+    Okular::SettingsCore::setMemoryLevel(memoryLevel);
+
+    Okular::Document document(nullptr);
+    const QString testFile = QStringLiteral(KDESRCDIR "data/") + fileName;
+    QMimeDatabase db;
+    QCOMPARE(document.openDocument(testFile, QUrl(), db.mimeTypeForFile(testFile)), Okular::Document::OpenSuccess);
+
+    QBENCHMARK {
+        // a new observer has no pixmaps yet, so every iteration renders all the pages
+        PixmapObserver observer;
+        document.addObserver(&observer);
+        observer.renderAllPages(&document, width);
+        // frees its pixmaps
+        document.removeObserver(&observer);
+        QCOMPARE(observer.received, observer.expected);
+    }
+
+    document.closeDocument();
+}
+
+// Document::reparseConfig() goes through the whole pixmap cache in the low
+// memory profile, none of the pixmaps can be freed so the work is the same every time
+void DocumentBenchmark::benchmarkCleanupPixmapMemory()
+{
+    Okular::SettingsCore::setThumbnailStoreSize(0);
+    Okular::SettingsCore::setMemoryLevel(Okular::SettingsCore::EnumMemoryLevel::Low);
+
+    Okular::Document document(nullptr);
+    PixmapObserver pageView;
+    PixmapObserver thumbnails;
+    pageView.unloadable = false;
+    thumbnails.unloadable = false;
+    document.addObserver(&pageView);
+    document.addObserver(&thumbnails);
+
+    const QString testFile = QStringLiteral(KDESRCDIR "data/simple-multipage.pdf");
+    QMimeDatabase db;
+    QCOMPARE(document.openDocument(testFile, QUrl(), db.mimeTypeForFile(testFile)), Okular::Document::OpenSuccess);
+    pageView.renderAllPages(&document, 1000);
+    thumbnails.renderAllPages(&document, 200);
+
+    QBENCHMARK {
+        document.reparseConfig();
+    }
+
+    for (uint i = 0; i < document.pages(); ++i) {
+        QVERIFY(document.page(i)->hasPixmap(&pageView));
+        QVERIFY(document.page(i)->hasPixmap(&thumbnails));
+    }
+
+    document.closeDocument();
+    document.removeObserver(&pageView);
+    document.removeObserver(&thumbnails);
+}
+
+static void addTextDocuments()
+{
+    QTest::addColumn<QString>("fileName");
+
+    const QStringList fileNames = {QStringLiteral("file1.pdf"), QStringLiteral("simple-multipage.pdf"), QStringLiteral("pdf_with_internal_links.pdf"), QStringLiteral("tocreload.pdf"), QStringLiteral("synctextest.pdf")};
+    for (const QString &fileName : fileNames) {
+        QTest::newRow(qPrintable(fileName)) << fileName;
+    }
+}
+
+void DocumentBenchmark::benchmarkRequestTextPages_data()
+{
+    addTextDocuments();
+}
+
+// Document::requestTextPage() for every page, like searching the whole document
+// does: the text is extracted and put in reading order
+void DocumentBenchmark::benchmarkRequestTextPages()
+{
+    QFETCH(QString, fileName);
+
+    Okular::Document document(nullptr);
+    const QString testFile = QStringLiteral(KDESRCDIR "data/") + fileName;
+    QMimeDatabase db;
+    QCOMPARE(document.openDocument(testFile, QUrl(), db.mimeTypeForFile(testFile)), Okular::Document::OpenSuccess);
+
+    // once, the pages of a freshly opened document have no text yet
+    QBENCHMARK_ONCE {
+        for (uint i = 0; i < document.pages(); ++i) {
+            document.requestTextPage(i);
+            QVERIFY(document.page(i)->hasTextPage());
+        }
+    }
+
+    document.closeDocument();
+}
+
+void DocumentBenchmark::benchmarkCorrectTextOrder_data()
+{
+    addTextDocuments();
+}
+
+// Only the reconstruction of the reading order of the text of every page
+void DocumentBenchmark::benchmarkCorrectTextOrder()
+{
+    QFETCH(QString, fileName);
+
+    const KPluginMetaData metaData = KPluginMetaData::findPluginById(QStringLiteral("okular_generators"), QStringLiteral("okularGenerator_poppler"));
+    std::unique_ptr<Okular::Generator> generator(KPluginFactory::instantiatePlugin<Okular::Generator>(metaData).plugin);
+    QVERIFY(generator);
+
+    const QString testFile = QStringLiteral(KDESRCDIR "data/") + fileName;
+    QVector<Okular::Page *> generatorPages;
+    QVERIFY(generator->loadDocument(testFile, generatorPages));
+
+    // the text of every page in the order the generator extracted it
+    QList<Okular::TextEntity::List> texts;
+    std::vector<std::unique_ptr<Okular::Page>> pages;
+    for (Okular::Page *page : std::as_const(generatorPages)) {
+        std::unique_ptr<Okular::TextPage> textPage(Okular::TextPageGenerationThread::extractedTextPage(generator.get(), page));
+        texts << (textPage ? textPage->words(nullptr, Okular::TextPage::CentralPixelTextAreaInclusionBehaviour) : Okular::TextEntity::List());
+        pages.emplace_back(page);
+    }
+    generator->closeDocument();
+
+    // correctTextOrder() rewrites the text it sorts, so every round gets copies made beforehand
+    const int rounds = 10;
+    std::vector<std::unique_ptr<Okular::TextPage>> copies;
+    for (int round = 0; round < rounds; ++round) {
+        for (std::size_t i = 0; i < pages.size(); ++i) {
+            copies.emplace_back(new Okular::TextPage(texts.at(i)));
+            Okular::TextPagePrivate::get(copies.back().get())->m_page = pages[i].get();
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (const std::unique_ptr<Okular::TextPage> &copy : copies) {
+        Okular::TextPagePrivate::get(copy.get())->correctTextOrder();
+    }
+    QTest::setBenchmarkResult(timer.nsecsElapsed() / 1000000.0 / rounds, QTest::WalltimeMilliseconds);
+}
+
+QTEST_MAIN(DocumentBenchmark)
+#include "documentbenchmark.moc"
@@ -0,0 +1,88 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QPainter>
+#include <QPixmap>
+#include <QTest>
+
+#include "../../core/observer.h"
+#include "../../core/page.h"
+#include "../../gui/pagepainter.h"
+#include "../settings.h"
+
+class PagePainterBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void benchmarkPaintPage_data();
+    void benchmarkPaintPage();
+};
+
+void PagePainterBenchmark::initTestCase()
+{
+    Okular::Settings::instance(QStringLiteral("pagepainterbenchmark"));
+    // the recolored pages are cached unless the memory profile is low,
+    // without it every iteration after the first would only measure a cache hit
+    Okular::Settings::setMemoryLevel(Okular::Settings::EnumMemoryLevel::Low);
+}
+
+void PagePainterBenchmark::benchmarkPaintPage_data()
+{
+    QTest::addColumn<bool>("changeColors");
+    QTest::addColumn<int>("renderMode");
+
+    QTest::newRow("original colors") << false << 0;
+    QTest::newRow("Inverted") << true << int(Okular::Settings::EnumRenderMode::Inverted);
+    QTest::newRow("Paper") << true << int(Okular::Settings::EnumRenderMode::Paper);
+    QTest::newRow("Recolor") << true << int(Okular::Settings::EnumRenderMode::Recolor);
+    QTest::newRow("BlackWhite") << true << int(Okular::Settings::EnumRenderMode::BlackWhite);
+    QTest::newRow("InvertLightness") << true << int(Okular::Settings::EnumRenderMode::InvertLightness);
+    QTest::newRow("InvertLuma") << true << int(Okular::Settings::EnumRenderMode::InvertLuma);
+    QTest::newRow("InvertLumaSymmetric") << true << int(Okular::Settings::EnumRenderMode::InvertLumaSymmetric);
+    QTest::newRow("HueShiftPositive") << true << int(Okular::Settings::EnumRenderMode::HueShiftPositive);
+    QTest::newRow("HueShiftNegative") << true << int(Okular::Settings::EnumRenderMode::HueShiftNegative);
+}
+
+// Paint an A4 page at 100 dpi the way PageView does when it gets a new pixmap
+void PagePainterBenchmark::benchmarkPaintPage()
+{
+    QFETCH(bool, changeColors);
+    QFETCH(int, renderMode);
+
+    Okular::Settings::setChangeColors(changeColors);
+    Okular::Settings::setRenderMode(renderMode);
+
+    const QSize size(827, 1169);
+    QImage render(size, QImage::Format_ARGB32_Premultiplied);
+    render.fill(Qt::white);
+    {
+        // some text lines and a colored picture
+        QPainter painter(&render);
+        for (int y = 80; y < size.height() - 80; y += 40) {
+            painter.fillRect(80, y, size.width() - 160, 20, Qt::black);
+        }
+        QLinearGradient gradient(0, 0, size.width(), 0);
+        gradient.setColorAt(0, Qt::red);
+        gradient.setColorAt(0.5, Qt::green);
+        gradient.setColorAt(1, Qt::blue);
+        painter.fillRect(200, 400, size.width() - 400, 300, gradient);
+    }
+
+    Okular::DocumentObserver observer;
+    Okular::Page page(0, size.width(), size.height(), Okular::Rotation0);
+    page.setPixmap(&observer, new QPixmap(QPixmap::fromImage(render)));
+
+    QImage target(size, QImage::Format_ARGB32_Premultiplied);
+    QBENCHMARK {
+        QPainter painter(&target);
+        PagePainter::paintPageOnPainter(&painter, &page, &observer, PagePainter::Accessibility, size.width(), size.height(), QRect(QPoint(0, 0), size));
+    }
+}
+
+QTEST_MAIN(PagePainterBenchmark)
+#include "pagepainterbenchmark.moc"
@@ -0,0 +1,181 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../../core/area.h"
+#include "../../core/misc.h"
+#include "../../core/page.h"
+#include "../../core/textpage.h"
+
+#include <memory>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define HAVE_MALLINFO2 1
+#endif
+
+class TextPageBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void benchmarkMemoryTextEntityList_data();
+    void benchmarkMemoryTextEntityList();
+    void benchmarkMemory_data();
+    void benchmarkMemory();
+    void benchmarkFindText_data();
+    void benchmarkFindText();
+    void benchmarkTextArea_data();
+    void benchmarkTextArea();
+    void benchmarkCorrectTextOrder_data();
+    void benchmarkCorrectTextOrder();
+};
+
+// Calls @p f for every character of a dense page, one entity per character like PDFGenerator does
+template<typename F> static void forEachCharacter(int characters, F f)
+{
+    static const QString text = QStringLiteral("Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. ");
+    const int charactersPerLine = 90;
+    const int lines = characters / charactersPerLine + 1;
+    for (int i = 0; i < characters; ++i) {
+        const int line = i / charactersPerLine;
+        const int column = i % charactersPerLine;
+        const double left = column / double(charactersPerLine);
+        const double top = line / double(lines);
+        const QString character = column == charactersPerLine - 1 ? QStringLiteral("\n") : QString(text.at(i % text.length()));
+        f(character, Okular::NormalizedRect(left, top, left + 1.0 / charactersPerLine, top + 1.0 / lines));
+    }
+}
+
+static qint64 allocatedBytes()
+{
+#ifdef HAVE_MALLINFO2
+    return mallinfo2().uordblks;
+#else
+    return -1;
+#endif
+}
+
+static void addPageSizes()
+{
+    QTest::addColumn<int>("characters");
+
+    QTest::newRow("1000 characters") << 1000;
+    QTest::newRow("5000 characters") << 5000;
+    QTest::newRow("20000 characters") << 20000;
+}
+
+void TextPageBenchmark::benchmarkMemoryTextEntityList_data()
+{
+    addPageSizes();
+}
+
+// The layout TextPage used before: one TextEntity per character
+void TextPageBenchmark::benchmarkMemoryTextEntityList()
+{
+    QFETCH(int, characters);
+#ifndef HAVE_MALLINFO2
+    QSKIP("Needs mallinfo2() to measure the memory");
+#endif
+
+    const qint64 before = allocatedBytes();
+    auto list = std::make_unique<Okular::TextEntity::List>();
+    forEachCharacter(characters, [&list](const QString &text, const Okular::NormalizedRect &area) { list->append(Okular::TextEntity(text, area)); });
+    list->squeeze();
+    QTest::setBenchmarkResult(allocatedBytes() - before, QTest::BytesAllocated);
+}
+
+void TextPageBenchmark::benchmarkMemory_data()
+{
+    addPageSizes();
+}
+
+void TextPageBenchmark::benchmarkMemory()
+{
+    QFETCH(int, characters);
+#ifndef HAVE_MALLINFO2
+    QSKIP("Needs mallinfo2() to measure the memory");
+#endif
+
+    Okular::TextEntity::List list;
+    forEachCharacter(characters, [&list](const QString &text, const Okular::NormalizedRect &area) { list.append(Okular::TextEntity(text, area)); });
+
+    // the list constructor packs the entities with their exact size, like Page::setTextPage does
+    const qint64 before = allocatedBytes();
+    auto textPage = std::make_unique<Okular::TextPage>(list);
+    QTest::setBenchmarkResult(allocatedBytes() - before, QTest::BytesAllocated);
+}
+
+void TextPageBenchmark::benchmarkFindText_data()
+{
+    addPageSizes();
+}
+
+void TextPageBenchmark::benchmarkFindText()
+{
+    QFETCH(int, characters);
+
+    Okular::TextPage textPage;
+    forEachCharacter(characters, [&textPage](const QString &text, const Okular::NormalizedRect &area) { textPage.append(text, area); });
+
+    QBENCHMARK {
+        int matches = 0;
+        Okular::RegularAreaRect *match = textPage.findText(0, QStringLiteral("magna aliqua"), Okular::FromTop, Qt::CaseInsensitive, nullptr);
+        while (match) {
+            ++matches;
+            Okular::RegularAreaRect *next = textPage.findText(0, QStringLiteral("magna aliqua"), Okular::NextResult, Qt::CaseInsensitive, match);
+            delete match;
+            match = next;
+        }
+        QVERIFY(matches > 0);
+    }
+}
+
+void TextPageBenchmark::benchmarkTextArea_data()
+{
+    addPageSizes();
+}
+
+// Selecting the whole page, like dragging the text selection tool over it
+void TextPageBenchmark::benchmarkTextArea()
+{
+    QFETCH(int, characters);
+
+    Okular::TextEntity::List list;
+    forEachCharacter(characters, [&list](const QString &text, const Okular::NormalizedRect &area) { list.append(Okular::TextEntity(text, area)); });
+    Okular::Page page(0, 600, 800, Okular::Rotation0);
+    page.setTextPage(new Okular::TextPage(list));
+
+    const Okular::TextSelection selection(Okular::NormalizedPoint(0, 0), Okular::NormalizedPoint(1, 1));
+    QBENCHMARK {
+        const std::unique_ptr<Okular::RegularAreaRect> area = page.textArea(selection);
+        QVERIFY(area && !area->isEmpty());
+    }
+}
+
+void TextPageBenchmark::benchmarkCorrectTextOrder_data()
+{
+    addPageSizes();
+}
+
+// Page::setTextPage() sorts the text with the XY-cut and builds the search
+// index, like the text extraction threads do before handing the page over
+void TextPageBenchmark::benchmarkCorrectTextOrder()
+{
+    QFETCH(int, characters);
+
+    Okular::TextEntity::List list;
+    forEachCharacter(characters, [&list](const QString &text, const Okular::NormalizedRect &area) { list.append(Okular::TextEntity(text, area)); });
+    Okular::Page page(0, 600, 800, Okular::Rotation0);
+
+    QBENCHMARK {
+        page.setTextPage(new Okular::TextPage(list));
+    }
+}
+
+QTEST_GUILESS_MAIN(TextPageBenchmark)
+#include "textpagebenchmark.moc"
@@ -0,0 +1,101 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QPixmap>
+#include <QTest>
+
+#include "../../core/tile.h"
+#include "../../core/tilesmanager_p.h"
+
+class TilesManagerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void benchmarkTilesAt_data();
+    void benchmarkTilesAt();
+    void benchmarkCleanupPixmapMemory_data();
+    void benchmarkCleanupPixmapMemory();
+};
+
+static void addPageSizes()
+{
+    QTest::addColumn<QSize>("size");
+
+    // A4 at 400% and 1600% zoom on a 96 dpi screen
+    QTest::newRow("A4 at 400%") << QSize(3175, 4490);
+    QTest::newRow("A4 at 1600%") << QSize(12700, 17960);
+}
+
+// The part of the page shown in a 1920x1080 viewport, scrolled to the middle of the page
+static Okular::NormalizedRect viewportRect(const QSize &size)
+{
+    const double width = qMin(1.0, 1920.0 / size.width());
+    const double height = qMin(1.0, 1080.0 / size.height());
+    return Okular::NormalizedRect(0.5 - width / 2, 0.5 - height / 2, 0.5 + width / 2, 0.5 + height / 2);
+}
+
+// Renders @p rect of the page, like Document::requestPixmaps() + Page::setPixmap() do for tiled pages
+static void setPixmap(Okular::TilesManager *tilesManager, const Okular::NormalizedRect &rect)
+{
+    const QRect geometry = rect.geometry(tilesManager->width(), tilesManager->height());
+    QPixmap pixmap(geometry.size());
+    pixmap.fill(Qt::white);
+    tilesManager->setRequest(rect, tilesManager->width(), tilesManager->height());
+    tilesManager->setPixmap(&pixmap, rect, false);
+}
+
+void TilesManagerBenchmark::benchmarkTilesAt_data()
+{
+    addPageSizes();
+}
+
+// PageView asks for the tiles in the viewport every time it paints
+void TilesManagerBenchmark::benchmarkTilesAt()
+{
+    QFETCH(QSize, size);
+
+    Okular::TilesManager tilesManager(0, size.width(), size.height());
+    const Okular::NormalizedRect rect = viewportRect(size);
+    setPixmap(&tilesManager, rect);
+
+    QBENCHMARK {
+        const QList<Okular::Tile> tiles = tilesManager.tilesAt(rect, Okular::TilesManager::PixmapTile);
+        QVERIFY(!tiles.isEmpty());
+    }
+}
+
+void TilesManagerBenchmark::benchmarkCleanupPixmapMemory_data()
+{
+    QTest::addColumn<QSize>("size");
+
+    // the whole page is rendered, so keep it to what fits in memory
+    QTest::newRow("A4 at 200%") << QSize(1588, 2245);
+    QTest::newRow("A4 at 400%") << QSize(3175, 4490);
+}
+
+// Render the whole page and then drop everything but the viewport, like scrolling
+// away and back does under memory pressure. Includes the time to set the pixmaps.
+void TilesManagerBenchmark::benchmarkCleanupPixmapMemory()
+{
+    QFETCH(QSize, size);
+
+    Okular::TilesManager tilesManager(0, size.width(), size.height());
+    const Okular::NormalizedRect rect = viewportRect(size);
+    const Okular::NormalizedRect wholePage(0, 0, 1, 1);
+
+    QBENCHMARK {
+        for (const Okular::Tile &tile : tilesManager.tilesAt(wholePage, Okular::TilesManager::TerminalTile)) {
+            if (!tile.isValid()) {
+                setPixmap(&tilesManager, tile.rect());
+            }
+        }
+        tilesManager.cleanupPixmapMemory(tilesManager.totalMemory(), rect, 0);
+    }
+}
+
+QTEST_MAIN(TilesManagerBenchmark)
+#include "tilesmanagerbenchmark.moc"
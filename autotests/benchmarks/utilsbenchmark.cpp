@@ -0,0 +1,67 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QPainter>
+#include <QTest>
+
+#include "../../core/area.h"
+#include "../../core/utils.h"
+#include "../settings_core.h"
+
+class UtilsBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void benchmarkImageBoundingBox_data();
+    void benchmarkImageBoundingBox();
+};
+
+void UtilsBenchmark::initTestCase()
+{
+    Okular::SettingsCore::instance(QStringLiteral("utilsbenchmark"));
+}
+
+void UtilsBenchmark::benchmarkImageBoundingBox_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("margin");
+    QTest::addColumn<QImage::Format>("format");
+
+    QTest::newRow("thumbnail") << QSize(200, 283) << 20 << QImage::Format_ARGB32_Premultiplied;
+    QTest::newRow("A4 at 100 dpi") << QSize(827, 1169) << 80 << QImage::Format_ARGB32_Premultiplied;
+    QTest::newRow("A4 at 300 dpi") << QSize(2480, 3508) << 240 << QImage::Format_ARGB32_Premultiplied;
+    QTest::newRow("RGB32 A4 at 300 dpi") << QSize(2480, 3508) << 240 << QImage::Format_RGB32;
+    QTest::newRow("RGB888 A4 at 100 dpi") << QSize(827, 1169) << 80 << QImage::Format_RGB888;
+    QTest::newRow("blank A4 at 100 dpi") << QSize(827, 1169) << -1 << QImage::Format_ARGB32_Premultiplied;
+}
+
+// A page with white margins around its text, the scan has to go through all the margins
+void UtilsBenchmark::benchmarkImageBoundingBox()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, margin);
+    QFETCH(QImage::Format, format);
+
+    QImage image(size, format);
+    image.fill(Qt::white);
+    if (margin >= 0) {
+        QPainter painter(&image);
+        const int lineHeight = qMax(2, size.height() / 60);
+        for (int y = margin; y < size.height() - margin; y += 2 * lineHeight) {
+            painter.fillRect(margin, y, size.width() - 2 * margin, lineHeight, Qt::black);
+        }
+    }
+
+    QBENCHMARK {
+        const Okular::NormalizedRect bbox = Okular::Utils::imageBoundingBox(&image);
+        QCOMPARE(bbox.isNull(), margin < 0);
+    }
+}
+
+QTEST_GUILESS_MAIN(UtilsBenchmark)
+#include "utilsbenchmark.moc"
@@ -6,6 +6,7 @@
 
 #include <QTest>
 
+#include "../core/formcalculationgraph_p.h"
 #include "../settings_core.h"
 #include "core/document.h"
 #include <QMap>
@@ -23,6 +24,8 @@ private Q_SLOTS:
     void cleanupTestCase();
 
     void testSimpleCalculate();
+    void testReferencedFieldNames_data();
+    void testReferencedFieldNames();
 
 private:
     Okular::Document *m_document;
@@ -104,6 +107,48 @@ void CalculateTextTest::testSimpleCalculate()
     QVERIFY(m_document->canRedo());
     m_document->redo();
     QCOMPARE(fields[QStringLiteral("Sum")]->text(), QStringLiteral("40"));
+
+    // Test that only the fields reading the edited one are recalculated:
+    // Max doesn't read Sum, so it keeps the value typed in it
+    m_document->editFormText(0, fields[QStringLiteral("Max")], QStringLiteral("99"), 0, 0, 0, QStringLiteral("30"));
+    QCOMPARE(fields[QStringLiteral("Max")]->text(), QStringLiteral("99"));
+    m_document->editFormText(0, fields[QStringLiteral("Sum")], QStringLiteral("5"), 0, 0, 0, QStringLiteral("40"));
+    QCOMPARE(fields[QStringLiteral("Sum")]->text(), QStringLiteral("5"));
+    QCOMPARE(fields[QStringLiteral("Max")]->text(), QStringLiteral("99"));
+
+    // while all of them read field1
+    m_document->editFormText(0, field1, QStringLiteral("1"), 0, 0, 0, QStringLiteral("10"));
+    QCOMPARE(fields[QStringLiteral("Sum")]->text(), QStringLiteral("31"));
+    QCOMPARE(fields[QStringLiteral("Min")]->text(), QStringLiteral("0"));
+    QCOMPARE(fields[QStringLiteral("Max")]->text(), QStringLiteral("30"));
+}
+
+void CalculateTextTest::testReferencedFieldNames_data()
+{
+    QTest::addColumn<QString>("script");
+    QTest::addColumn<QStringList>("names");
+    QTest::addColumn<bool>("complete");
+
+    QTest::newRow("simple calculate array") << QStringLiteral("AFSimple_Calculate(\"SUM\", new Array (\"field1\", \"field2\"));") << QStringList {QStringLiteral("field1"), QStringLiteral("field2")} << true;
+    QTest::newRow("simple calculate string") << QStringLiteral("AFSimple_Calculate(\"MAX\", \"field1, field3\");") << QStringList {QStringLiteral("field1"), QStringLiteral("field3")} << true;
+    QTest::newRow("getField") << QStringLiteral("event.value = Math.max(this.getField(\"a\").value, getField('b').value).toFixed(2);") << QStringList {QStringLiteral("a"), QStringLiteral("b")}
+                              << true;
+    QTest::newRow("function of the script") << QStringLiteral("function twice(x) { return 2 * x; } event.value = twice(getField(\"a\").value);") << QStringList {QStringLiteral("a")} << true;
+    QTest::newRow("computed name") << QStringLiteral("var n = \"a\"; event.value = getField(n).value;") << QStringList() << false;
+    QTest::newRow("document level function") << QStringLiteral("event.value = total(getField(\"a\").value);") << QStringList {QStringLiteral("a")} << false;
+    QTest::newRow("document level function through this") << QStringLiteral("event.value = this.total();") << QStringList() << false;
+    QTest::newRow("call in a string") << QStringLiteral("event.value = getField(\"a\").value + \"total()\";") << QStringList {QStringLiteral("a")} << true;
+}
+
+void CalculateTextTest::testReferencedFieldNames()
+{
+    QFETCH(QString, script);
+    QFETCH(QStringList, names);
+    QFETCH(bool, complete);
+
+    bool actualComplete = !complete;
+    QCOMPARE(Okular::FormCalculationGraph::referencedFieldNames(script, &actualComplete), names);
+    QCOMPARE(actualComplete, complete);
 }
 
 QTEST_MAIN(CalculateTextTest)
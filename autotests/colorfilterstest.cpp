@@ -0,0 +1,81 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QRandomGenerator>
+#include <QTest>
+
+#include "gui/colorfilters_p.h"
+
+#include <vector>
+
+class ColorFiltersTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testVectorMatchesScalar_data();
+    void testVectorMatchesScalar();
+};
+
+using Kernel = void (*)(QRgb *data, int pixels);
+
+void ColorFiltersTest::testVectorMatchesScalar_data()
+{
+    QTest::addColumn<int>("filter");
+    QTest::addColumn<int>("pixels");
+    QTest::addColumn<int>("offset");
+
+    // counts that are not a multiple of the vector widths leave pixels to the scalar loop,
+    // and an offset makes the loads unaligned
+    const char *names[] = {"invert lightness", "hue shift positive", "hue shift negative"};
+    for (int filter = 0; filter < 3; ++filter) {
+        for (int pixels : {0, 1, 3, 4, 7, 8, 15, 16, 17, 33, 1021}) {
+            for (int offset : {0, 1}) {
+                QTest::addRow("%s, %d pixels, offset %d", names[filter], pixels, offset) << filter << pixels << offset;
+            }
+        }
+    }
+}
+
+void ColorFiltersTest::testVectorMatchesScalar()
+{
+    QFETCH(int, filter);
+    QFETCH(int, pixels);
+    QFETCH(int, offset);
+
+    const Kernel vectorKernels[] = {ColorFilters::invertLightnessPixels, ColorFilters::rotateColorPixels<16>, ColorFilters::rotateColorPixels<8>};
+    const Kernel scalarKernels[] = {ColorFilters::invertLightnessPixelsScalar, ColorFilters::rotateColorPixelsScalar<16>, ColorFilters::rotateColorPixelsScalar<8>};
+
+    QRandomGenerator random(pixels * 2 + offset);
+    std::vector<QRgb> vectorPixels(pixels + offset);
+    for (QRgb &pixel : vectorPixels) {
+        // premultiplied colors, plus some of the gray and saturated ones the pages are made of
+        const int alpha = random.bounded(4) == 0 ? random.bounded(256) : 255;
+        const int gray = random.bounded(alpha + 1);
+        switch (random.bounded(3)) {
+        case 0:
+            pixel = qRgba(gray, gray, gray, alpha);
+            break;
+        case 1:
+            pixel = qRgba(random.bounded(2) * alpha, random.bounded(2) * alpha, random.bounded(2) * alpha, alpha);
+            break;
+        default:
+            pixel = qRgba(random.bounded(alpha + 1), random.bounded(alpha + 1), random.bounded(alpha + 1), alpha);
+            break;
+        }
+    }
+    std::vector<QRgb> scalarPixels = vectorPixels;
+
+    vectorKernels[filter](vectorPixels.data() + offset, pixels);
+    scalarKernels[filter](scalarPixels.data() + offset, pixels);
+
+    for (int i = 0; i < pixels + offset; ++i) {
+        QCOMPARE(vectorPixels[i], scalarPixels[i]);
+    }
+}
+
+QTEST_GUILESS_MAIN(ColorFiltersTest)
+#include "colorfilterstest.moc"
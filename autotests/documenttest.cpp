@@ -8,6 +8,7 @@
 */
 
 #include <QMimeDatabase>
+#include <QStandardPaths>
 #include <QTemporaryFile>
 #include <QTest>
 
@@ -28,7 +29,9 @@ class DocumentTest : public QObject
 
 private Q_SLOTS:
     void testCloseDuringRotationJob();
+    void testParallelRendering();
     void testDocdataMigration();
+    void testThumbnailStore();
     void testEvaluateKeystrokeEventChange_data();
     void testEvaluateKeystrokeEventChange();
 };
@@ -67,6 +70,41 @@ void DocumentTest::testCloseDuringRotationJob()
     delete dummyDocumentObserver;
 }
 
+// Test that asynchronous requests for all the pages end up rendered when the
+// generator renders several of them at the same time
+void DocumentTest::testParallelRendering()
+{
+    Okular::SettingsCore::instance(QStringLiteral("documenttest"));
+    Okular::SettingsCore::setRenderThreads(4);
+
+    Okular::Document *m_document = new Okular::Document(nullptr);
+    const QString testFile = QStringLiteral(KDESRCDIR "data/simple-multipage.pdf");
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile(testFile);
+
+    Okular::DocumentObserver *dummyDocumentObserver = new Okular::DocumentObserver();
+    m_document->addObserver(dummyDocumentObserver);
+
+    QCOMPARE(m_document->openDocument(testFile, QUrl(), mime), Okular::Document::OpenSuccess);
+    QVERIFY(m_document->pages() > 1);
+
+    QList<Okular::PixmapRequest *> requests;
+    for (uint i = 0; i < m_document->pages(); ++i) {
+        requests << new Okular::PixmapRequest(dummyDocumentObserver, i, 100, 100, 1, 1, Okular::PixmapRequest::Asynchronous);
+    }
+    m_document->requestPixmaps(requests);
+
+    for (uint i = 0; i < m_document->pages(); ++i) {
+        QTRY_VERIFY(m_document->page(i)->hasPixmap(dummyDocumentObserver, 100, 100));
+    }
+
+    m_document->closeDocument();
+    delete m_document;
+    delete dummyDocumentObserver;
+
+    Okular::SettingsCore::setRenderThreads(0);
+}
+
 // Test that, if there's a XML file in docdata referring to a document, we
 // detect that it must be migrated, that it doesn't get wiped out if you close
 // the document without migrating and that it does get wiped out after migrating
@@ -128,6 +166,68 @@ void DocumentTest::testDocdataMigration()
     delete m_document;
 }
 
+// Test that small renders are handed out without the generator the next time
+// the document is opened, and that the ones of refreshed pages are dropped
+void DocumentTest::testThumbnailStore()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    const QString storesDirectory = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/okular/thumbnails");
+    QDir(storesDirectory).removeRecursively();
+
+    Okular::SettingsCore::instance(QStringLiteral("documenttest"));
+    const int thumbnailStoreSize = Okular::SettingsCore::thumbnailStoreSize();
+    Okular::SettingsCore::setThumbnailStoreSize(10);
+
+    Okular::Document *m_document = new Okular::Document(nullptr);
+    const QString testFile = QStringLiteral(KDESRCDIR "data/simple-multipage.pdf");
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile(testFile);
+
+    Okular::DocumentObserver *dummyDocumentObserver = new Okular::DocumentObserver();
+    m_document->addObserver(dummyDocumentObserver);
+
+    auto requestFirstPages = [m_document, dummyDocumentObserver] {
+        QList<Okular::PixmapRequest *> requests;
+        requests << new Okular::PixmapRequest(dummyDocumentObserver, 0, 100, 100, 1, 1, Okular::PixmapRequest::Asynchronous);
+        requests << new Okular::PixmapRequest(dummyDocumentObserver, 1, 100, 100, 1, 1, Okular::PixmapRequest::Asynchronous);
+        m_document->requestPixmaps(requests);
+    };
+
+    // first session, the generator renders the pages
+    QCOMPARE(m_document->openDocument(testFile, QUrl::fromLocalFile(testFile), mime), Okular::Document::OpenSuccess);
+    requestFirstPages();
+    QTRY_VERIFY(m_document->page(0)->hasPixmap(dummyDocumentObserver, 100, 100));
+    QTRY_VERIFY(m_document->page(1)->hasPixmap(dummyDocumentObserver, 100, 100));
+    m_document->closeDocument();
+
+    // second session, the stored renders are decoded in the background and handed out
+    QCOMPARE(m_document->openDocument(testFile, QUrl::fromLocalFile(testFile), mime), Okular::Document::OpenSuccess);
+    requestFirstPages();
+    QTRY_VERIFY(m_document->page(0)->hasPixmap(dummyDocumentObserver, 100, 100));
+    QTRY_VERIFY(m_document->page(1)->hasPixmap(dummyDocumentObserver, 100, 100));
+
+    // the first page changes
+    m_document->refreshPixmaps(0);
+    QTRY_VERIFY(m_document->page(0)->hasPixmap(dummyDocumentObserver, 100, 100));
+    m_document->closeDocument();
+
+    // third session, only the second page is still stored
+    QCOMPARE(m_document->openDocument(testFile, QUrl::fromLocalFile(testFile), mime), Okular::Document::OpenSuccess);
+    requestFirstPages();
+    QTRY_VERIFY(m_document->page(0)->hasPixmap(dummyDocumentObserver, 100, 100));
+    QTRY_VERIFY(m_document->page(1)->hasPixmap(dummyDocumentObserver, 100, 100));
+    m_document->closeDocument();
+
+    // the three sessions rendered with the same settings share one store
+    QCOMPARE(QDir(storesDirectory).entryList(QDir::Dirs | QDir::NoDotAndDotDot).count(), 1);
+
+    delete m_document;
+    delete dummyDocumentObserver;
+
+    QDir(storesDirectory).removeRecursively();
+    Okular::SettingsCore::setThumbnailStoreSize(thumbnailStoreSize);
+}
+
 void DocumentTest::testEvaluateKeystrokeEventChange_data()
 {
     QTest::addColumn<QString>("oldVal");
@@ -0,0 +1,181 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QRandomGenerator>
+#include <QTest>
+
+#include "../core/area.h"
+#include "../core/utils.h"
+#include "../settings_core.h"
+
+class ImageBoundingBoxTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanup();
+    void testMatchesPixelScan_data();
+    void testMatchesPixelScan();
+    void testColumnNextToRightBound_data();
+    void testColumnNextToRightBound();
+};
+
+// The scan Utils::imageBoundingBox did with QImage::pixel(), except that the
+// right edge scan looks at the column next to the right bound too
+static Okular::NormalizedRect pixelScanBoundingBox(const QImage &image, QRgb paperColor)
+{
+    auto isPaper = [paperColor](QRgb argb) { return (argb & 0xFFFFFF) == (paperColor & 0xFFFFFF); };
+    const int width = image.width();
+    const int height = image.height();
+    int left, top, bottom, right, x;
+
+    for (top = 0; top < height; ++top) {
+        for (x = 0; x < width; ++x) {
+            if (!isPaper(image.pixel(x, top))) {
+                goto got_top;
+            }
+        }
+    }
+    return Okular::NormalizedRect(0, 0, 0, 0);
+got_top:
+    left = right = x;
+
+    for (bottom = height - 1; bottom >= top; --bottom) {
+        for (x = width - 1; x >= 0; --x) {
+            if (!isPaper(image.pixel(x, bottom))) {
+                goto got_bottom;
+            }
+        }
+    }
+got_bottom:
+    left = qMin(left, x);
+    right = qMax(right, x);
+
+    for (int y = top; y <= bottom && (left > 0 || right < width - 1); ++y) {
+        for (x = 0; x < left; ++x) {
+            if (!isPaper(image.pixel(x, y))) {
+                left = x;
+            }
+        }
+        for (x = width - 1; x > right; --x) {
+            if (!isPaper(image.pixel(x, y))) {
+                right = x;
+            }
+        }
+    }
+
+    return Okular::NormalizedRect(QRect(left, top, right - left + 1, bottom - top + 1), width, height);
+}
+
+void ImageBoundingBoxTest::initTestCase()
+{
+    Okular::SettingsCore::instance(QStringLiteral("imageboundingboxtest"));
+}
+
+void ImageBoundingBoxTest::cleanup()
+{
+    Okular::SettingsCore::setPaperColor(Qt::white);
+}
+
+void ImageBoundingBoxTest::testMatchesPixelScan_data()
+{
+    QTest::addColumn<QImage::Format>("format");
+    QTest::addColumn<int>("width");
+    QTest::addColumn<QColor>("paperColor");
+
+    const QList<QPair<const char *, QImage::Format>> formats = {
+        {"RGB32", QImage::Format_RGB32},
+        {"ARGB32", QImage::Format_ARGB32},
+        {"ARGB32 premultiplied", QImage::Format_ARGB32_Premultiplied},
+        {"RGB888", QImage::Format_RGB888},
+    };
+    // widths that are not a multiple of the vector widths leave pixels to the scalar loops
+    for (const auto &format : formats) {
+        for (int width : {1, 3, 4, 5, 7, 8, 9, 13, 16, 17, 31, 33, 67}) {
+            QTest::addRow("%s, width %d", format.first, width) << format.second << width << QColor(Qt::white);
+            QTest::addRow("%s, width %d, colored paper", format.first, width) << format.second << width << QColor(250, 240, 200);
+        }
+    }
+}
+
+// Random specks on the paper, some of them not opaque
+void ImageBoundingBoxTest::testMatchesPixelScan()
+{
+    QFETCH(QImage::Format, format);
+    QFETCH(int, width);
+    QFETCH(QColor, paperColor);
+
+    Okular::SettingsCore::setPaperColor(paperColor);
+    const QRgb paper = paperColor.rgb();
+    const bool hasAlpha = format == QImage::Format_ARGB32 || format == QImage::Format_ARGB32_Premultiplied;
+
+    QRandomGenerator random(width * 4 + int(format));
+    for (int round = 0; round < 50; ++round) {
+        const int height = 1 + random.bounded(20);
+        QImage image(width, height, format);
+        image.fill(paperColor);
+
+        const int specks = round == 0 ? 0 : 1 + random.bounded(4);
+        for (int i = 0; i < specks; ++i) {
+            const int x = random.bounded(width);
+            const int y = random.bounded(height);
+            if (!hasAlpha) {
+                image.setPixel(x, y, qRgb(random.bounded(256), random.bounded(256), 0));
+                continue;
+            }
+            // stored as is, without going through QImage::setPixel() conversions
+            QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+            switch (random.bounded(3)) {
+            case 0:
+                line[x] = qRgb(random.bounded(256), 0, random.bounded(256));
+                break;
+            case 1:
+                // the paper color with another alpha is still paper
+                line[x] = (paper & 0x00FFFFFF) | (quint32(random.bounded(255)) << 24);
+                break;
+            default:
+                // semi-transparent paper color, premultiplied
+                line[x] = qPremultiply(qRgba(qRed(paper), qGreen(paper), qBlue(paper), 1 + random.bounded(254)));
+                break;
+            }
+        }
+
+        QCOMPARE(Okular::Utils::imageBoundingBox(&image), pixelScanBoundingBox(image, paper));
+    }
+}
+
+void ImageBoundingBoxTest::testColumnNextToRightBound_data()
+{
+    QTest::addColumn<QImage::Format>("format");
+    QTest::addColumn<int>("width");
+
+    for (int width : {3, 5, 8, 9, 17, 33}) {
+        QTest::addRow("RGB32, width %d", width) << QImage::Format_RGB32 << width;
+        QTest::addRow("ARGB32 premultiplied, width %d", width) << QImage::Format_ARGB32_Premultiplied << width;
+        QTest::addRow("RGB888, width %d", width) << QImage::Format_RGB888 << width;
+    }
+}
+
+// The top and bottom rows set the right bound, a row in between has content one column further
+void ImageBoundingBoxTest::testColumnNextToRightBound()
+{
+    QFETCH(QImage::Format, format);
+    QFETCH(int, width);
+
+    QImage image(width, 5, format);
+    image.fill(Qt::white);
+    const int right = width / 2;
+    image.setPixel(right, 0, qRgb(0, 0, 0));
+    image.setPixel(right, 4, qRgb(0, 0, 0));
+    image.setPixel(right + 1, 2, qRgb(0, 0, 0));
+
+    QCOMPARE(Okular::Utils::imageBoundingBox(&image), Okular::NormalizedRect(QRect(right, 0, 2, 5), width, 5));
+    QCOMPARE(Okular::Utils::imageBoundingBox(&image), pixelScanBoundingBox(image, qRgb(255, 255, 255)));
+}
+
+QTEST_GUILESS_MAIN(ImageBoundingBoxTest)
+#include "imageboundingboxtest.moc"
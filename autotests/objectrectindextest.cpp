@@ -0,0 +1,113 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "core/area.h"
+#include "core/objectrectindex_p.h"
+#include <QRandomGenerator>
+
+#include <algorithm>
+#include <limits>
+
+class ObjectRectIndexTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void testCandidates();
+    void testNearest();
+
+private:
+    QList<Okular::ObjectRect *> m_rects;
+};
+
+static const double xScale = 800;
+static const double yScale = 1000;
+static const double maxDistanceSqr = 25;
+
+void ObjectRectIndexTest::init()
+{
+    // small links all over the page, a few overlapping ones and some past its border
+    QRandomGenerator random(42);
+    for (int i = 0; i < 1000; ++i) {
+        const double left = random.bounded(1.1) - 0.05;
+        const double top = random.bounded(1.1) - 0.05;
+        const double width = i % 100 == 0 ? 0.5 : random.bounded(0.05);
+        const double height = random.bounded(0.02);
+        const auto type = i % 10 == 0 ? Okular::ObjectRect::Image : Okular::ObjectRect::Action;
+        m_rects.append(new Okular::NonOwningObjectRect(left, top, left + width, top + height, false, type, nullptr));
+    }
+}
+
+void ObjectRectIndexTest::cleanup()
+{
+    qDeleteAll(m_rects);
+    m_rects.clear();
+}
+
+void ObjectRectIndexTest::testCandidates()
+{
+    const Okular::ObjectRectIndex index(m_rects, xScale, yScale);
+
+    QRandomGenerator random(7);
+    for (int i = 0; i < 2000; ++i) {
+        const double x = random.bounded(1.2) - 0.1;
+        const double y = random.bounded(1.2) - 0.1;
+
+        // every object rect that is hit is a candidate, last ones first
+        QList<int> hits;
+        for (int j = m_rects.count() - 1; j >= 0; --j) {
+            if (m_rects[j]->objectType() == Okular::ObjectRect::Action && m_rects[j]->distanceSqr(x, y, xScale, yScale) < maxDistanceSqr) {
+                hits.append(j);
+            }
+        }
+
+        const QList<int> candidates = index.candidates(Okular::ObjectRect::Action, x, y, xScale, yScale, maxDistanceSqr);
+        QVERIFY(std::is_sorted(candidates.begin(), candidates.end(), std::greater<int>()));
+        for (int hit : std::as_const(hits)) {
+            QVERIFY(candidates.contains(hit));
+        }
+        for (int candidate : candidates) {
+            QCOMPARE(m_rects[candidate]->objectType(), Okular::ObjectRect::Action);
+        }
+    }
+}
+
+void ObjectRectIndexTest::testNearest()
+{
+    const Okular::ObjectRectIndex index(m_rects, xScale, yScale);
+
+    QRandomGenerator random(11);
+    for (int i = 0; i < 2000; ++i) {
+        const double x = random.bounded(1.2) - 0.1;
+        const double y = random.bounded(1.2) - 0.1;
+
+        int expected = -1;
+        double expectedDistance = std::numeric_limits<double>::max();
+        for (int j = 0; j < m_rects.count(); ++j) {
+            const double d = m_rects[j]->distanceSqr(x, y, xScale, yScale);
+            if (m_rects[j]->objectType() == Okular::ObjectRect::Image && d < expectedDistance) {
+                expected = j;
+                expectedDistance = d;
+            }
+        }
+
+        double distance;
+        QCOMPARE(index.nearest(m_rects, Okular::ObjectRect::Image, x, y, xScale, yScale, &distance), expected);
+        QCOMPARE(distance, expectedDistance);
+    }
+
+    // nothing to find
+    double distance;
+    QCOMPARE(index.nearest(m_rects, Okular::ObjectRect::OAnnotation, 0.5, 0.5, xScale, yScale, &distance), -1);
+    QCOMPARE(distance, std::numeric_limits<double>::max());
+}
+
+QTEST_GUILESS_MAIN(ObjectRectIndexTest)
+#include "objectrectindextest.moc"
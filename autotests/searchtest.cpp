@@ -41,6 +41,8 @@ private Q_SLOTS:
     void initTestCase();
     void testNextAndPrevious();
     void test311232();
+    void testAllDocument();
+    void testAllDocumentCancel();
     void test323262();
     void test323263();
     void test430243();
@@ -48,6 +50,8 @@ private Q_SLOTS:
     void testHyphenAtEndOfLineWithoutYOverlap();
     void testHyphenWithYOverlap();
     void testHyphenAtEndOfPage();
+    void testHyphenBetweenMatches();
+    void testPreviousReversesNext();
     void testOneColumn();
     void testTwoColumns();
 };
@@ -183,6 +187,65 @@ void SearchTest::test311232()
     QCOMPARE(receiver.m_status, Okular::Document::NoMatchFound);
 }
 
+void SearchTest::testAllDocument()
+{
+    Okular::Document d(nullptr);
+    SearchFinishedReceiver receiver;
+    QSignalSpy spy(&d, &Okular::Document::searchFinished);
+
+    QObject::connect(&d, &Okular::Document::searchFinished, &receiver, &SearchFinishedReceiver::searchFinished);
+
+    const QString testFile = QStringLiteral(KDESRCDIR "data/simple-multipage.pdf");
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile(testFile);
+    d.openDocument(testFile, QUrl(), mime);
+
+    // the pages are searched by several threads, check the matches end up in the right pages
+    const int searchId = 0;
+    d.searchText(searchId, QStringLiteral("Page 40"), true, Qt::CaseSensitive, Okular::Document::AllDocument, false, QColor());
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(receiver.m_id, searchId);
+    QCOMPARE(receiver.m_status, Okular::Document::MatchFound);
+    for (uint i = 0; i < d.pages(); ++i) {
+        QCOMPARE(d.page(i)->hasHighlights(searchId), i == d.pages() - 1);
+    }
+
+    d.searchText(searchId, QStringLiteral("Page"), true, Qt::CaseSensitive, Okular::Document::GoogleAny, false, Qt::yellow);
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(receiver.m_status, Okular::Document::MatchFound);
+    for (uint i = 0; i < d.pages(); ++i) {
+        QVERIFY(d.page(i)->hasHighlights(searchId));
+    }
+
+    d.searchText(searchId, QStringLiteral("Page nothere"), true, Qt::CaseSensitive, Okular::Document::GoogleAll, false, Qt::yellow);
+    QTRY_COMPARE(spy.count(), 3);
+    QCOMPARE(receiver.m_status, Okular::Document::NoMatchFound);
+    for (uint i = 0; i < d.pages(); ++i) {
+        QVERIFY(!d.page(i)->hasHighlights(searchId));
+    }
+}
+
+void SearchTest::testAllDocumentCancel()
+{
+    Okular::Document d(nullptr);
+    SearchFinishedReceiver receiver;
+    QSignalSpy spy(&d, &Okular::Document::searchFinished);
+
+    QObject::connect(&d, &Okular::Document::searchFinished, &receiver, &SearchFinishedReceiver::searchFinished);
+
+    const QString testFile = QStringLiteral(KDESRCDIR "data/simple-multipage.pdf");
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile(testFile);
+    d.openDocument(testFile, QUrl(), mime);
+
+    const int searchId = 0;
+    d.searchText(searchId, QStringLiteral("Page"), true, Qt::CaseSensitive, Okular::Document::AllDocument, false, QColor());
+    d.cancelSearch();
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(receiver.m_id, searchId);
+    QCOMPARE(receiver.m_status, Okular::Document::SearchCancelled);
+}
+
 void SearchTest::test323262()
 {
     QVector<QString> text;
@@ -380,6 +443,70 @@ void SearchTest::testHyphenAtEndOfPage()
     delete page;
 }
 
+void SearchTest::testHyphenBetweenMatches()
+{
+    // Matches in the text as it is and matches omitting a hyphen
+    // are found in order when stepping through the results
+
+    QVector<QString> text;
+    text << QStringLiteral("foobar") << QStringLiteral("foo-") << QStringLiteral("bar") << QStringLiteral("foobar");
+
+    QVector<Okular::NormalizedRect> rect;
+    rect << Okular::NormalizedRect(0.0, 0.0, 0.6, 0.1) << Okular::NormalizedRect(0.0, 0.2, 0.4, 0.3) << Okular::NormalizedRect(0.0, 0.4, 0.3, 0.5) << Okular::NormalizedRect(0.0, 0.6, 0.6, 0.7);
+
+    CREATE_PAGE;
+
+    const QString searchString = QStringLiteral("foobar");
+    TEST_NEXT_PREV(Okular::FromTop, true);
+    TEST_NEXT_PREV(Okular::NextResult, true);
+    TEST_NEXT_PREV(Okular::NextResult, true);
+    TEST_NEXT_PREV(Okular::NextResult, false);
+
+    TEST_NEXT_PREV(Okular::FromBottom, true);
+    TEST_NEXT_PREV(Okular::PreviousResult, true);
+    TEST_NEXT_PREV(Okular::PreviousResult, true);
+    TEST_NEXT_PREV(Okular::PreviousResult, false);
+
+    delete page;
+}
+
+void SearchTest::testPreviousReversesNext()
+{
+    // Stepping backward finds the same matches as stepping forward, in the
+    // reverse order, also the ones omitting a hyphen
+
+    QVector<QString> text;
+    QVector<Okular::NormalizedRect> rect;
+    for (int i = 0; i < 8; i++) {
+        text << QStringLiteral("foo") << QStringLiteral("barfoo-") << QStringLiteral("bar") << QStringLiteral("xfoobarfoobar");
+        for (int line = 0; line < 4; line++) {
+            const double top = (i * 4 + line) * 0.03;
+            rect << Okular::NormalizedRect(0.0, top, 0.8, top + 0.02);
+        }
+    }
+
+    CREATE_PAGE;
+
+    const QString searchString = QStringLiteral("FooBar");
+    QList<Okular::RegularAreaRect> forward;
+    for (Okular::RegularAreaRect *result = tp->findText(0, searchString, Okular::FromTop, Qt::CaseInsensitive, nullptr); result;
+         result = tp->findText(0, searchString, Okular::NextResult, Qt::CaseInsensitive, nullptr)) {
+        forward.prepend(*result);
+        delete result;
+    }
+    QList<Okular::RegularAreaRect> backward;
+    for (Okular::RegularAreaRect *result = tp->findText(0, searchString, Okular::FromBottom, Qt::CaseInsensitive, nullptr); result;
+         result = tp->findText(0, searchString, Okular::PreviousResult, Qt::CaseInsensitive, nullptr)) {
+        backward.append(*result);
+        delete result;
+    }
+
+    QCOMPARE(forward.count(), 8 * 4);
+    QCOMPARE(backward, forward);
+
+    delete page;
+}
+
 void SearchTest::testOneColumn()
 {
     // Tests that the layout analysis algorithm does not create too many columns.
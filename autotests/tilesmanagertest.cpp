@@ -0,0 +1,78 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "core/tile.h"
+#include "core/tilesmanager_p.h"
+#include <QImage>
+
+class TilesManagerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testMarkDirtyRect();
+    void testMarkDirtyRectAcrossTiles();
+
+private:
+    static int invalidTileCount(Okular::TilesManager &tilesManager);
+};
+
+int TilesManagerTest::invalidTileCount(Okular::TilesManager &tilesManager)
+{
+    int count = 0;
+    const QList<Okular::Tile> tiles = tilesManager.tilesAt(Okular::NormalizedRect(0., 0., 1., 1.), Okular::TilesManager::TerminalTile);
+    for (const Okular::Tile &tile : tiles) {
+        if (!tile.isValid()) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void TilesManagerTest::testMarkDirtyRect()
+{
+    Okular::TilesManager tilesManager(0, 1000, 1000);
+    QImage image(1000, 1000, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    tilesManager.setImage(image, Okular::NormalizedRect(0., 0., 1., 1.), false /*isPartialPixmap*/);
+    QVERIFY(tilesManager.hasPixmap(Okular::NormalizedRect(0., 0., 1., 1.)));
+
+    // only the tile under the damage has to be rendered again
+    const Okular::NormalizedRect dirtyRect = tilesManager.markDirty(Okular::NormalizedRect(0.55, 0.3, 0.6, 0.35));
+    QVERIFY(dirtyRect == Okular::NormalizedRect(0.5, 0.25, 0.75, 0.5));
+    QCOMPARE(invalidTileCount(tilesManager), 1);
+    QVERIFY(!tilesManager.hasPixmap(Okular::NormalizedRect(0., 0., 1., 1.)));
+    QVERIFY(tilesManager.hasPixmap(Okular::NormalizedRect(0., 0., 0.5, 1.)));
+
+    // rendering the dirty rect makes the page whole again
+    QImage tileImage(250, 250, QImage::Format_ARGB32_Premultiplied);
+    tileImage.fill(Qt::red);
+    tilesManager.setImage(tileImage, dirtyRect, false /*isPartialPixmap*/);
+    QCOMPARE(invalidTileCount(tilesManager), 0);
+    QVERIFY(tilesManager.hasPixmap(Okular::NormalizedRect(0., 0., 1., 1.)));
+}
+
+void TilesManagerTest::testMarkDirtyRectAcrossTiles()
+{
+    Okular::TilesManager tilesManager(0, 1000, 1000);
+    QImage image(1000, 1000, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    tilesManager.setImage(image, Okular::NormalizedRect(0., 0., 1., 1.), false /*isPartialPixmap*/);
+
+    const Okular::NormalizedRect dirtyRect = tilesManager.markDirty(Okular::NormalizedRect(0.2, 0.2, 0.3, 0.3));
+    QVERIFY(dirtyRect == Okular::NormalizedRect(0., 0., 0.5, 0.5));
+    QCOMPARE(invalidTileCount(tilesManager), 4);
+
+    // a rect only touching the edge of a tile leaves it alone
+    tilesManager.setImage(image, Okular::NormalizedRect(0., 0., 1., 1.), false /*isPartialPixmap*/);
+    QVERIFY(tilesManager.markDirty(Okular::NormalizedRect(0.25, 0.1, 0.25, 0.2)).isNull());
+    QCOMPARE(invalidTileCount(tilesManager), 0);
+}
+
+QTEST_MAIN(TilesManagerTest)
+#include "tilesmanagertest.moc"
@@ -0,0 +1,147 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "allocatedpixmapindex_p.h"
+
+#include "observer.h"
+
+#include <iterator>
+
+using namespace Okular;
+
+AllocatedPixmapIndex::AllocatedPixmapIndex()
+    : m_count(0)
+{
+}
+
+AllocatedPixmapIndex::~AllocatedPixmapIndex()
+{
+    clear();
+}
+
+bool AllocatedPixmapIndex::isEmpty() const
+{
+    return m_count == 0;
+}
+
+int AllocatedPixmapIndex::count() const
+{
+    return m_count;
+}
+
+void AllocatedPixmapIndex::insert(AllocatedPixmap *pixmap)
+{
+    AllocatedPixmap *&slot = m_pixmaps[pixmap->observer][pixmap->page];
+    if (slot) {
+        delete slot;
+    } else {
+        ++m_count;
+    }
+    slot = pixmap;
+}
+
+AllocatedPixmap *AllocatedPixmapIndex::find(const DocumentObserver *observer, int page) const
+{
+    const auto oIt = m_pixmaps.find(observer);
+    if (oIt == m_pixmaps.end()) {
+        return nullptr;
+    }
+
+    const auto pIt = oIt->second.find(page);
+    return pIt != oIt->second.end() ? pIt->second : nullptr;
+}
+
+AllocatedPixmap *AllocatedPixmapIndex::take(const DocumentObserver *observer, int page)
+{
+    const auto oIt = m_pixmaps.find(observer);
+    if (oIt == m_pixmaps.end()) {
+        return nullptr;
+    }
+
+    const auto pIt = oIt->second.find(page);
+    if (pIt == oIt->second.end()) {
+        return nullptr;
+    }
+
+    AllocatedPixmap *pixmap = pIt->second;
+    oIt->second.erase(pIt);
+    if (oIt->second.empty()) {
+        m_pixmaps.erase(oIt);
+    }
+    --m_count;
+    return pixmap;
+}
+
+void AllocatedPixmapIndex::removeObserver(const DocumentObserver *observer)
+{
+    const auto oIt = m_pixmaps.find(observer);
+    if (oIt == m_pixmaps.end()) {
+        return;
+    }
+
+    for (const auto &entry : oIt->second) {
+        delete entry.second;
+    }
+    m_count -= static_cast<int>(oIt->second.size());
+    m_pixmaps.erase(oIt);
+}
+
+AllocatedPixmap *AllocatedPixmapIndex::farthest(int viewportPage, bool unloadableOnly, const DocumentObserver *observer) const
+{
+    AllocatedPixmap *farthestPixmap = nullptr;
+    int maxDistance = -1;
+
+    for (const auto &observerPixmaps : m_pixmaps) {
+        // Filter by observer
+        if (observer != nullptr && observerPixmaps.first != observer) {
+            continue;
+        }
+
+        // Walk from both ends towards the viewport page, so pixmaps are visited
+        // from the farthest to the nearest one
+        const std::map<int, AllocatedPixmap *> &pages = observerPixmaps.second;
+        auto low = pages.begin();
+        auto high = pages.end();
+        while (low != high) {
+            const auto last = std::prev(high);
+            const int lowDistance = qAbs(low->first - viewportPage);
+            const int highDistance = qAbs(last->first - viewportPage);
+            const bool takeLow = lowDistance >= highDistance;
+            const int distance = takeLow ? lowDistance : highDistance;
+
+            // nothing left in this observer can beat what we already have
+            if (distance <= maxDistance) {
+                break;
+            }
+
+            AllocatedPixmap *p = takeLow ? low->second : last->second;
+            if (!unloadableOnly || p->observer->canUnloadPixmap(p->page)) {
+                maxDistance = distance;
+                farthestPixmap = p;
+                break;
+            }
+
+            if (takeLow) {
+                ++low;
+            } else {
+                high = last;
+            }
+        }
+    }
+
+    return farthestPixmap;
+}
+
+void AllocatedPixmapIndex::clear()
+{
+    for (const auto &observerPixmaps : m_pixmaps) {
+        for (const auto &entry : observerPixmaps.second) {
+            delete entry.second;
+        }
+    }
+    m_pixmaps.clear();
+    m_count = 0;
+}
@@ -0,0 +1,102 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_ALLOCATEDPIXMAPINDEX_P_H_
+#define _OKULAR_ALLOCATEDPIXMAPINDEX_P_H_
+
+#include "okularcore_export.h"
+
+#include <QtGlobal>
+
+#include <map>
+
+namespace Okular
+{
+class DocumentObserver;
+}
+
+struct AllocatedPixmap {
+    // owner of the page
+    Okular::DocumentObserver *observer;
+    int page;
+    qulonglong memory;
+    // public constructor: initialize data
+    AllocatedPixmap(Okular::DocumentObserver *o, int p, qulonglong m)
+        : observer(o)
+        , page(p)
+        , memory(m)
+    {
+    }
+};
+
+namespace Okular
+{
+/**
+ * Keeps the allocation descriptors of the pixmaps in cache, indexed by
+ * observer and page.
+ *
+ * The pixmaps of each observer are kept sorted by page number, so the
+ * farthest pixmap from the viewport is always at one of the two ends and
+ * finding the next one to evict takes logarithmic time. Since the order does
+ * not depend on the viewport, nothing has to be updated when it moves.
+ *
+ * The index owns the descriptors it contains.
+ */
+class OKULARCORE_EXPORT AllocatedPixmapIndex
+{
+public:
+    AllocatedPixmapIndex();
+    ~AllocatedPixmapIndex();
+
+    bool isEmpty() const;
+    int count() const;
+
+    /**
+     * Adds @p pixmap to the index, replacing (and deleting) any previous
+     * descriptor for the same observer and page.
+     */
+    void insert(AllocatedPixmap *pixmap);
+
+    /**
+     * Returns the descriptor for @p page of @p observer, or nullptr.
+     */
+    AllocatedPixmap *find(const DocumentObserver *observer, int page) const;
+
+    /**
+     * Removes the descriptor for @p page of @p observer from the index and
+     * returns it, the caller takes ownership.
+     */
+    AllocatedPixmap *take(const DocumentObserver *observer, int page);
+
+    /**
+     * Removes and deletes all the descriptors of @p observer.
+     */
+    void removeObserver(const DocumentObserver *observer);
+
+    /**
+     * Returns the pixmap farthest from @p viewportPage, optionally only
+     * considering the ones of @p observer and the ones their observer can
+     * unload. Returns nullptr if there's no suitable pixmap.
+     */
+    AllocatedPixmap *farthest(int viewportPage, bool unloadableOnly, const DocumentObserver *observer = nullptr) const;
+
+    /**
+     * Removes and deletes all the descriptors.
+     */
+    void clear();
+
+private:
+    Q_DISABLE_COPY(AllocatedPixmapIndex)
+
+    std::map<const DocumentObserver *, std::map<int, AllocatedPixmap *>> m_pixmaps;
+    int m_count;
+};
+
+}
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
@@ -935,6 +935,11 @@ void AnnotationPrivate::annotationTransform(const QTransform &matrix)
 void AnnotationPrivate::transform(const QTransform &matrix)
 {
     m_transformedBoundary.transform(matrix);
+
+    // the annotation moved on its page
+    if (m_page) {
+        m_page->invalidateObjectRectIndex();
+    }
 }
 
 void AnnotationPrivate::baseTransform(const QTransform &matrix)
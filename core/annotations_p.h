@@ -68,6 +68,8 @@ public:
     int m_flags;
     NormalizedRect m_boundary;
     NormalizedRect m_transformedBoundary;
+    // m_boundary when the page pixmaps were last rendered with the annotation
+    NormalizedRect m_drawnBoundary;
 
     Okular::Annotation::Style m_style;
     Okular::Annotation::Window m_window;
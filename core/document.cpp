@@ -73,6 +73,7 @@
 #include "chooseenginedialog_p.h"
 #include "debug_p.h"
 #include "form.h"
+#include "formcalculationgraph_p.h"
 #include "generator_p.h"
 #include "interfaces/configinterface.h"
 #include "interfaces/guiinterface.h"
@@ -89,6 +90,8 @@
 #include "sourcereference.h"
 #include "sourcereference_p.h"
 #include "texteditors_p.h"
+#include "textsearchjob_p.h"
+#include "thumbnailstore_p.h"
 #include "tile.h"
 #include "tilesmanager_p.h"
 #include "utils.h"
@@ -104,20 +107,6 @@
 
 using namespace Okular;
 
-struct AllocatedPixmap {
-    // owner of the page
-    DocumentObserver *observer;
-    int page;
-    qulonglong memory;
-    // public constructor: initialize data
-    AllocatedPixmap(DocumentObserver *o, int p, qulonglong m)
-        : observer(o)
-        , page(p)
-        , memory(m)
-    {
-    }
-};
-
 struct ArchiveData {
     ArchiveData()
     {
@@ -144,6 +133,24 @@ struct RunningSearch {
     int pagesDone;
 };
 
+struct AllDocumentSearch {
+    // pages searched on the GUI thread before going back to the event loop
+    static const int PagesPerStep = 50;
+    // pages extracted and searched by each TextSearchJob
+    static const int PagesPerJob = 8;
+
+    TextSearchParameters parameters;
+    // pages whose highlights were removed when the search started
+    QSet<int> pagesToNotify;
+    // matches of the pages already searched but not highlighted yet
+    QMap<int, QVector<TextSearchMatch>> pendingMatches;
+    // pages without a TextPage waiting for the next TextSearchJob
+    QVector<Page *> pagesToExtract;
+    int nextPageToMerge = 0;
+    bool foundAMatch = false;
+    bool finished = false;
+};
+
 #define foreachObserver(cmd)                                                                                                                                                                                                                   \
     {                                                                                                                                                                                                                                          \
         QSet<DocumentObserver *>::const_iterator it = d->m_observers.constBegin(), end = d->m_observers.constEnd();                                                                                                                            \
@@ -391,7 +398,9 @@ void DocumentPrivate::cleanupPixmapMemory(qulonglong memoryToFree)
         }
     }
 
-    m_allocatedPixmaps.splice(m_allocatedPixmaps.end(), pixmapsToKeep);
+    for (AllocatedPixmap *p : pixmapsToKeep) {
+        m_allocatedPixmaps.insert(p);
+    }
     Q_UNUSED(pagesFreed);
     // p--rintf("freeMemory A:[%d -%d = %d] \n", m_allocatedPixmaps.count() + pagesFreed, pagesFreed, m_allocatedPixmaps.count() );
 }
@@ -403,34 +412,18 @@ void DocumentPrivate::cleanupPixmapMemory(qulonglong memoryToFree)
  */
 AllocatedPixmap *DocumentPrivate::searchLowestPriorityPixmap(bool unloadableOnly, bool thenRemoveIt, DocumentObserver *observer)
 {
-    std::list<AllocatedPixmap *>::iterator pIt = m_allocatedPixmaps.begin();
-    std::list<AllocatedPixmap *>::iterator pEnd = m_allocatedPixmaps.end();
-    std::list<AllocatedPixmap *>::iterator farthestPixmap = pEnd;
     const int currentViewportPage = (*m_viewportIterator).pageNumber;
 
     /* Find the pixmap that is farthest from the current viewport */
-    int maxDistance = -1;
-    while (pIt != pEnd) {
-        const AllocatedPixmap *p = *pIt;
-        // Filter by observer
-        if (observer == nullptr || p->observer == observer) {
-            const int distance = qAbs(p->page - currentViewportPage);
-            if (maxDistance < distance && (!unloadableOnly || p->observer->canUnloadPixmap(p->page))) {
-                maxDistance = distance;
-                farthestPixmap = pIt;
-            }
-        }
-        ++pIt;
-    }
+    AllocatedPixmap *selectedPixmap = m_allocatedPixmaps.farthest(currentViewportPage, unloadableOnly, observer);
 
     /* No pixmap to remove */
-    if (farthestPixmap == pEnd) {
+    if (!selectedPixmap) {
         return nullptr;
     }
 
-    AllocatedPixmap *selectedPixmap = *farthestPixmap;
     if (thenRemoveIt) {
-        m_allocatedPixmaps.erase(farthestPixmap);
+        m_allocatedPixmaps.take(selectedPixmap->observer, selectedPixmap->page);
     }
     return selectedPixmap;
 }
@@ -1079,8 +1072,8 @@ void DocumentPrivate::performAddPageAnnotation(int page, Annotation *annotation)
     notifyAnnotationChanges(page);
 
     if (annotation->flags() & Annotation::ExternallyDrawn) {
-        // Redraw everything, including ExternallyDrawn annotations
-        refreshPixmaps(page);
+        // Redraw the part of the page with the annotation
+        refreshPixmaps(page, annotationDamage(kp, annotation));
     }
 }
 
@@ -1089,6 +1082,7 @@ void DocumentPrivate::performRemovePageAnnotation(int page, Annotation *annotati
     Okular::SaveInterface *iface = qobject_cast<Okular::SaveInterface *>(m_generator);
     AnnotationProxy *proxy = iface ? iface->annotationProxy() : nullptr;
     bool isExternallyDrawn;
+    NormalizedRect damagedRect;
 
     // find out the page
     Page *kp = m_pagesVector[page];
@@ -1098,6 +1092,7 @@ void DocumentPrivate::performRemovePageAnnotation(int page, Annotation *annotati
 
     if (annotation->flags() & Annotation::ExternallyDrawn) {
         isExternallyDrawn = true;
+        damagedRect = annotationDamage(kp, annotation);
     } else {
         isExternallyDrawn = false;
     }
@@ -1115,8 +1110,8 @@ void DocumentPrivate::performRemovePageAnnotation(int page, Annotation *annotati
         notifyAnnotationChanges(page);
 
         if (isExternallyDrawn) {
-            // Redraw everything, including ExternallyDrawn annotations
-            refreshPixmaps(page);
+            // Redraw the part of the page the annotation was on
+            refreshPixmaps(page, damagedRect);
         }
     }
 }
@@ -1152,9 +1147,10 @@ void DocumentPrivate::performModifyPageAnnotation(int page, Annotation *annotati
             m_annotationBeingModified = false;
         }
 
-        // Redraw everything, including ExternallyDrawn annotations
-        qCDebug(OkularCoreDebug) << "Refreshing Pixmaps";
-        refreshPixmaps(page);
+        // Redraw where the annotation was and where it is now
+        const NormalizedRect damagedRect = annotationDamage(kp, annotation);
+        qCDebug(OkularCoreDebug) << "Refreshing Pixmaps in" << damagedRect;
+        refreshPixmaps(page, damagedRect);
     }
 }
 
@@ -1191,62 +1187,92 @@ void DocumentPrivate::performSetAnnotationContents(const QString &newContents, A
     performModifyPageAnnotation(pageNumber, annot, appearanceChanged);
 }
 
-void DocumentPrivate::recalculateForms()
-{
-    const QVariant fco = m_parent->metaData(QStringLiteral("FormCalculateOrder"));
-    const QVector<int> formCalculateOrder = fco.value<QVector<int>>();
-    for (int formId : formCalculateOrder) {
-        for (uint pageIdx = 0; pageIdx < m_parent->pages(); pageIdx++) {
-            const Page *p = m_parent->page(pageIdx);
-            if (p) {
-                bool pageNeedsRefresh = false;
-                const QList<Okular::FormField *> forms = p->formFields();
-                for (FormField *form : forms) {
-                    if (form->id() == formId) {
-                        const Action *action = form->additionalAction(FormField::CalculateField);
-                        if (action) {
-                            FormFieldText *fft = dynamic_cast<FormFieldText *>(form);
-                            std::shared_ptr<Event> event;
-                            QString oldVal;
-                            if (fft) {
-                                // Prepare text calculate event
-                                event = Event::createFormCalculateEvent(fft, m_pagesVector[pageIdx]);
-                                if (!m_scripter) {
-                                    m_scripter = new Scripter(this);
-                                }
-                                m_scripter->setEvent(event.get());
-                                // The value maybe changed in javascript so save it first.
-                                oldVal = fft->text();
-                            }
+void DocumentPrivate::recalculateForms(const QList<FormField *> &changedFields)
+{
+    if (!m_formCalculationGraph) {
+        const QVariant fco = m_parent->metaData(QStringLiteral("FormCalculateOrder"));
+        m_formCalculationGraph = new FormCalculationGraph(m_pagesVector, fco.value<QVector<int>>());
+    }
 
-                            m_parent->processAction(action);
-                            if (event && fft) {
-                                // Update text field from calculate
-                                m_scripter->setEvent(nullptr);
-                                const QString newVal = event->value().toString();
-                                if (newVal != oldVal) {
-                                    fft->setText(newVal);
-                                    fft->setAppearanceText(newVal);
-                                    if (const Okular::Action *action = fft->additionalAction(Okular::FormField::FormatField)) {
-                                        // The format action handles the refresh.
-                                        m_parent->processFormatAction(action, form);
-                                    } else {
-                                        Q_EMIT m_parent->refreshFormWidget(fft);
-                                        pageNeedsRefresh = true;
-                                    }
-                                }
-                            }
-                        } else {
-                            qWarning() << "Form that is part of calculate order doesn't have a calculate action";
-                        }
-                    }
-                }
-                if (pageNeedsRefresh) {
-                    refreshPixmaps(p->number());
+    // the names of the fields changed so far, by the user or by calculations
+    QSet<QString> changedNames;
+    for (const FormField *field : changedFields) {
+        changedNames.insert(field->fullyQualifiedName());
+    }
+
+    m_batchingFormRefreshes = true;
+    const QVector<FormCalculationGraph::CalculatedField> &calculatedFields = m_formCalculationGraph->calculatedFields();
+    for (const FormCalculationGraph::CalculatedField &calculatedField : calculatedFields) {
+        if (!changedFields.isEmpty() && !FormCalculationGraph::readsAnyOf(calculatedField, changedNames)) {
+            continue;
+        }
+
+        FormField *form = calculatedField.field;
+        const int pageIdx = calculatedField.page;
+        const Action *action = form->additionalAction(FormField::CalculateField);
+        FormFieldText *fft = dynamic_cast<FormFieldText *>(form);
+        std::shared_ptr<Event> event;
+        QString oldVal;
+        if (fft) {
+            // Prepare text calculate event
+            event = Event::createFormCalculateEvent(fft, m_pagesVector[pageIdx]);
+            if (!m_scripter) {
+                m_scripter = new Scripter(this);
+            }
+            m_scripter->setEvent(event.get());
+            // The value maybe changed in javascript so save it first.
+            oldVal = fft->text();
+        }
+
+        m_parent->processAction(action);
+        // the calculation may have changed the value, even through the fields API
+        changedNames.insert(form->fullyQualifiedName());
+        if (event && fft) {
+            // Update text field from calculate
+            m_scripter->setEvent(nullptr);
+            const QString newVal = event->value().toString();
+            if (newVal != oldVal) {
+                fft->setText(newVal);
+                fft->setAppearanceText(newVal);
+                if (const Okular::Action *action = fft->additionalAction(Okular::FormField::FormatField)) {
+                    // The format action handles the refresh.
+                    m_parent->processFormatAction(action, form);
+                } else {
+                    Q_EMIT m_parent->refreshFormWidget(fft);
+                    refreshFormPixmaps(pageIdx, fft);
                 }
             }
         }
     }
+    m_batchingFormRefreshes = false;
+
+    const QHash<int, NormalizedRect> damagedRects = m_formRefreshRects;
+    m_formRefreshRects.clear();
+    for (auto it = damagedRects.cbegin(); it != damagedRects.cend(); ++it) {
+        refreshPixmaps(it.key(), it.value());
+    }
+}
+
+void DocumentPrivate::refreshFormPixmaps(int page, const FormField *field)
+{
+    const Page *kp = m_pagesVector.value(page);
+    if (!kp) {
+        return;
+    }
+
+    NormalizedRect damagedRect = field->rect();
+    damagedRect.transform(kp->d->rotationMatrix());
+
+    if (m_batchingFormRefreshes) {
+        auto it = m_formRefreshRects.find(page);
+        if (it == m_formRefreshRects.end()) {
+            m_formRefreshRects.insert(page, damagedRect);
+        } else {
+            it.value() |= damagedRect;
+        }
+    } else {
+        refreshPixmaps(page, damagedRect);
+    }
 }
 
 void DocumentPrivate::saveDocumentInfo() const
@@ -1367,10 +1393,18 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
     // find a request
     PixmapRequest *request = nullptr;
     m_pixmapRequestsMutex.lock();
-    while (!m_pixmapRequestsStack.empty() && !request) {
-        PixmapRequest *r = m_pixmapRequestsStack.back();
+    std::list<PixmapRequest *>::iterator rIt = m_pixmapRequestsStack.end();
+    while (rIt != m_pixmapRequestsStack.begin() && !request) {
+        --rIt;
+        PixmapRequest *r = *rIt;
         if (!r) {
-            m_pixmapRequestsStack.pop_back();
+            rIt = m_pixmapRequestsStack.erase(rIt);
+            continue;
+        }
+
+        // Generators that render in parallel may still be busy with another request
+        // for the same page and observer, leave this one in the stack until it's done
+        if (isPixmapRequestExecuting(r->observer(), r->pageNumber())) {
             continue;
         }
 
@@ -1394,33 +1428,33 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
 
         // If it's a preload but the generator is not threaded no point in trying to preload
         if (r->preload() && !m_generator->hasFeature(Generator::Threaded)) {
-            m_pixmapRequestsStack.pop_back();
+            rIt = m_pixmapRequestsStack.erase(rIt);
             delete r;
         }
         // request only if page isn't already present and request has valid id
         else if ((!r->d->mForce && r->page()->hasPixmap(r->observer(), r->width(), r->height(), r->normalizedRect())) || !m_observers.contains(r->observer())) {
-            m_pixmapRequestsStack.pop_back();
+            rIt = m_pixmapRequestsStack.erase(rIt);
             delete r;
         } else if (!r->d->mForce && r->preload() && qAbs(r->pageNumber() - currentViewportPage) >= maxDistance) {
-            m_pixmapRequestsStack.pop_back();
+            rIt = m_pixmapRequestsStack.erase(rIt);
             // qCDebug(OkularCoreDebug) << "Ignoring request that doesn't fit in cache";
             delete r;
         }
         // Ignore requests for pixmaps that are already being generated
         else if (tilesManager && tilesManager->isRequesting(r->normalizedRect(), r->width(), r->height())) {
-            m_pixmapRequestsStack.pop_back();
+            rIt = m_pixmapRequestsStack.erase(rIt);
             delete r;
         }
         // If the requested area is above 4*screenSize pixels, and we're not rendering most of the page,  switch on the tile manager
-        else if (!tilesManager && m_generator->hasFeature(Generator::TiledRendering) && (long)r->width() * (long)r->height() > 4L * screenSize && normalizedArea < 0.75) {
+        else if (!tilesManager && !r->isTile() && m_generator->hasFeature(Generator::TiledRendering) && (long)r->width() * (long)r->height() > 4L * screenSize && normalizedArea < 0.75) {
             // if the image is too big. start using tiles
             qCDebug(OkularCoreDebug).nospace() << "Start using tiles on page " << r->pageNumber() << " (" << r->width() << "x" << r->height() << " px);";
 
             // fill the tiles manager with the last rendered pixmap
-            const QPixmap *pixmap = r->page()->_o_nearestPixmap(r->observer(), r->width(), r->height());
-            if (pixmap) {
-                tilesManager = new TilesManager(r->pageNumber(), pixmap->width(), pixmap->height(), r->page()->rotation());
-                tilesManager->setPixmap(pixmap, NormalizedRect(0, 0, 1, 1), true /*isPartialPixmap*/);
+            const QImage image = r->page()->_o_nearestImage(r->observer(), r->width(), r->height());
+            if (!image.isNull()) {
+                tilesManager = new TilesManager(r->pageNumber(), image.width(), image.height(), r->page()->rotation());
+                tilesManager->setImage(image, NormalizedRect(0, 0, 1, 1), true /*isPartialPixmap*/);
                 tilesManager->setSize(r->width(), r->height());
             } else {
                 // create new tiles manager
@@ -1455,7 +1489,7 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
                 // preload requests issued by PageView if the requested page is
                 // not visible and the user has just switched from a non-tiled
                 // zoom level to a tiled one
-                m_pixmapRequestsStack.pop_back();
+                rIt = m_pixmapRequestsStack.erase(rIt);
                 delete r;
             }
         }
@@ -1469,7 +1503,7 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
 
             request = r;
         } else if ((long)requestRect.width() * (long)requestRect.height() > 100L * screenSize && (SettingsCore::memoryLevel() != SettingsCore::EnumMemoryLevel::Greedy)) {
-            m_pixmapRequestsStack.pop_back();
+            rIt = m_pixmapRequestsStack.erase(rIt);
             if (!m_warnedOutOfMemory) {
                 qCWarning(OkularCoreDebug).nospace() << "Running out of memory on page " << r->pageNumber() << " (" << r->width() << "x" << r->height() << " px);";
                 qCWarning(OkularCoreDebug) << "this message will be reported only once.";
@@ -1511,12 +1545,17 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
             tm->setRequest(request->normalizedRect(), request->width(), request->height());
         }
 
-        if ((int)m_rotation % 2) {
-            request->d->swap();
-        }
+        if (m_generator->hasFeature(Generator::RotatedRendering)) {
+            // the generator renders the page as it is shown, no RotationJob needed
+            request->d->mRotation = m_rotation;
+        } else {
+            if ((int)m_rotation % 2) {
+                request->d->swap();
+            }
 
-        if (m_rotation != Rotation0 && !request->normalizedRect().isNull()) {
-            request->setNormalizedRect(TilesManager::fromRotatedRect(request->normalizedRect(), m_rotation));
+            if (m_rotation != Rotation0 && !request->normalizedRect().isNull()) {
+                request->setNormalizedRect(TilesManager::fromRotatedRect(request->normalizedRect(), m_rotation));
+            }
         }
 
         // If set elsewhere we already know we want it to be partial
@@ -1530,6 +1569,16 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
         m_executingPixmapRequests.push_back(request);
         m_pixmapRequestsMutex.unlock();
         m_generator->generatePixmap(request);
+
+        // feed the other rendering threads of generators that can render in parallel
+        if (m_generator->canGeneratePixmap()) {
+            m_pixmapRequestsMutex.lock();
+            const bool hasPixmaps = !m_pixmapRequestsStack.empty();
+            m_pixmapRequestsMutex.unlock();
+            if (hasPixmaps) {
+                sendGeneratorPixmapRequest();
+            }
+        }
     } else {
         m_pixmapRequestsMutex.unlock();
         // pino (7/4/2006): set the polling interval from 10 to 30
@@ -1589,6 +1638,8 @@ void DocumentPrivate::slotGeneratorConfigChanged()
         }
     }
     if (configchanged) {
+        renderSettingsChanged();
+
         // invalidate pixmaps
         QVector<Page *>::const_iterator it = m_pagesVector.constBegin(), end = m_pagesVector.constEnd();
         for (; it != end; ++it) {
@@ -1596,7 +1647,6 @@ void DocumentPrivate::slotGeneratorConfigChanged()
         }
 
         // [MEM] remove allocation descriptors
-        qDeleteAll(m_allocatedPixmaps);
         m_allocatedPixmaps.clear();
         m_allocatedPixmapsTotalMemory = 0;
 
@@ -1605,24 +1655,44 @@ void DocumentPrivate::slotGeneratorConfigChanged()
     }
 
     // free memory if in 'low' profile
-    if (SettingsCore::memoryLevel() == SettingsCore::EnumMemoryLevel::Low && !m_allocatedPixmaps.empty() && !m_pagesVector.isEmpty()) {
+    if (SettingsCore::memoryLevel() == SettingsCore::EnumMemoryLevel::Low && !m_allocatedPixmaps.isEmpty() && !m_pagesVector.isEmpty()) {
         cleanupPixmapMemory();
     }
 }
 
-void DocumentPrivate::refreshPixmaps(int pageNumber)
+// Grows @p rect by a couple of pixels of a @p width x @p height pixmap, for antialiasing
+static NormalizedRect paddedDamage(const NormalizedRect &rect, int width, int height)
+{
+    const double dx = 2.0 / qMax(width, 1);
+    const double dy = 2.0 / qMax(height, 1);
+    return NormalizedRect(qMax(rect.left - dx, 0.0), qMax(rect.top - dy, 0.0), qMin(rect.right + dx, 1.0), qMin(rect.bottom + dy, 1.0));
+}
+
+void DocumentPrivate::refreshPixmaps(int pageNumber, const NormalizedRect &damagedRect)
 {
     Page *page = m_pagesVector.value(pageNumber, nullptr);
     if (!page) {
         return;
     }
 
+    if (m_thumbnailStore) {
+        m_thumbnailStore->removePage(pageNumber);
+    }
+
+    // generators that can render a part of a page only render the damaged part again,
+    // it is then painted over the pixmaps, or replaces the tiles it covers
+    const bool renderDamagedRect = !damagedRect.isNull() && m_generator->hasFeature(Generator::TiledRendering);
+
     QMap<DocumentObserver *, PagePrivate::PixmapObject>::ConstIterator it = page->d->m_pixmaps.constBegin(), itEnd = page->d->m_pixmaps.constEnd();
     QVector<Okular::PixmapRequest *> pixmapsToRequest;
     for (; it != itEnd; ++it) {
-        const QSize size = (*it).m_pixmap->size();
+        const QSize size = (*it).m_image.size();
         PixmapRequest *p = new PixmapRequest(it.key(), pageNumber, size.width(), size.height(), 1 /* dpr */, 1, PixmapRequest::Asynchronous);
         p->d->mForce = true;
+        if (renderDamagedRect && !(*it).m_isPartialPixmap) {
+            p->setNormalizedRect(paddedDamage(damagedRect, size.width(), size.height()));
+            p->setTile(true);
+        }
         pixmapsToRequest << p;
     }
 
@@ -1639,8 +1709,6 @@ void DocumentPrivate::refreshPixmaps(int pageNumber)
 
         TilesManager *tilesManager = page->d->tilesManager(observer);
         if (tilesManager) {
-            tilesManager->markDirty();
-
             PixmapRequest *p = new PixmapRequest(observer, pageNumber, tilesManager->width(), tilesManager->height(), 1 /* dpr */, 1, PixmapRequest::Asynchronous);
 
             // Get the visible page rect
@@ -1653,8 +1721,17 @@ void DocumentPrivate::refreshPixmaps(int pageNumber)
                 }
             }
 
-            if (!visibleRect.isNull()) {
-                p->setNormalizedRect(visibleRect);
+            NormalizedRect requestRect = visibleRect;
+            if (damagedRect.isNull()) {
+                tilesManager->markDirty();
+            } else {
+                // the damaged tiles that are not visible are requested when they are scrolled to
+                const NormalizedRect dirtyRect = tilesManager->markDirty(paddedDamage(damagedRect, tilesManager->width(), tilesManager->height()));
+                requestRect = visibleRect & dirtyRect;
+            }
+
+            if (!requestRect.isNull() && requestRect.width() > 0 && requestRect.height() > 0) {
+                p->setNormalizedRect(requestRect);
                 p->setTile(true);
                 p->d->mForce = true;
                 requestedPixmaps.push_back(p);
@@ -1667,6 +1744,21 @@ void DocumentPrivate::refreshPixmaps(int pageNumber)
     }
 }
 
+NormalizedRect DocumentPrivate::annotationDamage(const Page *page, Annotation *annotation)
+{
+    AnnotationPrivate *annotationPrivate = annotation->d_ptr;
+    const NormalizedRect boundary = annotation->transformedBoundingRectangle();
+
+    NormalizedRect drawnBoundary = annotationPrivate->m_drawnBoundary;
+    annotationPrivate->m_drawnBoundary = annotationPrivate->m_boundary;
+    if (drawnBoundary.isNull()) {
+        return boundary;
+    }
+
+    drawnBoundary.transform(page->d->rotationMatrix());
+    return drawnBoundary | boundary;
+}
+
 void DocumentPrivate::_o_configChanged()
 {
     // free text pages if needed
@@ -1796,223 +1888,177 @@ void DocumentPrivate::doProcessSearchMatch(RegularAreaRect *match, RunningSearch
     delete pagesToNotify;
 }
 
-void DocumentPrivate::doContinueAllDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID)
+void DocumentPrivate::doContinueAllDocumentSearch(const QSharedPointer<AllDocumentSearch> &allSearch, int currentPage)
 {
-    QMap<Page *, QVector<RegularAreaRect *>> *pageMatches = static_cast<QMap<Page *, QVector<RegularAreaRect *>> *>(pageMatchesMap);
-    QSet<int> *pagesToNotify = static_cast<QSet<int> *>(pagesToNotifySet);
-    RunningSearch *search = m_searches.value(searchID);
-
-    if (m_searchCancelled || !search) {
-        typedef QVector<RegularAreaRect *> MatchesVector;
-
-        QApplication::restoreOverrideCursor();
-
-        if (search) {
-            search->isCurrentlySearching = false;
-        }
+    if (allSearch->finished) {
+        return;
+    }
 
-        Q_EMIT m_parent->searchFinished(searchID, Document::SearchCancelled);
-        for (const MatchesVector &mv : std::as_const(*pageMatches)) {
-            qDeleteAll(mv);
-        }
-        delete pageMatches;
-        delete pagesToNotify;
+    RunningSearch *search = m_searches.value(allSearch->parameters.searchID);
+    if (m_searchCancelled || !search || allSearch->parameters.aborted->loadRelaxed()) {
+        finishAllDocumentSearch(allSearch.data(), Document::SearchCancelled);
         return;
     }
 
-    if (currentPage < m_pagesVector.count()) {
-        // get page (from the first to the last)
+    // Pages that already have a TextPage are searched here, the others are
+    // extracted and searched in batches by TextSearchJobs on the thread pool.
+    // Generators that can't extract text in a thread get the old behavior
+    // of extracting one page per event loop iteration.
+    const bool threaded = m_generator->hasFeature(Generator::Threaded);
+    const int pagesCount = m_pagesVector.count();
+    int pagesSearched = 0;
+    while (currentPage < pagesCount && pagesSearched < AllDocumentSearch::PagesPerStep) {
         Page *page = m_pagesVector.at(currentPage);
-        int pageNumber = page->number(); // redundant? is it == currentPage ?
-
-        // request search page if needed
-        if (!page->hasTextPage()) {
-            m_parent->requestTextPage(pageNumber);
-        }
-
-        // loop on a page adding highlights for all found items
-        RegularAreaRect *lastMatch = nullptr;
-        while (true) {
-            if (lastMatch) {
-                lastMatch = page->findText(searchID, search->cachedString, NextResult, search->cachedCaseSensitivity, lastMatch);
-            } else {
-                lastMatch = page->findText(searchID, search->cachedString, FromTop, search->cachedCaseSensitivity);
+        ++currentPage;
+
+        if (page->hasTextPage()) {
+            ++pagesSearched;
+        } else if (threaded) {
+            allSearch->pagesToExtract.append(page);
+            if (allSearch->pagesToExtract.count() == AllDocumentSearch::PagesPerJob) {
+                startTextSearchJob(allSearch.data());
             }
+            continue;
+        } else {
+            m_parent->requestTextPage(page->number());
+            pagesSearched = AllDocumentSearch::PagesPerStep;
+        }
 
-            if (!lastMatch) {
-                break;
-            }
+        allSearch->pendingMatches.insert(page->number(), findTextSearchMatches(page->d->m_text, allSearch->parameters));
+    }
 
-            // add highlight rect to the matches map
-            (*pageMatches)[page].append(lastMatch);
-        }
-        delete lastMatch;
+    if (currentPage < pagesCount) {
+        QTimer::singleShot(0, m_parent, [this, allSearch, currentPage] { doContinueAllDocumentSearch(allSearch, currentPage); });
+    } else if (!allSearch->pagesToExtract.isEmpty()) {
+        startTextSearchJob(allSearch.data());
+    }
 
-        QTimer::singleShot(0, m_parent, [this, pagesToNotifySet, pageMatches, currentPage, searchID] { doContinueAllDocumentSearch(pagesToNotifySet, pageMatches, currentPage + 1, searchID); });
-    } else {
-        // reset cursor to previous shape
-        QApplication::restoreOverrideCursor();
+    mergeAllDocumentSearchMatches(allSearch.data());
+}
 
-        search->isCurrentlySearching = false;
-        bool foundAMatch = pageMatches->count() != 0;
-        QMap<Page *, QVector<RegularAreaRect *>>::const_iterator it, itEnd;
-        it = pageMatches->constBegin();
-        itEnd = pageMatches->constEnd();
-        for (; it != itEnd; ++it) {
-            for (RegularAreaRect *match : it.value()) {
-                it.key()->d->setHighlight(searchID, match, search->cachedColor);
-                delete match;
-            }
-            search->highlightedPages.insert(it.key()->number());
-            pagesToNotify->insert(it.key()->number());
-        }
+void DocumentPrivate::startTextSearchJob(AllDocumentSearch *allSearch)
+{
+    TextSearchJob *job = new TextSearchJob(m_generator, allSearch->pagesToExtract, allSearch->parameters);
+    allSearch->pagesToExtract.clear();
+    m_pageController->addTextSearchJob(job);
+}
 
-        for (DocumentObserver *observer : std::as_const(m_observers)) {
-            observer->notifySetup(m_pagesVector, 0);
-        }
+void DocumentPrivate::textSearchFinished(TextSearchJob *job)
+{
+    const QVector<TextSearchPageResult> results = job->takeResults();
+    const QSharedPointer<AllDocumentSearch> allSearch = m_allDocumentSearches.value(job->parameters().searchID);
 
-        // notify observers about highlights changes
-        for (int pageNumber : std::as_const(*pagesToNotify)) {
-            for (DocumentObserver *observer : std::as_const(m_observers)) {
-                observer->notifyPageChanged(pageNumber, DocumentObserver::Highlights);
+    // the search this job belongs to has already finished (e.g. it was cancelled)
+    if (!allSearch || allSearch->parameters.aborted != job->parameters().aborted) {
+        for (const TextSearchPageResult &result : results) {
+            for (const TextSearchMatch &match : result.matches) {
+                delete match.first;
             }
+            delete result.textPage;
         }
+        return;
+    }
 
-        if (foundAMatch) {
-            Q_EMIT m_parent->searchFinished(searchID, Document::MatchFound);
-        } else {
-            Q_EMIT m_parent->searchFinished(searchID, Document::NoMatchFound);
+    for (const TextSearchPageResult &result : results) {
+        // keep the extracted text, unless the page got one in the meantime
+        if (result.textPage) {
+            if (result.page->hasTextPage()) {
+                delete result.textPage;
+            } else {
+                result.page->setTextPage(result.textPage);
+                textGenerationDone(result.page);
+            }
         }
-
-        delete pageMatches;
-        delete pagesToNotify;
+        allSearch->pendingMatches.insert(result.page->number(), result.matches);
     }
+
+    mergeAllDocumentSearchMatches(allSearch.data());
 }
 
-void DocumentPrivate::doContinueGooglesDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QStringList &words)
+void DocumentPrivate::mergeAllDocumentSearchMatches(AllDocumentSearch *allSearch)
 {
-    typedef QPair<RegularAreaRect *, QColor> MatchColor;
-    QMap<Page *, QVector<MatchColor>> *pageMatches = static_cast<QMap<Page *, QVector<MatchColor>> *>(pageMatchesMap);
-    QSet<int> *pagesToNotify = static_cast<QSet<int> *>(pagesToNotifySet);
+    const int searchID = allSearch->parameters.searchID;
     RunningSearch *search = m_searches.value(searchID);
-
-    if (m_searchCancelled || !search) {
-        typedef QVector<MatchColor> MatchesVector;
-
-        QApplication::restoreOverrideCursor();
-
-        if (search) {
-            search->isCurrentlySearching = false;
-        }
-
-        Q_EMIT m_parent->searchFinished(searchID, Document::SearchCancelled);
-
-        for (const MatchesVector &mv : std::as_const(*pageMatches)) {
-            for (const MatchColor &mc : mv) {
-                delete mc.first;
-            }
-        }
-        delete pageMatches;
-        delete pagesToNotify;
+    if (m_searchCancelled || !search || allSearch->parameters.aborted->loadRelaxed()) {
+        finishAllDocumentSearch(allSearch, Document::SearchCancelled);
         return;
     }
 
-    const int wordCount = words.count();
-    const int hueStep = (wordCount > 1) ? (60 / (wordCount - 1)) : 60;
-    int baseHue, baseSat, baseVal;
-    search->cachedColor.getHsv(&baseHue, &baseSat, &baseVal);
-
-    if (currentPage < m_pagesVector.count()) {
-        // get page (from the first to the last)
-        Page *page = m_pagesVector.at(currentPage);
-        int pageNumber = page->number(); // redundant? is it == currentPage ?
+    // Pages are searched out of order, highlight them in page order as soon
+    // as all the previous pages are done so the first matches show up early
+    QMap<int, QVector<TextSearchMatch>>::iterator it = allSearch->pendingMatches.begin();
+    while (it != allSearch->pendingMatches.end() && it.key() == allSearch->nextPageToMerge) {
+        const int pageNumber = it.key();
+        Page *page = m_pagesVector.at(pageNumber);
+        for (const TextSearchMatch &match : std::as_const(it.value())) {
+            page->d->setHighlight(searchID, match.first, match.second);
+            delete match.first;
+        }
 
-        // request search page if needed
-        if (!page->hasTextPage()) {
-            m_parent->requestTextPage(pageNumber);
+        const bool hadHighlights = allSearch->pagesToNotify.remove(pageNumber);
+        if (!it.value().isEmpty()) {
+            allSearch->foundAMatch = true;
+            search->highlightedPages.insert(pageNumber);
         }
 
-        // loop on a page adding highlights for all found items
-        bool allMatched = wordCount > 0, anyMatched = false;
-        for (int w = 0; w < wordCount; w++) {
-            const QString &word = words[w];
-            int newHue = baseHue - w * hueStep;
-            if (newHue < 0) {
-                newHue += 360;
+        // notify observers about highlights changes
+        if (hadHighlights || !it.value().isEmpty()) {
+            for (DocumentObserver *observer : std::as_const(m_observers)) {
+                observer->notifyPageChanged(pageNumber, DocumentObserver::Highlights);
             }
-            QColor wordColor = QColor::fromHsv(newHue, baseSat, baseVal);
-            RegularAreaRect *lastMatch = nullptr;
-            // add all highlights for current word
-            bool wordMatched = false;
-            while (true) {
-                if (lastMatch) {
-                    lastMatch = page->findText(searchID, word, NextResult, search->cachedCaseSensitivity, lastMatch);
-                } else {
-                    lastMatch = page->findText(searchID, word, FromTop, search->cachedCaseSensitivity);
-                }
+        }
 
-                if (!lastMatch) {
-                    break;
-                }
+        it = allSearch->pendingMatches.erase(it);
+        ++allSearch->nextPageToMerge;
+    }
 
-                // add highligh rect to the matches map
-                (*pageMatches)[page].append(MatchColor(lastMatch, wordColor));
-                wordMatched = true;
-            }
-            allMatched = allMatched && wordMatched;
-            anyMatched = anyMatched || wordMatched;
-        }
+    if (allSearch->nextPageToMerge == m_pagesVector.count()) {
+        finishAllDocumentSearch(allSearch, allSearch->foundAMatch ? Document::MatchFound : Document::NoMatchFound);
+    }
+}
 
-        // if not all words are present in page, remove partial highlights
-        const bool matchAll = search->cachedType == Document::GoogleAll;
-        if (!allMatched && matchAll) {
-            const QVector<MatchColor> &matches = (*pageMatches)[page];
-            for (const MatchColor &mc : matches) {
-                delete mc.first;
-            }
-            pageMatches->remove(page);
-        }
+void DocumentPrivate::finishAllDocumentSearch(AllDocumentSearch *allSearch, Document::SearchStatus status)
+{
+    const int searchID = allSearch->parameters.searchID;
 
-        QTimer::singleShot(0, m_parent, [this, pagesToNotifySet, pageMatches, currentPage, searchID, words] { doContinueGooglesDocumentSearch(pagesToNotifySet, pageMatches, currentPage + 1, searchID, words); });
-    } else {
-        // reset cursor to previous shape
-        QApplication::restoreOverrideCursor();
+    // stop the jobs that are still running, their results will be discarded
+    allSearch->parameters.aborted->storeRelaxed(1);
+    allSearch->finished = true;
+
+    // reset cursor to previous shape
+    QApplication::restoreOverrideCursor();
 
+    if (RunningSearch *search = m_searches.value(searchID)) {
         search->isCurrentlySearching = false;
-        bool foundAMatch = pageMatches->count() != 0;
-        QMap<Page *, QVector<MatchColor>>::const_iterator it, itEnd;
-        it = pageMatches->constBegin();
-        itEnd = pageMatches->constEnd();
-        for (; it != itEnd; ++it) {
-            for (const MatchColor &mc : it.value()) {
-                it.key()->d->setHighlight(searchID, mc.first, mc.second);
-                delete mc.first;
-            }
-            search->highlightedPages.insert(it.key()->number());
-            pagesToNotify->insert(it.key()->number());
-        }
+    }
 
-        // send page lists to update observers (since some filter on bookmarks)
+    // send page lists to update observers (since some filter on bookmarks)
+    if (status != Document::SearchCancelled) {
         for (DocumentObserver *observer : std::as_const(m_observers)) {
             observer->notifySetup(m_pagesVector, 0);
         }
+    }
 
-        // notify observers about highlights changes
-        for (int pageNumber : std::as_const(*pagesToNotify)) {
-            for (DocumentObserver *observer : std::as_const(m_observers)) {
-                observer->notifyPageChanged(pageNumber, DocumentObserver::Highlights);
-            }
+    // notify observers about the pages that lost their highlights
+    for (int pageNumber : std::as_const(allSearch->pagesToNotify)) {
+        for (DocumentObserver *observer : std::as_const(m_observers)) {
+            observer->notifyPageChanged(pageNumber, DocumentObserver::Highlights);
         }
+    }
+    allSearch->pagesToNotify.clear();
 
-        if (foundAMatch) {
-            Q_EMIT m_parent->searchFinished(searchID, Document::MatchFound);
-        } else {
-            Q_EMIT m_parent->searchFinished(searchID, Document::NoMatchFound);
+    for (const QVector<TextSearchMatch> &matches : std::as_const(allSearch->pendingMatches)) {
+        for (const TextSearchMatch &match : matches) {
+            delete match.first;
         }
-
-        delete pageMatches;
-        delete pagesToNotify;
     }
+    allSearch->pendingMatches.clear();
+
+    // the search may be referenced by pending event loop iterations, they
+    // will find it finished and release it
+    const QSharedPointer<AllDocumentSearch> keepAlive = m_allDocumentSearches.take(searchID);
+
+    Q_EMIT m_parent->searchFinished(searchID, status);
 }
 
 QVariant DocumentPrivate::documentMetaData(const Generator::DocumentMetaDataKey key, const QVariant &option) const
@@ -2296,6 +2342,62 @@ Document::~Document()
     delete d;
 }
 
+void DocumentPrivate::createThumbnailStore(const QString &fileName)
+{
+    delete m_thumbnailStore;
+    m_thumbnailStore = nullptr;
+
+    const qint64 maximumSize = qint64(SettingsCore::thumbnailStoreSize()) * 1024 * 1024;
+    if (maximumSize > 0 && m_docSize > 0) {
+        m_thumbnailStore = new ThumbnailStore(fileName, m_docSize, m_generatorName, maximumSize);
+    }
+}
+
+void DocumentPrivate::renderSettingsChanged()
+{
+    // the store of the document rendered with the new settings, if the
+    // document has one
+    if (m_thumbnailStore) {
+        createThumbnailStore(m_docFileName);
+    }
+}
+
+void DocumentPrivate::loadStoredRender(PixmapRequest *request)
+{
+    const quint64 id = ++m_lastStoredRenderId;
+    m_loadingStoredRenders.insert(id, request);
+
+    const bool computeBoundingBox = !request->page()->isBoundingBoxKnown();
+    m_thumbnailStore->load(request, computeBoundingBox, m_parent, [this, id, computeBoundingBox](const QImage &image, const NormalizedRect &boundingBox) {
+        PixmapRequest *request = m_loadingStoredRenders.take(id);
+        if (!request) {
+            // the document was closed
+            return;
+        }
+
+        Page *page = m_pagesVector.value(request->pageNumber());
+        if (page != request->page() || !m_observers.contains(request->observer())) {
+            delete request;
+            return;
+        }
+
+        if (image.isNull()) {
+            // let the generator render it
+            if (m_thumbnailStore) {
+                m_thumbnailStore->forget(request);
+            }
+            m_parent->requestPixmaps({request}, Document::NoOption);
+            return;
+        }
+
+        page->d->setImage(request->observer(), image, NormalizedRect(), false /*isPartialPixmap*/, Rotation0);
+        if (computeBoundingBox && !page->isBoundingBoxKnown()) {
+            setPageBoundingBox(request->pageNumber(), boundingBox);
+        }
+        requestDone(request);
+    });
+}
+
 QString DocumentPrivate::docDataFileName(const QUrl &url, qint64 document_size)
 {
     QString fn = url.fileName();
@@ -2519,6 +2621,12 @@ Document::OpenResult Document::openDocument(const QString &docFile, const QUrl &
     d->m_generatorName = offer.pluginId();
     d->m_pageController = new PageController();
     connect(d->m_pageController, &PageController::rotationFinished, this, [this](int p, Okular::Page *op) { d->rotationFinished(p, op); });
+    connect(d->m_pageController, &PageController::textSearchFinished, this, [this](Okular::TextSearchJob *job) { d->textSearchFinished(job); });
+
+    // renders of documents that need a password would be readable without it
+    if (!fromFileDescriptor && password.isEmpty()) {
+        d->createThumbnailStore(docFile);
+    }
 
     for (Page *p : std::as_const(d->m_pagesVector)) {
         p->d->m_doc = d;
@@ -2639,6 +2747,13 @@ void Document::closeDocument()
 
     Q_EMIT aboutToClose();
 
+    // stop the running whole document searches, the jobs still queued
+    // are waited for when deleting the page controller
+    const QList<QSharedPointer<AllDocumentSearch>> allDocumentSearches = d->m_allDocumentSearches.values();
+    for (const QSharedPointer<AllDocumentSearch> &allSearch : allDocumentSearches) {
+        d->finishAllDocumentSearch(allSearch.data(), SearchCancelled);
+    }
+
     delete d->m_pageController;
     d->m_pageController = nullptr;
 
@@ -2648,6 +2763,15 @@ void Document::closeDocument()
     // remove requests left in queue
     d->clearAndWaitForRequests();
 
+    // waits for the stored renders being decoded, the ones not handed out yet are dropped
+    delete d->m_thumbnailStore;
+    d->m_thumbnailStore = nullptr;
+    qDeleteAll(d->m_loadingStoredRenders);
+    d->m_loadingStoredRenders.clear();
+
+    delete d->m_formCalculationGraph;
+    d->m_formCalculationGraph = nullptr;
+
     if (d->m_fontThread) {
         disconnect(d->m_fontThread, nullptr, this, nullptr);
         d->m_fontThread->stopExtraction();
@@ -2747,7 +2871,6 @@ void Document::closeDocument()
     d->m_pagesVector.clear();
 
     // clear 'memory allocation' descriptors
-    qDeleteAll(d->m_allocatedPixmaps);
     d->m_allocatedPixmaps.clear();
 
     // clear 'running searches' descriptors
@@ -2816,17 +2939,7 @@ void Document::removeObserver(DocumentObserver *pObserver)
         }
 
         // [MEM] free observer's allocation descriptors
-        std::list<AllocatedPixmap *>::iterator aIt = d->m_allocatedPixmaps.begin();
-        std::list<AllocatedPixmap *>::iterator aEnd = d->m_allocatedPixmaps.end();
-        while (aIt != aEnd) {
-            AllocatedPixmap *p = *aIt;
-            if (p->observer == pObserver) {
-                aIt = d->m_allocatedPixmaps.erase(aIt);
-                delete p;
-            } else {
-                ++aIt;
-            }
-        }
+        d->m_allocatedPixmaps.removeObserver(pObserver);
 
         for (PixmapRequest *executingRequest : std::as_const(d->m_executingPixmapRequests)) {
             if (executingRequest->observer() == pObserver) {
@@ -2850,6 +2963,8 @@ void Document::reparseConfig()
         }
     }
     if (configchanged) {
+        d->renderSettingsChanged();
+
         // invalidate pixmaps
         QVector<Page *>::const_iterator it = d->m_pagesVector.constBegin(), end = d->m_pagesVector.constEnd();
         for (; it != end; ++it) {
@@ -2857,7 +2972,6 @@ void Document::reparseConfig()
         }
 
         // [MEM] remove allocation descriptors
-        qDeleteAll(d->m_allocatedPixmaps);
         d->m_allocatedPixmaps.clear();
         d->m_allocatedPixmapsTotalMemory = 0;
 
@@ -2866,7 +2980,7 @@ void Document::reparseConfig()
     }
 
     // free memory if in 'low' profile
-    if (SettingsCore::memoryLevel() == SettingsCore::EnumMemoryLevel::Low && !d->m_allocatedPixmaps.empty() && !d->m_pagesVector.isEmpty()) {
+    if (SettingsCore::memoryLevel() == SettingsCore::EnumMemoryLevel::Low && !d->m_allocatedPixmaps.isEmpty() && !d->m_pagesVector.isEmpty()) {
         d->cleanupPixmapMemory();
     }
 }
@@ -3304,6 +3418,16 @@ static bool shouldCancelRenderingBecauseOf(const PixmapRequest &executingRequest
     return false;
 }
 
+bool DocumentPrivate::isPixmapRequestExecuting(const DocumentObserver *observer, int pageNumber) const
+{
+    for (const PixmapRequest *executingRequest : m_executingPixmapRequests) {
+        if (executingRequest->observer() == observer && executingRequest->pageNumber() == pageNumber) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool DocumentPrivate::cancelRenderingBecauseOf(PixmapRequest *executingRequest, PixmapRequest *newRequest)
 {
     // No point in aborting the rendering already finished, let it go through
@@ -3317,11 +3441,10 @@ bool DocumentPrivate::cancelRenderingBecauseOf(PixmapRequest *executingRequest,
 
     TilesManager *tm = executingRequest->d->tilesManager();
     if (tm) {
-        tm->setPixmap(nullptr, executingRequest->normalizedRect(), true /*isPartialPixmap*/);
+        tm->setImage(QImage(), executingRequest->normalizedRect(), true /*isPartialPixmap*/);
         tm->setRequest(NormalizedRect(), 0, 0);
     }
-    PagePrivate::PixmapObject object = executingRequest->page()->d->m_pixmaps.take(executingRequest->observer());
-    delete object.m_pixmap;
+    executingRequest->page()->d->m_pixmaps.remove(executingRequest->observer());
 
     if (executingRequest->d->mShouldAbortRender != 0) {
         return false;
@@ -3365,6 +3488,30 @@ void Document::requestPixmaps(const QList<PixmapRequest *> &requests, PixmapRequ
             requestedPages.insert(request->pageNumber());
         }
     }
+
+    // 1.A [STORED RENDERS] set the 'page field' (see PixmapRequest), check if it is valid
+    // and pick the requests a previous session already rendered
+    QList<PixmapRequest *> validRequests;
+    QList<PixmapRequest *> pendingRequests;
+    QList<PixmapRequest *> storedRequests;
+    for (PixmapRequest *request : requests) {
+        qCDebug(OkularCoreDebug).nospace() << "request observer=" << request->observer() << " " << request->width() << "x" << request->height() << "@" << request->pageNumber();
+        if (d->m_pagesVector.value(request->pageNumber()) == nullptr) {
+            // skip requests referencing an invalid page (must not happen)
+            delete request;
+            continue;
+        }
+
+        request->d->mPage = d->m_pagesVector.value(request->pageNumber());
+        validRequests << request;
+
+        if (d->m_thumbnailStore && ThumbnailStore::isEligible(request) && d->m_thumbnailStore->contains(request)) {
+            storedRequests << request;
+            continue;
+        }
+        pendingRequests << request;
+    }
+
     const bool removeAllPrevious = reqOptions & RemoveAllPrevious;
     d->m_pixmapRequestsMutex.lock();
     std::list<PixmapRequest *>::iterator sIt = d->m_pixmapRequestsStack.begin(), sEnd = d->m_pixmapRequestsStack.end();
@@ -3379,18 +3526,9 @@ void Document::requestPixmaps(const QList<PixmapRequest *> &requests, PixmapRequ
     }
 
     // 1.B [PREPROCESS REQUESTS] tweak some values of the requests
-    for (PixmapRequest *request : requests) {
-        // set the 'page field' (see PixmapRequest) and check if it is valid
-        qCDebug(OkularCoreDebug).nospace() << "request observer=" << request->observer() << " " << request->width() << "x" << request->height() << "@" << request->pageNumber();
-        if (d->m_pagesVector.value(request->pageNumber()) == nullptr) {
-            // skip requests referencing an invalid page (must not happen)
-            delete request;
-            continue;
-        }
-
-        request->d->mPage = d->m_pagesVector.value(request->pageNumber());
-
-        if (request->isTile()) {
+    for (PixmapRequest *request : std::as_const(pendingRequests)) {
+        // tile requests of pages without a tiles manager are a damaged part of the page, rendered as is
+        if (request->isTile() && request->d->tilesManager()) {
             // Change the current request rect so that only invalid tiles are
             // requested. Also make sure the rect is tile-aligned.
             NormalizedRect tilesRect;
@@ -3422,7 +3560,7 @@ void Document::requestPixmaps(const QList<PixmapRequest *> &requests, PixmapRequ
         for (PixmapRequest *executingRequest : std::as_const(d->m_executingPixmapRequests)) {
             bool newRequestsContainExecutingRequestPage = false;
             bool requestCancelled = false;
-            for (PixmapRequest *newRequest : requests) {
+            for (PixmapRequest *newRequest : std::as_const(validRequests)) {
                 if (newRequest->pageNumber() == executingRequest->pageNumber() && requesterObserver == executingRequest->observer()) {
                     newRequestsContainExecutingRequestPage = true;
                 }
@@ -3444,7 +3582,7 @@ void Document::requestPixmaps(const QList<PixmapRequest *> &requests, PixmapRequ
     }
 
     // 2. [ADD TO STACK] add requests to stack
-    for (PixmapRequest *request : requests) {
+    for (PixmapRequest *request : std::as_const(pendingRequests)) {
         // add request to the 'stack' at the right place
         if (!request->priority()) {
             // add priority zero requests to the top of the stack
@@ -3461,6 +3599,12 @@ void Document::requestPixmaps(const QList<PixmapRequest *> &requests, PixmapRequ
     }
     d->m_pixmapRequestsMutex.unlock();
 
+    // 2.B [STORED RENDERS] the stored renders are decoded off this thread and
+    // then handed out as if the generator had made them
+    for (PixmapRequest *request : std::as_const(storedRequests)) {
+        d->loadStoredRender(request);
+    }
+
     // 3. [START FIRST GENERATION] if <NO>generator is ready, start a new generation,
     // or else (if gen is running) it will be started when the new contents will
     // come from generator (in requestDone())</NO>
@@ -3490,9 +3634,9 @@ void DocumentPrivate::notifyAnnotationChanges(int page)
     foreachObserverD(notifyPageChanged(page, DocumentObserver::Annotations));
 }
 
-void DocumentPrivate::notifyFormChanges(int /*page*/)
+void DocumentPrivate::notifyFormChanges(int /*page*/, const QList<FormField *> &changedFields)
 {
-    recalculateForms();
+    recalculateForms(changedFields);
 }
 
 void Document::addPageAnnotation(int page, Annotation *annotation)
@@ -3822,6 +3966,11 @@ void Document::searchText(int searchID, const QString &text, bool fromStart, Qt:
         return;
     }
 
+    // a whole document search with the same ID is still running, stop it
+    if (const QSharedPointer<AllDocumentSearch> allSearch = d->m_allDocumentSearches.value(searchID)) {
+        d->finishAllDocumentSearch(allSearch.data(), SearchCancelled);
+    }
+
     // if searchID search not recorded, create new descriptor and init params
     QMap<int, RunningSearch *>::iterator searchIt = d->m_searches.find(searchID);
     if (searchIt == d->m_searches.end()) {
@@ -3855,10 +4004,14 @@ void Document::searchText(int searchID, const QString &text, bool fromStart, Qt:
 
     // 1. ALLDOC - process all document marking pages
     if (type == AllDocument) {
-        QMap<Page *, QVector<RegularAreaRect *>> *pageMatches = new QMap<Page *, QVector<RegularAreaRect *>>;
+        QSharedPointer<AllDocumentSearch> allSearch(new AllDocumentSearch);
+        allSearch->parameters = {searchID, {text}, {color}, caseSensitivity, false, QSharedPointer<QAtomicInt>(new QAtomicInt(0))};
+        allSearch->pagesToNotify = *pagesToNotify;
+        delete pagesToNotify;
+        d->m_allDocumentSearches.insert(searchID, allSearch);
 
         // search and highlight 'text' (as a solid phrase) on all pages
-        QTimer::singleShot(0, this, [this, pagesToNotify, pageMatches, searchID] { d->doContinueAllDocumentSearch(pagesToNotify, pageMatches, 0, searchID); });
+        QTimer::singleShot(0, this, [this, allSearch] { d->doContinueAllDocumentSearch(allSearch, 0); });
     }
     // 2. NEXTMATCH - find next matching item (or start from top)
     // 3. PREVMATCH - find previous matching item (or start from bottom)
@@ -3901,11 +4054,30 @@ void Document::searchText(int searchID, const QString &text, bool fromStart, Qt:
     }
     // 4. GOOGLE* - process all document marking pages
     else if (type == GoogleAll || type == GoogleAny) {
-        QMap<Page *, QVector<QPair<RegularAreaRect *, QColor>>> *pageMatches = new QMap<Page *, QVector<QPair<RegularAreaRect *, QColor>>>;
         const QStringList words = text.split(QLatin1Char(' '), Qt::SkipEmptyParts);
 
+        // every word gets its own color, with hues spreading from the search color
+        const int wordCount = words.count();
+        const int hueStep = (wordCount > 1) ? (60 / (wordCount - 1)) : 60;
+        int baseHue, baseSat, baseVal;
+        color.getHsv(&baseHue, &baseSat, &baseVal);
+        QVector<QColor> wordColors;
+        for (int w = 0; w < wordCount; w++) {
+            int newHue = baseHue - w * hueStep;
+            if (newHue < 0) {
+                newHue += 360;
+            }
+            wordColors.append(QColor::fromHsv(newHue, baseSat, baseVal));
+        }
+
+        QSharedPointer<AllDocumentSearch> allSearch(new AllDocumentSearch);
+        allSearch->parameters = {searchID, words, wordColors, caseSensitivity, type == GoogleAll, QSharedPointer<QAtomicInt>(new QAtomicInt(0))};
+        allSearch->pagesToNotify = *pagesToNotify;
+        delete pagesToNotify;
+        d->m_allDocumentSearches.insert(searchID, allSearch);
+
         // search and highlight every word in 'text' on all pages
-        QTimer::singleShot(0, this, [this, pagesToNotify, pageMatches, searchID, words] { d->doContinueGooglesDocumentSearch(pagesToNotify, pageMatches, 0, searchID, words); });
+        QTimer::singleShot(0, this, [this, allSearch] { d->doContinueAllDocumentSearch(allSearch, 0); });
     }
 }
 
@@ -3974,6 +4146,11 @@ void Document::resetSearch(int searchID)
 void Document::cancelSearch()
 {
     d->m_searchCancelled = true;
+
+    // stop the text extraction jobs without waiting for the next event loop iteration
+    for (const QSharedPointer<AllDocumentSearch> &allSearch : std::as_const(d->m_allDocumentSearches)) {
+        allSearch->parameters.aborted->storeRelaxed(1);
+    }
 }
 
 void Document::undo()
@@ -4026,6 +4203,12 @@ void Document::editFormButtons(int pageNumber, const QList<FormFieldButton *> &f
 
 void Document::reloadDocument() const
 {
+    // the document changed on disk, the renders stored for it are outdated
+    if (d->m_thumbnailStore) {
+        d->m_thumbnailStore->clear();
+        d->createThumbnailStore(d->m_docFileName);
+    }
+
     const int numOfPages = pages();
     for (int i = currentPage(); i >= 0; i--) {
         d->refreshPixmaps(i);
@@ -4393,7 +4576,7 @@ void Document::processFormatAction(const Action *action, Okular::FormField *ff)
         ff->setValue(QVariant(formattedText));
         ff->setAppearanceValue(QVariant(formattedText));
         Q_EMIT refreshFormWidget(ff);
-        d->refreshPixmaps(foundPage);
+        d->refreshFormPixmaps(foundPage, ff);
         // Then we make the form have the unformatted text, to use
         // in calculations and other things
         ff->setValue(QVariant(unformattedText));
@@ -4403,7 +4586,7 @@ void Document::processFormatAction(const Action *action, Okular::FormField *ff)
         // This is because the recalculateForms function delegated
         // the responsiblity for the refresh to us.
         Q_EMIT refreshFormWidget(ff);
-        d->refreshPixmaps(foundPage);
+        d->refreshFormPixmaps(foundPage, ff);
     }
 }
 
@@ -5074,14 +5257,26 @@ bool Document::swapBackingFile(const QString &newFileName, const QUrl &url)
                 rectsToDelete << oldPage->m_rects;
                 oldPage->m_annotations = newPage->m_annotations;
                 oldPage->m_rects = newPage->m_rects;
+                oldPage->d->invalidateObjectRectIndex();
             }
             qDeleteAll(newPagesVector);
+
+            // the form fields came with the new pages
+            delete d->m_formCalculationGraph;
+            d->m_formCalculationGraph = nullptr;
         }
 
         d->m_url = url;
         d->m_docFileName = newFileName;
         d->updateMetadataXmlNameAndDocSize();
         d->m_bookmarkManager->setUrl(d->m_url);
+
+        // the renders stored for the old file do not match the new one
+        if (d->m_thumbnailStore) {
+            d->m_thumbnailStore->clear();
+            d->createThumbnailStore(newFileName);
+        }
+
         d->m_documentInfo = DocumentInfo();
         d->m_documentInfoAskedKeys.clear();
 
@@ -5585,24 +5780,11 @@ void DocumentPrivate::requestDone(PixmapRequest *req)
         return;
     }
 
-#ifndef NDEBUG
-    if (!m_generator->canGeneratePixmap()) {
-        qCDebug(OkularCoreDebug) << "requestDone with generator not in READY state.";
-    }
-#endif
-
     if (!req->shouldAbortRender()) {
         // [MEM] 1.1 find and remove a previous entry for the same page and id
-        std::list<AllocatedPixmap *>::iterator aIt = m_allocatedPixmaps.begin();
-        std::list<AllocatedPixmap *>::iterator aEnd = m_allocatedPixmaps.end();
-        for (; aIt != aEnd; ++aIt) {
-            if ((*aIt)->page == req->pageNumber() && (*aIt)->observer == req->observer()) {
-                AllocatedPixmap *p = *aIt;
-                m_allocatedPixmaps.erase(aIt);
-                m_allocatedPixmapsTotalMemory -= p->memory;
-                delete p;
-                break;
-            }
+        if (AllocatedPixmap *p = m_allocatedPixmaps.take(req->observer(), req->pageNumber())) {
+            m_allocatedPixmapsTotalMemory -= p->memory;
+            delete p;
         }
 
         DocumentObserver *observer = req->observer();
@@ -5617,9 +5799,17 @@ void DocumentPrivate::requestDone(PixmapRequest *req)
             }
 
             AllocatedPixmap *memoryPage = new AllocatedPixmap(req->observer(), req->pageNumber(), memoryBytes);
-            m_allocatedPixmaps.push_back(memoryPage);
+            m_allocatedPixmaps.insert(memoryPage);
             m_allocatedPixmapsTotalMemory += memoryBytes;
 
+            // [STORE] 1.3 keep small renders for the next time the document is opened
+            if (m_thumbnailStore && ThumbnailStore::isEligible(req)) {
+                const PagePrivate::PixmapObject pixmapObject = req->page()->d->m_pixmaps.value(observer);
+                if (!pixmapObject.m_isPartialPixmap && pixmapObject.m_image.size() == QSize(req->width(), req->height())) {
+                    m_thumbnailStore->insert(req->pageNumber(), pixmapObject.m_image);
+                }
+            }
+
             // 2. notify an observer that its pixmap changed
             observer->notifyPageChanged(req->pageNumber(), DocumentObserver::Pixmap);
         }
@@ -5666,8 +5856,44 @@ void DocumentPrivate::setPageBoundingBox(int page, const NormalizedRect &boundin
     // TODO: Don't compute the bounding box if no one needs it (e.g., Trim Borders is off).
 }
 
+void DocumentPrivate::setPageSizes(const QMap<int, QSizeF> &sizes)
+{
+    if (!m_generator) {
+        return;
+    }
+
+    bool changed = false;
+    for (auto it = sizes.cbegin(); it != sizes.cend(); ++it) {
+        Page *kp = m_pagesVector.value(it.key());
+        if (!kp || it.value().isEmpty()) {
+            continue;
+        }
+
+        const bool transposed = kp->rotation() % 2;
+        if (it.value() == QSizeF(transposed ? kp->height() : kp->width(), transposed ? kp->width() : kp->height())) {
+            continue;
+        }
+
+        // the pixmaps of the old size go away with it
+        for (DocumentObserver *observer : std::as_const(m_observers)) {
+            if (AllocatedPixmap *p = m_allocatedPixmaps.take(observer, it.key())) {
+                m_allocatedPixmapsTotalMemory -= p->memory;
+                delete p;
+            }
+        }
+        kp->d->changeSize(PageSize(it.value().width(), it.value().height(), QString()));
+        changed = true;
+    }
+
+    if (changed) {
+        foreachObserverD(notifySetup(m_pagesVector, DocumentObserver::NewLayoutForPages));
+    }
+}
+
 void DocumentPrivate::calculateMaxTextPages()
 {
+    // TextPages are packed, but each also keeps a normalized copy of its text
+    // for searching (see TextSearchIndex), so they are not counted as smaller
     int multipliers = qMax(1, qRound(getTotalMemory() / 536870912.0)); // 512 MB
     switch (SettingsCore::memoryLevel()) {
     case SettingsCore::EnumMemoryLevel::Low:
@@ -5760,7 +5986,6 @@ void Document::setPageSize(const PageSize &size)
         (*pIt)->d->changeSize(size);
     }
     // clear 'memory allocation' descriptors
-    qDeleteAll(d->m_allocatedPixmaps);
     d->m_allocatedPixmaps.clear();
     d->m_allocatedPixmapsTotalMemory = 0;
     // notify the generator that the current page size has changed
@@ -21,9 +21,11 @@
 #include <QMap>
 #include <QMutex>
 #include <QPointer>
+#include <QSharedPointer>
 #include <QUrl>
 
 // local includes
+#include "allocatedpixmapindex_p.h"
 #include "fontinfo.h"
 #include "generator.h"
 
@@ -34,7 +36,7 @@ class QTimer;
 class QTemporaryFile;
 class KPluginMetaData;
 
-struct AllocatedPixmap;
+struct AllDocumentSearch;
 struct ArchiveData;
 struct RunningSearch;
 
@@ -42,9 +44,12 @@ namespace Okular
 {
 class ScriptAction;
 class ConfigInterface;
+class FormCalculationGraph;
 class PageController;
 class SaveInterface;
 class Scripter;
+class TextSearchJob;
+class ThumbnailStore;
 class View;
 }
 
@@ -123,6 +128,9 @@ public:
         , m_pageController(nullptr)
         , m_closingLoop(nullptr)
         , m_scripter(nullptr)
+        , m_thumbnailStore(nullptr)
+        , m_formCalculationGraph(nullptr)
+        , m_batchingFormRefreshes(false)
         , m_archiveData(nullptr)
         , m_fontsCached(false)
         , m_annotationEditingEnabled(true)
@@ -144,6 +152,9 @@ public:
     void cleanupPixmapMemory(qulonglong memoryToFree);
     AllocatedPixmap *searchLowestPriorityPixmap(bool unloadableOnly = false, bool thenRemoveIt = false, DocumentObserver *observer = nullptr /* any */);
     void calculateMaxTextPages();
+    void createThumbnailStore(const QString &fileName);
+    void renderSettingsChanged();
+    void loadStoredRender(PixmapRequest *request);
     qulonglong getTotalMemory();
     qulonglong getFreeMemory(qulonglong *freeSwap = nullptr);
     bool loadDocumentInfo(LoadDocumentInfoFlags loadWhat);
@@ -171,12 +182,14 @@ public:
     bool savePageDocumentInfo(QTemporaryFile *infoFile, int what) const;
     DocumentViewport nextDocumentViewport() const;
     void notifyAnnotationChanges(int page);
-    void notifyFormChanges(int page);
+    void notifyFormChanges(int page, const QList<FormField *> &changedFields);
     bool canAddAnnotationsNatively() const;
     bool canModifyExternalAnnotations() const;
     bool canRemoveExternalAnnotations() const;
     OKULARCORE_EXPORT static QString docDataFileName(const QUrl &url, qint64 document_size);
     bool cancelRenderingBecauseOf(PixmapRequest *executingRequest, PixmapRequest *newRequest);
+    // needs m_pixmapRequestsMutex to be locked
+    bool isPixmapRequestExecuting(const DocumentObserver *observer, int pageNumber) const;
 
     // Methods that implement functionality needed by undo commands
     void performAddPageAnnotation(int page, Annotation *annotation);
@@ -184,7 +197,14 @@ public:
     void performModifyPageAnnotation(int page, Annotation *annotation, bool appearanceChanged);
     void performSetAnnotationContents(const QString &newContents, Annotation *annot, int pageNumber);
 
-    void recalculateForms();
+    /**
+     * Runs the calculate actions of the fields that read @p changedFields,
+     * directly or through other calculated fields, or of all the calculated
+     * fields if @p changedFields is empty.
+     */
+    void recalculateForms(const QList<FormField *> &changedFields);
+    // refreshes the part of the pixmaps of page under field, once at the end of recalculateForms() if it is running
+    void refreshFormPixmaps(int page, const FormField *field);
 
     // private slots
     void saveDocumentInfo() const;
@@ -194,11 +214,21 @@ public:
     void slotFontReadingProgress(int page);
     void fontReadingGotFont(const Okular::FontInfo &font);
     void slotGeneratorConfigChanged();
-    void refreshPixmaps(int);
+    // refreshes the pixmaps of the page, only the part in damagedRect if it is not null
+    void refreshPixmaps(int pageNumber, const NormalizedRect &damagedRect = NormalizedRect());
+    /**
+     * Returns the part of @p page that has to be rendered again after
+     * @p annotation changed: the union of where it was drawn and where it
+     * is now, in the coordinates of the rotated page.
+     */
+    NormalizedRect annotationDamage(const Page *page, Annotation *annotation);
     void _o_configChanged();
     void doContinueDirectionMatchSearch(void *doContinueDirectionMatchSearchStruct);
-    void doContinueAllDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID);
-    void doContinueGooglesDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QStringList &words);
+    void doContinueAllDocumentSearch(const QSharedPointer<AllDocumentSearch> &allSearch, int currentPage);
+    void startTextSearchJob(AllDocumentSearch *allSearch);
+    void textSearchFinished(TextSearchJob *job);
+    void mergeAllDocumentSearchMatches(AllDocumentSearch *allSearch);
+    void finishAllDocumentSearch(AllDocumentSearch *allSearch, Document::SearchStatus status);
 
     void doProcessSearchMatch(RegularAreaRect *match, RunningSearch *search, QSet<int> *pagesToNotify, int currentPage, int searchID, bool moveViewport, const QColor &color);
 
@@ -220,6 +250,7 @@ public:
      * Sets the bounding box of the given @p page (in terms of upright orientation, i.e., Rotation0).
      */
     void setPageBoundingBox(int page, const NormalizedRect &boundingBox);
+    void setPageSizes(const QMap<int, QSizeF> &sizes);
 
     /**
      * Request a particular metadata of the Document itself (ie, not something
@@ -257,6 +288,8 @@ public:
     // find descriptors, mapped by ID (we handle multiple searches)
     QMap<int, RunningSearch *> m_searches;
     bool m_searchCancelled;
+    // whole document searches in progress, mapped by search ID
+    QHash<int, QSharedPointer<AllDocumentSearch>> m_allDocumentSearches;
 
     // needed because for remote documents docFileName is a local file and
     // we want the remote url when the document refers to relativeNames
@@ -279,7 +312,7 @@ public:
     std::list<PixmapRequest *> m_pixmapRequestsStack;
     std::list<PixmapRequest *> m_executingPixmapRequests;
     QMutex m_pixmapRequestsMutex;
-    std::list<AllocatedPixmap *> m_allocatedPixmaps;
+    AllocatedPixmapIndex m_allocatedPixmaps;
     qulonglong m_allocatedPixmapsTotalMemory;
     QList<int> m_allocatedTextPagesFifo;
     int m_maxAllocatedTextPages;
@@ -321,6 +354,17 @@ public:
 
     Scripter *m_scripter;
 
+    // small renders of the pages kept across sessions (may be null)
+    ThumbnailStore *m_thumbnailStore;
+    // the requests whose stored render is being decoded, by id
+    QHash<quint64, PixmapRequest *> m_loadingStoredRenders;
+    quint64 m_lastStoredRenderId = 0;
+
+    // built on the first recalculation (may be null)
+    FormCalculationGraph *m_formCalculationGraph;
+    bool m_batchingFormRefreshes;
+    QHash<int, NormalizedRect> m_formRefreshRects;
+
     ArchiveData *m_archiveData;
     QString m_archivedFileName;
 
@@ -452,7 +452,7 @@ void EditFormTextCommand::undo()
     moveViewportIfBoundingRectNotFullyVisible(m_form->rect(), m_docPriv, m_pageNumber);
     m_form->setText(m_prevContents);
     Q_EMIT m_docPriv->m_parent->formTextChangedByUndoRedo(m_pageNumber, m_form, m_prevContents, m_prevCursorPos, m_prevAnchorPos);
-    m_docPriv->notifyFormChanges(m_pageNumber);
+    m_docPriv->notifyFormChanges(m_pageNumber, {m_form});
 }
 
 void EditFormTextCommand::redo()
@@ -460,7 +460,7 @@ void EditFormTextCommand::redo()
     moveViewportIfBoundingRectNotFullyVisible(m_form->rect(), m_docPriv, m_pageNumber);
     m_form->setText(m_newContents);
     Q_EMIT m_docPriv->m_parent->formTextChangedByUndoRedo(m_pageNumber, m_form, m_newContents, m_newCursorPos, m_newCursorPos);
-    m_docPriv->notifyFormChanges(m_pageNumber);
+    m_docPriv->notifyFormChanges(m_pageNumber, {m_form});
 }
 
 int EditFormTextCommand::id() const
@@ -501,7 +501,7 @@ void EditFormListCommand::undo()
     moveViewportIfBoundingRectNotFullyVisible(m_form->rect(), m_docPriv, m_pageNumber);
     m_form->setCurrentChoices(m_prevChoices);
     Q_EMIT m_docPriv->m_parent->formListChangedByUndoRedo(m_pageNumber, m_form, m_prevChoices);
-    m_docPriv->notifyFormChanges(m_pageNumber);
+    m_docPriv->notifyFormChanges(m_pageNumber, {m_form});
 }
 
 void EditFormListCommand::redo()
@@ -509,7 +509,7 @@ void EditFormListCommand::redo()
     moveViewportIfBoundingRectNotFullyVisible(m_form->rect(), m_docPriv, m_pageNumber);
     m_form->setCurrentChoices(m_newChoices);
     Q_EMIT m_docPriv->m_parent->formListChangedByUndoRedo(m_pageNumber, m_form, m_newChoices);
-    m_docPriv->notifyFormChanges(m_pageNumber);
+    m_docPriv->notifyFormChanges(m_pageNumber, {m_form});
 }
 
 bool EditFormListCommand::refreshInternalPageReferences(const QVector<Page *> &newPagesVector)
@@ -550,7 +550,7 @@ void EditFormComboCommand::undo()
     }
     moveViewportIfBoundingRectNotFullyVisible(m_form->rect(), m_docPriv, m_pageNumber);
     Q_EMIT m_docPriv->m_parent->formComboChangedByUndoRedo(m_pageNumber, m_form, m_prevContents, m_prevCursorPos, m_prevAnchorPos);
-    m_docPriv->notifyFormChanges(m_pageNumber);
+    m_docPriv->notifyFormChanges(m_pageNumber, {m_form});
 }
 
 void EditFormComboCommand::redo()
@@ -562,7 +562,7 @@ void EditFormComboCommand::redo()
     }
     moveViewportIfBoundingRectNotFullyVisible(m_form->rect(), m_docPriv, m_pageNumber);
     Q_EMIT m_docPriv->m_parent->formComboChangedByUndoRedo(m_pageNumber, m_form, m_newContents, m_newCursorPos, m_newCursorPos);
-    m_docPriv->notifyFormChanges(m_pageNumber);
+    m_docPriv->notifyFormChanges(m_pageNumber, {m_form});
 }
 
 int EditFormComboCommand::id() const
@@ -609,47 +609,35 @@ EditFormButtonsCommand::EditFormButtonsCommand(Okular::DocumentPrivate *docPriv,
 void EditFormButtonsCommand::undo()
 {
     clearFormButtonStates();
-    QSet<int> extraPages;
     for (int i = 0; i < m_formButtons.size(); i++) {
         bool checked = m_prevButtonStates.at(i);
         if (checked) {
             m_formButtons.at(i)->setState(checked);
         }
-        if (m_pageNumbers.at(i) != m_pageNumber) {
-            extraPages << m_pageNumbers.at(i);
-        }
     }
 
     Okular::NormalizedRect boundingRect = buildBoundingRectangleForButtons(m_formButtons);
     moveViewportIfBoundingRectNotFullyVisible(boundingRect, m_docPriv, m_pageNumber);
     Q_EMIT m_docPriv->m_parent->formButtonsChangedByUndoRedo(m_pageNumber, m_formButtons);
-    m_docPriv->notifyFormChanges(m_pageNumber);
-    for (auto page : std::as_const(extraPages)) {
-        m_docPriv->notifyFormChanges(page);
-    }
+    // the buttons may be on other pages too, the recalculation covers all of them
+    m_docPriv->notifyFormChanges(m_pageNumber, QList<FormField *>(m_formButtons.cbegin(), m_formButtons.cend()));
 }
 
 void EditFormButtonsCommand::redo()
 {
     clearFormButtonStates();
-    QSet<int> extraPages;
     for (int i = 0; i < m_formButtons.size(); i++) {
         bool checked = m_newButtonStates.at(i);
         if (checked) {
             m_formButtons.at(i)->setState(checked);
         }
-        if (m_pageNumbers.at(i) != m_pageNumber) {
-            extraPages << m_pageNumbers.at(i);
-        }
     }
 
     Okular::NormalizedRect boundingRect = buildBoundingRectangleForButtons(m_formButtons);
     moveViewportIfBoundingRectNotFullyVisible(boundingRect, m_docPriv, m_pageNumber);
     Q_EMIT m_docPriv->m_parent->formButtonsChangedByUndoRedo(m_pageNumber, m_formButtons);
-    m_docPriv->notifyFormChanges(m_pageNumber);
-    for (auto page : std::as_const(extraPages)) {
-        m_docPriv->notifyFormChanges(page);
-    }
+    // the buttons may be on other pages too, the recalculation covers all of them
+    m_docPriv->notifyFormChanges(m_pageNumber, QList<FormField *>(m_formButtons.cbegin(), m_formButtons.cend()));
 }
 
 bool EditFormButtonsCommand::refreshInternalPageReferences(const QVector<Okular::Page *> &newPagesVector)
@@ -0,0 +1,241 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "formcalculationgraph_p.h"
+
+#include "action.h"
+#include "debug_p.h"
+#include "form.h"
+#include "page.h"
+
+#include <QHash>
+#include <QRegularExpression>
+
+using namespace Okular;
+
+// a single or double quoted JavaScript string
+static const QLatin1String kStringLiteral(R"re((?:"((?:[^"\\]|\\.)*)"|'((?:[^'\\]|\\.)*)'))re");
+
+static QString literalValue(const QRegularExpressionMatch &match)
+{
+    return match.captured(1).isNull() ? match.captured(2) : match.captured(1);
+}
+
+// Returns the arguments of the call whose opening parenthesis is at openingParenthesis,
+// or a null string if the call is not closed
+static QString callArguments(const QString &script, int openingParenthesis)
+{
+    int depth = 0;
+    QChar quote;
+    for (int i = openingParenthesis; i < script.size(); ++i) {
+        const QChar c = script.at(i);
+        if (!quote.isNull()) {
+            if (c == QLatin1Char('\\')) {
+                ++i;
+            } else if (c == quote) {
+                quote = QChar();
+            }
+        } else if (c == QLatin1Char('"') || c == QLatin1Char('\'')) {
+            quote = c;
+        } else if (c == QLatin1Char('(')) {
+            ++depth;
+        } else if (c == QLatin1Char(')') && --depth == 0) {
+            return script.mid(openingParenthesis + 1, i - openingParenthesis - 1);
+        }
+    }
+    return QString();
+}
+
+// Returns whether @p script only calls functions that can't read fields behind its back:
+// the ones of the language, the Acrobat ones, methods of objects and the functions the
+// script defines itself. Any other function, like a document level one, may call getField()
+static bool callsOnlyKnownFunctions(const QString &script)
+{
+    static const QRegularExpression stringLiteral(kStringLiteral);
+    static const QRegularExpression functionDefinition(QStringLiteral(R"(\bfunction\s+([A-Za-z_$][\w$]*))"));
+    // a name followed by an opening parenthesis, with what comes before it
+    static const QRegularExpression call(QStringLiteral(R"(((?:\bthis\s*)?\.\s*)?\b([A-Za-z_$][\w$]*)\s*\()"));
+    static const QSet<QString> builtins = {
+        // statements and operators
+        QStringLiteral("if"),
+        QStringLiteral("for"),
+        QStringLiteral("while"),
+        QStringLiteral("switch"),
+        QStringLiteral("return"),
+        QStringLiteral("catch"),
+        QStringLiteral("typeof"),
+        QStringLiteral("function"),
+        QStringLiteral("with"),
+        QStringLiteral("void"),
+        QStringLiteral("delete"),
+        QStringLiteral("new"),
+        QStringLiteral("in"),
+        QStringLiteral("instanceof"),
+        // global functions and constructors
+        QStringLiteral("parseInt"),
+        QStringLiteral("parseFloat"),
+        QStringLiteral("isNaN"),
+        QStringLiteral("isFinite"),
+        QStringLiteral("Number"),
+        QStringLiteral("String"),
+        QStringLiteral("Boolean"),
+        QStringLiteral("Array"),
+        QStringLiteral("Date"),
+        QStringLiteral("Object"),
+        QStringLiteral("RegExp"),
+        QStringLiteral("escape"),
+        QStringLiteral("unescape"),
+        // field lookups, whose names are checked apart
+        QStringLiteral("getField"),
+    };
+
+    QString code = script;
+    code.remove(stringLiteral);
+
+    QSet<QString> definedFunctions;
+    QRegularExpressionMatchIterator it = functionDefinition.globalMatch(code);
+    while (it.hasNext()) {
+        definedFunctions.insert(it.next().captured(1));
+    }
+
+    it = call.globalMatch(code);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        const QString qualifier = match.captured(1);
+        const QString name = match.captured(2);
+        if (!qualifier.isEmpty() && !qualifier.startsWith(QLatin1String("this"))) {
+            // a method of an object, like Math.max() or getField("a").value.toFixed()
+            continue;
+        }
+        // the AF functions are the Acrobat ones, implemented by the script engine
+        if (builtins.contains(name) || definedFunctions.contains(name) || name.startsWith(QLatin1String("AF"))) {
+            continue;
+        }
+        qCDebug(OkularCoreDebug) << "Calculation calls" << name << "which may read any field";
+        return false;
+    }
+    return true;
+}
+
+FormCalculationGraph::FormCalculationGraph(const QVector<Page *> &pages, const QVector<int> &calculateOrder)
+{
+    QHash<int, QVector<std::pair<FormField *, int>>> fieldsById;
+    for (const Page *page : pages) {
+        const QList<FormField *> formFields = page->formFields();
+        for (FormField *field : formFields) {
+            fieldsById[field->id()].append({field, page->number()});
+        }
+    }
+
+    for (int formId : calculateOrder) {
+        const QVector<std::pair<FormField *, int>> fields = fieldsById.value(formId);
+        for (const auto &[field, page] : fields) {
+            const Action *action = field->additionalAction(FormField::CalculateField);
+            if (!action) {
+                qWarning() << "Form that is part of calculate order doesn't have a calculate action";
+                continue;
+            }
+
+            CalculatedField calculatedField;
+            calculatedField.field = field;
+            calculatedField.page = page;
+            bool complete = false;
+            if (action->actionType() == Action::Script) {
+                calculatedField.references = referencedFieldNames(static_cast<const ScriptAction *>(action)->script(), &complete);
+            }
+            calculatedField.readsEveryField = !complete || calculatedField.references.isEmpty();
+            m_calculatedFields.append(calculatedField);
+        }
+    }
+}
+
+const QVector<FormCalculationGraph::CalculatedField> &FormCalculationGraph::calculatedFields() const
+{
+    return m_calculatedFields;
+}
+
+bool FormCalculationGraph::readsAnyOf(const CalculatedField &calculatedField, const QSet<QString> &fieldNames)
+{
+    if (calculatedField.readsEveryField) {
+        return true;
+    }
+
+    for (const QString &reference : calculatedField.references) {
+        if (fieldNames.contains(reference)) {
+            return true;
+        }
+        // a reference to a parent field reads its children too
+        const QString prefix = reference + QLatin1Char('.');
+        for (const QString &fieldName : fieldNames) {
+            if (fieldName.startsWith(prefix)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+QStringList FormCalculationGraph::referencedFieldNames(const QString &script, bool *complete)
+{
+    static const QRegularExpression getFieldCall(QStringLiteral(R"(getField\s*\()"));
+    static const QRegularExpression getFieldLiteralCall(QStringLiteral(R"(getField\s*\(\s*)") + kStringLiteral + QStringLiteral(R"(\s*\))"));
+    static const QRegularExpression simpleCalculateCall(QStringLiteral(R"(AFSimple_Calculate\s*\()"));
+    static const QRegularExpression stringLiteral(kStringLiteral);
+    // what may be left of the arguments of AFSimple_Calculate once the strings are removed
+    static const QRegularExpression fieldListSyntax(QStringLiteral(R"(^[\s,()\[\]]*(new\s+Array)?[\s,()\[\]]*$)"));
+
+    QStringList names;
+    *complete = true;
+
+    int literalCalls = 0;
+    QRegularExpressionMatchIterator it = getFieldLiteralCall.globalMatch(script);
+    while (it.hasNext()) {
+        names << literalValue(it.next());
+        ++literalCalls;
+    }
+    int calls = 0;
+    it = getFieldCall.globalMatch(script);
+    while (it.hasNext()) {
+        it.next();
+        ++calls;
+    }
+    if (calls != literalCalls) {
+        *complete = false;
+    }
+
+    it = simpleCalculateCall.globalMatch(script);
+    while (it.hasNext()) {
+        const QString arguments = callArguments(script, it.next().capturedEnd() - 1);
+        // the first argument is the operation, the rest the field names, either as
+        // an array of strings or as a string with comma separated names
+        const int firstComma = arguments.indexOf(QLatin1Char(','));
+        QString fieldList = firstComma == -1 ? QString() : arguments.mid(firstComma + 1);
+        if (fieldList.isEmpty()) {
+            *complete = false;
+            continue;
+        }
+
+        QRegularExpressionMatchIterator literals = stringLiteral.globalMatch(fieldList);
+        while (literals.hasNext()) {
+            const QStringList literalNames = literalValue(literals.next()).split(QLatin1Char(','), Qt::SkipEmptyParts);
+            for (const QString &name : literalNames) {
+                names << name.trimmed();
+            }
+        }
+        fieldList.remove(stringLiteral);
+        if (!fieldListSyntax.match(fieldList).hasMatch()) {
+            *complete = false;
+        }
+    }
+
+    if (*complete && !callsOnlyKnownFunctions(script)) {
+        *complete = false;
+    }
+
+    names.removeDuplicates();
+    qCDebug(OkularCoreDebug) << "Calculation reads" << names << (*complete ? "" : "and more");
+    return names;
+}
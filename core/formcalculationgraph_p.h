@@ -0,0 +1,70 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_FORMCALCULATIONGRAPH_P_H_
+#define _OKULAR_FORMCALCULATIONGRAPH_P_H_
+
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+class FormField;
+class Page;
+
+/**
+ * The calculated form fields of a document, in calculation order, with the
+ * fields each of them reads.
+ *
+ * The fields read by a calculation are found in the script of its calculate
+ * action, from the names given to getField() and AFSimple_Calculate(). When
+ * a name is not a string literal, the script calls a function that may read
+ * fields itself, like a document level one, or the script does not name any
+ * field, the calculation is assumed to read every field.
+ */
+class FormCalculationGraph
+{
+public:
+    struct CalculatedField {
+        FormField *field;
+        int page;
+        QStringList references;
+        bool readsEveryField;
+    };
+
+    /**
+     * Looks up the fields with the ids in @p calculateOrder in @p pages.
+     */
+    FormCalculationGraph(const QVector<Page *> &pages, const QVector<int> &calculateOrder);
+
+    /**
+     * The calculated fields, in calculation order.
+     */
+    const QVector<CalculatedField> &calculatedFields() const;
+
+    /**
+     * Returns whether @p calculatedField reads one of the fields
+     * named @p fieldNames.
+     */
+    static bool readsAnyOf(const CalculatedField &calculatedField, const QSet<QString> &fieldNames);
+
+    /**
+     * Returns the names of the fields read by @p script, sets @p complete to
+     * false if the script may read other fields too.
+     */
+    OKULARCORE_EXPORT static QStringList referencedFieldNames(const QString &script, bool *complete);
+
+private:
+    QVector<CalculatedField> m_calculatedFields;
+};
+
+}
+
+#endif
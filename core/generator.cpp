@@ -22,6 +22,8 @@
 #include <QDebug>
 #include <QIcon>
 #include <QMimeDatabase>
+#include <QSemaphore>
+#include <QThreadPool>
 #include <QTimer>
 
 #if HAVE_KWALLET
@@ -31,7 +33,10 @@
 #include "document_p.h"
 #include "page.h"
 #include "page_p.h"
+#include "settings_core.h"
 #include "textpage.h"
+#include "textpage_p.h"
+#include "tilesmanager_p.h"
 #include "utils.h"
 
 using namespace Okular;
@@ -39,9 +44,8 @@ using namespace Okular;
 GeneratorPrivate::GeneratorPrivate()
     : q_ptr(nullptr)
     , m_document(nullptr)
-    , mPixmapGenerationThread(nullptr)
     , mTextPageGenerationThread(nullptr)
-    , mPixmapReady(true)
+    , mPixmapGenerationsRunning(0)
     , mTextPageReady(true)
     , m_closing(false)
     , m_closingLoop(nullptr)
@@ -52,11 +56,11 @@ GeneratorPrivate::GeneratorPrivate()
 
 GeneratorPrivate::~GeneratorPrivate()
 {
-    if (mPixmapGenerationThread) {
-        mPixmapGenerationThread->wait();
+    for (PixmapGenerationThread *thread : std::as_const(mPixmapGenerationThreads)) {
+        thread->wait();
     }
 
-    delete mPixmapGenerationThread;
+    qDeleteAll(mPixmapGenerationThreads);
 
     if (mTextPageGenerationThread) {
         mTextPageGenerationThread->wait();
@@ -67,16 +71,19 @@ GeneratorPrivate::~GeneratorPrivate()
 
 PixmapGenerationThread *GeneratorPrivate::pixmapGenerationThread()
 {
-    if (mPixmapGenerationThread) {
-        return mPixmapGenerationThread;
+    for (PixmapGenerationThread *thread : std::as_const(mPixmapGenerationThreads)) {
+        if (!thread->isBusy()) {
+            return thread;
+        }
     }
 
     Q_Q(Generator);
-    mPixmapGenerationThread = new PixmapGenerationThread(q);
+    PixmapGenerationThread *thread = new PixmapGenerationThread(q);
     QObject::connect(
-        mPixmapGenerationThread, &PixmapGenerationThread::finished, q, [this] { pixmapGenerationFinished(); }, Qt::QueuedConnection);
+        thread, &PixmapGenerationThread::finished, q, [this, thread] { pixmapGenerationFinished(thread); }, Qt::QueuedConnection);
+    mPixmapGenerationThreads.append(thread);
 
-    return mPixmapGenerationThread;
+    return thread;
 }
 
 TextPageGenerationThread *GeneratorPrivate::textPageGenerationThread()
@@ -93,19 +100,19 @@ TextPageGenerationThread *GeneratorPrivate::textPageGenerationThread()
     return mTextPageGenerationThread;
 }
 
-void GeneratorPrivate::pixmapGenerationFinished()
+void GeneratorPrivate::pixmapGenerationFinished(PixmapGenerationThread *thread)
 {
     Q_Q(Generator);
-    PixmapRequest *request = mPixmapGenerationThread->request();
-    const QImage &img = mPixmapGenerationThread->image();
-    mPixmapGenerationThread->endGeneration();
+    PixmapRequest *request = thread->request();
+    const QImage &img = thread->image();
+    thread->endGeneration();
 
     QMutexLocker locker(threadsLock());
 
     if (m_closing) {
-        mPixmapReady = true;
+        --mPixmapGenerationsRunning;
         delete request;
-        if (mTextPageReady) {
+        if (mPixmapGenerationsRunning == 0 && mTextPageReady) {
             locker.unlock();
             m_closingLoop->quit();
         }
@@ -113,21 +120,22 @@ void GeneratorPrivate::pixmapGenerationFinished()
     }
 
     if (!request->shouldAbortRender()) {
-        request->page()->setPixmap(request->observer(), new QPixmap(QPixmap::fromImage(img)), request->normalizedRect());
+        PagePrivate::get(request->page())->setImage(request->observer(), img, request->normalizedRect(), false /* isPartialPixmap */, request->rotation());
         const int pageNumber = request->page()->number();
 
-        if (mPixmapGenerationThread->calcBoundingBox()) {
-            q->updatePageBoundingBox(pageNumber, mPixmapGenerationThread->boundingBox());
+        const PixmapRequestPrivate *requestPrivate = PixmapRequestPrivate::get(request);
+        if (requestPrivate->mResultBoundingBoxKnown) {
+            q->updatePageBoundingBox(pageNumber, requestPrivate->mResultBoundingBox);
         }
     } else {
-        // Cancel the text page generation too if it's still running
-        if (mTextPageGenerationThread && mTextPageGenerationThread->isRunning()) {
+        // Cancel the text page generation too if it's still running for this page
+        if (mTextPageGenerationThread && mTextPageGenerationThread->isRunning() && mTextPageGenerationThread->page() == request->page()) {
             mTextPageGenerationThread->abortExtraction();
             mTextPageGenerationThread->wait();
         }
     }
 
-    mPixmapReady = true;
+    --mPixmapGenerationsRunning;
     q->signalPixmapRequestDone(request);
 }
 
@@ -142,7 +150,7 @@ void GeneratorPrivate::textpageGenerationFinished()
 
     if (m_closing) {
         delete mTextPageGenerationThread->textPage();
-        if (mPixmapReady) {
+        if (mPixmapGenerationsRunning == 0) {
             locker.unlock();
             m_closingLoop->quit();
         }
@@ -161,6 +169,16 @@ QMutex *GeneratorPrivate::threadsLock()
     return &m_threadsMutex;
 }
 
+int GeneratorPrivate::maxPixmapGenerations() const
+{
+    if (!m_features.contains(Generator::ParallelRendering) || !m_features.contains(Generator::Threaded)) {
+        return 1;
+    }
+
+    const int threads = SettingsCore::renderThreads();
+    return threads > 0 ? threads : qMax(1, QThread::idealThreadCount());
+}
+
 QVariant GeneratorPrivate::metaData(const QString &, const QVariant &) const
 {
     return QVariant();
@@ -225,7 +243,7 @@ bool Generator::closeDocument()
     d->m_closing = true;
 
     d->threadsLock()->lock();
-    if (!(d->mPixmapReady && d->mTextPageReady)) {
+    if (!(d->mPixmapGenerationsRunning == 0 && d->mTextPageReady)) {
         QEventLoop loop;
         d->m_closingLoop = &loop;
 
@@ -248,7 +266,7 @@ bool Generator::closeDocument()
 bool Generator::canGeneratePixmap() const
 {
     Q_D(const Generator);
-    return d->mPixmapReady;
+    return d->mPixmapGenerationsRunning < d->maxPixmapGenerations();
 }
 
 bool Generator::canSign() const
@@ -269,7 +287,7 @@ CertificateStore *Generator::certificateStore() const
 void Generator::generatePixmap(PixmapRequest *request)
 {
     Q_D(Generator);
-    d->mPixmapReady = false;
+    ++d->mPixmapGenerationsRunning;
 
     const bool calcBoundingBox = !request->isTile() && !request->page()->isBoundingBoxKnown();
 
@@ -278,10 +296,16 @@ void Generator::generatePixmap(PixmapRequest *request)
             // It can happen that the text generation has already finished but
             // mTextPageReady is still false because textpageGenerationFinished
             // didn't have time to run, if so queue ourselves
-            QTimer::singleShot(0, this, [this, request] { generatePixmap(request); });
+            QTimer::singleShot(0, this, [this, request] {
+                // generatePixmap() will account for this generation again
+                --d_ptr->mPixmapGenerationsRunning;
+                generatePixmap(request);
+            });
             return;
         }
 
+        PixmapGenerationThread *thread = d->pixmapGenerationThread();
+
         /**
          * We create the text page for every page that is visible to the
          * user, so he can use the text extraction tools without a delay.
@@ -293,26 +317,27 @@ void Generator::generatePixmap(PixmapRequest *request)
             // dummy is used as a way to make sure the lambda gets disconnected each time it is executed
             // since not all the times the pixmap generation thread starts we want the text generation thread to also start
             QObject *dummy = new QObject();
-            connect(d_ptr->pixmapGenerationThread(), &QThread::started, dummy, [this, dummy] {
+            connect(thread, &QThread::started, dummy, [this, dummy] {
                 delete dummy;
                 d_ptr->textPageGenerationThread()->startGeneration();
             });
         }
         // pixmap generation thread must be started *after* connect(), else we may miss the start signal and get lock-ups (see bug 396137)
-        d->pixmapGenerationThread()->startGeneration(request, calcBoundingBox);
+        thread->startGeneration(request, calcBoundingBox);
 
         return;
     }
 
     const QImage &img = image(request);
-    request->page()->setPixmap(request->observer(), new QPixmap(QPixmap::fromImage(img)), request->normalizedRect());
+    PagePrivate::get(request->page())->setImage(request->observer(), img, request->normalizedRect(), false /* isPartialPixmap */, request->rotation());
     const int pageNumber = request->page()->number();
+    const Rotation rotation = request->rotation();
 
-    d->mPixmapReady = true;
+    --d->mPixmapGenerationsRunning;
 
     signalPixmapRequestDone(request);
     if (calcBoundingBox) {
-        updatePageBoundingBox(pageNumber, Utils::imageBoundingBox(&img));
+        updatePageBoundingBox(pageNumber, TilesManager::fromRotatedRect(Utils::imageBoundingBox(&img), rotation));
     }
 }
 
@@ -325,7 +350,27 @@ bool Generator::canGenerateTextPage() const
 void Generator::generateTextPage(Page *page)
 {
     TextRequest treq(page);
-    TextPage *tp = textPage(&treq);
+    // only threaded generators can extract the text out of the calling thread
+    const bool threaded = hasFeature(Threaded);
+    TextPage *tp = threaded ? nullptr : textPage(&treq);
+
+    // Correct the text order on a worker thread, so the calling thread only
+    // waits. The text generation thread is left to the generations started
+    // for pixmap requests.
+    if (threaded || tp) {
+        QSemaphore done;
+        QThreadPool::globalInstance()->start([this, page, threaded, &treq, &tp, &done] {
+            if (threaded) {
+                tp = textPage(&treq);
+            }
+            if (tp) {
+                TextPagePrivate::get(tp)->prepareForPage(page);
+            }
+            done.release();
+        });
+        done.acquire();
+    }
+
     page->setTextPage(tp);
     signalTextGenerationDone(page, tp);
 }
@@ -468,7 +513,7 @@ void Generator::signalPartialPixmapRequest(PixmapRequest *request, const QImage
     }
 
     PagePrivate *pagePrivate = PagePrivate::get(request->page());
-    pagePrivate->setPixmap(request->observer(), new QPixmap(QPixmap::fromImage(image)), request->normalizedRect(), true /* isPartialPixmap */);
+    pagePrivate->setImage(request->observer(), image, request->normalizedRect(), true /* isPartialPixmap */, request->rotation());
 
     const int pageNumber = request->page()->number();
     request->observer()->notifyPageChanged(pageNumber, Okular::DocumentObserver::Pixmap);
@@ -522,6 +567,14 @@ void Generator::updatePageBoundingBox(int page, const NormalizedRect &boundingBo
     }
 }
 
+void Generator::updatePageSizes(const QMap<int, QSizeF> &sizes)
+{
+    Q_D(Generator);
+    if (d->m_document) { // still connected to document?
+        d->m_document->setPageSizes(sizes);
+    }
+}
+
 QByteArray Generator::requestFontData(const Okular::FontInfo & /*font*/)
 {
     return {};
@@ -591,7 +644,9 @@ PixmapRequest::PixmapRequest(DocumentObserver *observer, int pageNumber, int wid
     d->mTile = false;
     d->mNormalizedRect = NormalizedRect();
     d->mPartialUpdatesWanted = false;
+    d->mRotation = Rotation0;
     d->mShouldAbortRender = 0;
+    d->mResultBoundingBoxKnown = false;
 }
 
 PixmapRequest::~PixmapRequest()
@@ -678,6 +733,11 @@ bool PixmapRequest::shouldAbortRender() const
     return d->mShouldAbortRender != 0;
 }
 
+Rotation PixmapRequest::rotation() const
+{
+    return d->mRotation;
+}
+
 Okular::TilesManager *PixmapRequestPrivate::tilesManager() const
 {
     return mPage->d->tilesManager(mObserver);
@@ -811,6 +871,7 @@ QDebug operator<<(QDebug str, const Okular::PixmapRequest &req)
     str << "- async:" << (req.asynchronous() ? "true" : "false");
     str << "- tile:" << (req.isTile() ? "true" : "false");
     str << "- rect:" << req.normalizedRect();
+    str << "- rotation:" << req.rotation();
     str << "- preload:" << (req.preload() ? "true" : "false");
     str << "- partialUpdates:" << (req.partialUpdatesWanted() ? "true" : "false");
     str << "- shouldAbort:" << (req.shouldAbortRender() ? "true" : "false");
@@ -21,6 +21,7 @@
 #include "signatureutils.h"
 
 #include <QList>
+#include <QMap>
 #include <QObject>
 #include <QSharedDataPointer>
 #include <QSizeF>
@@ -190,6 +191,7 @@ class OKULARCORE_EXPORT Generator : public QObject
     /// @cond PRIVATE
     friend class PixmapGenerationThread;
     friend class TextPageGenerationThread;
+    friend class TextSearchJobInternal;
     /// @endcond
 
     Q_OBJECT
@@ -200,17 +202,19 @@ public:
      * provide.
      */
     enum GeneratorFeature {
-        Threaded,          ///< Whether the Generator supports asynchronous generation of pictures or text pages
-        TextExtraction,    ///< Whether the Generator can extract text from the document in the form of TextPage's
-        ReadRawData,       ///< Whether the Generator can read a document directly from its raw data.
-        FontInfo,          ///< Whether the Generator can provide information about the fonts used in the document
-        PageSizes,         ///< Whether the Generator can change the size of the document pages.
-        PrintNative,       ///< Whether the Generator supports native cross-platform printing (QPainter-based).
-        PrintPostscript,   ///< Whether the Generator supports postscript-based file printing.
-        PrintToFile,       ///< Whether the Generator supports export to PDF & PS through the Print Dialog
-        TiledRendering,    ///< Whether the Generator can render tiles @since 0.16 (KDE 4.10)
-        SwapBackingFile,   ///< Whether the Generator can hot-swap the file it's reading from @since 1.3
-        SupportsCancelling ///< Whether the Generator can cancel requests @since 1.4
+        Threaded,           ///< Whether the Generator supports asynchronous generation of pictures or text pages
+        TextExtraction,     ///< Whether the Generator can extract text from the document in the form of TextPage's
+        ReadRawData,        ///< Whether the Generator can read a document directly from its raw data.
+        FontInfo,           ///< Whether the Generator can provide information about the fonts used in the document
+        PageSizes,          ///< Whether the Generator can change the size of the document pages.
+        PrintNative,        ///< Whether the Generator supports native cross-platform printing (QPainter-based).
+        PrintPostscript,    ///< Whether the Generator supports postscript-based file printing.
+        PrintToFile,        ///< Whether the Generator supports export to PDF & PS through the Print Dialog
+        TiledRendering,     ///< Whether the Generator can render tiles @since 0.16 (KDE 4.10)
+        SwapBackingFile,    ///< Whether the Generator can hot-swap the file it's reading from @since 1.3
+        SupportsCancelling, ///< Whether the Generator can cancel requests @since 1.4
+        ParallelRendering,  ///< Whether the Generator can render several pixmap requests at the same time from different threads @since 24.12
+        RotatedRendering    ///< Whether the Generator can render pages in the rotation given by PixmapRequest::rotation() @since 24.12
     };
 
     /**
@@ -303,6 +307,9 @@ public:
     /**
      * This method returns whether the generator is ready to
      * handle a new pixmap request.
+     *
+     * Generators with the @ref ParallelRendering feature are ready as long as
+     * not all the rendering threads are busy.
      */
     virtual bool canGeneratePixmap() const;
 
@@ -328,7 +335,9 @@ public:
      * This method can be called to trigger the generation of
      * a text page for the given @p page.
      *
-     * The generation is done in the calling thread.
+     * The calling thread waits for the generation. The text order is corrected
+     * on a worker thread, where threaded generators also extract the text;
+     * the others extract it in the calling thread.
      *
      * @see TextPage
      */
@@ -545,6 +554,9 @@ protected:
      *
      * @warning this method may be executed in its own separated thread if the
      * @ref Threaded is enabled!
+     *
+     * @warning if @ref ParallelRendering is enabled this method may be executed
+     * by several threads at the same time, each one with its own request.
      */
     virtual QImage image(PixmapRequest *request);
 
@@ -602,6 +614,16 @@ protected:
      */
     void updatePageBoundingBox(int page, const NormalizedRect &boundingBox);
 
+    /**
+     * Set the size of some pages after they have already been handed to the
+     * Document, for example when loadDocument() gave them a placeholder size
+     * because finding their real size is slow. @p sizes maps page numbers
+     * to their unrotated size. The observers are notified once for all of them.
+     *
+     * @since 24.12
+     */
+    void updatePageSizes(const QMap<int, QSizeF> &sizes);
+
     /**
      * Returns DPI, previously set via setDPI()
      * @since 0.19 (KDE 4.13)
@@ -765,6 +787,18 @@ public:
      */
     bool shouldAbortRender() const;
 
+    /**
+     * Returns the rotation the page has to be rendered in.
+     *
+     * It is always Rotation0 unless the generator has the RotatedRendering
+     * feature. Otherwise width(), height() and normalizedRect() describe
+     * the page once rotated, and the generator is expected to return an
+     * image of the rotated page.
+     *
+     * @since 24.12
+     */
+    Rotation rotation() const;
+
 private:
     Q_DISABLE_COPY(PixmapRequest)
 
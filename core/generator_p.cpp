@@ -9,6 +9,8 @@
 #include <QDebug>
 
 #include "fontinfo.h"
+#include "textpage_p.h"
+#include "tilesmanager_p.h"
 #include "utils.h"
 
 using namespace Okular;
@@ -38,28 +40,28 @@ PixmapRequest *PixmapGenerationThread::request() const
     return mRequest;
 }
 
-QImage PixmapGenerationThread::image() const
-{
-    return mRequest ? PixmapRequestPrivate::get(mRequest)->mResultImage : QImage();
-}
-
-bool PixmapGenerationThread::calcBoundingBox() const
+bool PixmapGenerationThread::isBusy() const
 {
-    return mCalcBoundingBox;
+    // mRequest is only reset once the finished() signal has been processed
+    return mRequest != nullptr;
 }
 
-NormalizedRect PixmapGenerationThread::boundingBox() const
+QImage PixmapGenerationThread::image() const
 {
-    return mBoundingBox;
+    return mRequest ? PixmapRequestPrivate::get(mRequest)->mResultImage : QImage();
 }
 
 void PixmapGenerationThread::run()
 {
     if (mRequest) {
-        PixmapRequestPrivate::get(mRequest)->mResultImage = mGenerator->image(mRequest);
+        PixmapRequestPrivate *requestPrivate = PixmapRequestPrivate::get(mRequest);
+        requestPrivate->mResultImage = mGenerator->image(mRequest);
 
         if (mCalcBoundingBox) {
-            mBoundingBox = Utils::imageBoundingBox(&PixmapRequestPrivate::get(mRequest)->mResultImage);
+            // the bounding box is in the coordinates of the unrotated page, it
+            // goes with the request so the GUI thread only has to store it
+            requestPrivate->mResultBoundingBox = TilesManager::fromRotatedRect(Utils::imageBoundingBox(&requestPrivate->mResultImage), mRequest->rotation());
+            requestPrivate->mResultBoundingBoxKnown = true;
         }
     }
 }
@@ -118,6 +120,12 @@ bool TextPageGenerationThread::shouldAbortExtraction() const
     return mTextRequest.shouldAbortExtraction();
 }
 
+TextPage *TextPageGenerationThread::extractedTextPage(Generator *generator, Page *page)
+{
+    TextRequest request(page);
+    return generator->textPage(&request);
+}
+
 void TextPageGenerationThread::run()
 {
     mTextPage = nullptr;
@@ -129,6 +137,8 @@ void TextPageGenerationThread::run()
     if (mTextRequest.shouldAbortExtraction()) {
         delete mTextPage;
         mTextPage = nullptr;
+    } else if (mTextPage) {
+        TextPagePrivate::get(mTextPage)->prepareForPage(page());
     }
 }
 
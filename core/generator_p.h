@@ -48,9 +48,12 @@ public:
     PixmapGenerationThread *pixmapGenerationThread();
     TextPageGenerationThread *textPageGenerationThread();
 
-    void pixmapGenerationFinished();
+    void pixmapGenerationFinished(PixmapGenerationThread *thread);
     void textpageGenerationFinished();
 
+    // how many pixmap requests can be rendered at the same time
+    int maxPixmapGenerations() const;
+
     QMutex *threadsLock();
 
     virtual QVariant metaData(const QString &key, const QVariant &option) const;
@@ -60,11 +63,11 @@ public:
     // NOTE: the following should be a QSet< GeneratorFeature >,
     // but it is not to avoid #include'ing generator.h
     QSet<int> m_features;
-    PixmapGenerationThread *mPixmapGenerationThread;
+    QList<PixmapGenerationThread *> mPixmapGenerationThreads;
     TextPageGenerationThread *mTextPageGenerationThread;
     mutable QMutex m_mutex;
     QMutex m_threadsMutex;
-    bool mPixmapReady : 1;
+    int mPixmapGenerationsRunning;
     bool mTextPageReady : 1;
     bool m_closing : 1;
     QEventLoop *m_closingLoop;
@@ -90,8 +93,13 @@ public:
     bool mPartialUpdatesWanted : 1;
     Page *mPage;
     NormalizedRect mNormalizedRect;
+    Rotation mRotation;
     QAtomicInt mShouldAbortRender;
     QImage mResultImage;
+    // the bounding box of the contents of mResultImage on the unrotated page,
+    // computed by the thread that rendered it when asked for
+    NormalizedRect mResultBoundingBox;
+    bool mResultBoundingBoxKnown : 1;
 };
 
 class TextRequestPrivate
@@ -115,10 +123,9 @@ public:
     void endGeneration();
 
     PixmapRequest *request() const;
+    bool isBusy() const;
 
     QImage image() const;
-    bool calcBoundingBox() const;
-    NormalizedRect boundingBox() const;
 
 protected:
     void run() override;
@@ -126,7 +133,6 @@ protected:
 private:
     Generator *mGenerator;
     PixmapRequest *mRequest;
-    NormalizedRect mBoundingBox;
     bool mCalcBoundingBox : 1;
 };
 
@@ -147,6 +153,12 @@ public:
     void abortExtraction();
     bool shouldAbortExtraction() const;
 
+    /**
+     * Returns the text of @p page as @p generator extracts it, before its order
+     * is corrected, for the benchmarks
+     */
+    OKULARCORE_EXPORT static TextPage *extractedTextPage(Generator *generator, Page *page);
+
 public Q_SLOTS:
     void startGeneration();
 
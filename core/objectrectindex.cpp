@@ -0,0 +1,182 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "objectrectindex_p.h"
+
+#include "annotations.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace Okular;
+
+// a grid has about this many object rects per cell
+static const int kRectsPerCell = 4;
+// and at most this many cells per side
+static const int kMaximumGridSize = 64;
+
+// Returns the area of the page out of which @p rect is not closer to a point than the area is
+static QRectF indexedArea(const ObjectRect *rect, double pageWidth, double pageHeight)
+{
+    if (rect->objectType() == ObjectRect::OAnnotation) {
+        // the distance to an annotation is measured from its shape, which is
+        // inside its boundary, minus the width of its stroke
+        const Annotation *annotation = static_cast<const AnnotationObjectRect *>(rect)->annotation();
+        const NormalizedRect boundary = annotation->transformedBoundingRectangle();
+        const double strokeWidth = annotation->style().width();
+        const double xMargin = pageWidth > 0 ? strokeWidth / pageWidth : 0;
+        const double yMargin = pageHeight > 0 ? strokeWidth / pageHeight : 0;
+        return QRectF(QPointF(boundary.left - xMargin, boundary.top - yMargin), QPointF(boundary.right + xMargin, boundary.bottom + yMargin)).normalized();
+    }
+
+    return rect->region().boundingRect();
+}
+
+ObjectRectIndex::ObjectRectIndex(const QList<ObjectRect *> &rects, double pageWidth, double pageHeight)
+{
+    std::vector<QRectF> areas(rects.count());
+    int counts[3] = {0, 0, 0};
+    for (int i = 0; i < rects.count(); ++i) {
+        if (isIndexed(rects[i]->objectType())) {
+            areas[i] = indexedArea(rects[i], pageWidth, pageHeight);
+            ++counts[rects[i]->objectType()];
+        }
+    }
+
+    for (int type = 0; type < 3; ++type) {
+        Grid &grid = m_grids[type];
+        grid.size = qBound(1, int(std::ceil(std::sqrt(double(counts[type]) / kRectsPerCell))), kMaximumGridSize);
+        grid.cells.resize(grid.size * grid.size);
+    }
+
+    // in the order of the object rects, so each cell lists them in that order
+    for (int i = 0; i < rects.count(); ++i) {
+        if (!isIndexed(rects[i]->objectType())) {
+            continue;
+        }
+
+        Grid &grid = m_grids[rects[i]->objectType()];
+        const QRectF &area = areas[i];
+        const int lastColumn = column(grid, area.right());
+        const int lastRow = row(grid, area.bottom());
+        for (int r = row(grid, area.top()); r <= lastRow; ++r) {
+            for (int c = column(grid, area.left()); c <= lastColumn; ++c) {
+                grid.cells[r * grid.size + c].push_back(i);
+            }
+        }
+    }
+}
+
+bool ObjectRectIndex::isIndexed(ObjectRect::ObjectType type)
+{
+    return type == ObjectRect::Action || type == ObjectRect::Image || type == ObjectRect::OAnnotation;
+}
+
+const ObjectRectIndex::Grid &ObjectRectIndex::grid(ObjectRect::ObjectType type) const
+{
+    return m_grids[type];
+}
+
+// Points outside of the page are in the cells at its border
+int ObjectRectIndex::column(const Grid &grid, double x) const
+{
+    return qBound(0, int(std::floor(x * grid.size)), grid.size - 1);
+}
+
+int ObjectRectIndex::row(const Grid &grid, double y) const
+{
+    return qBound(0, int(std::floor(y * grid.size)), grid.size - 1);
+}
+
+QList<int> ObjectRectIndex::candidates(ObjectRect::ObjectType type, double x, double y, double xScale, double yScale, double maxDistanceSqr) const
+{
+    const Grid &grid = this->grid(type);
+    const double maxDistance = std::sqrt(maxDistanceSqr);
+    const double xMargin = xScale > 0 ? maxDistance / xScale : 1;
+    const double yMargin = yScale > 0 ? maxDistance / yScale : 1;
+
+    QList<int> result;
+    const int lastColumn = column(grid, x + xMargin);
+    const int lastRow = row(grid, y + yMargin);
+    for (int r = row(grid, y - yMargin); r <= lastRow; ++r) {
+        for (int c = column(grid, x - xMargin); c <= lastColumn; ++c) {
+            const std::vector<int> &cell = grid.cells[r * grid.size + c];
+            result.append(QList<int>(cell.begin(), cell.end()));
+        }
+    }
+
+    // an object rect covering several of the cells is in all of them
+    std::sort(result.begin(), result.end(), std::greater<int>());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+int ObjectRectIndex::nearest(const QList<ObjectRect *> &rects, ObjectRect::ObjectType type, double x, double y, double xScale, double yScale, double *distance) const
+{
+    const Grid &grid = this->grid(type);
+    int nearest = -1;
+    double minDistance = std::numeric_limits<double>::max();
+    auto visit = [&rects, &grid, &nearest, &minDistance, x, y, xScale, yScale](int r, int c) {
+        for (int i : grid.cells[r * grid.size + c]) {
+            const double d = rects[i]->distanceSqr(x, y, xScale, yScale);
+            if (d < minDistance || (d == minDistance && i < nearest)) {
+                nearest = i;
+                minDistance = d;
+            }
+        }
+    };
+
+    const bool onPage = x >= 0 && x <= 1 && y >= 0 && y <= 1;
+    if (!onPage) {
+        // the rings below only bound the distance of points on the page
+        for (int r = 0; r < grid.size; ++r) {
+            for (int c = 0; c < grid.size; ++c) {
+                visit(r, c);
+            }
+        }
+    } else {
+        // visit the rings of cells around the one of the point until the
+        // cells left are farther than the nearest object rect found
+        const int pointColumn = column(grid, x);
+        const int pointRow = row(grid, y);
+        for (int ring = 0; ring < grid.size; ++ring) {
+            const int firstColumn = pointColumn - ring;
+            const int lastColumn = pointColumn + ring;
+            const int firstRow = pointRow - ring;
+            const int lastRow = pointRow + ring;
+            for (int r = qMax(0, firstRow); r <= qMin(grid.size - 1, lastRow); ++r) {
+                for (int c = qMax(0, firstColumn); c <= qMin(grid.size - 1, lastColumn); ++c) {
+                    if (r == firstRow || r == lastRow || c == firstColumn || c == lastColumn) {
+                        visit(r, c);
+                    }
+                }
+            }
+
+            double bound = std::numeric_limits<double>::max();
+            if (firstColumn > 0) {
+                bound = qMin(bound, (x - double(firstColumn) / grid.size) * xScale);
+            }
+            if (lastColumn < grid.size - 1) {
+                bound = qMin(bound, (double(lastColumn + 1) / grid.size - x) * xScale);
+            }
+            if (firstRow > 0) {
+                bound = qMin(bound, (y - double(firstRow) / grid.size) * yScale);
+            }
+            if (lastRow < grid.size - 1) {
+                bound = qMin(bound, (double(lastRow + 1) / grid.size - y) * yScale);
+            }
+            if (bound == std::numeric_limits<double>::max() || minDistance <= bound * bound) {
+                break;
+            }
+        }
+    }
+
+    if (distance) {
+        *distance = minDistance;
+    }
+    return nearest;
+}
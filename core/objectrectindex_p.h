@@ -0,0 +1,78 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_OBJECTRECTINDEX_P_H_
+#define _OKULAR_OBJECTRECTINDEX_P_H_
+
+#include "area.h"
+#include "okularcore_export.h"
+
+#include <QList>
+#include <QRectF>
+
+#include <vector>
+
+namespace Okular
+{
+/**
+ * Finds the object rects of a page near a point without looking at all of them.
+ *
+ * The object rects of each indexed type are put in the cells of a uniform grid
+ * over the page that their bounding box covers, so that only the ones in the
+ * cells around the point have their distance to it computed. The grid gets
+ * more cells as the page gets more object rects.
+ *
+ * The index is built from the object rects as they are, so it has to be built
+ * again whenever they are added, removed, rotated or moved.
+ *
+ * Source references are not indexed, their distance doesn't follow their
+ * bounding box.
+ */
+class OKULARCORE_EXPORT ObjectRectIndex
+{
+public:
+    /**
+     * Indexes @p rects, the object rects of a page of @p pageWidth x @p pageHeight.
+     */
+    ObjectRectIndex(const QList<ObjectRect *> &rects, double pageWidth, double pageHeight);
+
+    ObjectRectIndex(const ObjectRectIndex &) = delete;
+    ObjectRectIndex &operator=(const ObjectRectIndex &) = delete;
+
+    static bool isIndexed(ObjectRect::ObjectType type);
+
+    /**
+     * Returns the positions in the object rects of those of @p type whose
+     * bounding box may be closer than @p maxDistanceSqr to the point (@p x, @p y)
+     * at a page size of @p xScale x @p yScale, last ones first.
+     */
+    QList<int> candidates(ObjectRect::ObjectType type, double x, double y, double xScale, double yScale, double maxDistanceSqr) const;
+
+    /**
+     * Returns the position in @p rects, the object rects that were indexed, of the
+     * one of @p type nearest to the point (@p x, @p y) at a page size of
+     * @p xScale x @p yScale, or -1 if there is none, and sets @p distance to its
+     * squared distance.
+     */
+    int nearest(const QList<ObjectRect *> &rects, ObjectRect::ObjectType type, double x, double y, double xScale, double yScale, double *distance) const;
+
+private:
+    struct Grid {
+        int size = 0;
+        // the positions of the object rects in each cell, row by row
+        std::vector<std::vector<int>> cells;
+    };
+
+    const Grid &grid(ObjectRect::ObjectType type) const;
+    int column(const Grid &grid, double x) const;
+    int row(const Grid &grid, double y) const;
+
+    Grid m_grids[3];
+};
+
+}
+
+#endif
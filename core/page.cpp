@@ -14,6 +14,7 @@
 #include <QDomDocument>
 #include <QDomElement>
 #include <QHash>
+#include <QPainter>
 #include <QPixmap>
 #include <QSet>
 #include <QString>
@@ -31,6 +32,9 @@
 #include "document_p.h"
 #include "form.h"
 #include "form_p.h"
+#include "generator.h"
+#include "generator_p.h"
+#include "objectrectindex_p.h"
 #include "observer.h"
 #include "pagecontroller_p.h"
 #include "pagesize.h"
@@ -50,6 +54,8 @@
 using namespace Okular;
 
 static const double distanceConsideredEqual = 25; // 5px
+// pages with fewer object rects are quicker to look through than to index
+static const int minimumIndexedObjectRects = 32;
 
 static void deleteObjectRects(QList<ObjectRect *> &rects, const QSet<ObjectRect::ObjectType> &which)
 {
@@ -64,6 +70,13 @@ static void deleteObjectRects(QList<ObjectRect *> &rects, const QSet<ObjectRect:
     }
 }
 
+// Whether a render of the part @p rect of the page is the one of a damaged part
+// rather than of the whole page
+static bool isDamageRect(const NormalizedRect &rect)
+{
+    return !rect.isNull() && !(rect == NormalizedRect(0., 0., 1., 1.));
+}
+
 PagePrivate::PagePrivate(Page *page, uint n, double w, double h, Rotation o)
     : m_page(page)
     , m_number(n)
@@ -109,21 +122,26 @@ void PagePrivate::imageRotationDone(RotationJob *job)
 {
     TilesManager *tm = tilesManager(job->observer());
     if (tm) {
-        QPixmap *pixmap = new QPixmap(QPixmap::fromImage(job->image()));
-        tm->setPixmap(pixmap, job->rect(), job->isPartialUpdate());
-        delete pixmap;
+        tm->setImage(job->image(), job->rect(), job->isPartialUpdate());
+        return;
+    }
+
+    if (!job->isPartialUpdate() && isDamageRect(job->rect())) {
+        if (!mergeImage(job->observer(), job->image(), job->rect())) {
+            rejectDamageImage(job->observer(), job->image(), job->rect());
+        }
         return;
     }
 
     QMap<DocumentObserver *, PixmapObject>::iterator it = m_pixmaps.find(job->observer());
     if (it != m_pixmaps.end()) {
         PixmapObject &object = it.value();
-        (*object.m_pixmap) = QPixmap::fromImage(job->image());
+        object.m_image = job->image();
         object.m_rotation = job->rotation();
         object.m_isPartialPixmap = job->isPartialUpdate();
     } else {
         PixmapObject object;
-        object.m_pixmap = new QPixmap(QPixmap::fromImage(job->image()));
+        object.m_image = job->image();
         object.m_rotation = job->rotation();
         object.m_isPartialPixmap = job->isPartialUpdate();
 
@@ -240,9 +258,9 @@ bool Page::hasPixmap(DocumentObserver *observer, int width, int height, const No
         return false;
     }
 
-    const QPixmap *pixmap = it.value().m_pixmap;
+    const QImage &image = it.value().m_image;
 
-    return (pixmap->width() == width && pixmap->height() == height);
+    return (image.width() == width && image.height() == height);
 }
 
 void Page::setPageSize(DocumentObserver *observer, int width, int height)
@@ -282,6 +300,26 @@ bool Page::hasObjectRect(double x, double y, double xScale, double yScale) const
         return false;
     }
 
+    if (m_rects.count() >= minimumIndexedObjectRects) {
+        const ObjectRectIndex *index = d->objectRectIndex();
+        for (ObjectRect::ObjectType type : {ObjectRect::Action, ObjectRect::Image, ObjectRect::OAnnotation}) {
+            const QList<int> candidates = index->candidates(type, x, y, xScale, yScale, distanceConsideredEqual);
+            for (int i : candidates) {
+                if (m_rects[i]->distanceSqr(x, y, xScale, yScale) < distanceConsideredEqual) {
+                    return true;
+                }
+            }
+        }
+
+        // the source references are not indexed
+        for (const ObjectRect *rect : m_rects) {
+            if (rect->objectType() == ObjectRect::SourceRef && rect->distanceSqr(x, y, xScale, yScale) < distanceConsideredEqual) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     for (const ObjectRect *rect : m_rects) {
         if (rect->distanceSqr(x, y, xScale, yScale) < distanceConsideredEqual) {
             return true;
@@ -404,7 +442,7 @@ void PagePrivate::rotateAt(Rotation orientation)
 
         const PagePrivate::PixmapObject &object = it.value();
 
-        RotationJob *job = new RotationJob(object.m_pixmap->toImage(), object.m_rotation, m_rotation, it.key());
+        RotationJob *job = new RotationJob(object.m_image, object.m_rotation, m_rotation, it.key());
         job->setPage(this);
         m_doc->m_pageController->addRotationJob(job);
     }
@@ -429,6 +467,7 @@ void PagePrivate::rotateAt(Rotation orientation)
     for (ObjectRect *objRect : std::as_const(m_page->m_rects)) {
         objRect->transform(matrix);
     }
+    invalidateObjectRectIndex();
 
     const QTransform highlightRotationMatrix = Okular::buildRotationMatrix((Rotation)(((int)m_rotation - (int)oldRotation + 4) % 4));
     for (HighlightAreaRect *hlar : std::as_const(m_page->m_highlights)) {
@@ -451,10 +490,37 @@ void PagePrivate::changeSize(const PageSize &size)
     if (m_rotation % 2) {
         std::swap(m_width, m_height);
     }
+
+    // the stroke of the annotations takes another part of the page
+    invalidateObjectRectIndex();
+}
+
+const ObjectRectIndex *PagePrivate::objectRectIndex()
+{
+    if (!m_objectRectIndex) {
+        m_objectRectIndex = std::make_unique<ObjectRectIndex>(m_page->m_rects, m_width, m_height);
+    }
+    return m_objectRectIndex.get();
+}
+
+void PagePrivate::invalidateObjectRectIndex()
+{
+    m_objectRectIndex.reset();
 }
 
 const ObjectRect *Page::objectRect(ObjectRect::ObjectType type, double x, double y, double xScale, double yScale) const
 {
+    if (ObjectRectIndex::isIndexed(type) && m_rects.count() >= minimumIndexedObjectRects) {
+        // the candidates come last ones first too
+        const QList<int> candidates = d->objectRectIndex()->candidates(type, x, y, xScale, yScale, distanceConsideredEqual);
+        for (int i : candidates) {
+            if (m_rects[i]->distanceSqr(x, y, xScale, yScale) < distanceConsideredEqual) {
+                return m_rects[i];
+            }
+        }
+        return nullptr;
+    }
+
     // Walk list in reverse order so that annotations in the foreground are preferred
     QListIterator<ObjectRect *> it(m_rects);
     it.toBack();
@@ -472,6 +538,16 @@ QList<const ObjectRect *> Page::objectRects(ObjectRect::ObjectType type, double
 {
     QList<const ObjectRect *> result;
 
+    if (ObjectRectIndex::isIndexed(type) && m_rects.count() >= minimumIndexedObjectRects) {
+        const QList<int> candidates = d->objectRectIndex()->candidates(type, x, y, xScale, yScale, distanceConsideredEqual);
+        for (int i : candidates) {
+            if (m_rects[i]->distanceSqr(x, y, xScale, yScale) < distanceConsideredEqual) {
+                result.append(m_rects[i]);
+            }
+        }
+        return result;
+    }
+
     QListIterator<ObjectRect *> it(m_rects);
     it.toBack();
     while (it.hasPrevious()) {
@@ -486,6 +562,11 @@ QList<const ObjectRect *> Page::objectRects(ObjectRect::ObjectType type, double
 
 const ObjectRect *Page::nearestObjectRect(ObjectRect::ObjectType type, double x, double y, double xScale, double yScale, double *distance) const
 {
+    if (ObjectRectIndex::isIndexed(type) && m_rects.count() >= minimumIndexedObjectRects) {
+        const int nearest = d->objectRectIndex()->nearest(m_rects, type, x, y, xScale, yScale, distance);
+        return nearest >= 0 ? m_rects[nearest] : nullptr;
+    }
+
     ObjectRect *res = nullptr;
     double minDistance = std::numeric_limits<double>::max();
 
@@ -546,40 +627,94 @@ QList<FormField *> Page::formFields() const
 
 void Page::setPixmap(DocumentObserver *observer, QPixmap *pixmap, const NormalizedRect &rect)
 {
-    d->setPixmap(observer, pixmap, rect, false /*isPartialPixmap*/);
+    d->setImage(observer, pixmap->toImage(), rect, false /*isPartialPixmap*/, Rotation0);
+    delete pixmap;
 }
 
-void PagePrivate::setPixmap(DocumentObserver *observer, QPixmap *pixmap, const NormalizedRect &rect, bool isPartialPixmap)
+void PagePrivate::setImage(DocumentObserver *observer, const QImage &image, const NormalizedRect &rect, bool isPartialPixmap, Rotation imageRotation)
 {
-    if (m_rotation == Rotation0) {
+    if (imageRotation == m_rotation) {
         TilesManager *tm = tilesManager(observer);
         if (tm) {
-            tm->setPixmap(pixmap, rect, isPartialPixmap);
-            delete pixmap;
+            tm->setImage(image, rect, isPartialPixmap);
             return;
         }
 
-        QMap<DocumentObserver *, PagePrivate::PixmapObject>::iterator it = m_pixmaps.find(observer);
-        if (it != m_pixmaps.end()) {
-            delete it.value().m_pixmap;
-        } else {
-            it = m_pixmaps.insert(observer, PagePrivate::PixmapObject());
+        // a part of the page rendered again after it changed
+        if (!isPartialPixmap && isDamageRect(rect)) {
+            if (!mergeImage(observer, image, rect)) {
+                rejectDamageImage(observer, image, rect);
+            }
+            return;
         }
-        it.value().m_pixmap = pixmap;
-        it.value().m_rotation = m_rotation;
-        it.value().m_isPartialPixmap = isPartialPixmap;
+
+        PagePrivate::PixmapObject &object = m_pixmaps[observer];
+        object.m_image = image;
+        object.m_rotation = m_rotation;
+        object.m_isPartialPixmap = isPartialPixmap;
     } else {
-        // it can happen that we get a setPixmap while closing and thus the page controller is gone
+        // it can happen that we get a setImage while closing and thus the page controller is gone
         if (m_doc->m_pageController) {
-            RotationJob *job = new RotationJob(pixmap->toImage(), Rotation0, m_rotation, observer);
+            RotationJob *job = new RotationJob(image, imageRotation, m_rotation, observer);
             job->setPage(this);
-            job->setRect(TilesManager::toRotatedRect(rect, m_rotation));
+            job->setRect(TilesManager::toRotatedRect(TilesManager::fromRotatedRect(rect, imageRotation), m_rotation));
             job->setIsPartialUpdate(isPartialPixmap);
             m_doc->m_pageController->addRotationJob(job);
         }
+    }
+}
+
+bool PagePrivate::mergeImage(DocumentObserver *observer, const QImage &image, const NormalizedRect &rect)
+{
+    if (!isDamageRect(rect)) {
+        return false;
+    }
+
+    QMap<DocumentObserver *, PagePrivate::PixmapObject>::iterator it = m_pixmaps.find(observer);
+    if (it == m_pixmaps.end() || it.value().m_isPartialPixmap || it.value().m_rotation != m_rotation) {
+        return false;
+    }
+
+    QImage &target = it.value().m_image;
+    const QRect area = rect.geometry(target.width(), target.height());
+    // rotating the rect back and forth may round it differently by a pixel
+    if (qAbs(area.width() - image.width()) > 1 || qAbs(area.height() - image.height()) > 1) {
+        return false;
+    }
+
+    const qreal dpr = target.devicePixelRatio();
+    QPainter painter(&target);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(QRectF(area.x() / dpr, area.y() / dpr, area.width() / dpr, area.height() / dpr), image, QRectF(image.rect()));
+    return true;
+}
 
-        delete pixmap;
+void PagePrivate::rejectDamageImage(DocumentObserver *observer, const QImage &image, const NormalizedRect &rect)
+{
+    // the image of the observer changed size or rotation since the damage was
+    // requested, keep it as it is until the whole page is rendered again
+    const int width = qRound(image.width() / rect.width());
+    const int height = qRound(image.height() / rect.height());
+    qCDebug(OkularCoreDebug) << "Dropping the render of" << rect << "of page" << m_number << ", rendering the whole page at" << width << "x" << height;
+    if (width <= 0 || height <= 0) {
+        return;
     }
+
+    // the generator is still busy with the request of the image, ask once it is done
+    DocumentPrivate *doc = m_doc;
+    Page *page = m_page;
+    const int pageNumber = m_number;
+    QMetaObject::invokeMethod(
+        doc->m_parent,
+        [doc, page, pageNumber, observer, width, height] {
+            if (doc->m_pagesVector.value(pageNumber) != page || !doc->m_observers.contains(observer)) {
+                return;
+            }
+            PixmapRequest *request = new PixmapRequest(observer, pageNumber, width, height, 1 /* dpr */, 1, PixmapRequest::Asynchronous);
+            request->d->mForce = true;
+            doc->m_parent->requestPixmaps({request}, Document::NoOption);
+        },
+        Qt::QueuedConnection);
 }
 
 void Page::setTextPage(TextPage *textPage)
@@ -588,9 +723,8 @@ void Page::setTextPage(TextPage *textPage)
 
     d->m_text = textPage;
     if (d->m_text) {
-        d->m_text->d->m_page = this;
-        // Correct/optimize text order for search and text selection
-        d->m_text->d->correctTextOrder();
+        // Usually already done by the thread that extracted the text
+        d->m_text->d->prepareForPage(this);
     }
 }
 
@@ -610,6 +744,7 @@ void Page::setObjectRects(const QList<ObjectRect *> &rects)
     }
 
     m_rects << rects;
+    d->invalidateObjectRectIndex();
 }
 
 const QList<ObjectRect *> &Page::objectRects() const
@@ -641,6 +776,7 @@ void Page::setSourceReferences(const QList<SourceRefObjectRect *> &refRects)
     for (SourceRefObjectRect *rect : refRects) {
         m_rects << rect;
     }
+    d->invalidateObjectRectIndex();
 }
 
 void Page::setDuration(double seconds)
@@ -681,6 +817,7 @@ void Page::addAnnotation(Annotation *annotation)
         annotation->setUniqueName(uniqueName);
     }
     annotation->d_ptr->m_page = d;
+    annotation->d_ptr->m_drawnBoundary = annotation->d_ptr->m_boundary;
     m_annotations.append(annotation);
 
     AnnotationObjectRect *rect = new AnnotationObjectRect(annotation);
@@ -690,6 +827,7 @@ void Page::addAnnotation(Annotation *annotation)
     annotation->d_ptr->annotationTransform(matrix);
 
     m_rects.append(rect);
+    d->invalidateObjectRectIndex();
 }
 
 bool Page::removeAnnotation(Annotation *annotation)
@@ -713,6 +851,7 @@ bool Page::removeAnnotation(Annotation *annotation)
             qCDebug(OkularCoreDebug) << "removed annotation:" << annotation->uniqueName();
             annotation->d_ptr->m_page = nullptr;
             m_annotations.erase(aIt);
+            d->invalidateObjectRectIndex();
             break;
         }
     }
@@ -757,19 +896,12 @@ void Page::deletePixmap(DocumentObserver *observer)
         delete tm;
         d->m_tilesManagers.remove(observer);
     } else {
-        PagePrivate::PixmapObject object = d->m_pixmaps.take(observer);
-        delete object.m_pixmap;
+        d->m_pixmaps.remove(observer);
     }
 }
 
 void Page::deletePixmaps()
 {
-    QMapIterator<DocumentObserver *, PagePrivate::PixmapObject> it(d->m_pixmaps);
-    while (it.hasNext()) {
-        it.next();
-        delete it.value().m_pixmap;
-    }
-
     d->m_pixmaps.clear();
 
     qDeleteAll(d->m_tilesManagers);
@@ -782,6 +914,7 @@ void Page::deleteRects()
     QSet<ObjectRect::ObjectType> which;
     which << ObjectRect::Action << ObjectRect::Image;
     deleteObjectRects(m_rects, which);
+    d->invalidateObjectRectIndex();
 }
 
 void PagePrivate::deleteHighlights(int s_id)
@@ -808,6 +941,7 @@ void PagePrivate::deleteTextSelections()
 void Page::deleteSourceReferences()
 {
     deleteObjectRects(m_rects, QSet<ObjectRect::ObjectType>() << ObjectRect::SourceRef);
+    d->invalidateObjectRectIndex();
 }
 
 void Page::deleteAnnotations()
@@ -817,6 +951,7 @@ void Page::deleteAnnotations()
     // delete all stored annotations
     qDeleteAll(m_annotations);
     m_annotations.clear();
+    d->invalidateObjectRectIndex();
 }
 
 bool PagePrivate::restoreLocalContents(const QDomNode &pageNode)
@@ -983,30 +1118,44 @@ void PagePrivate::saveLocalContents(QDomNode &parentNode, QDomDocument &document
     }
 }
 
-const QPixmap *Page::_o_nearestPixmap(DocumentObserver *observer, int w, int h) const
+QImage Page::_o_nearestImage(DocumentObserver *observer, int w, int h) const
 {
     Q_UNUSED(h)
 
-    const QPixmap *pixmap = nullptr;
+    QImage image;
 
-    // if a pixmap is present for given id, use it
+    // if an image is present for given id, use it
     QMap<DocumentObserver *, PagePrivate::PixmapObject>::const_iterator itPixmap = d->m_pixmaps.constFind(observer);
     if (itPixmap != d->m_pixmaps.constEnd()) {
-        pixmap = itPixmap.value().m_pixmap;
+        image = itPixmap.value().m_image;
     } else if (!d->m_pixmaps.isEmpty()) {
         // else find the closest match using pixmaps of other IDs (great optim!)
         int minDistance = -1;
         QMap<DocumentObserver *, PagePrivate::PixmapObject>::const_iterator it = d->m_pixmaps.constBegin(), end = d->m_pixmaps.constEnd();
         for (; it != end; ++it) {
-            int pixWidth = (*it).m_pixmap->width(), distance = pixWidth > w ? pixWidth - w : w - pixWidth;
+            int pixWidth = (*it).m_image.width(), distance = pixWidth > w ? pixWidth - w : w - pixWidth;
             if (minDistance == -1 || distance < minDistance) {
-                pixmap = (*it).m_pixmap;
+                image = (*it).m_image;
                 minDistance = distance;
             }
         }
     }
 
-    return pixmap;
+    return image;
+}
+
+const QPixmap *Page::_o_nearestPixmap(DocumentObserver *observer, int w, int h) const
+{
+    const QImage image = _o_nearestImage(observer, w, h);
+    if (image.isNull()) {
+        return nullptr;
+    }
+
+    if (!d->m_nearestPixmap || d->m_nearestPixmapImageKey != image.cacheKey()) {
+        d->m_nearestPixmap = std::make_unique<QPixmap>(QPixmap::fromImage(image));
+        d->m_nearestPixmapImageKey = image.cacheKey();
+    }
+    return d->m_nearestPixmap.get();
 }
 
 bool Page::hasTilesManager(const DocumentObserver *observer) const
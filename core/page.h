@@ -415,6 +415,9 @@ private:
     friend class ::PagePainter;
     /// @endcond
 
+    QImage _o_nearestImage(DocumentObserver *, int, int) const;
+    // kept for binary compatibility, the pixmap is made from _o_nearestImage()
+    // and lives until the next call
     const QPixmap *_o_nearestPixmap(DocumentObserver *, int, int) const;
 
     QList<ObjectRect *> m_rects;
@@ -12,11 +12,15 @@
 #define _OKULAR_PAGE_PRIVATE_H_
 
 // qt/kde includes
+#include <QImage>
 #include <QMap>
+#include <QPixmap>
 #include <QString>
 #include <QTransform>
 #include <qdom.h>
 
+#include <memory>
+
 // local includes
 #include "area.h"
 #include "global.h"
@@ -31,6 +35,7 @@ class DocumentObserver;
 class DocumentPrivate;
 class FormField;
 class HighlightAreaRect;
+class ObjectRectIndex;
 class Page;
 class PageSize;
 class PageTransition;
@@ -123,6 +128,18 @@ public:
      */
     void setTilesManager(const DocumentObserver *observer, TilesManager *tm);
 
+    /**
+     * Returns the index of the object rects of the page, built again if
+     * they changed since it was last used.
+     */
+    const ObjectRectIndex *objectRectIndex();
+
+    /**
+     * Drops the index of the object rects, for when they are added,
+     * removed, rotated or moved.
+     */
+    void invalidateObjectRectIndex();
+
     /**
      * Moves contents that are generated from oldPage to this. And clears them from page
      * so it can be deleted fine.
@@ -134,12 +151,33 @@ public:
      */
     OKULARCORE_EXPORT static FormField *findEquivalentForm(const Page *p, FormField *oldField);
 
-    void setPixmap(DocumentObserver *observer, QPixmap *pixmap, const NormalizedRect &rect, bool isPartialPixmap);
+    /**
+     * Sets the @p image of @p observer, rendered in @p imageRotation with
+     * @p rect in the coordinates of the page rotated by it. It is rotated to
+     * the rotation of the page by a RotationJob if they differ.
+     */
+    void setImage(DocumentObserver *observer, const QImage &image, const NormalizedRect &rect, bool isPartialPixmap, Rotation imageRotation);
+
+    /**
+     * Paints @p image, the render of the part @p rect of the page, over the
+     * image of @p observer, keeping the rest of it.
+     *
+     * Returns false if @p rect is the whole page or if the observer has no
+     * complete image of the size @p image was rendered for.
+     */
+    bool mergeImage(DocumentObserver *observer, const QImage &image, const NormalizedRect &rect);
+
+    /**
+     * Drops @p image, the render of the damaged part @p rect of the page that
+     * mergeImage() could not paint over the image of @p observer, and asks
+     * for the whole page at the size @p image was rendered for instead.
+     */
+    void rejectDamageImage(DocumentObserver *observer, const QImage &image, const NormalizedRect &rect);
 
     class PixmapObject
     {
     public:
-        QPixmap *m_pixmap = nullptr;
+        QImage m_image;
         Rotation m_rotation;
         bool m_isPartialPixmap = false;
     };
@@ -158,6 +196,10 @@ public:
     PageTransition *m_transition;
     HighlightAreaRect *m_textSelections;
     QList<FormField *> formfields;
+    std::unique_ptr<ObjectRectIndex> m_objectRectIndex;
+    // the one handed out by Page::_o_nearestPixmap(), and the image it was made from
+    mutable std::unique_ptr<QPixmap> m_nearestPixmap;
+    mutable qint64 m_nearestPixmapImageKey = 0;
     Action *m_openingAction;
     Action *m_closingAction;
     double m_duration;
@@ -9,6 +9,9 @@
 // local includes
 #include "page_p.h"
 #include "rotationjob_p.h"
+#include "textsearchjob_p.h"
+
+#include <QThread>
 
 #include <threadweaver/queueing.h>
 
@@ -17,6 +20,8 @@ using namespace Okular;
 PageController::PageController()
     : QObject()
 {
+    // text extraction is mostly CPU bound, use all the cores for searching
+    m_searchWeaver.setMaximumNumberOfThreads(QThread::idealThreadCount());
 }
 
 PageController::~PageController()
@@ -29,6 +34,12 @@ void PageController::addRotationJob(RotationJob *job)
     ThreadWeaver::enqueue(&m_weaver, job);
 }
 
+void PageController::addTextSearchJob(TextSearchJob *job)
+{
+    connect(job, &TextSearchJob::done, this, &PageController::textSearchDone);
+    ThreadWeaver::enqueue(&m_searchWeaver, job);
+}
+
 void PageController::imageRotationDone(const ThreadWeaver::JobPointer &j)
 {
     RotationJob *job = static_cast<RotationJob *>(j.data());
@@ -39,3 +50,8 @@ void PageController::imageRotationDone(const ThreadWeaver::JobPointer &j)
         Q_EMIT rotationFinished(job->page()->m_number, job->page()->m_page);
     }
 }
+
+void PageController::textSearchDone(const ThreadWeaver::JobPointer &j)
+{
+    Q_EMIT textSearchFinished(static_cast<TextSearchJob *>(j.data()));
+}
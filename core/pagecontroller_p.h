@@ -15,9 +15,10 @@ namespace Okular
 {
 class Page;
 class RotationJob;
+class TextSearchJob;
 
 /* There is one PageController per document. It receives notifications of
- * completed RotationJobs */
+ * completed RotationJobs and TextSearchJobs */
 class PageController : public QObject
 {
     Q_OBJECT
@@ -27,15 +28,19 @@ public:
     ~PageController() override;
 
     void addRotationJob(RotationJob *job);
+    void addTextSearchJob(TextSearchJob *job);
 
 Q_SIGNALS:
     void rotationFinished(int page, Okular::Page *okularPage);
+    void textSearchFinished(Okular::TextSearchJob *job);
 
 private Q_SLOTS:
     void imageRotationDone(const ThreadWeaver::JobPointer &job);
+    void textSearchDone(const ThreadWeaver::JobPointer &job);
 
 private:
     ThreadWeaver::Queue m_weaver;
+    ThreadWeaver::Queue m_searchWeaver;
 };
 
 }
@@ -16,9 +16,12 @@
 #include "page_p.h"
 #include <unordered_set>
 
+#include <algorithm>
 #include <cstring>
+#include <numeric>
+#include <vector>
 
-#include <QVarLengthArray>
+#include <QStringMatcher>
 #include <QtAlgorithms>
 
 using namespace Okular;
@@ -51,24 +54,26 @@ class SearchPoint
 {
 public:
     SearchPoint()
-        : offset_begin(-1)
+        : entity_begin(-1)
+        , entity_end(-1)
+        , offset_begin(-1)
         , offset_end(-1)
     {
     }
 
-    /** The TextEntity containing the first character of the match. */
-    TextEntity::List::ConstIterator it_begin;
+    /** The index of the TextEntity containing the first character of the match. */
+    int entity_begin;
 
-    /** The TextEntity containing the last character of the match. */
-    TextEntity::List::ConstIterator it_end;
+    /** The index of the TextEntity containing the last character of the match. */
+    int entity_end;
 
-    /** The index of the first character of the match in (*it_begin)->text().
-     *  Satisfies 0 <= offset_begin < (*it_begin)->text().length().
+    /** The index of the first character of the match in the text of entity_begin.
+     *  Satisfies 0 <= offset_begin < text length.
      */
     int offset_begin;
 
-    /** One plus the index of the last character of the match in (*it_end)->text().
-     *  Satisfies 0 < offset_end <= (*it_end)->text().length().
+    /** One plus the index of the last character of the match in the text of entity_end.
+     *  Satisfies 0 < offset_end <= text length.
      */
     int offset_end;
 };
@@ -156,8 +161,111 @@ NormalizedRect TextEntity::transformedArea(const QTransform &matrix) const
     return transformed_area;
 }
 
+NormalizedRect PackedTextEntities::transformedArea(int i, const QTransform &matrix) const
+{
+    NormalizedRect transformed_area = area(i);
+    transformed_area.transform(matrix);
+    return transformed_area;
+}
+
+bool PackedTextEntities::startsWord(int i) const
+{
+    if (i == 0) {
+        return true;
+    }
+
+    const QStringView previous = text(i - 1);
+    if (previous.isEmpty() || !previous.back().isSpace()) {
+        return false;
+    }
+
+    // hyphenated words continue in the next line
+    if (previous.endsWith(QLatin1String("-\n"))) {
+        return false;
+    }
+    if (previous == QLatin1String("\n") && i > 1 && text(i - 2).endsWith(QLatin1Char('-'))) {
+        return false;
+    }
+
+    return true;
+}
+
+int PackedTextEntities::wordStart(int i) const
+{
+    // m_wordStarts always contains 0, the first entity of the first word
+    const auto it = std::upper_bound(m_wordStarts.constBegin(), m_wordStarts.constEnd(), i);
+    return *(it - 1);
+}
+
+void PackedTextEntities::append(QStringView text, const NormalizedRect &area)
+{
+    if (m_offsets.isEmpty()) {
+        m_offsets.append(0);
+    }
+
+    m_text.append(text);
+    m_offsets.append(m_text.length());
+    m_left.append(area.left);
+    m_top.append(area.top);
+    m_right.append(area.right);
+    m_bottom.append(area.bottom);
+
+    const int i = count() - 1;
+    if (startsWord(i)) {
+        m_wordStarts.append(i);
+    }
+}
+
+void PackedTextEntities::removeLast()
+{
+    const int i = count() - 1;
+    if (!m_wordStarts.isEmpty() && m_wordStarts.last() == i) {
+        m_wordStarts.removeLast();
+    }
+
+    m_offsets.removeLast();
+    m_text.truncate(m_offsets.last());
+    m_left.removeLast();
+    m_top.removeLast();
+    m_right.removeLast();
+    m_bottom.removeLast();
+}
+
+TextEntity::List PackedTextEntities::toList() const
+{
+    TextEntity::List list;
+    list.reserve(count());
+    for (int i = 0; i < count(); ++i) {
+        list.append(TextEntity(text(i).toString(), area(i)));
+    }
+    return list;
+}
+
+void PackedTextEntities::setList(const TextEntity::List &list)
+{
+    *this = PackedTextEntities();
+
+    qsizetype textLength = 0;
+    for (const TextEntity &te : list) {
+        textLength += te.text().length();
+    }
+    m_text.reserve(textLength);
+    m_offsets.reserve(list.count() + 1);
+    m_left.reserve(list.count());
+    m_top.reserve(list.count());
+    m_right.reserve(list.count());
+    m_bottom.reserve(list.count());
+
+    for (const TextEntity &te : list) {
+        append(te.text(), te.area());
+    }
+
+    m_wordStarts.squeeze();
+}
+
 TextPagePrivate::TextPagePrivate()
     : m_page(nullptr)
+    , m_preparedPage(nullptr)
 {
 }
 
@@ -174,7 +282,7 @@ TextPage::TextPage()
 TextPage::TextPage(const TextEntity::List &words)
     : d(new TextPagePrivate())
 {
-    d->m_words = words;
+    d->setWordList(words);
 }
 
 TextPage::~TextPage()
@@ -185,20 +293,21 @@ TextPage::~TextPage()
 void TextPage::append(const QString &text, const NormalizedRect &area)
 {
     if (!text.isEmpty()) {
+        d->m_searchIndex.clear();
         if (!d->m_words.isEmpty()) {
-            const TextEntity &lastEntity = d->m_words.last();
+            const int last = d->m_words.count() - 1;
             // Unicode Normalization Form KC (NFKC) may alter characters, for example ⑥ to 6, so we use NFC
-            const QString concatText = lastEntity.text() + text.normalized(QString::NormalizationForm_C);
+            const QString concatText = d->m_words.text(last).toString() + text.normalized(QString::NormalizationForm_C);
             if (concatText != concatText.normalized(QString::NormalizationForm_C)) {
                 // If this happens it means that the new text + old one have combined, for example A and ◌̊  form Å
-                NormalizedRect newArea = area | lastEntity.area();
+                NormalizedRect newArea = area | d->m_words.area(last);
                 d->m_words.removeLast();
-                d->m_words.append(TextEntity(concatText.normalized(QString::NormalizationForm_C), newArea));
+                d->m_words.append(concatText.normalized(QString::NormalizationForm_C), newArea);
                 return;
             }
         }
 
-        d->m_words.append(TextEntity(text.normalized(QString::NormalizationForm_C), area));
+        d->m_words.append(text.normalized(QString::NormalizationForm_C), area);
     }
 }
 
@@ -224,56 +333,6 @@ struct WordWithCharacters {
 };
 typedef QList<WordWithCharacters> WordsWithCharacters;
 
-/**
- * We will divide the whole page in some regions depending on the horizontal and
- * vertical spacing among different regions. Each region will have an area and an
- * associated WordsWithCharacters in sorted order.
- */
-class RegionText
-{
-public:
-    RegionText() {};
-
-    RegionText(const WordsWithCharacters &wordsWithCharacters, const QRect area)
-        : m_region_wordWithCharacters(wordsWithCharacters)
-        , m_area(area)
-    {
-    }
-
-    inline QString string() const
-    {
-        QString res;
-        for (const WordWithCharacters &word : m_region_wordWithCharacters) {
-            res += word.text();
-        }
-        return res;
-    }
-
-    inline WordsWithCharacters text() const
-    {
-        return m_region_wordWithCharacters;
-    }
-
-    inline QRect area() const
-    {
-        return m_area;
-    }
-
-    inline void setArea(const QRect area)
-    {
-        m_area = area;
-    }
-
-    inline void setText(const WordsWithCharacters &wordsWithCharacters)
-    {
-        m_region_wordWithCharacters = wordsWithCharacters;
-    }
-
-private:
-    WordsWithCharacters m_region_wordWithCharacters;
-    QRect m_area;
-};
-
 std::unique_ptr<RegularAreaRect> TextPage::textArea(const TextSelection &sel) const
 {
     if (d->m_words.isEmpty()) {
@@ -386,28 +445,29 @@ std::unique_ptr<RegularAreaRect> TextPage::textArea(const TextSelection &sel) co
         }
     }
 
-    TextEntity::List::ConstIterator it = d->m_words.constBegin(), itEnd = d->m_words.constEnd();
-    TextEntity::List::ConstIterator start = it, end = itEnd, tmpIt = it; //, tmpItEnd = itEnd;
+    const PackedTextEntities &words = d->m_words;
+    const int count = words.count();
+    int start = 0, end = count;
     const MergeSide side = d->m_page ? (MergeSide)d->m_page->totalOrientation() : MergeRight;
 
     NormalizedRect tmp;
     // case 2(a)
-    for (; it != itEnd; ++it) {
-        tmp = it->area();
+    for (int i = 0; i < count; ++i) {
+        tmp = words.area(i);
         if (tmp.contains(startC.x, startC.y)) {
-            start = it;
+            start = i;
         }
         if (tmp.contains(endC.x, endC.y)) {
-            end = it;
+            end = i;
         }
     }
 
     // case 2(b)
-    it = tmpIt;
-    if (start == it && end == itEnd) {
-        for (; it != itEnd; ++it) {
+    if (start == 0 && end == count) {
+        int i = 0;
+        for (; i < count; ++i) {
             // is there any text rectangle within the start_end rect
-            tmp = it->area();
+            tmp = words.area(i);
             if (start_end.intersects(tmp)) {
                 break;
             }
@@ -415,25 +475,24 @@ std::unique_ptr<RegularAreaRect> TextPage::textArea(const TextSelection &sel) co
 
         // we have searched every text entities, but none is within the rectangle created by start and end
         // so, no selection should be done
-        if (it == itEnd) {
+        if (i == count) {
             return ret;
         }
     }
-    it = tmpIt;
     bool selection_two_start = false;
 
     // case 3.a
-    if (start == it) {
+    if (start == 0) {
         NormalizedRect rect;
 
         // selection type 01
         if (startC.y <= endC.y) {
-            for (; it != itEnd; ++it) {
-                rect = it->area();
+            for (int i = 0; i < count; ++i) {
+                rect = words.area(i);
                 bool flagV = !rect.isBottom(startC);
 
                 if (flagV && rect.isRight(startC)) {
-                    start = it;
+                    start = i;
                     break;
                 }
             }
@@ -444,8 +503,8 @@ std::unique_ptr<RegularAreaRect> TextPage::textArea(const TextSelection &sel) co
             selection_two_start = true;
             int distance = scaleX + scaleY + 100;
 
-            for (; it != itEnd; ++it) {
-                rect = it->area();
+            for (int i = 0; i < count; ++i) {
+                rect = words.area(i);
 
                 if (rect.isBottomOrLevel(startC) && rect.isRight(startC)) {
                     QRect entRect = rect.geometry(scaleX, scaleY);
@@ -463,7 +522,7 @@ std::unique_ptr<RegularAreaRect> TextPage::textArea(const TextSelection &sel) co
 
                     if ((xdist + ydist) < distance) {
                         distance = xdist + ydist;
-                        start = it;
+                        start = i;
                     }
                 }
             }
@@ -471,19 +530,16 @@ std::unique_ptr<RegularAreaRect> TextPage::textArea(const TextSelection &sel) co
     }
 
     // case 3.b
-    if (end == itEnd) {
-        it = tmpIt;
-        itEnd = itEnd - 1;
-
+    if (end == count) {
         NormalizedRect rect;
 
         if (startC.y <= endC.y) {
-            for (; itEnd >= it; itEnd--) {
-                rect = itEnd->area();
+            for (int i = count - 1; i >= 0; i--) {
+                rect = words.area(i);
                 bool flagV = !rect.isTop(endC);
 
                 if (flagV && rect.isLeft(endC)) {
-                    end = itEnd;
+                    end = i;
                     break;
                 }
             }
@@ -491,8 +547,8 @@ std::unique_ptr<RegularAreaRect> TextPage::textArea(const TextSelection &sel) co
 
         else {
             int distance = scaleX + scaleY + 100;
-            for (; itEnd >= it; itEnd--) {
-                rect = itEnd->area();
+            for (int i = count - 1; i >= 0; i--) {
+                rect = words.area(i);
 
                 if (rect.isTopOrLevel(endC) && rect.isLeft(endC)) {
                     QRect entRect = rect.geometry(scaleX, scaleY);
@@ -510,7 +566,7 @@ std::unique_ptr<RegularAreaRect> TextPage::textArea(const TextSelection &sel) co
 
                     if ((xdist + ydist) < distance) {
                         distance = xdist + ydist;
-                        end = itEnd;
+                        end = i;
                     }
                 }
             }
@@ -529,18 +585,16 @@ std::unique_ptr<RegularAreaRect> TextPage::textArea(const TextSelection &sel) co
 
     // if start is less than end swap them
     if (start > end) {
-        it = start;
-        start = end;
-        end = it;
+        std::swap(start, end);
     }
 
     // removes the possibility of crash, in case none of 1 to 3 is true
-    if (end == d->m_words.constEnd()) {
+    if (end == count) {
         end--;
     }
 
     for (; start <= end; start++) {
-        ret->appendShape(start->transformedArea(matrix), side);
+        ret->appendShape(words.transformedArea(start, matrix), side);
     }
 
     return ret;
@@ -553,9 +607,9 @@ RegularAreaRect *TextPage::findText(int searchID, const QString &query, SearchDi
     if (d->m_words.isEmpty() || query.isEmpty() || (area && area->isNull())) {
         return nullptr;
     }
-    TextEntity::List::ConstIterator start;
+    int start;
     int start_offset = 0;
-    TextEntity::List::ConstIterator end;
+    int end;
     const QMap<int, SearchPoint *>::const_iterator sIt = d->m_searchPoints.constFind(searchID);
     if (sIt == d->m_searchPoints.constEnd()) {
         // if no previous run of this search is found, then set it to start
@@ -569,34 +623,33 @@ RegularAreaRect *TextPage::findText(int searchID, const QString &query, SearchDi
     bool forward = true;
     switch (dir) {
     case FromTop:
-        start = d->m_words.constBegin();
+        start = 0;
         start_offset = 0;
-        end = d->m_words.constEnd();
+        end = d->m_words.count();
         break;
     case FromBottom:
-        start = d->m_words.constEnd();
+        start = d->m_words.count();
         start_offset = 0;
-        end = d->m_words.constBegin();
+        end = 0;
         forward = false;
         break;
     case NextResult:
-        start = (*sIt)->it_end;
+        start = (*sIt)->entity_end;
         start_offset = (*sIt)->offset_end;
-        end = d->m_words.constEnd();
+        end = d->m_words.count();
         break;
     case PreviousResult:
-        start = (*sIt)->it_begin;
+        start = (*sIt)->entity_begin;
         start_offset = (*sIt)->offset_begin;
-        end = d->m_words.constBegin();
+        end = 0;
         forward = false;
         break;
     };
     RegularAreaRect *ret = nullptr;
-    const TextComparisonFunction cmpFn = caseSensitivity == Qt::CaseSensitive ? CaseSensitiveCmpFn : CaseInsensitiveCmpFn;
     if (forward) {
-        ret = d->findTextInternalForward(searchID, query, cmpFn, start, start_offset, end);
+        ret = d->findTextInternalForward(searchID, query, caseSensitivity, start, start_offset);
     } else {
-        ret = d->findTextInternalBackward(searchID, query, cmpFn, start, start_offset, end);
+        ret = d->findTextInternalBackward(searchID, query, caseSensitivity, start, start_offset, end);
     }
     return ret;
 }
@@ -605,7 +658,7 @@ RegularAreaRect *TextPage::findText(int searchID, const QString &query, SearchDi
 // we have a '-' just followed by a '\n' character
 // check if the string contains a '-' character
 // if the '-' is the last entry
-static int stringLengthAdaptedWithHyphen(const QString &str, TextEntity::List::ConstIterator it, TextEntity::List::ConstIterator textListEnd)
+static int stringLengthAdaptedWithHyphen(QStringView str, int i, const PackedTextEntities &words)
 {
     const int len = str.length();
 
@@ -614,17 +667,17 @@ static int stringLengthAdaptedWithHyphen(const QString &str, TextEntity::List::C
     // check if the string contains a '-' character
     // if the '-' is the last entry
     if (str.endsWith(QLatin1Char('-'))) {
-        // validity chek of it + 1
-        if ((it + 1) != textListEnd) {
+        // validity chek of i + 1
+        if ((i + 1) != words.count()) {
             // 1. if the next character is '\n'
-            const QString &lookahedStr = (it + 1)->text();
+            const QStringView lookahedStr = words.text(i + 1);
             if (lookahedStr.startsWith(QLatin1Char('\n'))) {
                 return len - 1;
             }
 
             // 2. if the next word is in a different line or not
-            const NormalizedRect &hyphenArea = it->area();
-            const NormalizedRect &lookaheadArea = (it + 1)->area();
+            const NormalizedRect hyphenArea = words.area(i);
+            const NormalizedRect lookaheadArea = words.area(i + 1);
 
             // lookahead to check whether both the '-' rect and next character rect overlap
             if (!doesConsumeY(hyphenArea, lookaheadArea, 70)) {
@@ -640,56 +693,133 @@ static int stringLengthAdaptedWithHyphen(const QString &str, TextEntity::List::C
     return len;
 }
 
+// Use NFKC for search operations. NFKC leaves ASCII untouched, so only
+// make a normalized copy of the text when it has other characters
+static QStringView normalizedForSearch(QStringView str, QString *storage)
+{
+    for (const QChar c : str) {
+        if (c.unicode() >= 0x80) {
+            *storage = str.toString().normalized(QString::NormalizationForm_KC);
+            return *storage;
+        }
+    }
+    return str;
+}
+
+void TextSearchIndex::build(const PackedTextEntities &words)
+{
+    clear();
+
+    const int count = words.count();
+    m_offsets.reserve(count + 1);
+    m_text.reserve(words.concatenatedText().length());
+    for (int i = 0; i < count; ++i) {
+        m_offsets.append(m_text.length());
+        QString normalizedStr;
+        const QStringView str = normalizedForSearch(words.text(i), &normalizedStr);
+        m_text.append(str);
+        if (stringLengthAdaptedWithHyphen(str, i, words) < str.length()) {
+            m_optionalHyphens.append(i);
+        }
+    }
+    m_offsets.append(m_text.length());
+}
+
+void TextSearchIndex::clear()
+{
+    m_text.clear();
+    m_offsets.clear();
+    m_optionalHyphens.clear();
+}
+
+int TextSearchIndex::entityAt(int position) const
+{
+    // entities with an empty normalized text share their offset with the next one
+    return std::upper_bound(m_offsets.constBegin(), m_offsets.constEnd(), position) - m_offsets.constBegin() - 1;
+}
+
+int TextSearchIndex::nextOptionalHyphen(int position) const
+{
+    const auto it = std::upper_bound(m_optionalHyphens.constBegin(), m_optionalHyphens.constEnd(), position, [this](int pos, int i) { return pos < m_offsets[i + 1]; });
+    return it == m_optionalHyphens.constEnd() ? -1 : *it;
+}
+
+int TextSearchIndex::previousOptionalHyphen(int position) const
+{
+    const auto it = std::lower_bound(m_optionalHyphens.constBegin(), m_optionalHyphens.constEnd(), position, [this](int i, int pos) { return m_offsets[i] < pos; });
+    return it == m_optionalHyphens.constBegin() ? -1 : *(it - 1);
+}
+
+TextPagePrivate *TextPagePrivate::get(const TextPage *textPage)
+{
+    return textPage ? textPage->d : nullptr;
+}
+
+void TextPagePrivate::prepareForPage(Page *page)
+{
+    m_page = page;
+    if (m_preparedPage != page) {
+        // Correct/optimize text order for search and text selection
+        correctTextOrder();
+        m_preparedPage = page;
+    }
+    searchIndex();
+}
+
+const TextSearchIndex &TextPagePrivate::searchIndex()
+{
+    if (!m_searchIndex.isBuilt()) {
+        m_searchIndex.build(m_words);
+    }
+    return m_searchIndex;
+}
+
 RegularAreaRect *TextPagePrivate::searchPointToArea(const SearchPoint *sp)
 {
     const PagePrivate *pagePrivate = PagePrivate::get(m_page);
     const QTransform matrix = pagePrivate ? pagePrivate->rotationMatrix() : QTransform();
     RegularAreaRect *ret = new RegularAreaRect;
 
-    for (TextEntity::List::ConstIterator it = sp->it_begin;; it++) {
-        const TextEntity &curEntity = *it;
-        ret->append(curEntity.transformedArea(matrix));
-
-        if (it == sp->it_end) {
-            break;
-        }
+    for (int i = sp->entity_begin; i <= sp->entity_end; i++) {
+        ret->append(m_words.transformedArea(i, matrix));
     }
 
     ret->simplify();
     return ret;
 }
 
-RegularAreaRect *TextPagePrivate::findTextInternalForward(int searchID, const QString &_query, TextComparisonFunction comparer, TextEntity::List::ConstIterator start, int start_offset, TextEntity::List::ConstIterator end)
+bool TextPagePrivate::matchForward(const QString &query, TextComparisonFunction comparer, int start, int start_offset, int lastStartPosition, SearchPoint *sp)
 {
-    // normalize query search all unicode (including glyphs)
-    // Use NFKC for search operations. Use NFC for copy, makeWord, and export operations.
-    const QString query = _query.normalized(QString::NormalizationForm_KC);
+    const TextSearchIndex &textIndex = searchIndex();
+    const int end = m_words.count();
 
     // j is the current position in our query
     // queryLeft is the length of the query we have left to match
     int j = 0, queryLeft = query.length();
 
-    TextEntity::List::ConstIterator it = start;
+    int index = start;
     int offset = start_offset;
 
-    TextEntity::List::ConstIterator it_begin = TextEntity::List::ConstIterator();
+    int index_begin = -1;
     int offset_begin = 0; // dummy initial value to suppress compiler warnings
 
-    while (it != end) {
-        const TextEntity &curEntity = *it;
-        const QString &str = curEntity.text().normalized(QString::NormalizationForm_KC);
+    while (index != end) {
+        const QStringView str = textIndex.text(index);
         const int strLen = str.length();
-        const int adjustedLen = stringLengthAdaptedWithHyphen(str, it, m_words.constEnd());
+        const int adjustedLen = stringLengthAdaptedWithHyphen(str, index, m_words);
         // adjustedLen <= strLen
 
         if (offset >= strLen) {
-            it++;
+            index++;
             offset = 0;
             continue;
         }
 
-        if (it_begin == TextEntity::List::ConstIterator()) {
-            it_begin = it;
+        if (index_begin == -1) {
+            if (textIndex.position(index, offset) > lastStartPosition) {
+                return false;
+            }
+            index_begin = index;
             offset_begin = offset;
         }
 
@@ -699,7 +829,7 @@ RegularAreaRect *TextPagePrivate::findTextInternalForward(int searchID, const QS
             // we have equal (or less than) area of the query left as the length of the current
             // entity
             const int min = qMin(queryLeft, matchingLen - offset);
-            if (comparer(QStringView {str}.mid(offset, min), QStringView {query}.mid(j, min))) {
+            if (comparer(str.mid(offset, min), QStringView {query}.mid(j, min))) {
                 matchedLen = min;
                 break;
             }
@@ -715,9 +845,9 @@ RegularAreaRect *TextPagePrivate::findTextInternalForward(int searchID, const QS
 #endif
             j = 0;
             queryLeft = query.length();
-            it = it_begin;
+            index = index_begin;
             offset = offset_begin + 1;
-            it_begin = TextEntity::List::ConstIterator();
+            index_begin = -1;
         } else {
             // we have a match
             // move the current position in the query
@@ -732,24 +862,69 @@ RegularAreaRect *TextPagePrivate::findTextInternalForward(int searchID, const QS
             queryLeft -= matchedLen;
 
             if (queryLeft == 0) {
-                // save or update the search point for the current searchID
-                QMap<int, SearchPoint *>::iterator sIt = m_searchPoints.find(searchID);
-                if (sIt == m_searchPoints.end()) {
-                    sIt = m_searchPoints.insert(searchID, new SearchPoint);
-                }
-                SearchPoint *sp = *sIt;
-                sp->it_begin = it_begin;
-                sp->it_end = it;
+                sp->entity_begin = index_begin;
+                sp->entity_end = index;
                 sp->offset_begin = offset_begin;
                 sp->offset_end = offset + matchedLen;
-                return searchPointToArea(sp);
+                return true;
             }
 
-            it++;
+            index++;
             offset = 0;
         }
     }
     // end of loop - it means that we've ended the textentities
+    return false;
+}
+
+RegularAreaRect *TextPagePrivate::findTextInternalForward(int searchID, const QString &_query, Qt::CaseSensitivity caseSensitivity, int start, int start_offset)
+{
+    // normalize query search all unicode (including glyphs)
+    // Use NFKC for search operations. Use NFC for copy, makeWord, and export operations.
+    const QString query = _query.normalized(QString::NormalizationForm_KC);
+    const TextComparisonFunction comparer = caseSensitivity == Qt::CaseSensitive ? CaseSensitiveCmpFn : CaseInsensitiveCmpFn;
+
+    const TextSearchIndex &textIndex = searchIndex();
+    const QStringMatcher matcher(query, caseSensitivity);
+    // a match omitting a hyphen starts at most this far before the hyphen
+    const int hyphenWindow = 2 * query.length() + 2;
+
+    // Matches that contain the text as it is in the page are found with the
+    // matcher on the whole normalized text. Only around the hyphens the query
+    // may omit we fall back to matching entity by entity, so that the first
+    // match found is the same one a plain entity walk would find.
+    SearchPoint found;
+    bool matched = false;
+    int from = textIndex.position(start, start_offset);
+    while (!matched) {
+        const int matchPosition = matcher.indexIn(textIndex.concatenatedText(), from);
+        const int hyphen = textIndex.nextOptionalHyphen(from);
+        const int hyphenWindowStart = hyphen == -1 ? -1 : qMax(from, textIndex.position(hyphen, 0) - hyphenWindow);
+
+        if (matchPosition != -1 && (hyphenWindowStart == -1 || matchPosition < hyphenWindowStart)) {
+            const int matchEntity = textIndex.entityAt(matchPosition);
+            matched = matchForward(query, comparer, matchEntity, matchPosition - textIndex.position(matchEntity, 0), matchPosition, &found);
+            from = matchPosition + 1;
+        } else if (hyphenWindowStart != -1) {
+            const int windowEntity = textIndex.entityAt(hyphenWindowStart);
+            const int hyphenEnd = textIndex.position(hyphen + 1, 0);
+            matched = matchForward(query, comparer, windowEntity, hyphenWindowStart - textIndex.position(windowEntity, 0), hyphenEnd - 1, &found);
+            from = hyphenEnd;
+        } else {
+            break;
+        }
+    }
+
+    if (matched) {
+        // save or update the search point for the current searchID
+        QMap<int, SearchPoint *>::iterator sIt = m_searchPoints.find(searchID);
+        if (sIt == m_searchPoints.end()) {
+            sIt = m_searchPoints.insert(searchID, new SearchPoint);
+        }
+        SearchPoint *sp = *sIt;
+        *sp = found;
+        return searchPointToArea(sp);
+    }
 
     const QMap<int, SearchPoint *>::iterator sIt = m_searchPoints.find(searchID);
     if (sIt != m_searchPoints.end()) {
@@ -760,43 +935,43 @@ RegularAreaRect *TextPagePrivate::findTextInternalForward(int searchID, const QS
     return nullptr;
 }
 
-RegularAreaRect *TextPagePrivate::findTextInternalBackward(int searchID, const QString &_query, TextComparisonFunction comparer, TextEntity::List::ConstIterator start, int start_offset, TextEntity::List::ConstIterator end)
+bool TextPagePrivate::matchBackward(const QString &query, TextComparisonFunction comparer, int start, int start_offset, int end, int firstEndPosition, SearchPoint *sp)
 {
-    // normalize query to search all unicode (including glyphs)
-    // Use NFKC for search operations. Use NFC for copy, makeWord, and export operations.
-    const QString query = _query.normalized(QString::NormalizationForm_KC);
-
     // j is the current position in our query
     // len is the length of the string in TextEntity
     // queryLeft is the length of the query we have left
     int j = query.length(), queryLeft = query.length();
 
-    TextEntity::List::ConstIterator it = start;
+    const TextSearchIndex &textIndex = searchIndex();
+
+    int index = start;
     int offset = start_offset;
 
-    TextEntity::List::ConstIterator it_begin = TextEntity::List::ConstIterator();
+    int index_begin = -1;
     int offset_begin = 0; // dummy initial value to suppress compiler warnings
 
     while (true) {
         if (offset <= 0) {
-            if (it == end) {
+            if (index == end) {
                 break;
             }
-            it--;
+            index--;
         }
 
-        const TextEntity &curEntity = *it;
-        const QString &str = curEntity.text().normalized(QString::NormalizationForm_KC);
+        const QStringView str = textIndex.text(index);
         const int strLen = str.length();
-        const int adjustedLen = stringLengthAdaptedWithHyphen(str, it, m_words.constEnd());
+        const int adjustedLen = stringLengthAdaptedWithHyphen(str, index, m_words);
         // adjustedLen <= strLen
 
         if (offset <= 0) {
             offset = strLen;
         }
 
-        if (it_begin == TextEntity::List::ConstIterator()) {
-            it_begin = it;
+        if (index_begin == -1) {
+            if (textIndex.position(index, offset) < firstEndPosition) {
+                return false;
+            }
+            index_begin = index;
             offset_begin = offset;
         }
 
@@ -807,7 +982,7 @@ RegularAreaRect *TextPagePrivate::findTextInternalBackward(int searchID, const Q
         for (int matchingLen = strLen; matchingLen >= adjustedLen; matchingLen--) {
             const int hyphenOffset = (strLen - matchingLen);
             const int min = qMin(queryLeft + hyphenOffset, offset);
-            if (comparer(QStringView {str}.mid(offset - min, min - hyphenOffset), QStringView {query}.mid(j - min + hyphenOffset, min - hyphenOffset))) {
+            if (comparer(str.mid(offset - min, min - hyphenOffset), QStringView {query}.mid(j - min + hyphenOffset, min - hyphenOffset))) {
                 matchedLen = min - hyphenOffset;
                 break;
             }
@@ -824,9 +999,9 @@ RegularAreaRect *TextPagePrivate::findTextInternalBackward(int searchID, const Q
 
             j = query.length();
             queryLeft = query.length();
-            it = it_begin;
+            index = index_begin;
             offset = offset_begin - 1;
-            it_begin = TextEntity::List::ConstIterator();
+            index_begin = -1;
         } else {
             // we have a match
             // move the current position in the query
@@ -841,23 +1016,76 @@ RegularAreaRect *TextPagePrivate::findTextInternalBackward(int searchID, const Q
             queryLeft -= matchedLen;
 
             if (queryLeft == 0) {
-                // save or update the search point for the current searchID
-                QMap<int, SearchPoint *>::iterator sIt = m_searchPoints.find(searchID);
-                if (sIt == m_searchPoints.end()) {
-                    sIt = m_searchPoints.insert(searchID, new SearchPoint);
-                }
-                SearchPoint *sp = *sIt;
-                sp->it_begin = it;
-                sp->it_end = it_begin;
+                sp->entity_begin = index;
+                sp->entity_end = index_begin;
                 sp->offset_begin = offset - matchedLen;
                 sp->offset_end = offset_begin;
-                return searchPointToArea(sp);
+                return true;
             }
 
             offset = 0;
         }
     }
     // end of loop - it means that we've ended the textentities
+    return false;
+}
+
+RegularAreaRect *TextPagePrivate::findTextInternalBackward(int searchID, const QString &_query, Qt::CaseSensitivity caseSensitivity, int start, int start_offset, int end)
+{
+    // normalize query to search all unicode (including glyphs)
+    // Use NFKC for search operations. Use NFC for copy, makeWord, and export operations.
+    const QString query = _query.normalized(QString::NormalizationForm_KC);
+    const TextComparisonFunction comparer = caseSensitivity == Qt::CaseSensitive ? CaseSensitiveCmpFn : CaseInsensitiveCmpFn;
+
+    const TextSearchIndex &textIndex = searchIndex();
+    const QString &text = textIndex.concatenatedText();
+    const int firstPosition = textIndex.position(end, 0);
+    // a match omitting a hyphen ends at most this far after the hyphen
+    const int hyphenWindow = 2 * query.length() + 2;
+
+    // The mirror of findTextInternalForward: matches that contain the text as
+    // it is in the page are found with lastIndexOf on the whole normalized
+    // text, and only around the hyphens the query may omit we fall back to
+    // matching entity by entity, so that the last match found is the same one
+    // a plain entity walk would find.
+    SearchPoint found;
+    bool matched = false;
+    const int startPosition = textIndex.position(start, start_offset);
+    // the entity a walk ending at position starts in, the one a plain walk from start would be in
+    const auto walkEntity = [&](int position) { return position == startPosition ? start : textIndex.entityAt(position); };
+    // the position the match has to end at or before
+    int from = startPosition;
+    while (!matched) {
+        const int lastMatchStart = from - query.length();
+        const int matchPosition = lastMatchStart >= firstPosition ? text.lastIndexOf(query, lastMatchStart, caseSensitivity) : -1;
+        const int matchEnd = matchPosition < firstPosition ? -1 : matchPosition + query.length();
+        const int hyphen = textIndex.previousOptionalHyphen(from);
+        const int hyphenWindowEnd = hyphen == -1 ? -1 : qMin(from, textIndex.position(hyphen + 1, 0) + hyphenWindow);
+
+        if (matchEnd != -1 && matchEnd > hyphenWindowEnd) {
+            const int matchEntity = walkEntity(matchEnd);
+            matched = matchBackward(query, comparer, matchEntity, matchEnd - textIndex.position(matchEntity, 0), end, matchEnd, &found);
+            from = matchEnd - 1;
+        } else if (hyphen != -1) {
+            const int windowEntity = walkEntity(hyphenWindowEnd);
+            const int hyphenStart = textIndex.position(hyphen, 0);
+            matched = matchBackward(query, comparer, windowEntity, hyphenWindowEnd - textIndex.position(windowEntity, 0), end, hyphenStart + 1, &found);
+            from = hyphenStart;
+        } else {
+            break;
+        }
+    }
+
+    if (matched) {
+        // save or update the search point for the current searchID
+        QMap<int, SearchPoint *>::iterator sIt = m_searchPoints.find(searchID);
+        if (sIt == m_searchPoints.end()) {
+            sIt = m_searchPoints.insert(searchID, new SearchPoint);
+        }
+        SearchPoint *sp = *sIt;
+        *sp = found;
+        return searchPointToArea(sp);
+    }
 
     const QMap<int, SearchPoint *>::iterator sIt = m_searchPoints.find(searchID);
     if (sIt != m_searchPoints.end()) {
@@ -879,51 +1107,33 @@ QString TextPage::text(const RegularAreaRect *area, TextAreaInclusionBehaviour b
         return QString();
     }
 
-    TextEntity::List::ConstIterator it = d->m_words.constBegin(), itEnd = d->m_words.constEnd();
+    if (!area) {
+        return d->m_words.concatenatedText();
+    }
+
     QString ret;
-    if (area) {
-        for (; it != itEnd; ++it) {
-            if (b == AnyPixelTextAreaInclusionBehaviour) {
-                if (area->intersects(it->area())) {
-                    ret += it->text();
-                }
-            } else {
-                NormalizedPoint center = it->area().center();
-                if (area->contains(center.x, center.y)) {
-                    ret += it->text();
-                }
+    for (int i = 0; i < d->m_words.count(); ++i) {
+        if (b == AnyPixelTextAreaInclusionBehaviour) {
+            if (area->intersects(d->m_words.area(i))) {
+                ret += d->m_words.text(i);
+            }
+        } else {
+            NormalizedPoint center = d->m_words.area(i).center();
+            if (area->contains(center.x, center.y)) {
+                ret += d->m_words.text(i);
             }
-        }
-    } else {
-        for (; it != itEnd; ++it) {
-            ret += it->text();
         }
     }
     return ret;
 }
 
-static bool compareTinyTextEntityX(const WordWithCharacters &first, const WordWithCharacters &second)
-{
-    QRect firstArea = first.area().roundedGeometry(1000, 1000);
-    QRect secondArea = second.area().roundedGeometry(1000, 1000);
-
-    return firstArea.left() < secondArea.left();
-}
-
-static bool compareTinyTextEntityY(const WordWithCharacters &first, const WordWithCharacters &second)
-{
-    const QRect firstArea = first.area().roundedGeometry(1000, 1000);
-    const QRect secondArea = second.area().roundedGeometry(1000, 1000);
-
-    return firstArea.top() < secondArea.top();
-}
-
 /**
  * Sets a new world list. Deleting the contents of the old one
  */
 void TextPagePrivate::setWordList(const TextEntity::List &list)
 {
-    m_words = list;
+    m_words.setList(list);
+    m_searchIndex.clear();
 }
 
 /**
@@ -1047,9 +1257,74 @@ static WordsWithCharacters makeWordFromCharacters(const TextEntity::List &charac
 }
 
 /**
- * Create Lines from the words and sort them
+ * The words of a page as the XY cut sees them, and the buffers it works in.
+ *
+ * Regions and lines only hold positions in the words, so cutting a region
+ * in two partitions its positions in place instead of copying its words,
+ * and the buffers are reused from one region to the next.
+ */
+struct XYCutContext {
+    XYCutContext(const WordsWithCharacters &wordsWithCharacters, int width, int height)
+        : words(wordsWithCharacters)
+        , pageWidth(width)
+        , pageHeight(height)
+    {
+        const int count = words.count();
+        geometry.reserve(count);
+        roundedGeometry.reserve(count);
+        sortLeft.reserve(count);
+        sortTop.reserve(count);
+        for (const WordWithCharacters &word : words) {
+            const NormalizedRect area = word.area();
+            geometry.push_back(area.geometry(pageWidth, pageHeight));
+            roundedGeometry.push_back(area.roundedGeometry(pageWidth, pageHeight));
+            const QRect sortArea = area.roundedGeometry(1000, 1000);
+            sortLeft.push_back(sortArea.left());
+            sortTop.push_back(sortArea.top());
+        }
+    }
+
+    const WordsWithCharacters &words;
+    const int pageWidth;
+    const int pageHeight;
+
+    // the areas of the words, computed once
+    std::vector<QRect> geometry;
+    std::vector<QRect> roundedGeometry;
+    std::vector<int> sortLeft;
+    std::vector<int> sortTop;
+
+    // the lines made by the last makeAndSortLines(): the positions of their
+    // words one line after the other, where each line starts in them followed
+    // by where the last one ends, and their areas
+    std::vector<int> lineWords;
+    std::vector<int> lineStarts;
+    std::vector<QRect> lineRects;
+
+    // scratch buffers
+    std::vector<int> sortedWords;
+    std::vector<int> wordLines;
+    std::vector<int> columnSpaces;
+    std::vector<int> projectionOnXAxis;
+    std::vector<int> projectionOnYAxis;
+    std::vector<int> partitionedWords;
+};
+
+/**
+ * A region of the XY cut: its area and its words, the positions from
+ * begin to end excluded in the positions the XY cut partitions.
  */
-QList<QPair<WordsWithCharacters, QRect>> makeAndSortLines(const WordsWithCharacters &wordsTmp, int pageWidth, int pageHeight)
+struct XYCutRegion {
+    int begin;
+    int end;
+    QRect area;
+};
+
+/**
+ * Create Lines from the words at the positions from @p begin to @p end
+ * excluded and sort them, into the lines of @p context
+ */
+static void makeAndSortLines(XYCutContext &context, const int *begin, const int *end)
 {
     /**
      * We cannot assume that the generator will give us texts in the right order.
@@ -1062,41 +1337,37 @@ QList<QPair<WordsWithCharacters, QRect>> makeAndSortLines(const WordsWithCharact
      * 3. Within each line sort the TinyTextEntity 's by x0(left)
      */
 
-    QList<QPair<WordsWithCharacters, QRect>> lines;
-
-    /*
-     Make a new copy of the TextList in the words, so that the wordsTmp and lines do
-     not contain same pointers for all the TinyTextEntity.
-     */
-    QList<WordWithCharacters> words = wordsTmp;
+    std::vector<int> &words = context.sortedWords;
+    words.assign(begin, end);
 
     // Step 1
-    std::sort(words.begin(), words.end(), compareTinyTextEntityY);
+    std::sort(words.begin(), words.end(), [&context](int first, int second) { return context.sortTop[first] < context.sortTop[second]; });
 
     // Step 2
-    QList<WordWithCharacters>::Iterator it = words.begin(), itEnd = words.end();
+    std::vector<QRect> &lineRects = context.lineRects;
+    lineRects.clear();
+    context.wordLines.resize(words.size());
 
     // for every non-space texts(characters/words) in the textList
-    for (; it != itEnd; it++) {
-        const QRect elementArea = (*it).area().roundedGeometry(pageWidth, pageHeight);
-        bool found = false;
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        const QRect &elementArea = context.roundedGeometry[words[i]];
+        const int lineCount = lineRects.size();
+        int line = 0;
 
-        for (QPair<WordsWithCharacters, QRect> &linesI : lines) {
+        for (; line < lineCount; ++line) {
             /* the line area which will be expanded
                line_rects is only necessary to preserve the topmin and bottommax of all
                the texts in the line, left and right is not necessary at all
             */
-            QRect &lineArea = linesI.second;
-            const int text_y1 = elementArea.top(), text_y2 = elementArea.top() + elementArea.height(), text_x1 = elementArea.left(), text_x2 = elementArea.left() + elementArea.width();
-            const int line_y1 = lineArea.top(), line_y2 = lineArea.top() + lineArea.height(), line_x1 = lineArea.left(), line_x2 = lineArea.left() + lineArea.width();
+            QRect &lineArea = lineRects[line];
 
             /*
                if the new text and the line has y overlapping parts of more than 70%,
                the text will be added to this line
              */
             if (doesConsumeY(elementArea, lineArea, 70)) {
-                WordsWithCharacters &line = linesI.first;
-                line.append(*it);
+                const int text_y1 = elementArea.top(), text_y2 = elementArea.top() + elementArea.height(), text_x1 = elementArea.left(), text_x2 = elementArea.left() + elementArea.width();
+                const int line_y1 = lineArea.top(), line_y2 = lineArea.top() + lineArea.height(), line_x1 = lineArea.left(), line_x2 = lineArea.left() + lineArea.width();
 
                 const int newLeft = line_x1 < text_x1 ? line_x1 : text_x1;
                 const int newRight = line_x2 > text_x2 ? line_x2 : text_x2;
@@ -1104,36 +1375,53 @@ QList<QPair<WordsWithCharacters, QRect>> makeAndSortLines(const WordsWithCharact
                 const int newBottom = text_y2 > line_y2 ? text_y2 : line_y2;
 
                 lineArea = QRect(newLeft, newTop, newRight - newLeft, newBottom - newTop);
-                found = true;
-            }
-
-            if (found) {
                 break;
             }
         }
 
-        /* when we have found a new line create a new TextList containing
-           only one element and append it to the lines
-         */
-        if (!found) {
-            lines.append(QPair<WordsWithCharacters, QRect>({*it}, elementArea));
+        // when we have found a new line it starts with this text
+        if (line == lineCount) {
+            lineRects.push_back(elementArea);
         }
+        context.wordLines[i] = line;
     }
 
-    // Step 3
-    for (QPair<WordsWithCharacters, QRect> &line : lines) {
-        WordsWithCharacters &list = line.first;
-        std::sort(list.begin(), list.end(), compareTinyTextEntityX);
+    // group the texts by line, in the order they were added to it
+    const int lineCount = lineRects.size();
+    std::vector<int> &lineStarts = context.lineStarts;
+    lineStarts.assign(lineCount + 1, 0);
+    for (int line : std::as_const(context.wordLines)) {
+        ++lineStarts[line];
+    }
+    int start = 0;
+    for (int line = 0; line <= lineCount; ++line) {
+        const int count = lineStarts[line];
+        lineStarts[line] = start;
+        start += count;
+    }
+    context.lineWords.resize(words.size());
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        context.lineWords[lineStarts[context.wordLines[i]]++] = words[i];
+    }
+    // each line now starts where the previous one was
+    for (int line = lineCount; line > 0; --line) {
+        lineStarts[line] = lineStarts[line - 1];
     }
-    lines.shrink_to_fit();
+    lineStarts[0] = 0;
 
-    return lines;
+    // Step 3
+    for (int line = 0; line < lineCount; ++line) {
+        std::sort(context.lineWords.begin() + lineStarts[line], context.lineWords.begin() + lineStarts[line + 1], [&context](int first, int second) {
+            return context.sortLeft[first] < context.sortLeft[second];
+        });
+    }
 }
 
 /**
- * Calculate Statistical information from the lines we made previously
+ * Calculate Statistical information from the lines of the words at the
+ * positions from @p begin to @p end excluded
  */
-static void calculateStatisticalInformation(const QList<WordWithCharacters> &words, int pageWidth, int pageHeight, int *word_spacing, int *line_spacing, int *col_spacing)
+static void calculateStatisticalInformation(XYCutContext &context, const int *begin, const int *end, int *word_spacing, int *line_spacing, int *col_spacing)
 {
     /**
      * For the region, defined by line_rects and lines
@@ -1145,40 +1433,22 @@ static void calculateStatisticalInformation(const QList<WordWithCharacters> &wor
     /**
      * Step 0
      */
-    const QList<QPair<WordsWithCharacters, QRect>> sortedLines = makeAndSortLines(words, pageWidth, pageHeight);
+    makeAndSortLines(context, begin, end);
+    const std::vector<QRect> &lineRects = context.lineRects;
+    const int lineCount = lineRects.size();
 
     /**
      * Step 1
      */
-    QMap<int, int> line_space_stat;
-    for (int i = 0; i < sortedLines.length(); i++) {
-        const QRect rectUpper = sortedLines.at(i).second;
-
-        if (i + 1 == sortedLines.length()) {
-            break;
-        }
-        const QRect rectLower = sortedLines.at(i + 1).second;
-
-        int linespace = rectLower.top() - (rectUpper.top() + rectUpper.height());
-        if (linespace < 0) {
-            linespace = -linespace;
-        }
-
-        if (line_space_stat.contains(linespace)) {
-            line_space_stat[linespace]++;
-        } else {
-            line_space_stat[linespace] = 1;
-        }
-    }
-
     *line_spacing = 0;
     int weighted_count = 0;
-    QMapIterator<int, int> iterate_linespace(line_space_stat);
+    for (int i = 0; i + 1 < lineCount; i++) {
+        const QRect &rectUpper = lineRects[i];
+        const QRect &rectLower = lineRects[i + 1];
 
-    while (iterate_linespace.hasNext()) {
-        iterate_linespace.next();
-        *line_spacing += iterate_linespace.value() * iterate_linespace.key();
-        weighted_count += iterate_linespace.value();
+        const int linespace = rectLower.top() - (rectUpper.top() + rectUpper.height());
+        *line_spacing += qAbs(linespace);
+        weighted_count++;
     }
     if (*line_spacing != 0) {
         *line_spacing = (int)((double)*line_spacing / (double)weighted_count + 0.5);
@@ -1187,170 +1457,121 @@ static void calculateStatisticalInformation(const QList<WordWithCharacters> &wor
     /**
      * Step 2
      */
-    // We would like to use QMap instead of QHash as it will keep the keys sorted
-    QMap<int, int> hor_space_stat;
-    QMap<int, int> col_space_stat;
-    QList<QList<QRect>> space_rects;
-    QVector<QRect> max_hor_space_rects;
+    *word_spacing = 0;
+    weighted_count = 0;
+    // the widest space of each line, taken for a space between columns
+    std::vector<int> &columnSpaces = context.columnSpaces;
+    columnSpaces.clear();
 
     // Space in every line
-    for (const QPair<WordsWithCharacters, QRect> &sortedLine : sortedLines) {
-        const WordsWithCharacters list = sortedLine.first;
-        QList<QRect> line_space_rects;
-        int maxSpace = 0, minSpace = pageWidth;
+    for (int line = 0; line < lineCount; ++line) {
+        int maxSpace = 0;
 
         // for every TinyTextEntity element in the line
-        WordsWithCharacters::ConstIterator it = list.begin(), itEnd = list.end();
-        QRect max_area1, max_area2;
-        // for every line
-        for (; it != itEnd; it++) {
-            const QRect area1 = (*it).area().roundedGeometry(pageWidth, pageHeight);
-            if (it + 1 == itEnd) {
-                break;
-            }
-
-            const QRect area2 = (*(it + 1)).area().roundedGeometry(pageWidth, pageHeight);
-            int space = area2.left() - area1.right();
+        for (int k = context.lineStarts[line]; k + 1 < context.lineStarts[line + 1]; ++k) {
+            const QRect &area1 = context.roundedGeometry[context.lineWords[k]];
+            const QRect &area2 = context.roundedGeometry[context.lineWords[k + 1]];
+            const int space = area2.left() - area1.right();
 
             if (space > maxSpace) {
-                max_area1 = area1;
-                max_area2 = area2;
                 maxSpace = space;
             }
 
-            if (space < minSpace && space != 0) {
-                minSpace = space;
-            }
-
             // if we found a real space, whose length is not zero and also less than the pageWidth
-            if (space != 0 && space != pageWidth) {
-                // increase the count of the space amount
-                if (hor_space_stat.contains(space)) {
-                    hor_space_stat[space]++;
-                } else {
-                    hor_space_stat[space] = 1;
-                }
-
-                int left, right, top, bottom;
-
-                left = area1.right();
-                right = area2.left();
-
-                top = area2.top() < area1.top() ? area2.top() : area1.top();
-                bottom = area2.bottom() > area1.bottom() ? area2.bottom() : area1.bottom();
-
-                QRect rect(left, top, right - left, bottom - top);
-                line_space_rects.append(rect);
-            }
-        }
-
-        space_rects.append(line_space_rects);
-
-        if (hor_space_stat.contains(maxSpace)) {
-            if (hor_space_stat[maxSpace] != 1) {
-                hor_space_stat[maxSpace]--;
-            } else {
-                hor_space_stat.remove(maxSpace);
+            if (space > 0 && space != context.pageWidth) {
+                *word_spacing += space;
+                weighted_count++;
             }
         }
 
         if (maxSpace != 0) {
-            if (col_space_stat.contains(maxSpace)) {
-                col_space_stat[maxSpace]++;
-            } else {
-                col_space_stat[maxSpace] = 1;
+            if (maxSpace != context.pageWidth) {
+                *word_spacing -= maxSpace;
+                weighted_count--;
             }
-
-            // store the max rect of each line
-            const int left = max_area1.right();
-            const int right = max_area2.left();
-            const int top = (max_area1.top() > max_area2.top()) ? max_area2.top() : max_area1.top();
-            const int bottom = (max_area1.bottom() < max_area2.bottom()) ? max_area2.bottom() : max_area1.bottom();
-
-            const QRect rect(left, top, right - left, bottom - top);
-            max_hor_space_rects.append(rect);
-        } else {
-            max_hor_space_rects.append(QRect(0, 0, 0, 0));
+            columnSpaces.push_back(maxSpace);
         }
     }
 
-    // All the between word space counts are in hor_space_stat
-    *word_spacing = 0;
-    weighted_count = 0;
-    QMapIterator<int, int> iterate(hor_space_stat);
-
-    while (iterate.hasNext()) {
-        iterate.next();
-
-        if (iterate.key() > 0) {
-            *word_spacing += iterate.value() * iterate.key();
-            weighted_count += iterate.value();
-        }
-    }
     if (weighted_count) {
         *word_spacing = (int)((double)*word_spacing / (double)weighted_count + 0.5);
     }
 
+    // the most common column space, the smallest one of those as common
     *col_spacing = 0;
-    QMapIterator<int, int> iterate_col(col_space_stat);
-
-    while (iterate_col.hasNext()) {
-        iterate_col.next();
-        if (iterate_col.value() > *col_spacing) {
-            *col_spacing = iterate_col.value();
-        }
+    std::sort(columnSpaces.begin(), columnSpaces.end());
+    int maxCount = 0;
+    for (std::size_t i = 0; i < columnSpaces.size();) {
+        std::size_t next = i + 1;
+        while (next < columnSpaces.size() && columnSpaces[next] == columnSpaces[i]) {
+            ++next;
+        }
+        if (int(next - i) > maxCount) {
+            maxCount = int(next - i);
+            *col_spacing = columnSpaces[i];
+        }
+        i = next;
     }
-    *col_spacing = col_space_stat.key(*col_spacing);
 
     // if there is just one line in a region, there is no point in dividing it
-    if (sortedLines.length() == 1) {
+    if (lineCount == 1) {
         *word_spacing = *col_spacing;
     }
 }
 
+/**
+ * Adds @p value to the projection profile @p profile of @p size from @p first to
+ * @p last included. The profile holds the differences between its consecutive
+ * values until they are summed up.
+ */
+static void addToProjectionProfile(std::vector<int> &profile, int size, int first, int last, int value)
+{
+    first = qMax(first, 0);
+    last = qMin(last, size - 1);
+    if (first <= last) {
+        profile[first] += value;
+        profile[last + 1] -= value;
+    }
+}
+
 /**
  * Implements the XY Cut algorithm for textpage segmentation
- * The resulting RegionTextList will contain RegionText whose WordsWithCharacters::word and
- * WordsWithCharacters::characters are reused from wordsWithCharacters (i.e. no new nor delete happens in this function)
+ * It partitions @p words, the positions of the words of @p context, so that each
+ * resulting region has its words together, the regions following each other in
+ * reading order.
  */
-static RegionTextList XYCutForBoundingBoxes(const QList<WordWithCharacters> &wordsWithCharacters, int pageWidth, int pageHeight)
+static std::vector<XYCutRegion> XYCutForBoundingBoxes(XYCutContext &context, std::vector<int> &words)
 {
-    RegionTextList tree;
-    QRect contentRect(0, 0, pageWidth, pageHeight);
-    const RegionText root(wordsWithCharacters, contentRect);
+    std::vector<XYCutRegion> tree;
+    QRect contentRect(0, 0, context.pageWidth, context.pageHeight);
 
     // start the tree with the root, it is our only region at the start
-    tree.push_back(root);
+    tree.push_back({0, int(words.size()), contentRect});
 
-    int i = 0;
+    std::size_t i = 0;
 
     // while traversing the tree has not been ended
-    while (i < tree.length()) {
-        const RegionText node = tree.at(i);
-        QRect regionRect = node.area();
+    while (i < tree.size()) {
+        const XYCutRegion node = tree[i];
+        int *const nodeBegin = words.data() + node.begin;
+        int *const nodeEnd = words.data() + node.end;
+        QRect regionRect = node.area;
 
         /**
          * 1. calculation of projection profiles
          */
-        // allocate the size of proj profiles and initialize with 0
-        int size_proj_y = node.area().height();
-        int size_proj_x = node.area().width();
-        // dynamic memory allocation
-        QVarLengthArray<int> proj_on_xaxis(size_proj_x);
-        QVarLengthArray<int> proj_on_yaxis(size_proj_y);
-
-        for (int j = 0; j < size_proj_y; ++j) {
-            proj_on_yaxis[j] = 0;
-        }
-        for (int j = 0; j < size_proj_x; ++j) {
-            proj_on_xaxis[j] = 0;
-        }
-
-        const QList<WordWithCharacters> list = node.text();
+        // the size of proj profiles, they get one more value for the
+        // difference at their end and are initialized with 0
+        const int size_proj_y = qMax(node.area.height(), 0);
+        const int size_proj_x = qMax(node.area.width(), 0);
+        std::vector<int> &proj_on_xaxis = context.projectionOnXAxis;
+        std::vector<int> &proj_on_yaxis = context.projectionOnYAxis;
+        proj_on_xaxis.assign(size_proj_x + 1, 0);
+        proj_on_yaxis.assign(size_proj_y + 1, 0);
 
         // Calculate tcx and tcy locally for each new region
         int word_spacing, line_spacing, column_spacing;
-        calculateStatisticalInformation(list, pageWidth, pageHeight, &word_spacing, &line_spacing, &column_spacing);
+        calculateStatisticalInformation(context, nodeBegin, nodeEnd, &word_spacing, &line_spacing, &column_spacing);
 
         const int tcx = word_spacing * 2;
         const int tcy = line_spacing * 2;
@@ -1360,24 +1581,19 @@ static RegionTextList XYCutForBoundingBoxes(const QList<WordWithCharacters> &wor
         int count;
 
         // for every text in the region
-        for (const WordWithCharacters &wwc : list) {
-            const QRect entRect = wwc.area().geometry(pageWidth, pageHeight);
+        for (const int *it = nodeBegin; it != nodeEnd; ++it) {
+            const QRect &entRect = context.geometry[*it];
 
             // calculate vertical projection profile proj_on_xaxis1
-            for (int k = entRect.left(); k <= entRect.left() + entRect.width(); ++k) {
-                if ((k - regionRect.left()) < size_proj_x && (k - regionRect.left()) >= 0) {
-                    proj_on_xaxis[k - regionRect.left()] += entRect.height();
-                }
-            }
+            addToProjectionProfile(proj_on_xaxis, size_proj_x, entRect.left() - regionRect.left(), entRect.left() + entRect.width() - regionRect.left(), entRect.height());
 
             // calculate horizontal projection profile in the same way
-            for (int k = entRect.top(); k <= entRect.top() + entRect.height(); ++k) {
-                if ((k - regionRect.top()) < size_proj_y && (k - regionRect.top()) >= 0) {
-                    proj_on_yaxis[k - regionRect.top()] += entRect.width();
-                }
-            }
+            addToProjectionProfile(proj_on_yaxis, size_proj_y, entRect.top() - regionRect.top(), entRect.top() + entRect.height() - regionRect.top(), entRect.width());
         }
 
+        std::partial_sum(proj_on_xaxis.begin(), proj_on_xaxis.begin() + size_proj_x, proj_on_xaxis.begin());
+        std::partial_sum(proj_on_yaxis.begin(), proj_on_yaxis.begin() + size_proj_y, proj_on_yaxis.begin());
+
         for (int j = 0; j < size_proj_y; ++j) {
             if (proj_on_yaxis[j] > maxY) {
                 maxY = proj_on_yaxis[j];
@@ -1509,62 +1725,41 @@ static RegionTextList XYCutForBoundingBoxes(const QList<WordWithCharacters> &wor
         } else {
             // no cut possible
             // we can now update the node rectangle with the shrinked rectangle
-            RegionText tmpNode = tree.at(i);
-            tmpNode.setArea(regionRect);
-            tree.replace(i, tmpNode);
+            tree[i].area = regionRect;
             i++;
             continue;
         }
 
-        WordsWithCharacters list1, list2;
-
-        // horizontal cut, topRect and bottomRect
-        if (cut_hor) {
-            for (const WordWithCharacters &word : list) {
-                const QRect wordRect = word.area().geometry(pageWidth, pageHeight);
-
-                if (topRect.intersects(wordRect)) {
-                    list1.append(word);
-                } else {
-                    list2.append(word);
-                }
+        // horizontal cut, topRect and bottomRect, or vertical cut, leftRect and rightRect:
+        // the words in the first rect go before the others, both keeping their order
+        Q_ASSERT(cut_hor != cut_ver);
+        const QRect &firstRect = cut_hor ? topRect : leftRect;
+        const QRect &secondRect = cut_hor ? bottomRect : rightRect;
+        std::vector<int> &secondWords = context.partitionedWords;
+        secondWords.clear();
+        int *firstEnd = nodeBegin;
+        for (const int *it = nodeBegin; it != nodeEnd; ++it) {
+            if (firstRect.intersects(context.geometry[*it])) {
+                *firstEnd++ = *it;
+            } else {
+                secondWords.push_back(*it);
             }
-
-            RegionText node1(list1, topRect);
-            RegionText node2(list2, bottomRect);
-
-            tree.replace(i, node1);
-            tree.insert(i + 1, node2);
         }
+        std::copy(secondWords.begin(), secondWords.end(), firstEnd);
 
-        // vertical cut, leftRect and rightRect
-        else if (cut_ver) {
-            for (const WordWithCharacters &word : list) {
-                const QRect wordRect = word.area().geometry(pageWidth, pageHeight);
-
-                if (leftRect.intersects(wordRect)) {
-                    list1.append(word);
-                } else {
-                    list2.append(word);
-                }
-            }
-
-            RegionText node1(list1, leftRect);
-            RegionText node2(list2, rightRect);
-
-            tree.replace(i, node1);
-            tree.insert(i + 1, node2);
-        }
+        const int middle = firstEnd - words.data();
+        tree[i] = {node.begin, middle, firstRect};
+        tree.insert(tree.begin() + i + 1, {middle, node.end, secondRect});
     }
 
-    tree.shrink_to_fit();
     return tree;
 }
 
 /**
- * Add spaces in between words in a line. It reuses the pointers passed in tree and might add new ones. You will need to take care of deleting them if needed
+ * Add spaces in between words in a line, and returns the characters of the words
+ * of the regions of @p tree, one region after the other.
  */
-TextEntity::List addNecessarySpace(RegionTextList tree, int pageWidth, int pageHeight)
+static TextEntity::List addNecessarySpace(XYCutContext &context, const std::vector<int> &words, const std::vector<XYCutRegion> &tree)
 {
     /**
      * 1. Call makeAndSortLines before adding spaces in between words in a line
@@ -1572,23 +1767,31 @@ TextEntity::List addNecessarySpace(RegionTextList tree, int pageWidth, int pageH
      * 3. Finally, extract all the space separated texts from each region and return it
      */
 
+    // the characters of the words, and at most a space after each
+    int counter = 0;
+    for (const WordWithCharacters &word : context.words) {
+        counter += word.characters.count() + 1;
+    }
+
     TextEntity::List res;
-    // Only change the texts under RegionTexts, not the area
-    for (const RegionText &tmpRegion : std::as_const(tree)) {
+    res.reserve(counter);
+    const QString spaceStr(QStringLiteral(" "));
+    for (const XYCutRegion &region : tree) {
         // Step 01
-        QList<QPair<WordsWithCharacters, QRect>> sortedLines = makeAndSortLines(tmpRegion.text(), pageWidth, pageHeight);
-        int counter = 0;
-
-        // Step 02
-        for (QPair<WordsWithCharacters, QRect> &sortedLine : sortedLines) {
-            WordsWithCharacters &list = sortedLine.first;
-            for (int k = 0; k < list.length(); k++) {
-                const QRect area1 = list.at(k).area().roundedGeometry(pageWidth, pageHeight);
-                if (k + 1 >= list.length()) {
+        makeAndSortLines(context, words.data() + region.begin, words.data() + region.end);
+
+        // Step 02 and 03
+        const int lineCount = context.lineRects.size();
+        for (int line = 0; line < lineCount; ++line) {
+            const int lineEnd = context.lineStarts[line + 1];
+            for (int k = context.lineStarts[line]; k < lineEnd; k++) {
+                res += context.words.at(context.lineWords[k]).characters;
+                if (k + 1 >= lineEnd) {
                     break;
                 }
 
-                const QRect area2 = list.at(k + 1).area().roundedGeometry(pageWidth, pageHeight);
+                const QRect &area1 = context.roundedGeometry[context.lineWords[k]];
+                const QRect &area2 = context.roundedGeometry[context.lineWords[k + 1]];
                 const int space = area2.left() - area1.right();
 
                 if (space != 0) {
@@ -1598,30 +1801,13 @@ TextEntity::List addNecessarySpace(RegionTextList tree, int pageWidth, int pageH
                     const int top = area2.top() < area1.top() ? area2.top() : area1.top();
                     const int bottom = area2.bottom() > area1.bottom() ? area2.bottom() : area1.bottom();
 
-                    const QString spaceStr(QStringLiteral(" "));
                     const QRect rect(QPoint(left, top), QPoint(right, bottom));
-                    const NormalizedRect entRect(rect, pageWidth, pageHeight);
-                    TextEntity ent1 = TextEntity(spaceStr, entRect);
-                    WordWithCharacters word(ent1, QList<TextEntity>() << ent1);
-
-                    list.insert(k + 1, word);
-
-                    // Skip the space
-                    k++;
+                    res.append(TextEntity(spaceStr, NormalizedRect(rect, context.pageWidth, context.pageHeight)));
                 }
             }
-            counter += list.length();
-        }
-        res.reserve(res.length() + counter);
-
-        for (const QPair<WordsWithCharacters, QRect> &sortedLine : std::as_const(sortedLines)) {
-            for (const WordWithCharacters &word : sortedLine.first) {
-                res += word.characters;
-            }
         }
     }
 
-    // Step 03
     res.shrink_to_fit();
     return res;
 }
@@ -1639,7 +1825,7 @@ void TextPagePrivate::correctTextOrder()
     const int pageWidth = (int)(scalingFactor * m_page->width());
     const int pageHeight = (int)(scalingFactor * m_page->height());
 
-    TextEntity::List characters = m_words;
+    TextEntity::List characters = m_words.toList();
 
     /**
      * Remove spaces from the text
@@ -1649,17 +1835,21 @@ void TextPagePrivate::correctTextOrder()
     /**
      * Construct words from characters
      */
-    const QList<WordWithCharacters> wordsWithCharacters = makeWordFromCharacters(characters, pageWidth, pageHeight);
+    const WordsWithCharacters wordsWithCharacters = makeWordFromCharacters(characters, pageWidth, pageHeight);
 
     /**
-     * Make a XY Cut tree for segmentation of the texts
+     * Make a XY Cut tree for segmentation of the texts, it only moves
+     * around the positions of the words
      */
-    RegionTextList tree = XYCutForBoundingBoxes(wordsWithCharacters, pageWidth, pageHeight);
+    XYCutContext context(wordsWithCharacters, pageWidth, pageHeight);
+    std::vector<int> words(wordsWithCharacters.count());
+    std::iota(words.begin(), words.end(), 0);
+    const std::vector<XYCutRegion> tree = XYCutForBoundingBoxes(context, words);
 
     /**
      * Add spaces to the word
      */
-    const auto listOfCharacters = addNecessarySpace(std::move(tree), pageWidth, pageHeight);
+    const auto listOfCharacters = addNecessarySpace(context, words, tree);
 
     setWordList(listOfCharacters);
 }
@@ -1670,23 +1860,22 @@ TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionB
         return TextEntity::List();
     }
 
+    if (!area) {
+        return d->m_words.toList();
+    }
+
     TextEntity::List ret;
-    if (area) {
-        for (const TextEntity &te : std::as_const(d->m_words)) {
-            if (b == AnyPixelTextAreaInclusionBehaviour) {
-                if (area->intersects(te.area())) {
-                    ret.append(te);
-                }
-            } else {
-                const NormalizedPoint center = te.area().center();
-                if (area->contains(center.x, center.y)) {
-                    ret.append(te);
-                }
+    for (int i = 0; i < d->m_words.count(); ++i) {
+        const NormalizedRect teArea = d->m_words.area(i);
+        if (b == AnyPixelTextAreaInclusionBehaviour) {
+            if (area->intersects(teArea)) {
+                ret.append(TextEntity(d->m_words.text(i).toString(), teArea));
+            }
+        } else {
+            const NormalizedPoint center = teArea.center();
+            if (area->contains(center.x, center.y)) {
+                ret.append(TextEntity(d->m_words.text(i).toString(), teArea));
             }
-        }
-    } else {
-        for (const TextEntity &te : std::as_const(d->m_words)) {
-            ret.append(te);
         }
     }
     return ret;
@@ -1694,55 +1883,33 @@ TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionB
 
 std::unique_ptr<RegularAreaRect> TextPage::wordAt(const NormalizedPoint &p) const
 {
-    TextEntity::List::ConstIterator itBegin = d->m_words.constBegin(), itEnd = d->m_words.constEnd();
-    TextEntity::List::ConstIterator it = itBegin;
-    TextEntity::List::ConstIterator posIt = itEnd;
-    for (; it != itEnd; ++it) {
-        if (it->area().contains(p.x, p.y)) {
-            posIt = it;
+    const PackedTextEntities &words = d->m_words;
+    const int count = words.count();
+    int posIt = count;
+    for (int i = 0; i < count; ++i) {
+        if (words.area(i).contains(p.x, p.y)) {
+            posIt = i;
             break;
         }
     }
-    if (posIt != itEnd) {
-        if (posIt->text().simplified().isEmpty()) {
+    if (posIt != count) {
+        if (words.text(posIt).trimmed().isEmpty()) {
             return nullptr;
         }
-        // Find the first TinyTextEntity of the word
-        while (posIt != itBegin) {
-            --posIt;
-            const QString itText = posIt->text();
-            if (itText.right(1).at(0).isSpace()) {
-                if (itText.endsWith(QLatin1String("-\n"))) {
-                    // Is an hyphenated word
-                    // continue searching the start of the word back
-                    continue;
-                }
-
-                if (itText == QLatin1String("\n") && posIt != itBegin) {
-                    --posIt;
-                    if (posIt->text().endsWith(QLatin1String("-"))) {
-                        // Is an hyphenated word
-                        // continue searching the start of the word back
-                        continue;
-                    }
-                    ++posIt;
-                }
+        // Find the first TextEntity of the word, hyphenated words included
+        posIt = words.wordStart(posIt);
 
-                ++posIt;
-                break;
-            }
-        }
         auto ret = std::make_unique<RegularAreaRect>();
         QString foundWord;
-        for (; posIt != itEnd; ++posIt) {
-            const QString itText = posIt->text();
-            if (itText.simplified().isEmpty()) {
+        for (; posIt != count; ++posIt) {
+            const QStringView itText = words.text(posIt);
+            if (itText.trimmed().isEmpty()) {
                 break;
             }
 
-            ret->appendShape(posIt->area());
-            foundWord += posIt->text();
-            if (itText.right(1).at(0).isSpace()) {
+            ret->appendShape(words.area(posIt));
+            foundWord += itText;
+            if (itText.back().isSpace()) {
                 if (!foundWord.endsWith(QLatin1String("-\n"))) {
                     break;
                 }
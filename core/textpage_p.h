@@ -13,11 +13,10 @@
 #include <QMap>
 #include <QPair>
 #include <QTransform>
+#include <QVector>
 
 class SearchPoint;
 
-class RegionText;
-
 namespace Okular
 {
 class PagePrivate;
@@ -31,9 +30,137 @@ class Page;
 typedef bool (*TextComparisonFunction)(QStringView from, const QStringView to);
 
 /**
- * A list of RegionText. It keeps a bunch of TextList with their bounding rectangles
+ * The TextEntity's of a page in a compact layout: the texts of all the
+ * entities one after the other in a single UTF-16 buffer, and their areas
+ * in parallel float arrays. Pages have thousands of entities, mostly of a
+ * single character, so this avoids a QString and four doubles for each.
+ *
+ * Entities are addressed by index.
  */
-typedef QList<RegionText> RegionTextList;
+class PackedTextEntities
+{
+public:
+    int count() const
+    {
+        return m_left.count();
+    }
+
+    bool isEmpty() const
+    {
+        return m_left.isEmpty();
+    }
+
+    QStringView text(int i) const
+    {
+        return QStringView(m_text).mid(m_offsets[i], m_offsets[i + 1] - m_offsets[i]);
+    }
+
+    /**
+     * Returns the text of all the entities
+     */
+    const QString &concatenatedText() const
+    {
+        return m_text;
+    }
+
+    NormalizedRect area(int i) const
+    {
+        return NormalizedRect(m_left[i], m_top[i], m_right[i], m_bottom[i]);
+    }
+
+    NormalizedRect transformedArea(int i, const QTransform &matrix) const;
+
+    /**
+     * Returns the index of the first entity of the word entity @p i is part of.
+     * Words end after an entity ending with a space, unless it is a hyphenation.
+     */
+    int wordStart(int i) const;
+
+    void append(QStringView text, const NormalizedRect &area);
+    void removeLast();
+
+    TextEntity::List toList() const;
+    void setList(const TextEntity::List &list);
+
+private:
+    bool startsWord(int i) const;
+
+    QString m_text;
+    // m_offsets[i] is where the text of entity i starts in m_text, the last one is m_text.length()
+    QVector<int> m_offsets;
+    QVector<float> m_left;
+    QVector<float> m_top;
+    QVector<float> m_right;
+    QVector<float> m_bottom;
+    // sorted indexes of the entities that start a word
+    QVector<int> m_wordStarts;
+};
+
+/**
+ * The text of a page prepared for searching: the NFKC normalized text of all
+ * the entities one after the other, so that a query can be looked for in the
+ * whole page with QStringMatcher instead of being compared entity by entity.
+ *
+ * Positions in the buffer map back to an entity and an offset in its normalized
+ * text, which is what SearchPoint uses.
+ */
+class TextSearchIndex
+{
+public:
+    bool isBuilt() const
+    {
+        return !m_offsets.isEmpty();
+    }
+
+    void build(const PackedTextEntities &words);
+    void clear();
+
+    /**
+     * Returns the normalized text of the entity @p i
+     */
+    QStringView text(int i) const
+    {
+        return QStringView(m_text).mid(m_offsets[i], m_offsets[i + 1] - m_offsets[i]);
+    }
+
+    const QString &concatenatedText() const
+    {
+        return m_text;
+    }
+
+    /**
+     * Returns the position in the buffer of @p offset in the normalized text of the
+     * entity @p i, @p i can be the entity count
+     */
+    int position(int i, int offset) const
+    {
+        return m_offsets[i] + offset;
+    }
+
+    /**
+     * Returns the entity the character at @p position belongs to
+     */
+    int entityAt(int position) const;
+
+    /**
+     * Returns the first entity ending after @p position that can be matched
+     * without its hyphen, or -1
+     */
+    int nextOptionalHyphen(int position) const;
+
+    /**
+     * Returns the last entity starting before @p position that can be matched
+     * without its hyphen, or -1
+     */
+    int previousOptionalHyphen(int position) const;
+
+private:
+    QString m_text;
+    // m_offsets[i] is where the normalized text of entity i starts in m_text, the last one is m_text.length()
+    QVector<int> m_offsets;
+    // sorted indexes of the entities ending with a hyphen that the query may omit
+    QVector<int> m_optionalHyphens;
+};
 
 class TextPagePrivate
 {
@@ -41,11 +168,25 @@ public:
     TextPagePrivate();
     ~TextPagePrivate();
 
-    RegularAreaRect *findTextInternalForward(int searchID, const QString &query, TextComparisonFunction comparer, const TextEntity::List::ConstIterator start, int start_offset, const TextEntity::List::ConstIterator end);
-    RegularAreaRect *findTextInternalBackward(int searchID, const QString &query, TextComparisonFunction comparer, const TextEntity::List::ConstIterator start, int start_offset, const TextEntity::List::ConstIterator end);
+    OKULARCORE_EXPORT static TextPagePrivate *get(const TextPage *textPage);
+
+    RegularAreaRect *findTextInternalForward(int searchID, const QString &query, Qt::CaseSensitivity caseSensitivity, int start, int start_offset);
+    RegularAreaRect *findTextInternalBackward(int searchID, const QString &query, Qt::CaseSensitivity caseSensitivity, int start, int start_offset, int end);
+
+    /**
+     * Corrects the text order for @p page and builds the search index, unless
+     * already done. Only reads the size of @p page, so text extraction threads
+     * call it to spare that work to Page::setTextPage on the GUI thread.
+     */
+    void prepareForPage(Page *page);
+
+    /**
+     * Returns the search index, building it if needed
+     */
+    const TextSearchIndex &searchIndex();
 
     /**
-     * Copy a TextList to m_words, the pointers of list are adopted
+     * Packs a TextList into m_words
      */
     void setWordList(const TextEntity::List &list);
 
@@ -53,15 +194,21 @@ public:
      * Make necessary modifications in the TextList to make the text order correct, so
      * that textselection works fine
      */
-    void correctTextOrder();
+    OKULARCORE_EXPORT void correctTextOrder();
 
     // variables those can be accessed directly from TextPage
-    TextEntity::List m_words;
+    PackedTextEntities m_words;
     QMap<int, SearchPoint *> m_searchPoints;
     Page *m_page;
+    // the page the text order has been corrected for
+    Page *m_preparedPage;
+    // built lazily, cleared whenever m_words changes
+    TextSearchIndex m_searchIndex;
 
 private:
     RegularAreaRect *searchPointToArea(const SearchPoint *sp);
+    bool matchForward(const QString &query, TextComparisonFunction comparer, int start, int start_offset, int lastStartPosition, SearchPoint *sp);
+    bool matchBackward(const QString &query, TextComparisonFunction comparer, int start, int start_offset, int end, int firstEndPosition, SearchPoint *sp);
 };
 
 }
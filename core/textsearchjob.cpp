@@ -0,0 +1,123 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "textsearchjob_p.h"
+
+#include "area.h"
+#include "generator.h"
+#include "textpage.h"
+#include "textpage_p.h"
+
+using namespace Okular;
+
+QVector<TextSearchMatch> Okular::findTextSearchMatches(TextPage *textPage, const TextSearchParameters &parameters)
+{
+    QVector<TextSearchMatch> matches;
+    if (!textPage) {
+        return matches;
+    }
+
+    const int wordCount = parameters.words.count();
+    bool allMatched = wordCount > 0;
+    for (int w = 0; w < wordCount; ++w) {
+        const QString &word = parameters.words[w];
+        const QColor &color = parameters.colors[w];
+
+        // add all the matches of the current word
+        RegularAreaRect *lastMatch = nullptr;
+        bool wordMatched = false;
+        while (true) {
+            if (lastMatch) {
+                lastMatch = textPage->findText(parameters.searchID, word, NextResult, parameters.caseSensitivity, lastMatch);
+            } else {
+                lastMatch = textPage->findText(parameters.searchID, word, FromTop, parameters.caseSensitivity);
+            }
+
+            if (!lastMatch) {
+                break;
+            }
+
+            matches.append(TextSearchMatch(lastMatch, color));
+            wordMatched = true;
+        }
+        allMatched = allMatched && wordMatched;
+    }
+
+    // if not all words are present in page, remove partial highlights
+    if (!allMatched && parameters.matchAll) {
+        for (const TextSearchMatch &match : std::as_const(matches)) {
+            delete match.first;
+        }
+        matches.clear();
+    }
+
+    return matches;
+}
+
+TextSearchJob::TextSearchJob(Generator *generator, const QVector<Page *> &pages, const TextSearchParameters &parameters)
+    : ThreadWeaver::QObjectDecorator(new TextSearchJobInternal(generator, pages, parameters))
+{
+}
+
+const TextSearchParameters &TextSearchJob::parameters() const
+{
+    return static_cast<const TextSearchJobInternal *>(job())->mParameters;
+}
+
+const QVector<Page *> &TextSearchJob::pages() const
+{
+    return static_cast<const TextSearchJobInternal *>(job())->mPages;
+}
+
+QVector<TextSearchPageResult> TextSearchJob::takeResults()
+{
+    TextSearchJobInternal *internal = static_cast<TextSearchJobInternal *>(job());
+    QVector<TextSearchPageResult> results;
+    results.swap(internal->mResults);
+    return results;
+}
+
+TextSearchJobInternal::TextSearchJobInternal(Generator *generator, const QVector<Page *> &pages, const TextSearchParameters &parameters)
+    : mGenerator(generator)
+    , mPages(pages)
+    , mParameters(parameters)
+{
+}
+
+TextSearchJobInternal::~TextSearchJobInternal()
+{
+    // results never collected, e.g. because the search was cancelled
+    for (const TextSearchPageResult &result : std::as_const(mResults)) {
+        for (const TextSearchMatch &match : result.matches) {
+            delete match.first;
+        }
+        delete result.textPage;
+    }
+}
+
+void TextSearchJobInternal::run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread)
+{
+    Q_UNUSED(self);
+    Q_UNUSED(thread);
+
+    mResults.reserve(mPages.count());
+    for (Page *page : mPages) {
+        if (mParameters.aborted->loadRelaxed()) {
+            return;
+        }
+
+        TextRequest request(page);
+        TextPage *textPage = mGenerator->textPage(&request);
+        if (textPage) {
+            // search in the text as it will be once set into the page, in the same
+            // order and with the rotation of the page
+            TextPagePrivate::get(textPage)->prepareForPage(page);
+        }
+        mResults.append({page, textPage, findTextSearchMatches(textPage, mParameters)});
+    }
+}
+
+#include "moc_textsearchjob_p.cpp"
@@ -0,0 +1,91 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_TEXTSEARCHJOB_P_H_
+#define _OKULAR_TEXTSEARCHJOB_P_H_
+
+#include <QAtomicInt>
+#include <QColor>
+#include <QPair>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+
+#include <threadweaver/job.h>
+#include <threadweaver/qobjectdecorator.h>
+
+namespace Okular
+{
+class Generator;
+class Page;
+class RegularAreaRect;
+class TextPage;
+
+typedef QPair<RegularAreaRect *, QColor> TextSearchMatch;
+
+/* Parameters shared by all the pages of a whole document search */
+struct TextSearchParameters {
+    int searchID;
+    QStringList words;
+    QVector<QColor> colors; // one per word
+    Qt::CaseSensitivity caseSensitivity;
+    bool matchAll; // drop the matches of a page if not all the words are in it
+
+    // raised when the search is cancelled, checked by the jobs between pages
+    QSharedPointer<QAtomicInt> aborted;
+};
+
+/* Search result of a single page */
+struct TextSearchPageResult {
+    Page *page;
+    TextPage *textPage; // extracted by the job, owned by the result until given to the page
+    QVector<TextSearchMatch> matches;
+};
+
+/* Finds all the matches of the search words in @p textPage */
+QVector<TextSearchMatch> findTextSearchMatches(TextPage *textPage, const TextSearchParameters &parameters);
+
+class TextSearchJobInternal : public ThreadWeaver::Job
+{
+    friend class TextSearchJob;
+
+public:
+    ~TextSearchJobInternal() override;
+
+    TextSearchJobInternal(const TextSearchJobInternal &) = delete;
+    TextSearchJobInternal &operator=(const TextSearchJobInternal &) = delete;
+
+protected:
+    void run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread) override;
+
+private:
+    TextSearchJobInternal(Generator *generator, const QVector<Page *> &pages, const TextSearchParameters &parameters);
+
+    Generator *mGenerator;
+    const QVector<Page *> mPages;
+    const TextSearchParameters mParameters;
+    QVector<TextSearchPageResult> mResults;
+};
+
+/* Extracts the text of some pages that don't have a TextPage yet and
+ * searches it, off the GUI thread. The extracted TextPages are handed back
+ * with the results so the document can keep them. */
+class TextSearchJob : public ThreadWeaver::QObjectDecorator
+{
+    Q_OBJECT
+public:
+    TextSearchJob(Generator *generator, const QVector<Page *> &pages, const TextSearchParameters &parameters);
+
+    const TextSearchParameters &parameters() const;
+    const QVector<Page *> &pages() const;
+
+    // Transfers the ownership of the results to the caller
+    QVector<TextSearchPageResult> takeResults();
+};
+
+}
+
+#endif
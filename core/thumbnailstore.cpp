@@ -0,0 +1,281 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "thumbnailstore_p.h"
+
+#include "area.h"
+#include "debug_p.h"
+#include "generator.h"
+#include "generator_p.h"
+#include "page.h"
+#include "settings_core.h"
+#include "utils.h"
+
+#include <QColor>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+using namespace Okular;
+
+// bump when the way pages are rendered or stored changes, so old stores are not used
+static const int kStoreVersion = 2;
+// renders bigger than this (in device pixels) are page views, not thumbnails
+static const int kMaxThumbnailSize = 512;
+// how much of the beginning and the end of the document goes into its key
+static const qint64 kHashedChunkSize = 1024 * 1024;
+// check the size budget after this many renders were stored
+static const int kInsertsPerEviction = 64;
+
+static const QLatin1String kUsedStampFileName("used");
+
+static void evictStores(const QString &storesDirectory, const QString &currentStore, qint64 maximumSize)
+{
+    struct StoreInfo {
+        QString path;
+        qint64 size;
+        QDateTime lastUsed;
+    };
+
+    QVector<StoreInfo> stores;
+    qint64 totalSize = 0;
+    const QFileInfoList storeDirectories = QDir(storesDirectory).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QFileInfo &storeDirectory : storeDirectories) {
+        StoreInfo store;
+        store.path = storeDirectory.absoluteFilePath();
+        store.size = 0;
+        const QFileInfoList files = QDir(store.path).entryInfoList(QDir::Files);
+        for (const QFileInfo &file : files) {
+            store.size += file.size();
+        }
+        const QFileInfo stamp(store.path + QLatin1Char('/') + kUsedStampFileName);
+        store.lastUsed = stamp.exists() ? stamp.lastModified() : storeDirectory.lastModified();
+        totalSize += store.size;
+        stores.append(store);
+    }
+
+    if (totalSize <= maximumSize) {
+        return;
+    }
+
+    std::sort(stores.begin(), stores.end(), [](const StoreInfo &a, const StoreInfo &b) { return a.lastUsed < b.lastUsed; });
+    for (const StoreInfo &store : std::as_const(stores)) {
+        if (totalSize <= maximumSize) {
+            break;
+        }
+        if (store.path == currentStore) {
+            continue;
+        }
+        qCDebug(OkularCoreDebug) << "Evicting thumbnail store" << store.path;
+        if (QDir(store.path).removeRecursively()) {
+            totalSize -= store.size;
+        }
+    }
+}
+
+ThumbnailStore::ThumbnailStore(const QString &fileName, qint64 documentSize, const QString &generatorName, qint64 maximumSize)
+    : m_maximumSize(maximumSize)
+    , m_insertsSinceEviction(0)
+{
+    // the writes must happen in the order they were asked for
+    m_ioPool.setMaxThreadCount(1);
+
+    m_directory = QDir(storesDirectory()).absoluteFilePath(documentKey(fileName, documentSize, generatorName));
+    qCDebug(OkularCoreDebug) << "Thumbnail store is" << m_directory;
+
+    const QStringList entries = QDir(m_directory).entryList({QStringLiteral("*.png")}, QDir::Files);
+    m_entries = QSet<QString>(entries.begin(), entries.end());
+
+    const QString directory = m_directory;
+    m_ioPool.start([directory] {
+        QDir().mkpath(directory);
+        QFile stamp(directory + QLatin1Char('/') + kUsedStampFileName);
+        if (stamp.open(QIODevice::WriteOnly)) {
+            stamp.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        }
+    });
+    scheduleEviction();
+}
+
+ThumbnailStore::~ThumbnailStore()
+{
+    m_ioPool.waitForDone();
+}
+
+bool ThumbnailStore::isEligible(const PixmapRequest *request)
+{
+    const PixmapRequestPrivate *d = PixmapRequestPrivate::get(request);
+    if (request->isTile() || d->mForce || !d->mPage || d->tilesManager()) {
+        return false;
+    }
+
+    if (d->mPage->rotation() != Rotation0) {
+        return false;
+    }
+
+    return request->width() > 0 && request->height() > 0 && std::max(request->width(), request->height()) <= kMaxThumbnailSize;
+}
+
+bool ThumbnailStore::contains(const PixmapRequest *request) const
+{
+    return m_entries.contains(entryName(request->pageNumber(), request->width(), request->height()));
+}
+
+void ThumbnailStore::load(const PixmapRequest *request, bool computeBoundingBox, QObject *context, const Loaded &loaded)
+{
+    const QString path = m_directory + QLatin1Char('/') + entryName(request->pageNumber(), request->width(), request->height());
+    const QSize size(request->width(), request->height());
+    m_ioPool.start([path, size, computeBoundingBox, context, loaded] {
+        QImage image(path, "PNG");
+        if (image.size() != size) {
+            // damaged, let the generator render it
+            image = QImage();
+        }
+
+        NormalizedRect boundingBox;
+        if (computeBoundingBox && !image.isNull()) {
+            boundingBox = Utils::imageBoundingBox(&image);
+        }
+
+        QMetaObject::invokeMethod(context, [loaded, image, boundingBox] { loaded(image, boundingBox); }, Qt::QueuedConnection);
+    });
+}
+
+void ThumbnailStore::forget(const PixmapRequest *request)
+{
+    m_entries.remove(entryName(request->pageNumber(), request->width(), request->height()));
+}
+
+void ThumbnailStore::insert(int page, const QImage &image)
+{
+    if (image.isNull() || m_changedPages.contains(page)) {
+        return;
+    }
+
+    const QString name = entryName(page, image.width(), image.height());
+    if (m_entries.contains(name)) {
+        return;
+    }
+    m_entries.insert(name);
+
+    const QString path = m_directory + QLatin1Char('/') + name;
+    m_ioPool.start([path, image] {
+        // the directory is gone after clear()
+        QDir().mkpath(QFileInfo(path).path());
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || !image.save(&file, "PNG") || !file.commit()) {
+            qCDebug(OkularCoreDebug) << "Could not store thumbnail" << path;
+        }
+    });
+
+    if (++m_insertsSinceEviction >= kInsertsPerEviction) {
+        scheduleEviction();
+    }
+}
+
+void ThumbnailStore::removePage(int page)
+{
+    m_changedPages.insert(page);
+
+    const QString prefix = QString::number(page) + QLatin1Char('-');
+    QStringList paths;
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->startsWith(prefix)) {
+            paths << m_directory + QLatin1Char('/') + *it;
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (!paths.isEmpty()) {
+        m_ioPool.start([paths] {
+            for (const QString &path : paths) {
+                QFile::remove(path);
+            }
+        });
+    }
+}
+
+void ThumbnailStore::clear()
+{
+    m_entries.clear();
+    m_changedPages.clear();
+
+    const QString directory = m_directory;
+    m_ioPool.start([directory] { QDir(directory).removeRecursively(); });
+}
+
+QString ThumbnailStore::storesDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/okular/thumbnails");
+}
+
+void ThumbnailStore::addRenderSettings(QCryptographicHash *hash, const QString &generatorName)
+{
+    hash->addData(QByteArray::number(kStoreVersion));
+    hash->addData(generatorName.toUtf8());
+    hash->addData(QByteArray::number(SettingsCore::textAntialias()));
+    hash->addData(QByteArray::number(SettingsCore::graphicsAntialias()));
+    hash->addData(QByteArray::number(SettingsCore::textHinting()));
+
+    // the paper color the generators are given, see DocumentPrivate::documentMetaData()
+    const bool paperMode = SettingsCore::changeColors() && SettingsCore::renderMode() == SettingsCore::EnumRenderMode::Paper;
+    hash->addData(QByteArray::number(paperMode ? SettingsCore::paperColor().rgba() : QColor(Qt::white).rgba()));
+
+    // the generators keep their own render settings in their own config files, any
+    // change there makes a new store rather than guessing which ones matter
+    const QDir configDirectory(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation));
+    const QFileInfoList generatorConfigs = configDirectory.entryInfoList({QStringLiteral("okular-generator-*rc")}, QDir::Files, QDir::Name);
+    for (const QFileInfo &generatorConfig : generatorConfigs) {
+        QFile file(generatorConfig.absoluteFilePath());
+        if (file.open(QIODevice::ReadOnly)) {
+            hash->addData(generatorConfig.fileName().toUtf8());
+            hash->addData(file.readAll());
+        }
+    }
+}
+
+QString ThumbnailStore::documentKey(const QString &fileName, qint64 documentSize, const QString &generatorName)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    addRenderSettings(&hash, generatorName);
+
+    // hashing the whole document would take longer than rendering its thumbnails,
+    // the size and both ends of it change with almost any edit
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly)) {
+        hash.addData(file.read(kHashedChunkSize));
+        if (documentSize > kHashedChunkSize) {
+            file.seek(std::max(kHashedChunkSize, documentSize - kHashedChunkSize));
+            hash.addData(file.read(kHashedChunkSize));
+        }
+    }
+
+    return QString::number(documentSize) + QLatin1Char('-') + QString::fromLatin1(hash.result().toHex());
+}
+
+QString ThumbnailStore::entryName(int page, int width, int height)
+{
+    return QStringLiteral("%1-%2x%3.png").arg(page).arg(width).arg(height);
+}
+
+void ThumbnailStore::scheduleEviction()
+{
+    m_insertsSinceEviction = 0;
+
+    const QString root = storesDirectory();
+    const QString current = m_directory;
+    const qint64 maximumSize = m_maximumSize;
+    m_ioPool.start([root, current, maximumSize] { evictStores(root, current, maximumSize); });
+}
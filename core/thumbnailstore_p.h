@@ -0,0 +1,131 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_THUMBNAILSTORE_P_H_
+#define _OKULAR_THUMBNAILSTORE_P_H_
+
+#include <QImage>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+
+#include <functional>
+
+class QCryptographicHash;
+class QObject;
+
+namespace Okular
+{
+class NormalizedRect;
+class PixmapRequest;
+
+/**
+ * Keeps small renders of the pages of a document on disk, so that the
+ * thumbnails of a document that was already opened once can be shown
+ * without asking the generator for them again.
+ *
+ * The renders are a cache that can be thrown away at any time, so unlike the
+ * docdata, which holds the annotations and bookmarks of the user, they live
+ * in the cache location, where they are not backed up and where removing
+ * them can never take user data along. There is a directory per document,
+ * named after the size of the document and a hash of its contents and of the
+ * settings the pages are rendered with, so the same file opened from another
+ * place still finds them while a modified file, or one rendered differently,
+ * does not. Only small, whole page, unrotated renders are stored.
+ *
+ * Documents opened with a password are never stored, their renders would
+ * be readable without it.
+ *
+ * All the disk reads, writes and removals run in order on a private thread,
+ * the store keeps an in-memory list of the renders it has so looking up a
+ * render that is not there never touches the disk.
+ *
+ * The directories of all the documents share a size budget, when it is
+ * exceeded the directories of the documents not opened for the longest
+ * time are removed.
+ */
+class ThumbnailStore
+{
+public:
+    /**
+     * Creates the store of the document @p fileName opened with the
+     * generator @p generatorName, keeping all the stores under
+     * @p maximumSize bytes.
+     */
+    ThumbnailStore(const QString &fileName, qint64 documentSize, const QString &generatorName, qint64 maximumSize);
+    ~ThumbnailStore();
+
+    ThumbnailStore(const ThumbnailStore &) = delete;
+    ThumbnailStore &operator=(const ThumbnailStore &) = delete;
+
+    /**
+     * Returns whether the result of @p request is something the store
+     * can hold.
+     */
+    static bool isEligible(const PixmapRequest *request);
+
+    /**
+     * Returns whether there is a stored render for @p request.
+     */
+    bool contains(const PixmapRequest *request) const;
+
+    using Loaded = std::function<void(const QImage &image, const NormalizedRect &boundingBox)>;
+
+    /**
+     * Decodes the stored render for @p request on the thread of the store, and
+     * when @p computeBoundingBox is set computes the bounding box of its contents
+     * there too. Then calls @p loaded with them in the thread of @p context.
+     *
+     * The image is null if the render could not be read, the store then
+     * forgets it when @p loaded calls forget().
+     */
+    void load(const PixmapRequest *request, bool computeBoundingBox, QObject *context, const Loaded &loaded);
+
+    /**
+     * Forgets the stored render for @p request, because it could not be read.
+     */
+    void forget(const PixmapRequest *request);
+
+    /**
+     * Stores @p image as the render of @p page, unless the page contents
+     * changed during this session.
+     */
+    void insert(int page, const QImage &image);
+
+    /**
+     * Forgets the renders of @p page and does not store new ones for the
+     * rest of the session, since they may show changes that are not saved.
+     */
+    void removePage(int page);
+
+    /**
+     * Forgets all the renders of the document, the ones rendered after are
+     * stored again.
+     */
+    void clear();
+
+    /**
+     * The directory all the stores live in.
+     */
+    static QString storesDirectory();
+
+private:
+    static QString documentKey(const QString &fileName, qint64 documentSize, const QString &generatorName);
+    static void addRenderSettings(QCryptographicHash *hash, const QString &generatorName);
+    static QString entryName(int page, int width, int height);
+    void scheduleEviction();
+
+    QString m_directory;
+    qint64 m_maximumSize;
+    QSet<QString> m_entries;
+    QSet<int> m_changedPages;
+    int m_insertsSinceEviction;
+    QThreadPool m_ioPool;
+};
+
+}
+
+#endif
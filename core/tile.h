@@ -8,6 +8,8 @@
 
 #include "area.h"
 
+#include <QImage>
+
 class QPixmap;
 
 namespace Okular
@@ -15,14 +17,27 @@ namespace Okular
 /**
  * This class represents a rectangular portion of a page.
  *
- * It doesn't take ownership of pixmap
+ * The image is implicitly shared with the tiles manager, holding a
+ * tile does not copy its pixels
  *
  * @since 0.16 (KDE 4.10)
  */
 class OKULARCORE_EXPORT Tile
 {
 public:
-    Tile(const NormalizedRect &rect, QPixmap *pixmap, bool isValid);
+    /**
+     * @since 24.12
+     */
+    Tile(const NormalizedRect &rect, const QImage &image, bool isValid);
+
+    /**
+     * Makes a tile holding a copy of the image of @p pixmap, it
+     * doesn't take ownership of pixmap.
+     *
+     * @deprecated use the constructor taking a QImage
+     */
+    OKULARCORE_DEPRECATED Tile(const NormalizedRect &rect, QPixmap *pixmap, bool isValid);
+
     Tile(const Tile &t);
     ~Tile();
 
@@ -32,12 +47,22 @@ public:
     NormalizedRect rect() const;
 
     /**
-     * Pixmap (may also be NULL)
+     * Image (may also be null)
+     *
+     * @since 24.12
+     */
+    QImage image() const;
+
+    /**
+     * Pixmap (may also be NULL), made from the image the first time
+     * it is asked for and owned by the tile
+     *
+     * @deprecated use image(), which doesn't convert the tile
      */
-    QPixmap *pixmap() const;
+    OKULARCORE_DEPRECATED QPixmap *pixmap() const;
 
     /**
-     * True if the pixmap is available and updated
+     * True if the image is available and updated
      */
     bool isValid() const;
 
@@ -5,13 +5,16 @@
 
 #include "tilesmanager_p.h"
 
+#include <QImage>
 #include <QList>
-#include <QPainter>
 #include <QPixmap>
+#include <QTransform>
 #include <qmath.h>
 
 #include "tile.h"
 
+#include <memory>
+
 #define TILES_MAXSIZE 2000000
 
 using namespace Okular;
@@ -33,13 +36,18 @@ public:
 
     bool hasPixmap(const NormalizedRect &rect, const TileNode &tile) const;
     void tilesAt(const NormalizedRect &rect, TileNode &tile, QList<Tile> &result, TileLeaf tileLeaf);
-    void setPixmap(const QPixmap *pixmap, const NormalizedRect &rect, TileNode &tile, bool isPartialPixmap);
+    void setImage(const QImage &image, const NormalizedRect &rect, TileNode &tile, bool isPartialPixmap);
 
     /**
      * Mark @p tile and all its children as dirty
      */
     static void markDirty(TileNode &tile);
 
+    /**
+     * Mark the terminal tiles of @p tile intersecting @p rect, and their parents, as dirty
+     */
+    void markDirty(const NormalizedRect &rect, TileNode &tile, NormalizedRect &dirtyRect);
+
     /**
      * Deletes all tiles, recursively
      */
@@ -62,6 +70,7 @@ public:
      * Otherwise it just returns false, without performing any operation.
      */
     bool splitBigTiles(TileNode &tile, const NormalizedRect &rect);
+    QImage tileImage(const QImage &image, const QRect &imageRect, const TileNode &tile) const;
 
     // The page is split in a 4x4 grid of tiles
     TileNode tiles[16];
@@ -116,9 +125,8 @@ TilesManager::~TilesManager()
 
 void TilesManager::Private::deleteTiles(const TileNode &tile)
 {
-    if (tile.pixmap) {
-        totalPixels -= tile.pixmap->width() * tile.pixmap->height();
-        delete tile.pixmap;
+    if (!tile.image.isNull()) {
+        totalPixels -= tile.image.width() * tile.image.height();
     }
 
     if (tile.nTiles > 0) {
@@ -182,7 +190,43 @@ void TilesManager::Private::markDirty(TileNode &tile)
     }
 }
 
-void TilesManager::setPixmap(const QPixmap *pixmap, const NormalizedRect &rect, bool isPartialPixmap)
+NormalizedRect TilesManager::markDirty(const NormalizedRect &rect)
+{
+    NormalizedRect dirtyRect;
+    const NormalizedRect rotatedRect = fromRotatedRect(rect, d->rotation);
+    for (TileNode &tile : d->tiles) {
+        d->markDirty(rotatedRect, tile, dirtyRect);
+    }
+
+    return dirtyRect.isNull() ? dirtyRect : toRotatedRect(dirtyRect, d->rotation);
+}
+
+void TilesManager::Private::markDirty(const NormalizedRect &rect, TileNode &tile, NormalizedRect &dirtyRect)
+{
+    // tiles only touching the edge of rect are left alone
+    const NormalizedRect intersection = tile.rect & rect;
+    if (intersection.width() <= 0 || intersection.height() <= 0) {
+        return;
+    }
+
+    // the parent must be dirty too, hasPixmap() does not look into clean parents
+    tile.dirty = true;
+
+    if (tile.nTiles == 0) {
+        if (dirtyRect.isNull()) {
+            dirtyRect = tile.rect;
+        } else {
+            dirtyRect |= tile.rect;
+        }
+        return;
+    }
+
+    for (int i = 0; i < tile.nTiles; ++i) {
+        markDirty(rect, tile.tiles[i], dirtyRect);
+    }
+}
+
+void TilesManager::setImage(const QImage &image, const NormalizedRect &rect, bool isPartialPixmap)
 {
     const NormalizedRect rotatedRect = TilesManager::fromRotatedRect(rect, d->rotation);
     if (!d->requestRect.isNull()) {
@@ -190,22 +234,22 @@ void TilesManager::setPixmap(const QPixmap *pixmap, const NormalizedRect &rect,
             return;
         }
 
-        if (pixmap) {
-            // Check whether the pixmap has the same absolute size of the expected
+        if (!image.isNull()) {
+            // Check whether the image has the same absolute size of the expected
             // request.
             // If the document is rotated, rotate requestRect back to the original
-            // rotation before comparing to pixmap's size. This is to avoid
+            // rotation before comparing to image's size. This is to avoid
             // conversion issues. The pixmap request was made using an unrotated
             // rect.
-            QSize pixmapSize = pixmap->size();
+            QSize imageSize = image.size();
             int w = width();
             int h = height();
             if (d->rotation % 2) {
                 std::swap(w, h);
-                pixmapSize.transpose();
+                imageSize.transpose();
             }
 
-            if (rotatedRect.geometry(w, h).size() != pixmapSize) {
+            if (rotatedRect.geometry(w, h).size() != imageSize) {
                 return;
             }
         }
@@ -214,20 +258,31 @@ void TilesManager::setPixmap(const QPixmap *pixmap, const NormalizedRect &rect,
     }
 
     for (TileNode &tile : d->tiles) {
-        d->setPixmap(pixmap, rotatedRect, tile, isPartialPixmap);
+        d->setImage(image, rotatedRect, tile, isPartialPixmap);
     }
 }
 
-void TilesManager::Private::setPixmap(const QPixmap *pixmap, const NormalizedRect &rect, TileNode &tile, bool isPartialPixmap)
+QImage TilesManager::Private::tileImage(const QImage &image, const QRect &imageRect, const TileNode &tile) const
 {
-    QRect pixmapRect = TilesManager::toRotatedRect(rect, rotation).geometry(width, height);
+    const QRect tileRect = TilesManager::toRotatedRect(tile.rect, rotation).geometry(width, height);
+    // a tile covering the whole image shares its pixels
+    if (tileRect == imageRect) {
+        return image;
+    }
+
+    return image.copy(tileRect.translated(-imageRect.topLeft()));
+}
+
+void TilesManager::Private::setImage(const QImage &image, const NormalizedRect &rect, TileNode &tile, bool isPartialPixmap)
+{
+    QRect imageRect = TilesManager::toRotatedRect(rect, rotation).geometry(width, height);
 
     // Exclude tiles outside the viewport
     if (!tile.rect.intersects(rect)) {
         return;
     }
     // Avoid painting partial pixmaps over tiles that already have a fully rendered pixmap, even if dirty
-    if (isPartialPixmap && tile.pixmap != nullptr && !tile.partial) {
+    if (isPartialPixmap && !tile.image.isNull() && !tile.partial) {
         return;
     }
 
@@ -237,11 +292,10 @@ void TilesManager::Private::setPixmap(const QPixmap *pixmap, const NormalizedRec
         // paint children tiles
         if (tile.nTiles > 0) {
             for (int i = 0; i < tile.nTiles; ++i) {
-                setPixmap(pixmap, rect, tile.tiles[i], isPartialPixmap);
+                setImage(image, rect, tile.tiles[i], isPartialPixmap);
             }
 
-            delete tile.pixmap;
-            tile.pixmap = nullptr;
+            tile.image = QImage();
         }
         // We could paint the pixmap over part of the tile here, but
         // there is little reason to as it will usually be offscreen
@@ -257,27 +311,24 @@ void TilesManager::Private::setPixmap(const QPixmap *pixmap, const NormalizedRec
 
         // check whether the tile size is big and split it if necessary
         if (!splitBigTiles(tile, rect)) {
-            if (tile.pixmap) {
-                totalPixels -= tile.pixmap->width() * tile.pixmap->height();
-                delete tile.pixmap;
+            if (!tile.image.isNull()) {
+                totalPixels -= tile.image.width() * tile.image.height();
             }
             tile.rotation = rotation;
-            if (pixmap) {
-                const NormalizedRect rotatedRect = TilesManager::toRotatedRect(tile.rect, rotation);
-                tile.pixmap = new QPixmap(pixmap->copy(rotatedRect.geometry(width, height).translated(-pixmapRect.topLeft())));
-                totalPixels += tile.pixmap->width() * tile.pixmap->height();
+            if (!image.isNull()) {
+                tile.image = tileImage(image, imageRect, tile);
+                totalPixels += tile.image.width() * tile.image.height();
             } else {
-                tile.pixmap = nullptr;
+                tile.image = QImage();
             }
         } else {
-            if (tile.pixmap) {
-                totalPixels -= tile.pixmap->width() * tile.pixmap->height();
-                delete tile.pixmap;
-                tile.pixmap = nullptr;
+            if (!tile.image.isNull()) {
+                totalPixels -= tile.image.width() * tile.image.height();
+                tile.image = QImage();
             }
 
             for (int i = 0; i < tile.nTiles; ++i) {
-                setPixmap(pixmap, rect, tile.tiles[i], isPartialPixmap);
+                setImage(image, rect, tile.tiles[i], isPartialPixmap);
             }
         }
     } else {
@@ -289,20 +340,18 @@ void TilesManager::Private::setPixmap(const QPixmap *pixmap, const NormalizedRec
         if (tileRect.width() * tileRect.height() >= TILES_MAXSIZE || isPartialPixmap) {
             tile.dirty = isPartialPixmap;
             tile.partial = isPartialPixmap;
-            if (tile.pixmap) {
-                totalPixels -= tile.pixmap->width() * tile.pixmap->height();
-                delete tile.pixmap;
-                tile.pixmap = nullptr;
+            if (!tile.image.isNull()) {
+                totalPixels -= tile.image.width() * tile.image.height();
+                tile.image = QImage();
             }
 
             for (int i = 0; i < tile.nTiles; ++i) {
-                setPixmap(pixmap, rect, tile.tiles[i], isPartialPixmap);
+                setImage(image, rect, tile.tiles[i], isPartialPixmap);
             }
         } else {
             // remove children tiles
             for (int i = 0; i < tile.nTiles; ++i) {
                 deleteTiles(tile.tiles[i]);
-                tile.tiles[i].pixmap = nullptr;
             }
 
             delete[] tile.tiles;
@@ -310,17 +359,15 @@ void TilesManager::Private::setPixmap(const QPixmap *pixmap, const NormalizedRec
             tile.nTiles = 0;
 
             // paint tile
-            if (tile.pixmap) {
-                totalPixels -= tile.pixmap->width() * tile.pixmap->height();
-                delete tile.pixmap;
+            if (!tile.image.isNull()) {
+                totalPixels -= tile.image.width() * tile.image.height();
             }
             tile.rotation = rotation;
-            if (pixmap) {
-                const NormalizedRect rotatedRect = TilesManager::toRotatedRect(tile.rect, rotation);
-                tile.pixmap = new QPixmap(pixmap->copy(rotatedRect.geometry(width, height).translated(-pixmapRect.topLeft())));
-                totalPixels += tile.pixmap->width() * tile.pixmap->height();
+            if (!image.isNull()) {
+                tile.image = tileImage(image, imageRect, tile);
+                totalPixels += tile.image.width() * tile.image.height();
             } else {
-                tile.pixmap = nullptr;
+                tile.image = QImage();
             }
             tile.dirty = isPartialPixmap;
             tile.partial = isPartialPixmap;
@@ -387,7 +434,7 @@ void TilesManager::Private::tilesAt(const NormalizedRect &rect, TileNode &tile,
     // requesting huge areas unnecessarily
     splitBigTiles(tile, rect);
 
-    if ((tileLeaf == TerminalTile && tile.nTiles == 0) || (tileLeaf == PixmapTile && tile.pixmap)) {
+    if ((tileLeaf == TerminalTile && tile.nTiles == 0) || (tileLeaf == PixmapTile && !tile.image.isNull())) {
         NormalizedRect rotatedRect;
         if (rotation != Rotation0) {
             rotatedRect = TilesManager::toRotatedRect(tile.rect, rotation);
@@ -395,52 +442,12 @@ void TilesManager::Private::tilesAt(const NormalizedRect &rect, TileNode &tile,
             rotatedRect = tile.rect;
         }
 
-        if (tile.pixmap && tileLeaf == PixmapTile && tile.rotation != rotation) {
+        if (!tile.image.isNull() && tileLeaf == PixmapTile && tile.rotation != rotation) {
             // Lazy tiles rotation
-            int angleToRotate = (rotation - tile.rotation) * 90;
-            int xOffset = 0, yOffset = 0;
-            int w = 0, h = 0;
-            switch (angleToRotate) {
-            case 0:
-                xOffset = 0;
-                yOffset = 0;
-                w = tile.pixmap->width();
-                h = tile.pixmap->height();
-                break;
-            case 90:
-            case -270:
-                xOffset = 0;
-                yOffset = -tile.pixmap->height();
-                w = tile.pixmap->height();
-                h = tile.pixmap->width();
-                break;
-            case 180:
-            case -180:
-                xOffset = -tile.pixmap->width();
-                yOffset = -tile.pixmap->height();
-                w = tile.pixmap->width();
-                h = tile.pixmap->height();
-                break;
-            case 270:
-            case -90:
-                xOffset = -tile.pixmap->width();
-                yOffset = 0;
-                w = tile.pixmap->height();
-                h = tile.pixmap->width();
-                break;
-            }
-            QPixmap *rotatedPixmap = new QPixmap(w, h);
-            QPainter p(rotatedPixmap);
-            p.rotate(angleToRotate);
-            p.translate(xOffset, yOffset);
-            p.drawPixmap(0, 0, *tile.pixmap);
-            p.end();
-
-            delete tile.pixmap;
-            tile.pixmap = rotatedPixmap;
+            tile.image = tile.image.transformed(QTransform().rotate((rotation - tile.rotation) * 90));
             tile.rotation = rotation;
         }
-        result.append(Tile(rotatedRect, tile.pixmap, tile.isValid()));
+        result.append(Tile(rotatedRect, tile.image, tile.isValid()));
     } else {
         for (int i = 0; i < tile.nTiles; ++i) {
             tilesAt(rect, tile.tiles[i], result, tileLeaf);
@@ -463,7 +470,7 @@ void TilesManager::cleanupPixmapMemory(qulonglong numberOfBytes, const Normalize
 
     while (numberOfBytes > 0 && !rankedTiles.isEmpty()) {
         TileNode *tile = rankedTiles.takeLast();
-        if (!tile->pixmap) {
+        if (tile->image.isNull()) {
             continue;
         }
 
@@ -472,7 +479,7 @@ void TilesManager::cleanupPixmapMemory(qulonglong numberOfBytes, const Normalize
             continue;
         }
 
-        qulonglong pixels = tile->pixmap->width() * tile->pixmap->height();
+        qulonglong pixels = tile->image.width() * tile->image.height();
         d->totalPixels -= pixels;
         if (numberOfBytes < 4 * pixels) {
             numberOfBytes = 0;
@@ -480,8 +487,7 @@ void TilesManager::cleanupPixmapMemory(qulonglong numberOfBytes, const Normalize
             numberOfBytes -= 4 * pixels;
         }
 
-        delete tile->pixmap;
-        tile->pixmap = nullptr;
+        tile->image = QImage();
 
         tile->partial = true;
 
@@ -513,7 +519,7 @@ void TilesManager::Private::rankTiles(TileNode &tile, QList<TileNode *> &rankedT
         return;
     }
 
-    if (tile.pixmap) {
+    if (!tile.image.isNull()) {
         // Update distance
         if (!visibleRect.isNull()) {
             NormalizedPoint viewportCenter = visibleRect.center();
@@ -636,8 +642,7 @@ NormalizedRect TilesManager::toRotatedRect(const NormalizedRect &rect, Rotation
 }
 
 TileNode::TileNode()
-    : pixmap(nullptr)
-    , rotation(Rotation0)
+    : rotation(Rotation0)
     , dirty(true)
     , partial(true)
     , distance(-1)
@@ -649,7 +654,7 @@ TileNode::TileNode()
 
 bool TileNode::isValid() const
 {
-    return pixmap && !dirty;
+    return !image.isNull() && !dirty;
 }
 
 class Tile::Private
@@ -658,21 +663,32 @@ public:
     Private();
 
     NormalizedRect rect;
-    QPixmap *pixmap;
+    QImage image;
     bool isValid;
+    // made from the image when pixmap() is called
+    mutable std::unique_ptr<QPixmap> pixmap;
 };
 
 Tile::Private::Private()
-    : pixmap(nullptr)
-    , isValid(false)
+    : isValid(false)
 {
 }
 
+Tile::Tile(const NormalizedRect &rect, const QImage &image, bool isValid)
+    : d(new Tile::Private)
+{
+    d->rect = rect;
+    d->image = image;
+    d->isValid = isValid;
+}
+
 Tile::Tile(const NormalizedRect &rect, QPixmap *pixmap, bool isValid)
     : d(new Tile::Private)
 {
     d->rect = rect;
-    d->pixmap = pixmap;
+    if (pixmap) {
+        d->image = pixmap->toImage();
+    }
     d->isValid = isValid;
 }
 
@@ -680,7 +696,7 @@ Tile::Tile(const Tile &t)
     : d(new Tile::Private)
 {
     d->rect = t.d->rect;
-    d->pixmap = t.d->pixmap;
+    d->image = t.d->image;
     d->isValid = t.d->isValid;
 }
 
@@ -691,8 +707,9 @@ Tile &Tile::operator=(const Tile &other)
     }
 
     d->rect = other.d->rect;
-    d->pixmap = other.d->pixmap;
+    d->image = other.d->image;
     d->isValid = other.d->isValid;
+    d->pixmap.reset();
 
     return *this;
 }
@@ -707,9 +724,17 @@ NormalizedRect Tile::rect() const
     return d->rect;
 }
 
+QImage Tile::image() const
+{
+    return d->image;
+}
+
 QPixmap *Tile::pixmap() const
 {
-    return d->pixmap;
+    if (!d->pixmap && !d->image.isNull()) {
+        d->pixmap = std::make_unique<QPixmap>(QPixmap::fromImage(d->image));
+    }
+    return d->pixmap.get();
 }
 
 bool Tile::isValid() const
@@ -9,7 +9,7 @@
 #include "area.h"
 #include "okularcore_export.h"
 
-class QPixmap;
+#include <QImage>
 
 namespace Okular
 {
@@ -41,15 +41,15 @@ public:
     NormalizedRect rect;
 
     /**
-     * Associated pixmap or NULL if not present
+     * Associated image or a null image if not present
      *
-     * For each node, it is guaranteed that there's no more than one pixmap
+     * For each node, it is guaranteed that there's no more than one image
      * along the path from the root to the node itself.
-     * In fact, it is very frequent that a leaf node has no pixmap and one
+     * In fact, it is very frequent that a leaf node has no image and one
      * of its ancestors has. Such a situation shows, for example, when the
      * parent tile still has a dirty tile from a previous lower zoom level.
      */
-    QPixmap *pixmap;
+    QImage image;
 
     /**
      * Rotation of this individual tile.
@@ -99,7 +99,7 @@ public:
  * grid of 16 tiles. Then each of these tiles can be recursively split in 4
  * subtiles so that we keep the size of each pixmap inside a safe interval.
  */
-class TilesManager
+class OKULARCORE_EXPORT TilesManager
 {
 public:
     enum TileLeaf {
@@ -114,15 +114,16 @@ public:
     TilesManager &operator=(const TilesManager &) = delete;
 
     /**
-     * Sets the pixmap of the tiles covered by @p rect (which represents
-     * the location of @p pixmap on the page).
-     * @p pixmap may cover an area which contains multiple tiles. So each
-     * tile we get a cropped part of the @p pixmap.
+     * Sets the image of the tiles covered by @p rect (which represents
+     * the location of @p image on the page).
+     * @p image may cover an area which contains multiple tiles. So each
+     * tile we get a cropped part of the @p image. A null @p image drops
+     * the images of the tiles.
      *
      * Also it checks the dimensions of the given parameters against the
      * current request as to avoid setting pixmaps of late requests.
      */
-    void setPixmap(const QPixmap *pixmap, const NormalizedRect &rect, bool isPartialPixmap);
+    void setImage(const QImage &image, const NormalizedRect &rect, bool isPartialPixmap);
 
     /**
      * Checks whether all tiles intersecting with @p rect are available.
@@ -193,6 +194,16 @@ public:
      */
     void markDirty();
 
+    /**
+     * Mark the tiles intersecting @p rect as dirty, so that only they are
+     * requested again.
+     *
+     * Returns the union of the tiles that were marked, which is @p rect
+     * aligned to the tiles. The tiles that did not change keep their
+     * pixmaps and are not marked.
+     */
+    NormalizedRect markDirty(const NormalizedRect &rect);
+
     /**
      * Returns a rotated NormalizedRect given a @p rotation
      */
@@ -19,6 +19,16 @@
 #include <QWidget>
 #include <QWindow>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 using namespace Okular;
 
 QRect Utils::rotateRect(const QRect source, int width, int height, int orientation)
@@ -66,16 +76,159 @@ inline static bool isPaperColor(QRgb argb, QRgb paperColor)
     return (argb & 0xFFFFFF) == (paperColor & 0xFFFFFF); // ignore alpha
 }
 
+namespace
+{
+/**
+ * Tells the pixels of the paper color in the scan lines of an image.
+ *
+ * Like QImage::pixel() the stored value of a 32 bit pixel is compared, the
+ * color bytes of a premultiplied pixel are not unpremultiplied first. The
+ * vectorized scans compare (pixel & mask) to value, then look for the pixel
+ * that doesn't match one by one.
+ */
+struct PaperTest {
+    QRgb paperColor;
+    QRgb mask;
+    QRgb value;
+
+    bool matches(QRgb pixel) const
+    {
+        return isPaperColor(pixel, paperColor);
+    }
+};
+}
+
+// Returns the first pixel of @p line in [@p from, @p to) that isn't of the paper color, or @p to
+static int firstNonPaper(const QRgb *line, int from, int to, const PaperTest &test)
+{
+    int x = from;
+#if defined(__AVX2__)
+    const __m256i mask8 = _mm256_set1_epi32(test.mask);
+    const __m256i value8 = _mm256_set1_epi32(test.value);
+    for (; x + 8 <= to; x += 8) {
+        const __m256i pixels = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(line + x)), mask8);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(pixels, value8)) != -1) {
+            for (int i = x; i < x + 8; ++i) {
+                if (!test.matches(line[i])) {
+                    return i;
+                }
+            }
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i mask4 = _mm_set1_epi32(test.mask);
+    const __m128i value4 = _mm_set1_epi32(test.value);
+    for (; x + 4 <= to; x += 4) {
+        const __m128i pixels = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(line + x)), mask4);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(pixels, value4)) != 0xFFFF) {
+            for (int i = x; i < x + 4; ++i) {
+                if (!test.matches(line[i])) {
+                    return i;
+                }
+            }
+        }
+    }
+#elif defined(__ARM_NEON)
+    const uint32x4_t mask4 = vdupq_n_u32(test.mask);
+    const uint32x4_t value4 = vdupq_n_u32(test.value);
+    for (; x + 4 <= to; x += 4) {
+        const uint32x4_t equal = vceqq_u32(vandq_u32(vld1q_u32(line + x), mask4), value4);
+        const uint32x2_t halves = vand_u32(vget_low_u32(equal), vget_high_u32(equal));
+        if ((vget_lane_u32(halves, 0) & vget_lane_u32(halves, 1)) != 0xFFFFFFFF) {
+            for (int i = x; i < x + 4; ++i) {
+                if (!test.matches(line[i])) {
+                    return i;
+                }
+            }
+        }
+    }
+#endif
+    for (; x < to; ++x) {
+        if (!test.matches(line[x])) {
+            return x;
+        }
+    }
+    return to;
+}
+
+// Returns the last pixel of @p line in [@p from, @p to) that isn't of the paper color, or @p from - 1
+static int lastNonPaper(const QRgb *line, int from, int to, const PaperTest &test)
+{
+    int x = to;
+#if defined(__AVX2__)
+    const __m256i mask8 = _mm256_set1_epi32(test.mask);
+    const __m256i value8 = _mm256_set1_epi32(test.value);
+    for (; x - 8 >= from; x -= 8) {
+        const __m256i pixels = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(line + x - 8)), mask8);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(pixels, value8)) != -1) {
+            for (int i = x - 1; i >= x - 8; --i) {
+                if (!test.matches(line[i])) {
+                    return i;
+                }
+            }
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i mask4 = _mm_set1_epi32(test.mask);
+    const __m128i value4 = _mm_set1_epi32(test.value);
+    for (; x - 4 >= from; x -= 4) {
+        const __m128i pixels = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(line + x - 4)), mask4);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(pixels, value4)) != 0xFFFF) {
+            for (int i = x - 1; i >= x - 4; --i) {
+                if (!test.matches(line[i])) {
+                    return i;
+                }
+            }
+        }
+    }
+#elif defined(__ARM_NEON)
+    const uint32x4_t mask4 = vdupq_n_u32(test.mask);
+    const uint32x4_t value4 = vdupq_n_u32(test.value);
+    for (; x - 4 >= from; x -= 4) {
+        const uint32x4_t equal = vceqq_u32(vandq_u32(vld1q_u32(line + x - 4), mask4), value4);
+        const uint32x2_t halves = vand_u32(vget_low_u32(equal), vget_high_u32(equal));
+        if ((vget_lane_u32(halves, 0) & vget_lane_u32(halves, 1)) != 0xFFFFFFFF) {
+            for (int i = x - 1; i >= x - 4; --i) {
+                if (!test.matches(line[i])) {
+                    return i;
+                }
+            }
+        }
+    }
+#endif
+    for (--x; x >= from; --x) {
+        if (!test.matches(line[x])) {
+            return x;
+        }
+    }
+    return from - 1;
+}
+
 NormalizedRect Utils::imageBoundingBox(const QImage *image)
 {
-    if (!image) {
+    if (!image || image->isNull()) {
         return NormalizedRect();
     }
 
-    const int width = image->width();
-    const int height = image->height();
-    const QRgb paperColor = SettingsCore::paperColor().rgb();
-    int left, top, bottom, right, x, y;
+    // the scans read the pixels straight from the scan lines, so they need 32 bit ones
+    QImage converted;
+    const QImage *source = image;
+    if (image->format() != QImage::Format_RGB32 && image->format() != QImage::Format_ARGB32 && image->format() != QImage::Format_ARGB32_Premultiplied) {
+        converted = image->convertToFormat(QImage::Format_ARGB32);
+        source = &converted;
+    }
+
+    const int width = source->width();
+    const int height = source->height();
+    PaperTest test;
+    test.paperColor = SettingsCore::paperColor().rgb();
+    // ignore alpha
+    test.mask = 0x00FFFFFF;
+    test.value = test.paperColor & 0x00FFFFFF;
+    auto line = [source](int y) { return reinterpret_cast<const QRgb *>(source->constScanLine(y)); };
+    int left, top, bottom, right, x;
 
 #ifdef BBOX_DEBUG
     QTime time;
@@ -84,26 +237,23 @@ NormalizedRect Utils::imageBoundingBox(const QImage *image)
 
     // Scan pixels for top non-white
     for (top = 0; top < height; ++top) {
-        for (x = 0; x < width; ++x) {
-            if (!isPaperColor(image->pixel(x, top), paperColor)) {
-                goto got_top;
-            }
+        x = firstNonPaper(line(top), 0, width, test);
+        if (x < width) {
+            break;
         }
     }
-    return NormalizedRect(0, 0, 0, 0); // the image is blank
-got_top:
+    if (top == height) {
+        return NormalizedRect(0, 0, 0, 0); // the image is blank
+    }
     left = right = x;
 
-    // Scan pixels for bottom non-white
-    for (bottom = height - 1; bottom >= top; --bottom) {
-        for (x = width - 1; x >= 0; --x) {
-            if (!isPaperColor(image->pixel(x, bottom), paperColor)) {
-                goto got_bottom;
-            }
+    // Scan pixels for bottom non-white, the top row has some
+    for (bottom = height - 1;; --bottom) {
+        x = lastNonPaper(line(bottom), 0, width, test);
+        if (x >= 0) {
+            break;
         }
     }
-    Q_ASSERT(0); // image changed?!
-got_bottom:
     if (x < left) {
         left = x;
     }
@@ -112,16 +262,12 @@ got_bottom:
     }
 
     // Scan for leftmost and rightmost (we already found some bounds on these):
-    for (y = top; y <= bottom && (left > 0 || right < width - 1); ++y) {
-        for (x = 0; x < left; ++x) {
-            if (!isPaperColor(image->pixel(x, y), paperColor)) {
-                left = x;
-            }
-        }
-        for (x = width - 1; x > right + 1; --x) {
-            if (!isPaperColor(image->pixel(x, y), paperColor)) {
-                right = x;
-            }
+    for (int y = top; y <= bottom && (left > 0 || right < width - 1); ++y) {
+        const QRgb *pixels = line(y);
+        left = firstNonPaper(pixels, 0, left, test);
+        x = lastNonPaper(pixels, right + 1, width, test);
+        if (x > right) {
+            right = x;
         }
     }
 
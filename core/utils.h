@@ -43,6 +43,8 @@ public:
      * Compute the smallest rectangle that contains all non-white pixels in image),
      * in normalized [0,1] coordinates.
      *
+     * It only reads @p image, so it can be called from the thread that rendered it.
+     *
      * @since 0.7 (KDE 4.1)
      */
     static NormalizedRect imageBoundingBox(const QImage *image);
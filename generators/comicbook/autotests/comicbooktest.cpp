@@ -4,8 +4,14 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 
+#include <QBuffer>
+#include <QImage>
+#include <QMutex>
+#include <QTemporaryDir>
 #include <QTest>
 
+#include <KZip>
+
 #include "core/document.h"
 #include "core/generator.h"
 #include "core/observer.h"
@@ -22,6 +28,10 @@ class ComicBookGeneratorTest : public QObject
 private Q_SLOTS:
     void initTestCase();
     void testRotatedImage();
+    void testScaledImage();
+    void testTiles_data();
+    void testTiles();
+    void testProbedPageSizes();
     void cleanupTestCase();
 };
 
@@ -50,6 +60,180 @@ void ComicBookGeneratorTest::testRotatedImage()
     QVERIFY(image.height() > image.width());
 }
 
+void ComicBookGeneratorTest::testScaledImage()
+{
+    ComicBook::Document document;
+    const QString testFile = QStringLiteral(KDESRCDIR "autotests/data/rotated_cb.cbz");
+    QVERIFY(document.open(testFile));
+
+    QVector<Okular::Page *> pagesVector;
+    document.pages(&pagesVector);
+
+    const Okular::Page *p = pagesVector[0];
+    const QSize size(p->width() / 4, p->height() / 4);
+    const QImage image = document.pageImage(0, size);
+    QCOMPARE(image.size(), size);
+
+    const QRect clip(0, 0, size.width() / 2, size.height() / 2);
+    const QImage clippedImage = document.pageImage(0, size, clip);
+    QCOMPARE(clippedImage.size(), clip.size());
+    QCOMPARE(clippedImage.pixel(0, 0), image.pixel(0, 0));
+
+    // the second time it comes from the cache
+    QCOMPARE(document.pageImage(0, size).cacheKey(), image.cacheKey());
+}
+
+void ComicBookGeneratorTest::testTiles_data()
+{
+    QTest::addColumn<QByteArray>("format");
+    QTest::addColumn<QSize>("size");
+
+    // the tiles of the smaller size are cut from the decoded page, the ones of the
+    // bigger size are too big to be kept and are decoded one by one
+    QTest::newRow("PNG, cached page") << QByteArray("PNG") << QSize(512, 275);
+    QTest::newRow("PNG, page decoded by tile") << QByteArray("PNG") << QSize(4096, 2200);
+    QTest::newRow("JPEG, cached page") << QByteArray("JPEG") << QSize(400, 300);
+    QTest::newRow("JPEG, page decoded by tile") << QByteArray("JPEG") << QSize(4000, 3000);
+}
+
+void ComicBookGeneratorTest::testTiles()
+{
+    QFETCH(QByteArray, format);
+    QFETCH(QSize, size);
+
+    const bool lossless = format == "PNG";
+    QImage page(lossless ? QSize(1024, 550) : QSize(800, 600), QImage::Format_RGB32);
+    if (lossless) {
+        for (int y = 0; y < page.height(); ++y) {
+            for (int x = 0; x < page.width(); ++x) {
+                page.setPixel(x, y, qRgb(x % 256, y % 256, (x + y) % 256));
+            }
+        }
+    } else {
+        // a solid color in each quarter, so the tiles can be checked despite the compression
+        const QRgb quarterColors[] = {qRgb(255, 0, 0), qRgb(0, 255, 0), qRgb(0, 0, 255), qRgb(255, 255, 255)};
+        for (int y = 0; y < page.height(); ++y) {
+            for (int x = 0; x < page.width(); ++x) {
+                page.setPixel(x, y, quarterColors[(y >= page.height() / 2) * 2 + (x >= page.width() / 2)]);
+            }
+        }
+    }
+
+    QTemporaryDir dir;
+    const QString testFile = dir.filePath(QStringLiteral("tiles.cbz"));
+    {
+        KZip zip(testFile);
+        QVERIFY(zip.open(QIODevice::WriteOnly));
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(page.save(&buffer, format.constData(), 100));
+        QVERIFY(zip.writeFile(QStringLiteral("page.") + QString::fromLatin1(format.toLower()), buffer.data()));
+        QVERIFY(zip.close());
+    }
+
+    ComicBook::Document document;
+    QVERIFY(document.open(testFile));
+    QVector<Okular::Page *> pagesVector;
+    document.pages(&pagesVector);
+    qDeleteAll(pagesVector);
+
+    // the tiles first, so they are not cut from a whole page decoded before them
+    const int halfWidth = size.width() / 2;
+    const int halfHeight = size.height() / 2;
+    const QList<QRect> clips = {QRect(0, 0, halfWidth, halfHeight),
+                                QRect(halfWidth, 0, size.width() - halfWidth, halfHeight),
+                                QRect(0, halfHeight, halfWidth, size.height() - halfHeight),
+                                QRect(halfWidth, halfHeight, size.width() - halfWidth, size.height() - halfHeight)};
+    QList<QImage> tiles;
+    for (const QRect &clip : clips) {
+        tiles.append(document.pageImage(0, size, clip));
+        QCOMPARE(tiles.last().size(), clip.size());
+    }
+
+    const QImage image = document.pageImage(0, size);
+    QCOMPARE(image.size(), size);
+    for (int i = 0; i < clips.count(); ++i) {
+        if (lossless) {
+            QCOMPARE(tiles.at(i).convertToFormat(QImage::Format_RGB32), image.copy(clips.at(i)).convertToFormat(QImage::Format_RGB32));
+            continue;
+        }
+        const QColor expected = QColor(page.pixel(i % 2 ? page.width() * 3 / 4 : page.width() / 4, i / 2 ? page.height() * 3 / 4 : page.height() / 4));
+        const QColor center = QColor(tiles.at(i).pixel(tiles.at(i).width() / 2, tiles.at(i).height() / 2));
+        QVERIFY(qAbs(center.red() - expected.red()) < 16);
+        QVERIFY(qAbs(center.green() - expected.green()) < 16);
+        QVERIFY(qAbs(center.blue() - expected.blue()) < 16);
+    }
+}
+
+void ComicBookGeneratorTest::testProbedPageSizes()
+{
+    // more pages than the ones probed before opening, each of its own size
+    const int pageCount = 40;
+    QTemporaryDir dir;
+    const QString testFile = dir.filePath(QStringLiteral("pages.cbz"));
+    {
+        KZip zip(testFile);
+        QVERIFY(zip.open(QIODevice::WriteOnly));
+        for (int i = 0; i < pageCount; ++i) {
+            QImage image(100 + i, 200, QImage::Format_RGB32);
+            image.fill(Qt::white);
+            QBuffer buffer;
+            buffer.open(QIODevice::WriteOnly);
+            QVERIFY(image.save(&buffer, "PNG"));
+            QVERIFY(zip.writeFile(QStringLiteral("page%1.png").arg(i), buffer.data()));
+        }
+        QVERIFY(zip.writeFile(QStringLiteral("ComicInfo.xml"), QByteArray("<ComicInfo/>")));
+        // named like an image, so only probed later
+        QVERIFY(zip.writeFile(QStringLiteral("zz_broken.png"), QByteArray("not an image")));
+        QVERIFY(zip.close());
+    }
+
+    // without a callback all the sizes are known when it returns, and the broken entry is not a page
+    {
+        ComicBook::Document document;
+        QVERIFY(document.open(testFile));
+        QVector<Okular::Page *> pagesVector;
+        document.pages(&pagesVector);
+        QCOMPARE(pagesVector.count(), pageCount);
+        for (int i = 0; i < pageCount; ++i) {
+            QCOMPARE(pagesVector[i]->width(), 100. + i);
+        }
+        qDeleteAll(pagesVector);
+    }
+
+    // with a callback the sizes of the other pages come later, and the broken entry is a page without an image
+    ComicBook::Document document;
+    QVERIFY(document.open(testFile));
+    QVector<Okular::Page *> pagesVector;
+    QMutex mutex;
+    QMap<int, QSize> probedSizes;
+    document.pages(&pagesVector, [&mutex, &probedSizes](const QMap<int, QSize> &sizes) {
+        QMutexLocker locker(&mutex);
+        probedSizes.insert(sizes);
+    });
+    QCOMPARE(pagesVector.count(), pageCount + 1);
+    QCOMPARE(pagesVector[0]->width(), 100.);
+
+    auto allSizesKnown = [&mutex, &probedSizes, &pagesVector] {
+        QMutexLocker locker(&mutex);
+        for (int i = 0; i < pageCount; ++i) {
+            const QSize pageSize(int(pagesVector[i]->width()), int(pagesVector[i]->height()));
+            if (probedSizes.value(i, pageSize) != QSize(100 + i, 200)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    QTRY_VERIFY(allSizesKnown());
+    {
+        QMutexLocker locker(&mutex);
+        QVERIFY(!probedSizes.isEmpty());
+        QVERIFY(!probedSizes.contains(pageCount));
+    }
+    QVERIFY(document.pageImage(pageCount, QSize(100, 150)).isNull());
+    qDeleteAll(pagesVector);
+}
+
 QTEST_MAIN(ComicBookGeneratorTest)
 #include "comicbooktest.moc"
 
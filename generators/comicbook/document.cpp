@@ -9,7 +9,7 @@
 #include <QBuffer>
 #include <QImage>
 #include <QImageReader>
-#include <QScopedPointer>
+#include <QThread>
 
 #include <KLocalizedString>
 #include <KTar>
@@ -28,9 +28,82 @@
 #include "directory.h"
 #include "qnatsort.h"
 #include "unrar.h"
+#if WITH_LIBARCHIVE
+#include "rararchive.h"
+#endif
 
 using namespace ComicBook;
 
+// the cost of the decoded pages cache is in kilobytes
+static const int kDecodedPagesCacheSize = 64 * 1024;
+// the encoded images of the pages read last, in kilobytes too
+static const int kPageDataCacheSize = 32 * 1024;
+// pages whose size is found before the document opens, enough to fill the first screen
+static const int kFirstProbedPages = 4;
+// the probing threads report the sizes they found every this many pages
+static const int kProbeReportInterval = 32;
+// used for the pages not probed yet when none could be
+static const QSize kPlaceholderSize(1000, 1500);
+
+static KArchive *createArchive(const QString &fileName, const QMimeType &mime)
+{
+    /**
+     * We have a zip archive
+     */
+    if (mime.inherits(QStringLiteral("application/x-cbz")) || mime.inherits(QStringLiteral("application/zip"))) {
+        return new KZip(fileName);
+    }
+
+    /**
+     * We have a TAR archive
+     */
+    if (mime.inherits(QStringLiteral("application/x-cbt")) || mime.inherits(QStringLiteral("application/x-gzip")) || mime.inherits(QStringLiteral("application/x-tar")) || mime.inherits(QStringLiteral("application/x-bzip"))) {
+        return new KTar(fileName);
+    }
+
+#if WITH_K7ZIP
+    /**
+     * We have a 7z archive
+     */
+    if (mime.inherits(QStringLiteral("application/x-cb7")) || mime.inherits(QStringLiteral("application/x-7z-compressed"))) {
+        return new K7Zip(fileName);
+    }
+#endif
+
+    return nullptr;
+}
+
+// Returns whether the name of @p file says it's an image Qt can read
+static bool hasImageName(const QString &file)
+{
+    static const QList<QByteArray> imageMimeTypes = QImageReader::supportedMimeTypes();
+    static const QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile(file, QMimeDatabase::MatchExtension);
+    return !mime.isDefault() && imageMimeTypes.contains(mime.name().toLatin1());
+}
+
+// Returns the size of the image in @p dev, as it is shown, or an invalid size if it's not an image
+static QSize probeImageSize(QIODevice *dev)
+{
+    QImageReader reader(dev);
+    reader.setAutoTransform(true);
+    if (!reader.canRead()) {
+        return QSize();
+    }
+
+    QSize pageSize = reader.size();
+    if (reader.transformation() & QImageIOHandler::TransformationRotate90) {
+        pageSize.transpose();
+    }
+    if (!pageSize.isValid()) {
+        const QImage i = reader.read();
+        if (!i.isNull()) {
+            pageSize = i.size();
+        }
+    }
+    return pageSize;
+}
+
 static void imagesInArchive(const QString &prefix, const KArchiveDirectory *dir, QStringList *entries)
 {
     const QStringList entryList = dir->entries();
@@ -47,13 +120,19 @@ static void imagesInArchive(const QString &prefix, const KArchiveDirectory *dir,
 Document::Document()
     : mDirectory(nullptr)
     , mUnrar(nullptr)
+    , mRarArchive(nullptr)
     , mArchive(nullptr)
     , mArchiveDir(nullptr)
+    , mDecodedPages(kDecodedPagesCacheSize)
+    , mPageData(kPageDataCacheSize)
+    , mProbeCanceled(false)
 {
 }
 
 Document::~Document()
 {
+    mProbeCanceled = true;
+    mProbePool.waitForDone();
 }
 
 bool Document::open(const QString &fileName)
@@ -62,37 +141,30 @@ bool Document::open(const QString &fileName)
 
     QMimeDatabase db;
     const QMimeType mime = db.mimeTypeForFile(fileName, QMimeDatabase::MatchContent);
+    mFileName = fileName;
+    mMimeType = mime;
 
-    /**
-     * We have a zip archive
-     */
-    if (mime.inherits(QStringLiteral("application/x-cbz")) || mime.inherits(QStringLiteral("application/zip"))) {
-        mArchive = new KZip(fileName);
-
+    mArchive = createArchive(fileName, mime);
+    if (mArchive) {
         if (!processArchive()) {
             return false;
         }
+    } else if (mime.inherits(QStringLiteral("application/x-cbr")) || mime.inherits(QStringLiteral("application/x-rar")) || mime.inherits(QStringLiteral("application/vnd.rar"))) {
+#if WITH_LIBARCHIVE
         /**
-         * We have a TAR archive
+         * Read the rar archive in place, its pages are decompressed when they are shown
          */
-    } else if (mime.inherits(QStringLiteral("application/x-cbt")) || mime.inherits(QStringLiteral("application/x-gzip")) || mime.inherits(QStringLiteral("application/x-tar")) || mime.inherits(QStringLiteral("application/x-bzip"))) {
-        mArchive = new KTar(fileName);
-
-        if (!processArchive()) {
-            return false;
+        mRarArchive = new RarArchive();
+        if (mRarArchive->open(fileName)) {
+            mEntries = mRarArchive->list();
+            return true;
         }
-#if WITH_K7ZIP
-        /**
-         * We have a 7z archive
-         */
-    } else if (mime.inherits(QStringLiteral("application/x-cb7")) || mime.inherits(QStringLiteral("application/x-7z-compressed"))) {
-        mArchive = new K7Zip(fileName);
 
-        if (!processArchive()) {
-            return false;
-        }
+        qCDebug(OkularComicbookDebug) << "libarchive can't read" << fileName << "trying with unrar";
+        delete mRarArchive;
+        mRarArchive = nullptr;
 #endif
-    } else if (mime.inherits(QStringLiteral("application/x-cbr")) || mime.inherits(QStringLiteral("application/x-rar")) || mime.inherits(QStringLiteral("application/vnd.rar"))) {
+
         if (!Unrar::isAvailable()) {
             mLastErrorString = i18n("Cannot open document, neither unrar nor unarchiver were found.");
             return false;
@@ -139,7 +211,11 @@ void Document::close()
 {
     mLastErrorString.clear();
 
-    if (!(mArchive || mUnrar || mDirectory)) {
+    mProbeCanceled = true;
+    mProbePool.waitForDone();
+    mProbeCanceled = false;
+
+    if (!(mArchive || mUnrar || mRarArchive || mDirectory)) {
         return;
     }
 
@@ -149,8 +225,16 @@ void Document::close()
     mDirectory = nullptr;
     delete mUnrar;
     mUnrar = nullptr;
+#if WITH_LIBARCHIVE
+    delete mRarArchive;
+    mRarArchive = nullptr;
+#endif
     mPageMap.clear();
     mEntries.clear();
+
+    QMutexLocker locker(&mDecodedPagesMutex);
+    mDecodedPages.clear();
+    mPageData.clear();
 }
 
 bool Document::processArchive()
@@ -177,52 +261,143 @@ bool Document::processArchive()
     return true;
 }
 
-void Document::pages(QVector<Okular::Page *> *pagesVector)
+QIODevice *Document::createDevice(const QString &file, const KArchiveDirectory *archiveDir) const
+{
+    if (archiveDir) {
+        const KArchiveFile *entry = static_cast<const KArchiveFile *>(archiveDir->entry(file));
+        return entry ? entry->createDevice() : nullptr;
+    } else if (mDirectory) {
+        return mDirectory->createDevice(file);
+#if WITH_LIBARCHIVE
+    } else if (mRarArchive) {
+        return mRarArchive->createDevice(file);
+#endif
+    } else {
+        return mUnrar->createDevice(file);
+    }
+}
+
+void Document::pages(QVector<Okular::Page *> *pagesVector, const PageSizesProbed &pageSizesProbed)
 {
     std::sort(mEntries.begin(), mEntries.end(), caseSensitiveNaturalOrderLessThen);
-    QScopedPointer<QIODevice> dev;
 
-    int count = 0;
-    pagesVector->clear();
-    pagesVector->resize(mEntries.size());
-    QImageReader reader;
-    reader.setAutoTransform(true);
+    // Only the first pages and the entries whose name doesn't tell whether they are
+    // images are probed now, the other ones become pages of a placeholder size
+    QList<QSize> pageSizes;
+    QSize placeholderSize;
     for (const QString &file : std::as_const(mEntries)) {
-        if (mArchive) {
-            const KArchiveFile *entry = static_cast<const KArchiveFile *>(mArchiveDir->entry(file));
-            if (entry) {
-                dev.reset(entry->createDevice());
+        if (pageSizes.count() >= kFirstProbedPages && hasImageName(file)) {
+            mPageMap.append(file);
+            pageSizes.append(QSize());
+            continue;
+        }
+
+        std::unique_ptr<QIODevice> dev(createDevice(file, mArchiveDir));
+        const QSize pageSize = dev ? probeImageSize(dev.get()) : QSize();
+        if (pageSize.isValid()) {
+            mPageMap.append(file);
+            pageSizes.append(pageSize);
+            if (!placeholderSize.isValid()) {
+                placeholderSize = pageSize;
             }
-        } else if (mDirectory) {
-            dev.reset(mDirectory->createDevice(file));
-        } else {
-            dev.reset(mUnrar->createDevice(file));
+        } else if (dev) {
+            qCDebug(OkularComicbookDebug) << "Ignoring" << file << "doesn't seem to be an image";
+        }
+    }
+    if (!placeholderSize.isValid()) {
+        placeholderSize = kPlaceholderSize;
+    }
+
+    QList<int> unprobedPages;
+    for (int page = 0; page < pageSizes.count(); ++page) {
+        if (!pageSizes[page].isValid()) {
+            unprobedPages.append(page);
         }
+    }
 
-        if (!dev.isNull()) {
-            reader.setDevice(dev.data());
-            if (reader.canRead()) {
-                QSize pageSize = reader.size();
-                if (reader.transformation() & QImageIOHandler::TransformationRotate90) {
-                    pageSize.transpose();
+    if (!unprobedPages.isEmpty()) {
+        if (pageSizesProbed) {
+            probePageSizes(unprobedPages, pageSizesProbed);
+        } else {
+            // nobody to tell about them later, wait for them
+            QMutex mutex;
+            probePageSizes(unprobedPages, [&mutex, &pageSizes](const QMap<int, QSize> &sizes) {
+                QMutexLocker locker(&mutex);
+                for (auto it = sizes.cbegin(); it != sizes.cend(); ++it) {
+                    pageSizes[it.key()] = it.value();
                 }
-                if (!pageSize.isValid()) {
-                    const QImage i = reader.read();
-                    if (!i.isNull()) {
-                        pageSize = i.size();
-                    }
+            });
+            mProbePool.waitForDone();
+
+            // as when all the entries are probed first, the ones that are not images are not pages
+            for (int page = pageSizes.count() - 1; page >= 0; --page) {
+                if (!pageSizes[page].isValid()) {
+                    mPageMap.removeAt(page);
+                    pageSizes.removeAt(page);
                 }
+            }
+        }
+    }
+
+    pagesVector->clear();
+    pagesVector->reserve(pageSizes.count());
+    for (int page = 0; page < pageSizes.count(); ++page) {
+        const QSize pageSize = pageSizes[page].isValid() ? pageSizes[page] : placeholderSize;
+        pagesVector->append(new Okular::Page(page, pageSize.width(), pageSize.height(), Okular::Rotation0));
+    }
+}
+
+void Document::probePageSizes(const QList<int> &pages, const PageSizesProbed &pageSizesProbed)
+{
+    // The entries of a zip archive, of a directory and of an extracted rar archive can be
+    // read at the same time by several threads, each zip reader opening the archive again.
+    // Other archives, rar ones read in place included, have to be decompressed from the
+    // beginning, so one thread reads them all.
+    const bool sequential = (mArchive && !dynamic_cast<KZip *>(mArchive)) || mRarArchive;
+    const int jobCount = sequential ? 1 : qBound(1, int(pages.count() / kProbeReportInterval), QThread::idealThreadCount());
+    mProbePool.setMaxThreadCount(jobCount);
+
+    for (int job = 0; job < jobCount; ++job) {
+        // each job probes a contiguous range, so the first pages of each are known first
+        const QList<int> jobPages = pages.mid(pages.count() * job / jobCount, pages.count() * (job + 1) / jobCount - pages.count() * job / jobCount);
+        QStringList jobFiles;
+        for (int page : jobPages) {
+            jobFiles.append(mPageMap[page]);
+        }
+
+        mProbePool.start([this, jobPages, jobFiles, pageSizesProbed] {
+            std::unique_ptr<KArchive> archive;
+            const KArchiveDirectory *archiveDir = nullptr;
+            if (mArchive) {
+                archive.reset(createArchive(mFileName, mMimeType));
+                if (!archive || !archive->open(QIODevice::ReadOnly) || !archive->directory()) {
+                    qCDebug(OkularComicbookDebug) << "Can't open" << mFileName << "again to probe its pages";
+                    return;
+                }
+                archiveDir = archive->directory();
+            }
+
+            QMap<int, QSize> sizes;
+            for (int i = 0; i < jobPages.count() && !mProbeCanceled; ++i) {
+                std::unique_ptr<QIODevice> dev(createDevice(jobFiles[i], archiveDir));
+                const QSize pageSize = dev ? probeImageSize(dev.get()) : QSize();
                 if (pageSize.isValid()) {
-                    pagesVector->replace(count, new Okular::Page(count, pageSize.width(), pageSize.height(), Okular::Rotation0));
-                    mPageMap.append(file);
-                    count++;
+                    sizes.insert(jobPages[i], pageSize);
                 } else {
-                    qCDebug(OkularComicbookDebug) << "Ignoring" << file << "doesn't seem to be an image even if QImageReader::canRead returned true";
+                    qCDebug(OkularComicbookDebug) << jobFiles[i] << "doesn't seem to be an image, keeping its placeholder size";
+                }
+
+                if (sizes.count() >= kProbeReportInterval) {
+                    pageSizesProbed(sizes);
+                    sizes.clear();
                 }
             }
-        }
+
+            if (!sizes.isEmpty() && !mProbeCanceled) {
+                pageSizesProbed(sizes);
+            }
+        });
     }
-    pagesVector->resize(count);
 }
 
 QStringList Document::pageTitles() const
@@ -230,30 +405,107 @@ QStringList Document::pageTitles() const
     return QStringList();
 }
 
-QImage Document::pageImage(int page) const
+QImage Document::pageImage(int page, const QSize &size, const QRect &clip) const
+{
+    if (page < 0 || page >= mPageMap.count()) {
+        return QImage();
+    }
+
+    // full size images are only asked for printing, they are too big to keep
+    if (size.isEmpty()) {
+        return decodePageImage(page, size, clip);
+    }
+
+    const QString key = QStringLiteral("%1-%2x%3").arg(page).arg(size.width()).arg(size.height());
+    {
+        QMutexLocker locker(&mDecodedPagesMutex);
+        if (const QImage *image = mDecodedPages.object(key)) {
+            return clip.isValid() ? image->copy(clip) : *image;
+        }
+    }
+
+    // the tiles of a page that fits in the cache are cut from the whole page, decoded once;
+    // the ones of a bigger page are decoded one by one, from the image data kept for the page
+    const qint64 cost = qint64(size.width()) * size.height() * 4 / 1024;
+    if (clip.isValid() && cost > kDecodedPagesCacheSize / 2) {
+        return decodePageImage(page, size, clip);
+    }
+
+    const QImage image = decodePageImage(page, size, QRect());
+    if (!image.isNull()) {
+        QMutexLocker locker(&mDecodedPagesMutex);
+        mDecodedPages.insert(key, new QImage(image), qMax<qsizetype>(1, image.sizeInBytes() / 1024));
+    }
+
+    return clip.isValid() ? image.copy(clip) : image;
+}
+
+QByteArray Document::pageData(int page) const
 {
+    {
+        QMutexLocker locker(&mDecodedPagesMutex);
+        if (const QByteArray *data = mPageData.object(page)) {
+            return *data;
+        }
+    }
+
+    QByteArray data;
     if (mArchive) {
         const KArchiveFile *entry = static_cast<const KArchiveFile *>(mArchiveDir->entry(mPageMap[page]));
-        if (entry) {
-            std::unique_ptr<QIODevice> dev(entry->createDevice());
-            // This could simply be
-            //     QImageReader reader(dev.get());
-            // but due to https://codereview.qt-project.org/c/qt/qtbase/+/349174 and https://invent.kde.org/frameworks/karchive/-/merge_requests/14
-            // it can not, so it will have to be like this at least until Qt6
-            // Test with https://bugs.kde.org/attachment.cgi?id=74039 (it's a cbz with a png inside)
-            QBuffer b;
-            b.setData(dev->readAll());
-            QImageReader reader(&b);
-            reader.setAutoTransform(true);
-            return reader.read();
+        if (!entry) {
+            return QByteArray();
         }
-    } else if (mDirectory) {
-        return QImage(mPageMap[page]);
+
+        std::unique_ptr<QIODevice> dev(entry->createDevice());
+        // This could simply be
+        //     QImageReader reader(dev.get());
+        // but due to https://codereview.qt-project.org/c/qt/qtbase/+/349174 and https://invent.kde.org/frameworks/karchive/-/merge_requests/14
+        // it can not, so it will have to be like this at least until Qt6
+        // Test with https://bugs.kde.org/attachment.cgi?id=74039 (it's a cbz with a png inside)
+        data = dev->readAll();
+#if WITH_LIBARCHIVE
+    } else if (mRarArchive) {
+        data = mRarArchive->contentOf(mPageMap[page]);
+#endif
     } else {
-        return QImage::fromData(mUnrar->contentOf(mPageMap[page]));
+        data = mUnrar->contentOf(mPageMap[page]);
+    }
+
+    QMutexLocker locker(&mDecodedPagesMutex);
+    mPageData.insert(page, new QByteArray(data), qMax<qsizetype>(1, data.size() / 1024));
+    return data;
+}
+
+QImage Document::decodePageImage(int page, const QSize &size, const QRect &clip) const
+{
+    QBuffer buffer;
+    QImageReader reader;
+    if (mDirectory) {
+        reader.setFileName(mPageMap[page]);
+    } else {
+        const QByteArray data = pageData(page);
+        if (data.isEmpty()) {
+            return QImage();
+        }
+        buffer.setData(data);
+        reader.setDevice(&buffer);
+    }
+    reader.setAutoTransform(true);
+
+    if (!size.isEmpty()) {
+        // Let the image handler scale while decoding, the JPEG one does it in the DCT
+        // so big scans are never decoded at full size. The scaled size applies before
+        // the EXIF transformation.
+        const QImageIOHandler::Transformations transformation = reader.transformation();
+        reader.setScaledSize((transformation & QImageIOHandler::TransformationRotate90) ? size.transposed() : size);
+        if (clip.isValid() && transformation == QImageIOHandler::TransformationNone) {
+            reader.setScaledClipRect(clip);
+            return reader.read();
+        }
     }
 
-    return QImage();
+    const QImage image = reader.read();
+    return clip.isValid() ? image.copy(clip) : image;
 }
 
 QString Document::lastErrorString() const
@@ -7,12 +7,22 @@
 #ifndef COMICBOOK_DOCUMENT_H
 #define COMICBOOK_DOCUMENT_H
 
+#include <QCache>
+#include <QImage>
+#include <QMap>
+#include <QMimeType>
+#include <QMutex>
 #include <QStringList>
+#include <QThreadPool>
+
+#include <atomic>
+#include <functional>
 
 class KArchiveDirectory;
 class KArchive;
-class QImage;
+class QIODevice;
 class Unrar;
+class RarArchive;
 class Directory;
 
 namespace Okular
@@ -31,23 +41,63 @@ public:
     bool open(const QString &fileName);
     void close();
 
-    void pages(QVector<Okular::Page *> *pagesVector);
+    /**
+     * Called from the probing threads with the sizes of pages that got a
+     * placeholder size.
+     */
+    using PageSizesProbed = std::function<void(const QMap<int, QSize> &sizes)>;
+
+    /**
+     * Fills @p pagesVector with the pages of the document.
+     *
+     * Only the size of the first pages is found before returning, the other
+     * pages get a placeholder size and are probed by a pool of threads, which
+     * report their sizes to @p pageSizesProbed as they find them. Without
+     * @p pageSizesProbed it waits for all of them, and the entries that turn
+     * out not to be images are not pages. With it they are already pages, which
+     * keep their placeholder size and have no image.
+     */
+    void pages(QVector<Okular::Page *> *pagesVector, const PageSizesProbed &pageSizesProbed = PageSizesProbed());
     QStringList pageTitles() const;
 
-    QImage pageImage(int page) const;
+    /**
+     * Returns the image of @p page scaled to @p size, or at its own size if
+     * @p size is empty. If @p clip is valid only that part of the scaled image
+     * is returned.
+     *
+     * Scaled images are kept in a small cache, so going back and forth between
+     * neighbouring pages doesn't decode them again, and the parts of a page
+     * are cut from the same decoded image. Only the parts of pages too big to
+     * be kept are decoded one by one.
+     */
+    QImage pageImage(int page, const QSize &size = QSize(), const QRect &clip = QRect()) const;
 
     QString lastErrorString() const;
 
 private:
     bool processArchive();
+    QIODevice *createDevice(const QString &file, const KArchiveDirectory *archiveDir) const;
+    void probePageSizes(const QList<int> &pages, const PageSizesProbed &pageSizesProbed);
+    QImage decodePageImage(int page, const QSize &size, const QRect &clip) const;
+    QByteArray pageData(int page) const;
 
     QStringList mPageMap;
     Directory *mDirectory;
     Unrar *mUnrar;
+    RarArchive *mRarArchive;
     KArchive *mArchive;
     const KArchiveDirectory *mArchiveDir;
     QString mLastErrorString;
     QStringList mEntries;
+    QString mFileName;
+    QMimeType mMimeType;
+    mutable QMutex mDecodedPagesMutex;
+    mutable QCache<QString, QImage> mDecodedPages;
+    // the image files of archives, so the tiles of a page don't read its entry again
+    mutable QCache<int, QByteArray> mPageData;
+    std::atomic<bool> mProbeCanceled;
+    // last, so it's destroyed first
+    QThreadPool mProbePool;
 };
 
 }
@@ -22,8 +22,10 @@ OKULAR_EXPORT_PLUGIN(ComicBookGenerator, "libokularGenerator_comicbook.json")
 
 ComicBookGenerator::ComicBookGenerator(QObject *parent, const QVariantList &args)
     : Generator(parent, args)
+    , mDocumentGeneration(0)
 {
     setFeature(Threaded);
+    setFeature(TiledRendering);
     setFeature(PrintNative);
     setFeature(PrintToFile);
 }
@@ -42,25 +44,63 @@ bool ComicBookGenerator::loadDocument(const QString &fileName, QVector<Okular::P
         return false;
     }
 
-    mDocument.pages(&pagesVector);
+    // the sizes come from the probing threads, and may still be on their way
+    // when this document is closed
+    const int documentGeneration = mDocumentGeneration;
+    mDocument.pages(&pagesVector, [this, documentGeneration](const QMap<int, QSize> &sizes) {
+        QMap<int, QSizeF> pageSizes;
+        for (auto it = sizes.cbegin(); it != sizes.cend(); ++it) {
+            pageSizes.insert(it.key(), it.value());
+        }
+        QMetaObject::invokeMethod(
+            this,
+            [this, documentGeneration, pageSizes] {
+                if (documentGeneration == mDocumentGeneration) {
+                    updatePageSizes(pageSizes);
+                }
+            },
+            Qt::QueuedConnection);
+    });
     return true;
 }
 
 bool ComicBookGenerator::doCloseDocument()
 {
     mDocument.close();
+    ++mDocumentGeneration;
 
     return true;
 }
 
-QImage ComicBookGenerator::image(Okular::PixmapRequest *request)
+// The pages whose entry turned out not to be an image after they were made
+// show why they are empty instead of blank paper
+static QImage unreadablePageImage(const QSize &size)
 {
-    int width = request->width();
-    int height = request->height();
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(Qt::white);
+
+    QPainter painter(&image);
+    QFont font = painter.font();
+    font.setPixelSize(qMax(8, size.width() / 24));
+    painter.setFont(font);
+    painter.setPen(Qt::darkGray);
+    painter.drawRect(image.rect().adjusted(0, 0, -1, -1));
+    const int margin = size.width() / 10;
+    painter.drawText(image.rect().adjusted(margin, margin, -margin, -margin), Qt::AlignCenter | Qt::TextWordWrap, i18n("This page is not an image that can be shown."));
+    return image;
+}
 
-    QImage image = mDocument.pageImage(request->pageNumber());
+QImage ComicBookGenerator::image(Okular::PixmapRequest *request)
+{
+    const QSize size(request->width(), request->height());
+    if (request->isTile()) {
+        const QRect clip = request->normalizedRect().geometry(size.width(), size.height());
+        const QImage image = mDocument.pageImage(request->pageNumber(), size, clip);
+        return image.isNull() ? unreadablePageImage(size).copy(clip) : image;
+    }
 
-    return image.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    const QImage image = mDocument.pageImage(request->pageNumber(), size);
+    return image.isNull() ? unreadablePageImage(size) : image;
 }
 
 Okular::Document::PrintError ComicBookGenerator::print(QPrinter &printer)
@@ -32,6 +32,7 @@ protected:
 
 private:
     ComicBook::Document mDocument;
+    int mDocumentGeneration;
 };
 
 #endif
@@ -0,0 +1,243 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "rararchive.h"
+
+#include <QFile>
+#include <QIODevice>
+
+#include <memory>
+
+#include <archive.h>
+#include <archive_entry.h>
+
+#include "debug_comicbook.h"
+
+// how much of the archive file libarchive reads at once
+static const size_t kReadBlockSize = 64 * 1024;
+
+static QString entryName(archive_entry *entry)
+{
+    if (const char *name = archive_entry_pathname_utf8(entry)) {
+        return QString::fromUtf8(name);
+    }
+    return QFile::decodeName(archive_entry_pathname(entry));
+}
+
+/**
+ * Reads one entry of the archive while it's decompressed, then gives the
+ * reader back to the archive so the next entries can be read with it.
+ */
+class RarEntryDevice : public QIODevice
+{
+public:
+    RarEntryDevice(const RarArchive *rarArchive, archive *reader, int entry, qint64 size)
+        : mRarArchive(rarArchive)
+        , mReader(reader)
+        , mEntry(entry)
+        , mSize(size)
+        , mRead(0)
+    {
+        open(QIODevice::ReadOnly);
+    }
+
+    ~RarEntryDevice() override
+    {
+        if (mReader) {
+            mRarArchive->returnReader(mReader, mEntry + 1);
+        }
+    }
+
+    bool isSequential() const override
+    {
+        return true;
+    }
+
+    qint64 bytesAvailable() const override
+    {
+        return qMax<qint64>(0, mSize - mRead) + QIODevice::bytesAvailable();
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        if (!mReader) {
+            return -1;
+        }
+
+        const la_ssize_t read = archive_read_data(mReader, data, size_t(maxSize));
+        if (read < 0) {
+            setErrorString(QString::fromUtf8(archive_error_string(mReader)));
+            qCDebug(OkularComicbookDebug) << "Error decompressing rar entry" << mEntry << errorString();
+            // don't hand a broken reader back
+            archive_read_free(mReader);
+            mReader = nullptr;
+            return -1;
+        }
+        if (read == 0 && maxSize > 0) {
+            return -1;
+        }
+
+        mRead += read;
+        return read;
+    }
+
+    qint64 writeData(const char *, qint64) override
+    {
+        return -1;
+    }
+
+private:
+    const RarArchive *mRarArchive;
+    archive *mReader;
+    int mEntry;
+    qint64 mSize;
+    qint64 mRead;
+};
+
+RarArchive::RarArchive()
+    : mIdleReader(nullptr)
+    , mIdleReaderNextEntry(0)
+{
+}
+
+RarArchive::~RarArchive()
+{
+    if (mIdleReader) {
+        archive_read_free(mIdleReader);
+    }
+}
+
+bool RarArchive::open(const QString &fileName)
+{
+    mFileName = fileName;
+    mFiles.clear();
+    mEntryIndexes.clear();
+
+    archive *reader = openReader();
+    if (!reader) {
+        return false;
+    }
+
+    // only the headers are read, the data of the entries is skipped
+    archive_entry *entry;
+    int index = 0;
+    int result;
+    while ((result = archive_read_next_header(reader, &entry)) == ARCHIVE_OK || result == ARCHIVE_WARN) {
+        if (archive_entry_filetype(entry) == AE_IFREG && !archive_entry_is_encrypted(entry)) {
+            const QString name = entryName(entry);
+            mFiles.append(name);
+            mEntryIndexes.insert(name, index);
+        }
+        ++index;
+    }
+
+    if (result != ARCHIVE_EOF) {
+        // a damaged end still leaves the entries before it readable
+        qCDebug(OkularComicbookDebug) << "Error reading the rar archive" << fileName << archive_error_string(reader);
+    }
+
+    archive_read_free(reader);
+    return index > 0;
+}
+
+QStringList RarArchive::list() const
+{
+    return mFiles;
+}
+
+QByteArray RarArchive::contentOf(const QString &fileName) const
+{
+    std::unique_ptr<QIODevice> dev(createDevice(fileName));
+    return dev ? dev->readAll() : QByteArray();
+}
+
+QIODevice *RarArchive::createDevice(const QString &fileName) const
+{
+    const auto it = mEntryIndexes.constFind(fileName);
+    if (it == mEntryIndexes.constEnd()) {
+        return nullptr;
+    }
+
+    archive *reader = takeReader(*it);
+    if (!reader) {
+        return nullptr;
+    }
+
+    // takeReader() stopped right after the header of the entry
+    archive_entry *entry;
+    const int result = archive_read_next_header(reader, &entry);
+    if (result != ARCHIVE_OK && result != ARCHIVE_WARN) {
+        qCDebug(OkularComicbookDebug) << "Can't find" << fileName << "in" << mFileName << archive_error_string(reader);
+        archive_read_free(reader);
+        return nullptr;
+    }
+
+    return new RarEntryDevice(this, reader, *it, archive_entry_size_is_set(entry) ? archive_entry_size(entry) : 0);
+}
+
+archive *RarArchive::openReader() const
+{
+    archive *reader = archive_read_new();
+    archive_read_support_format_rar(reader);
+#if ARCHIVE_VERSION_NUMBER >= 3004000
+    archive_read_support_format_rar5(reader);
+#endif
+
+    if (archive_read_open_filename(reader, QFile::encodeName(mFileName).constData(), kReadBlockSize) != ARCHIVE_OK) {
+        qCDebug(OkularComicbookDebug) << "Can't open the rar archive" << mFileName << archive_error_string(reader);
+        archive_read_free(reader);
+        return nullptr;
+    }
+
+    return reader;
+}
+
+// Returns a reader whose next header is the one of @p entry
+archive *RarArchive::takeReader(int entry) const
+{
+    archive *reader = nullptr;
+    int nextEntry = 0;
+    {
+        QMutexLocker locker(&mIdleReaderMutex);
+        if (mIdleReader && mIdleReaderNextEntry <= entry) {
+            reader = mIdleReader;
+            nextEntry = mIdleReaderNextEntry;
+            mIdleReader = nullptr;
+        }
+    }
+
+    if (!reader) {
+        // the entry is behind the idle reader, start again from the beginning
+        reader = openReader();
+        if (!reader) {
+            return nullptr;
+        }
+    }
+
+    archive_entry *skipped;
+    for (; nextEntry < entry; ++nextEntry) {
+        const int result = archive_read_next_header(reader, &skipped);
+        if (result != ARCHIVE_OK && result != ARCHIVE_WARN) {
+            qCDebug(OkularComicbookDebug) << "Error reading the rar archive" << mFileName << archive_error_string(reader);
+            archive_read_free(reader);
+            return nullptr;
+        }
+    }
+
+    return reader;
+}
+
+void RarArchive::returnReader(archive *reader, int nextEntry) const
+{
+    QMutexLocker locker(&mIdleReaderMutex);
+    // keep the one that was used last, the next page is usually read after it
+    if (mIdleReader) {
+        archive_read_free(mIdleReader);
+    }
+    mIdleReader = reader;
+    mIdleReaderNextEntry = nextEntry;
+}
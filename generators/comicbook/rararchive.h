@@ -0,0 +1,79 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef RARARCHIVE_H
+#define RARARCHIVE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+
+struct archive;
+class QIODevice;
+
+/**
+ * Reads rar archives in process with libarchive.
+ *
+ * Opening the archive only reads the headers of its entries, an entry is
+ * decompressed when it's read, straight from the archive file.
+ *
+ * Rar archives can only be read from the beginning, so the reader that
+ * read the last entry is kept and reused if a later entry is asked for,
+ * reading the pages in order doesn't go through the archive again for
+ * each of them.
+ */
+class RarArchive
+{
+public:
+    RarArchive();
+    ~RarArchive();
+
+    RarArchive(const RarArchive &) = delete;
+    RarArchive &operator=(const RarArchive &) = delete;
+
+    /**
+     * Opens the rar archive @p fileName and reads its list of files.
+     */
+    bool open(const QString &fileName);
+
+    /**
+     * Returns the list of files from the archive.
+     */
+    QStringList list() const;
+
+    /**
+     * Returns the content of the file with the given name.
+     *
+     * Can be called from several threads at the same time.
+     */
+    QByteArray contentOf(const QString &fileName) const;
+
+    /**
+     * Returns a new device reading the file with the given name while it
+     * is decompressed. It must be deleted before the RarArchive.
+     *
+     * Can be called from several threads at the same time.
+     */
+    QIODevice *createDevice(const QString &fileName) const;
+
+private:
+    friend class RarEntryDevice;
+
+    archive *openReader() const;
+    archive *takeReader(int entry) const;
+    void returnReader(archive *reader, int nextEntry) const;
+
+    QString mFileName;
+    QStringList mFiles;
+    // the position of each file among all the entries of the archive
+    QHash<QString, int> mEntryIndexes;
+
+    mutable QMutex mIdleReaderMutex;
+    mutable archive *mIdleReader;
+    mutable int mIdleReaderNextEntry;
+};
+
+#endif
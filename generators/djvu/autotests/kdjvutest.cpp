@@ -0,0 +1,129 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QBuffer>
+#include <QFile>
+#include <QImage>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QtEndian>
+
+#include "../kdjvu.h"
+
+class KDjVuTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testParallelMatchesSerial_data();
+    void testParallelMatchesSerial();
+
+private:
+    QTemporaryDir m_dir;
+    QString m_fileName;
+};
+
+static const int kPageWidth = 1200;
+static const int kPageHeight = 1600;
+
+static QByteArray chunk(const char *id, const QByteArray &data)
+{
+    QByteArray result(id, 4);
+    const quint32 size = qToBigEndian(quint32(data.size()));
+    result += QByteArray(reinterpret_cast<const char *>(&size), 4) + data;
+    if (data.size() % 2) {
+        result += '\0';
+    }
+    return result;
+}
+
+// A single page document whose only layer is a JPEG background, the kind of
+// DjVu file that can be made without a DjVu encoder
+void KDjVuTest::initTestCase()
+{
+    QImage background(kPageWidth, kPageHeight, QImage::Format_RGB32);
+    for (int y = 0; y < kPageHeight; ++y) {
+        for (int x = 0; x < kPageWidth; ++x) {
+            background.setPixel(x, y, qRgb(x * 255 / kPageWidth, y * 255 / kPageHeight, ((x / 50 + y / 50) % 2) * 255));
+        }
+    }
+    QBuffer jpeg;
+    jpeg.open(QIODevice::WriteOnly);
+    QVERIFY(background.save(&jpeg, "JPEG", 90));
+
+    // width and height, version 26, 300 dpi, gamma 2.2, no rotation
+    QByteArray info;
+    info += char(kPageWidth >> 8);
+    info += char(kPageWidth & 0xff);
+    info += char(kPageHeight >> 8);
+    info += char(kPageHeight & 0xff);
+    info += char(26);
+    info += char(0);
+    info += char(300 & 0xff);
+    info += char(300 >> 8);
+    info += char(22);
+    info += char(1);
+
+    const QByteArray form = chunk("FORM", QByteArray("DJVU") + chunk("INFO", info) + chunk("BGjp", jpeg.data()));
+
+    m_fileName = m_dir.filePath(QStringLiteral("page.djvu"));
+    QFile file(m_fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QVERIFY(file.write(QByteArray("AT&T") + form) > 0);
+}
+
+void KDjVuTest::testParallelMatchesSerial_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("rotation");
+    QTest::addColumn<QRect>("rect");
+
+    QTest::newRow("page") << QSize(kPageWidth, kPageHeight) << 0 << QRect();
+    // wider than a block, so the rows have several blocks too
+    QTest::newRow("zoomed page") << QSize(kPageWidth * 2, kPageHeight * 2) << 0 << QRect();
+    QTest::newRow("rotated page") << QSize(kPageHeight * 2, kPageWidth * 2) << 1 << QRect();
+    QTest::newRow("tile") << QSize(kPageWidth * 3, kPageHeight * 3) << 0 << QRect(700, 900, 1800, 2100);
+    QTest::newRow("edge tile") << QSize(kPageWidth * 3, kPageHeight * 3) << 2 << QRect(2500, 3900, 2000, 1000);
+}
+
+// Each thread renders with a page handle of its own, the image is the same as when one thread renders it all
+void KDjVuTest::testParallelMatchesSerial()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, rotation);
+    QFETCH(QRect, rect);
+
+    KDjVu djvu;
+    djvu.setCacheEnabled(false);
+    QVERIFY(djvu.openFile(m_fileName));
+    QCOMPARE(djvu.pages().count(), 1);
+
+    djvu.setRenderThreadCount(1);
+    const QImage serial = djvu.image(0, size.width(), size.height(), rotation, rect);
+    QCOMPARE(serial.size(), rect.isNull() ? size : (rect & QRect(QPoint(0, 0), size)).size());
+
+    // without JPEG support djvulibre renders the background as white paper
+    bool hasContent = false;
+    for (int y = 0; y < serial.height() && !hasContent; y += 16) {
+        for (int x = 0; x < serial.width() && !hasContent; x += 16) {
+            hasContent = serial.pixel(x, y) != qRgb(255, 255, 255);
+        }
+    }
+    if (!hasContent) {
+        QSKIP("djvulibre was built without JPEG support");
+    }
+
+    for (int threads : {2, 3, 8}) {
+        djvu.setRenderThreadCount(threads);
+        // twice, the second time with the page handles made the first time
+        QCOMPARE(djvu.image(0, size.width(), size.height(), rotation, rect), serial);
+        QCOMPARE(djvu.image(0, size.width(), size.height(), rotation, rect), serial);
+    }
+}
+
+QTEST_GUILESS_MAIN(KDjVuTest)
+#include "kdjvutest.moc"
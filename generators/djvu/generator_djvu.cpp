@@ -15,6 +15,8 @@
 #include <core/textpage.h>
 #include <core/utils.h>
 
+#include "settings_core.h"
+
 #include <QDomDocument>
 #include <QMutex>
 #include <QPixmap>
@@ -65,6 +67,8 @@ DjVuGenerator::DjVuGenerator(QObject *parent, const QVariantList &args)
 {
     setFeature(TextExtraction);
     setFeature(Threaded);
+    setFeature(RotatedRendering);
+    setFeature(TiledRendering);
     setFeature(PrintPostscript);
     if (Okular::FilePrinter::ps2pdfAvailable()) {
         setFeature(PrintToFile);
@@ -105,10 +109,34 @@ bool DjVuGenerator::doCloseDocument()
     return true;
 }
 
+// How many bytes of decoded pages are kept for the memory level
+static qint64 decodedPagesCacheSize()
+{
+    switch (Okular::SettingsCore::memoryLevel()) {
+    case Okular::SettingsCore::EnumMemoryLevel::Low:
+        // only the page being rendered
+        return 0;
+    case Okular::SettingsCore::EnumMemoryLevel::Normal:
+        return 64 * 1024 * 1024;
+    case Okular::SettingsCore::EnumMemoryLevel::Aggressive:
+        return 256 * 1024 * 1024;
+    case Okular::SettingsCore::EnumMemoryLevel::Greedy:
+        return 1024 * 1024 * 1024;
+    }
+    return 64 * 1024 * 1024;
+}
+
 QImage DjVuGenerator::image(Okular::PixmapRequest *request)
 {
+    QRect rect;
+    if (request->isTile()) {
+        rect = request->normalizedRect().geometry(request->width(), request->height());
+    }
+
     userMutex()->lock();
-    QImage img = m_djvu->image(request->pageNumber(), request->width(), request->height(), request->page()->rotation());
+    // the memory level may have changed since the last page
+    m_djvu->setCacheSize(decodedPagesCacheSize());
+    QImage img = m_djvu->image(request->pageNumber(), request->width(), request->height(), request->rotation(), rect);
     userMutex()->unlock();
     return img;
 }
@@ -7,12 +7,14 @@
 #include "kdjvu.h"
 
 #include <QByteArray>
+#include <QCache>
 #include <QDomDocument>
 #include <QFile>
 #include <QHash>
-#include <QPainter>
 #include <QQueue>
 #include <QString>
+#include <QThread>
+#include <QThreadPool>
 
 #include <KLocalizedString>
 #include <QDebug>
@@ -22,6 +24,9 @@
 
 #include <stdio.h>
 
+#include <algorithm>
+#include <atomic>
+
 QDebug &operator<<(QDebug &s, const ddjvu_rect_t r)
 {
     s.nospace() << "[" << r.x << "," << r.y << " - " << r.w << "x" << r.h << "]";
@@ -133,25 +138,64 @@ static bool find_replace_or_add_second_in_pair(miniexp_t theexp, const char *whi
     return false;
 }
 
-// ImageCacheItem
+// ImageCacheKey
+
+struct ImageCacheKey {
+    int page;
+    int width;
+    int height;
+    int rotation;
+    // null for the whole page
+    QRect rect;
+
+    bool operator==(const ImageCacheKey &other) const
+    {
+        return page == other.page && width == other.width && height == other.height && rotation == other.rotation && rect == other.rect;
+    }
+};
+
+static size_t qHash(const ImageCacheKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.page, key.width, key.height, key.rotation, key.rect.x(), key.rect.y(), key.rect.width(), key.rect.height());
+}
+
+// DecodedPage
 
-class ImageCacheItem
+/**
+ * A page decoded by djvulibre, released when it leaves the cache.
+ */
+class DecodedPage
 {
 public:
-    ImageCacheItem(int p, int w, int h, const QImage &i)
+    explicit DecodedPage(ddjvu_page_t *p)
         : page(p)
-        , width(w)
-        , height(h)
-        , img(i)
     {
     }
 
-    int page;
-    int width;
-    int height;
-    QImage img;
+    ~DecodedPage()
+    {
+        ddjvu_page_release(page);
+        for (ddjvu_page_t *renderPage : std::as_const(renderPages)) {
+            ddjvu_page_release(renderPage);
+        }
+    }
+
+    DecodedPage(const DecodedPage &) = delete;
+    DecodedPage &operator=(const DecodedPage &) = delete;
+
+    ddjvu_page_t *page;
+    // more handles of the same page, one for each other thread rendering it;
+    // they share the decoded data of the page, so they cost next to nothing
+    QList<ddjvu_page_t *> renderPages;
 };
 
+// until told otherwise, the caches keep this many bytes each
+static const qsizetype kDefaultCacheSize = 64 * 1024 * 1024;
+// the most pixels a single call to ddjvu_page_render() gets
+static const int kRenderBlockSize = 1500;
+// and the least rows a block gets when splitting an image among threads
+static const int kMinimumRenderBlockHeight = 256;
+
 // KdjVu::Page
 
 int KDjVu::Page::width() const
@@ -426,11 +470,16 @@ public:
         , m_djvu_document(nullptr)
         , m_format(nullptr)
         , m_docBookmarks(nullptr)
+        , m_pages_cache(kDefaultCacheSize)
+        , mImgCache(kDefaultCacheSize)
         , m_cacheEnabled(true)
     {
+        m_renderPool.setMaxThreadCount(QThread::idealThreadCount());
     }
 
-    QImage generateImageTile(ddjvu_page_t *djvupage, int &res, int width, int row, int xdelta, int height, int col, int ydelta);
+    ddjvu_page_t *createPage(int page);
+    DecodedPage *decodedPage(int page);
+    bool renderBlock(ddjvu_page_t *djvupage, int width, int height, const QRect &block, uchar *bits, qsizetype bytesPerLine);
 
     void readBookmarks();
     void fillBookmarksRecurse(QDomDocument &maindoc, QDomNode &curnode, miniexp_t exp, int offset = -1);
@@ -444,9 +493,9 @@ public:
     ddjvu_format_t *m_format;
 
     QVector<KDjVu::Page> m_pages;
-    QVector<ddjvu_page_t *> m_pages_cache;
-
-    QList<ImageCacheItem *> mImgCache;
+    // the cost of the entries is about their size in bytes
+    QCache<int, DecodedPage> m_pages_cache;
+    QCache<ImageCacheKey, QImage> mImgCache;
 
     QHash<QString, QVariant> m_metaData;
     QDomDocument *m_docBookmarks;
@@ -455,20 +504,48 @@ public:
 
     bool m_cacheEnabled;
 
+    // renders the blocks of an image at the same time
+    QThreadPool m_renderPool;
+
     static unsigned int s_formatmask[4];
 };
 
 unsigned int KDjVu::Private::s_formatmask[4] = {0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000};
 
-QImage KDjVu::Private::generateImageTile(ddjvu_page_t *djvupage, int &res, int width, int row, int xdelta, int height, int col, int ydelta)
+ddjvu_page_t *KDjVu::Private::createPage(int page)
+{
+    ddjvu_page_t *newpage = ddjvu_page_create_by_pageno(m_djvu_document, page);
+    // wait for the new page to be loaded
+    ddjvu_status_t sts;
+    while ((sts = ddjvu_page_decoding_status(newpage)) < DDJVU_JOB_OK) {
+        handle_ddjvu_messages(m_djvu_cxt, true);
+    }
+    return newpage;
+}
+
+DecodedPage *KDjVu::Private::decodedPage(int page)
+{
+    if (DecodedPage *decoded = m_pages_cache.object(page)) {
+        return decoded;
+    }
+
+    DecodedPage *decoded = new DecodedPage(createPage(page));
+
+    // djvulibre doesn't tell how much memory a decoded page takes, a byte per
+    // pixel is about what its layers take. The page is cached even if it
+    // alone takes more than the whole cache, as it's needed until the next one
+    const qsizetype cost = qMin<qsizetype>(qsizetype(m_pages.at(page).width()) * m_pages.at(page).height(), m_pages_cache.maxCost());
+    m_pages_cache.insert(page, decoded, cost);
+    return decoded;
+}
+
+bool KDjVu::Private::renderBlock(ddjvu_page_t *djvupage, int width, int height, const QRect &block, uchar *bits, qsizetype bytesPerLine)
 {
     ddjvu_rect_t renderrect;
-    renderrect.x = row * xdelta;
-    renderrect.y = col * ydelta;
-    int realwidth = qMin(width - renderrect.x, xdelta);
-    int realheight = qMin(height - renderrect.y, ydelta);
-    renderrect.w = realwidth;
-    renderrect.h = realheight;
+    renderrect.x = block.x();
+    renderrect.y = block.y();
+    renderrect.w = block.width();
+    renderrect.h = block.height();
 #ifdef KDJVU_DEBUG
     qDebug() << "renderrect:" << renderrect;
 #endif
@@ -477,24 +554,17 @@ QImage KDjVu::Private::generateImageTile(ddjvu_page_t *djvupage, int &res, int w
     pagerect.y = 0;
     pagerect.w = width;
     pagerect.h = height;
-#ifdef KDJVU_DEBUG
-    qDebug() << "pagerect:" << pagerect;
-#endif
-    handle_ddjvu_messages(m_djvu_cxt, false);
-    QImage res_img(realwidth, realheight, QImage::Format_RGB32);
-    // the following line workarounds a rare crash in djvulibre;
-    // it should be fixed with >= 3.5.21
-    ddjvu_page_get_width(djvupage);
-    res = ddjvu_page_render(djvupage, DDJVU_RENDER_COLOR, &pagerect, &renderrect, m_format, res_img.bytesPerLine(), (char *)res_img.bits());
+    const int res = ddjvu_page_render(djvupage, DDJVU_RENDER_COLOR, &pagerect, &renderrect, m_format, bytesPerLine, (char *)bits);
     if (!res) {
-        res_img.fill(Qt::white);
+        for (int y = 0; y < block.height(); ++y) {
+            QRgb *line = reinterpret_cast<QRgb *>(bits + y * bytesPerLine);
+            std::fill(line, line + block.width(), qRgb(255, 255, 255));
+        }
     }
 #ifdef KDJVU_DEBUG
     qDebug() << "rendering result:" << res;
 #endif
-    handle_ddjvu_messages(m_djvu_cxt, false);
-
-    return res_img;
+    return res;
 }
 
 void KDjVu::Private::readBookmarks()
@@ -663,7 +733,7 @@ bool KDjVu::openFile(const QString &fileName)
     d->m_pages.clear();
     d->m_pages.resize(numofpages);
     d->m_pages_cache.clear();
-    d->m_pages_cache.resize(numofpages);
+    d->mImgCache.clear();
 
     // get the document type
     QString doctype;
@@ -729,13 +799,8 @@ void KDjVu::closeFile()
     // deleting the pages
     d->m_pages.clear();
     // releasing the djvu pages
-    QVector<ddjvu_page_t *>::Iterator it = d->m_pages_cache.begin(), itEnd = d->m_pages_cache.end();
-    for (; it != itEnd; ++it) {
-        ddjvu_page_release(*it);
-    }
     d->m_pages_cache.clear();
     // clearing the image cache
-    qDeleteAll(d->mImgCache);
     d->mImgCache.clear();
     // clearing the old metadata
     d->m_metaData.clear();
@@ -859,101 +924,101 @@ const QVector<KDjVu::Page> &KDjVu::pages() const
     return d->m_pages;
 }
 
-QImage KDjVu::image(int page, int width, int height, int rotation)
+QImage KDjVu::image(int page, int width, int height, int rotation, const QRect &rect)
 {
+    const ImageCacheKey key = {page, width, height, rotation, rect};
     if (d->m_cacheEnabled) {
-        bool found = false;
-        QList<ImageCacheItem *>::Iterator it = d->mImgCache.begin(), itEnd = d->mImgCache.end();
-        for (; (it != itEnd) && !found; ++it) {
-            const ImageCacheItem *cur = *it;
-            if ((cur->page == page) && (rotation % 2 == 0 ? cur->width == width && cur->height == height : cur->width == height && cur->height == width)) {
-                found = true;
-            }
-        }
-        if (found) {
-            // taking the element and pushing to the top of the list
-            --it;
-            ImageCacheItem *cur2 = *it;
-            d->mImgCache.erase(it);
-            d->mImgCache.push_front(cur2);
-
-            return cur2->img;
+        if (const QImage *cached = d->mImgCache.object(key)) {
+            return *cached;
         }
     }
 
-    if (!d->m_pages_cache.at(page)) {
-        ddjvu_page_t *newpage = ddjvu_page_create_by_pageno(d->m_djvu_document, page);
-        // wait for the new page to be loaded
-        ddjvu_status_t sts;
-        while ((sts = ddjvu_page_decoding_status(newpage)) < DDJVU_JOB_OK) {
-            handle_ddjvu_messages(d->m_djvu_cxt, true);
-        }
-        d->m_pages_cache[page] = newpage;
-    }
-    ddjvu_page_t *djvupage = d->m_pages_cache[page];
+    DecodedPage *decoded = d->decodedPage(page);
+
+    // djvulibre rotates counter-clockwise, on top of the orientation of the page
+    const ddjvu_page_rotation_t djvuRotation = (ddjvu_page_rotation_t)((ddjvu_page_get_initial_rotation(decoded->page) + flipRotation(rotation)) % 4);
 
-    /*
-        if ( ddjvu_page_get_rotation( djvupage ) != flipRotation( rotation ) )
-        {
-    // TODO: test documents with initial rotation != 0
-    //        ddjvu_page_set_rotation( djvupage, m_pages.at( page )->orientation() );
-            ddjvu_page_set_rotation( djvupage, (ddjvu_page_rotation_t)flipRotation( rotation ) );
+    const QRect renderRect = rect.isNull() ? QRect(0, 0, width, height) : rect & QRect(0, 0, width, height);
+    if (renderRect.isEmpty()) {
+        return QImage();
+    }
+    QImage newimg(renderRect.size(), QImage::Format_RGB32);
+
+    // the image is rendered in blocks of at most kRenderBlockSize pixels per side,
+    // and cut in more rows of blocks so all the threads get some when it's large
+    const int threads = d->m_renderPool.maxThreadCount();
+    const int blockHeight = qBound(kMinimumRenderBlockHeight, (renderRect.height() + threads - 1) / threads, kRenderBlockSize);
+    QList<QRect> blocks;
+    for (int y = renderRect.top(); y <= renderRect.bottom(); y += blockHeight) {
+        for (int x = renderRect.left(); x <= renderRect.right(); x += kRenderBlockSize) {
+            blocks << (QRect(x, y, kRenderBlockSize, blockHeight) & renderRect);
         }
-    */
+    }
 
-    static const int xdelta = 1500;
-    static const int ydelta = 1500;
+    // a page handle keeps the rotation and the state of the rendering, and
+    // djvulibre doesn't promise it can render from several threads at once,
+    // so each job renders its blocks through a handle of its own
+    const int jobs = qMin(int(blocks.count()), threads);
+    while (decoded->renderPages.count() < jobs - 1) {
+        decoded->renderPages.append(d->createPage(page));
+    }
+    const QList<ddjvu_page_t *> djvupages = QList<ddjvu_page_t *>{decoded->page} + decoded->renderPages.mid(0, jobs - 1);
 
-    int xparts = width / xdelta + 1;
-    int yparts = height / ydelta + 1;
+    handle_ddjvu_messages(d->m_djvu_cxt, false);
+    for (ddjvu_page_t *djvupage : djvupages) {
+        if (ddjvu_page_get_rotation(djvupage) != djvuRotation) {
+            ddjvu_page_set_rotation(djvupage, djvuRotation);
+        }
+        // the following line workarounds a rare crash in djvulibre;
+        // it should be fixed with >= 3.5.21
+        ddjvu_page_get_width(djvupage);
+    }
 
-    QImage newimg;
+    // every block is rendered straight into its part of the image, job
+    // after job takes the next block of the rows
+    uchar *bits = newimg.bits();
+    const qsizetype bytesPerLine = newimg.bytesPerLine();
+    auto renderJob = [this, &blocks, &djvupages, jobs, width, height, renderRect, bits, bytesPerLine](int job) {
+        bool rendered = true;
+        for (int i = job; i < blocks.count(); i += jobs) {
+            const QRect &block = blocks.at(i);
+            uchar *blockBits = bits + (block.y() - renderRect.y()) * bytesPerLine + (block.x() - renderRect.x()) * sizeof(QRgb);
+            rendered = d->renderBlock(djvupages.at(job), width, height, block, blockBits, bytesPerLine) && rendered;
+        }
+        return rendered;
+    };
 
-    int res = 10000;
-    if ((xparts == 1) && (yparts == 1)) {
-        // only one part -- render at once with no need to auxiliary image
-        newimg = d->generateImageTile(djvupage, res, width, 0, xdelta, height, 0, ydelta);
+    bool res = true;
+    if (jobs == 1) {
+        res = renderJob(0);
     } else {
-        // more than one part -- need to render piece-by-piece and to compose
-        // the results
-        newimg = QImage(width, height, QImage::Format_RGB32);
-        QPainter p;
-        p.begin(&newimg);
-        int parts = xparts * yparts;
-        for (int i = 0; i < parts; ++i) {
-            const int row = i % xparts;
-            const int col = i / xparts;
-            int tmpres = 0;
-            const QImage tempp = d->generateImageTile(djvupage, tmpres, width, row, xdelta, height, col, ydelta);
-            p.drawImage(row * xdelta, col * ydelta, tempp);
-            res = qMin(tmpres, res);
+        std::atomic<bool> allRendered = true;
+        for (int job = 0; job < jobs; ++job) {
+            d->m_renderPool.start([&renderJob, &allRendered, job] {
+                if (!renderJob(job)) {
+                    allRendered = false;
+                }
+            });
         }
-        p.end();
+        d->m_renderPool.waitForDone();
+        res = allRendered;
     }
+    handle_ddjvu_messages(d->m_djvu_cxt, false);
 
     if (res && d->m_cacheEnabled) {
-        // delete all the cached pixmaps for the current page with a size that
-        // differs no more than 35% of the new pixmap size
-        int imgsize = newimg.width() * newimg.height();
-        if (imgsize > 0) {
-            for (int i = 0; i < d->mImgCache.count();) {
-                ImageCacheItem *cur = d->mImgCache.at(i);
-                if ((cur->page == page) && (abs(cur->img.width() * cur->img.height() - imgsize) < imgsize * 0.35)) {
-                    d->mImgCache.removeAt(i);
-                    delete cur;
-                } else {
-                    ++i;
+        if (rect.isNull()) {
+            // delete all the cached images of the whole current page with a size
+            // that differs no more than 35% of the new image size
+            const qint64 imgsize = qint64(newimg.width()) * newimg.height();
+            const QList<ImageCacheKey> keys = d->mImgCache.keys();
+            for (const ImageCacheKey &cachedKey : keys) {
+                if (cachedKey.page == page && cachedKey.rect.isNull() && qAbs(qint64(cachedKey.width) * cachedKey.height - imgsize) < imgsize * 0.35) {
+                    d->mImgCache.remove(cachedKey);
                 }
             }
         }
 
-        // the image cache has too many elements, remove the last
-        if (d->mImgCache.size() >= 10) {
-            delete d->mImgCache.last();
-            d->mImgCache.removeLast();
-        }
-        ImageCacheItem *ich = new ImageCacheItem(page, width, height, newimg);
-        d->mImgCache.push_front(ich);
+        d->mImgCache.insert(key, new QImage(newimg), newimg.sizeInBytes());
     }
 
     return newimg;
@@ -1070,11 +1135,31 @@ void KDjVu::setCacheEnabled(bool enable)
 
     d->m_cacheEnabled = enable;
     if (!d->m_cacheEnabled) {
-        qDeleteAll(d->mImgCache);
         d->mImgCache.clear();
     }
 }
 
+void KDjVu::setCacheSize(qint64 bytes)
+{
+    d->m_pages_cache.setMaxCost(bytes);
+    d->mImgCache.setMaxCost(bytes);
+}
+
+qint64 KDjVu::cacheSize() const
+{
+    return d->m_pages_cache.maxCost();
+}
+
+void KDjVu::setRenderThreadCount(int threads)
+{
+    d->m_renderPool.setMaxThreadCount(qMax(1, threads));
+}
+
+int KDjVu::renderThreadCount() const
+{
+    return d->m_renderPool.maxThreadCount();
+}
+
 bool KDjVu::isCacheEnabled() const
 {
     return d->m_cacheEnabled;
@@ -250,11 +250,13 @@ public:
     void linksAndAnnotationsForPage(int pageNum, QList<KDjVu::Link *> *links, QList<KDjVu::Annotation *> *annotations) const;
 
     /**
-     * Check if the image for the specified \p page with the specified
-     * \p width, \p height and \p rotation is already in cache, and returns
-     * it. If not, a null image is returned.
+     * Returns the image of the specified \p page, turned clockwise by
+     * \p rotation quarters from its own orientation and of size \p width
+     * x \p height once turned, or only its part \p rect if it's not null.
+     * Large images are rendered in blocks by several threads at once.
+     * The images recently rendered are cached.
      */
-    QImage image(int page, int width, int height, int rotation);
+    QImage image(int page, int width, int height, int rotation, const QRect &rect = QRect());
 
     /**
      * Export the currently open document as PostScript file \p fileName.
@@ -283,6 +285,27 @@ public:
      */
     bool isCacheEnabled() const;
 
+    /**
+     * Set how many bytes the decoded pages can take, and as many the rendered
+     * pages if their cache is enabled. The least recently used ones are
+     * dropped first.
+     */
+    void setCacheSize(qint64 bytes);
+    /**
+     * \returns how many bytes each of the caches can take
+     */
+    qint64 cacheSize() const;
+
+    /**
+     * Set how many threads render the parts of a large image at the same time.
+     * By default as many as the cores.
+     */
+    void setRenderThreadCount(int threads);
+    /**
+     * \returns how many threads render the parts of a large image
+     */
+    int renderThreadCount() const;
+
     /**
      * Return the page number of the page whose title is \p name.
      */
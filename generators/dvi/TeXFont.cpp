@@ -3,6 +3,99 @@
 
 #include "TeXFont.h"
 
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+
+// The shrunken characters of all the fonts of all the documents share this
+// budget, in bytes.
+static const qsizetype glyphCacheSize = 32 * 1024 * 1024;
+
+namespace
+{
+// The display resolution is rounded to whole DPIs, the difference between
+// close resolutions is not visible anyway.
+struct glyphKey {
+    const TeXFont *font;
+    quint16 character;
+    int resolution;
+    QRgb color;
+
+    bool operator==(const glyphKey &other) const
+    {
+        return font == other.font && character == other.character && resolution == other.resolution && color == other.color;
+    }
+};
+
+size_t qHash(const glyphKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.font, key.character, key.resolution, key.color);
+}
+
+struct cachedGlyph {
+    QImage shrunkenCharacter;
+    short x2, y2;
+};
+
+struct glyphCache {
+    glyphCache()
+        : glyphs(glyphCacheSize)
+    {
+    }
+
+    QMutex mutex;
+    QCache<glyphKey, cachedGlyph> glyphs;
+};
+}
+
+Q_GLOBAL_STATIC(glyphCache, theGlyphCache)
+
+static glyphKey keyOf(const TeXFont *font, const TeXFontDefinition *parent, quint16 ch, const QColor &color)
+{
+    return glyphKey {font, ch, qRound(parent->displayResolution_in_dpi), color.rgba()};
+}
+
 TeXFont::~TeXFont()
 {
+    invalidateGlyphs();
+}
+
+void TeXFont::invalidateGlyphs()
+{
+    setDisplayResolution();
+
+    if (!theGlyphCache.exists()) {
+        return;
+    }
+
+    QMutexLocker locker(&theGlyphCache->mutex);
+    const QList<glyphKey> keys = theGlyphCache->glyphs.keys();
+    for (const glyphKey &key : keys) {
+        if (key.font == this) {
+            theGlyphCache->glyphs.remove(key);
+        }
+    }
+}
+
+bool TeXFont::loadCachedGlyph(quint16 ch, const QColor &color, glyph *g) const
+{
+    QMutexLocker locker(&theGlyphCache->mutex);
+    const cachedGlyph *cached = theGlyphCache->glyphs.object(keyOf(this, parent, ch, color));
+    if (!cached) {
+        return false;
+    }
+
+    g->color = color;
+    g->shrunkenCharacter = cached->shrunkenCharacter;
+    g->x2 = cached->x2;
+    g->y2 = cached->y2;
+    return true;
+}
+
+void TeXFont::cacheGlyph(quint16 ch, const glyph *g) const
+{
+    const qsizetype cost = qMax<qsizetype>(1, g->shrunkenCharacter.sizeInBytes());
+
+    QMutexLocker locker(&theGlyphCache->mutex);
+    theGlyphCache->glyphs.insert(keyOf(this, parent, ch, g->color), new cachedGlyph {g->shrunkenCharacter, g->x2, g->y2}, cost);
 }
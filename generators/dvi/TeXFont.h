@@ -25,6 +25,8 @@ public:
     TeXFont(const TeXFont &) = delete;
     TeXFont &operator=(const TeXFont &) = delete;
 
+    // The shrunken characters of other resolutions stay in the glyph
+    // cache, so going back to one of them doesn't render them again.
     void setDisplayResolution()
     {
         for (glyph &g : glyphtable) {
@@ -32,6 +34,10 @@ public:
         }
     }
 
+    // Forgets the shrunken characters of all the resolutions, for when
+    // they would be rendered differently.
+    void invalidateGlyphs();
+
     virtual glyph *getGlyph(quint16 character, bool generateCharacterPixmap = false, const QColor &color = Qt::black) = 0;
 
     // Checksum of the font. Used e.g. by PK fonts. This field is filled
@@ -44,6 +50,12 @@ public:
     QString errorMessage;
 
 protected:
+    // Sets the shrunken character of g, which must be the glyph of ch,
+    // from the glyph cache. Returns false if it is not cached.
+    bool loadCachedGlyph(quint16 ch, const QColor &color, glyph *g) const;
+    // Puts the shrunken character of g in the glyph cache.
+    void cacheGlyph(quint16 ch, const glyph *g) const;
+
     glyph glyphtable[TeXFontDefinition::max_num_of_chars_in_font];
     TeXFontDefinition *parent;
 };
@@ -210,6 +210,13 @@ void TeXFontDefinition::setDisplayResolution(double _displayResolution_in_dpi)
     }
 }
 
+void TeXFontDefinition::invalidateGlyphs()
+{
+    if (font != nullptr) {
+        font->invalidateGlyphs();
+    }
+}
+
 /** mark_as_used marks the font, and all the fonts it refers to, as
     used, i.e. their FONT_IN_USE-flag is set. */
 
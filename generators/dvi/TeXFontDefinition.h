@@ -77,6 +77,8 @@ public:
 
     // Members for character fonts
     void setDisplayResolution(double _displayResolution_in_dpi);
+    // Drops the glyphs rendered so far, for when the font would render them differently
+    void invalidateGlyphs();
 
     bool isLocated() const
     {
@@ -156,7 +156,7 @@ glyph *TeXFont_PFB::getGlyph(quint16 ch, bool generateCharacterPixmap, const QCo
         return g;
     }
 
-    if ((generateCharacterPixmap == true) && ((g->shrunkenCharacter.isNull()) || (color != g->color))) {
+    if ((generateCharacterPixmap == true) && ((g->shrunkenCharacter.isNull()) || (color != g->color)) && !loadCachedGlyph(ch, color, g)) {
         int error;
         unsigned int res = (unsigned int)(parent->displayResolution_in_dpi / parent->enlargement + 0.5);
         g->color = color;
@@ -273,6 +273,7 @@ glyph *TeXFont_PFB::getGlyph(quint16 ch, bool generateCharacterPixmap, const QCo
             g->x2 = -slot->bitmap_left;
             g->y2 = slot->bitmap_top;
         }
+        cacheGlyph(ch, g);
     }
 
     // Load glyph width, if that hasn't been done yet.
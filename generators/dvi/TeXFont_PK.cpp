@@ -136,8 +136,9 @@ glyph *TeXFont_PK::getGlyph(quint16 ch, bool generateCharacterPixmap, const QCol
     }
 
     // At this point, g points to a properly loaded character. Generate
-    // a smoothly scaled QPixmap if the user asks for it.
-    if ((generateCharacterPixmap == true) && ((g->shrunkenCharacter.isNull()) || (color != g->color)) && (characterBitmaps[ch]->w != 0)) {
+    // a smoothly scaled QPixmap if the user asks for it and it wasn't
+    // generated for this resolution already.
+    if ((generateCharacterPixmap == true) && ((g->shrunkenCharacter.isNull()) || (color != g->color)) && (characterBitmaps[ch]->w != 0) && !loadCachedGlyph(ch, color, g)) {
         g->color = color;
         double shrinkFactor = 1200 / parent->displayResolution_in_dpi;
 
@@ -297,6 +298,7 @@ glyph *TeXFont_PK::getGlyph(quint16 ch, bool generateCharacterPixmap, const QCol
         }
 
         g->shrunkenCharacter = im32;
+        cacheGlyph(ch, g);
     }
     return g;
 }
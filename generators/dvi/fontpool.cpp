@@ -107,11 +107,10 @@ void fontPool::setParameters(bool _useFontHints)
 {
     // Check if glyphs need to be cleared
     if (_useFontHints != useFontHints) {
-        double displayResolution = displayResolution_in_dpi;
         QList<TeXFontDefinition *>::iterator it_fontp = fontList.begin();
         for (; it_fontp != fontList.end(); ++it_fontp) {
             TeXFontDefinition *fontp = *it_fontp;
-            fontp->setDisplayResolution(displayResolution * fontp->enlargement);
+            fontp->invalidateGlyphs();
         }
     }
 
@@ -372,7 +371,7 @@ void fontPool::setCMperDVIunit(double _CMperDVI)
     QList<TeXFontDefinition *>::iterator it_fontp = fontList.begin();
     for (; it_fontp != fontList.end(); ++it_fontp) {
         TeXFontDefinition *fontp = *it_fontp;
-        fontp->setDisplayResolution(displayResolution_in_dpi * fontp->enlargement);
+        fontp->invalidateGlyphs();
     }
 }
 
@@ -385,7 +384,9 @@ void fontPool::setDisplayResolution(double _displayResolution_in_dpi)
     // Ignore minute changes by less than 2 DPI. The difference would
     // hardly be visible anyway. That saves a lot of re-painting,
     // e.g. when the user resizes the window, and a flickery mouse
-    // changes the window size by 1 pixel all the time.
+    // changes the window size by 1 pixel all the time. Bigger changes
+    // are cheap, the glyphs of every resolution are kept in the glyph
+    // cache of TeXFont.
     if (fabs(displayResolution_in_dpi - _displayResolution_in_dpi) <= 2.0) {
 #ifdef DEBUG_FONTPOOL
         qCDebug(OkularDviDebug) << "fontPool::setDisplayResolution(...): resolution wasn't changed. Aborting.";
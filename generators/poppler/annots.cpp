@@ -54,10 +54,11 @@ static int maskExportedFlags(int flags)
 }
 
 // BEGIN PopplerAnnotationProxy implementation
-PopplerAnnotationProxy::PopplerAnnotationProxy(Poppler::Document *doc, QMutex *userMutex, QHash<Okular::Annotation *, Poppler::Annotation *> *annotsOnOpenHash)
+PopplerAnnotationProxy::PopplerAnnotationProxy(Poppler::Document *doc, QMutex *userMutex, QHash<Okular::Annotation *, Poppler::Annotation *> *annotsOnOpenHash, std::function<void()> documentModified)
     : ppl_doc(doc)
     , mutex(userMutex)
     , annotationsOnOpenHash(annotsOnOpenHash)
+    , documentModifiedCallback(std::move(documentModified))
 {
 }
 
@@ -442,6 +443,8 @@ static Poppler::Annotation *createPopplerAnnotationFromOkularAnnotation(const Ok
 }
 void PopplerAnnotationProxy::notifyAddition(Okular::Annotation *okl_ann, int page)
 {
+    documentModifiedCallback();
+
     QMutexLocker ml(mutex);
 
     std::unique_ptr<Poppler::Page> ppl_page = ppl_doc->page(page);
@@ -512,6 +515,8 @@ void PopplerAnnotationProxy::notifyModification(const Okular::Annotation *okl_an
         return;
     }
 
+    documentModifiedCallback();
+
     QMutexLocker ml(mutex);
 
     if (okl_ann->flags() & (Okular::Annotation::BeingMoved | Okular::Annotation::BeingResized)) {
@@ -586,6 +591,8 @@ void PopplerAnnotationProxy::notifyRemoval(Okular::Annotation *okl_ann, int page
         return;
     }
 
+    documentModifiedCallback();
+
     QMutexLocker ml(mutex);
 
     std::unique_ptr<Poppler::Page> ppl_page = ppl_doc->page(page);
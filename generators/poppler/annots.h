@@ -17,6 +17,7 @@
 
 #include <QMutex>
 
+#include <functional>
 #include <unordered_map>
 
 #include "core/annotations.h"
@@ -26,7 +27,7 @@ extern Okular::Annotation *createAnnotationFromPopplerAnnotation(Poppler::Annota
 class PopplerAnnotationProxy : public Okular::AnnotationProxy
 {
 public:
-    PopplerAnnotationProxy(Poppler::Document *doc, QMutex *userMutex, QHash<Okular::Annotation *, Poppler::Annotation *> *annotsOnOpenHash);
+    PopplerAnnotationProxy(Poppler::Document *doc, QMutex *userMutex, QHash<Okular::Annotation *, Poppler::Annotation *> *annotsOnOpenHash, std::function<void()> documentModified);
     ~PopplerAnnotationProxy() override;
 
     bool supports(Capability capability) const override;
@@ -38,6 +39,7 @@ private:
     Poppler::Document *ppl_doc;
     QMutex *mutex;
     QHash<Okular::Annotation *, Poppler::Annotation *> *annotationsOnOpenHash;
+    std::function<void()> documentModifiedCallback;
     std::unordered_map<Okular::StampAnnotation *, std::unique_ptr<Poppler::AnnotationAppearance>> deletedStampsAnnotationAppearance;
 };
 
@@ -27,6 +27,7 @@
 #include <QMutex>
 #include <QPainter>
 #include <QPrinter>
+#include <QScopeGuard>
 #include <QStack>
 #include <QTemporaryFile>
 #include <QTextStream>
@@ -640,6 +641,10 @@ static QList<Okular::ObjectRect *> generateLinks(std::vector<std::unique_ptr<Pop
  *           mutex is needed only because we have the asynchronous thread; else
  *           the operations are all within the 'gui' thread, scheduled by the
  *           Qt scheduler and no mutex is needed.
+ *           Pages rendered at the same time by the parallel rendering threads
+ *           use their own copy of the Poppler::Document (see
+ *           acquireRenderDocument) so they don't need to take the mutex
+ *           while rasterizing.
  * external: dangerous operations are all locked via mutex internally, and the
  *           only needed external thing is the 'canGeneratePixmap' method
  *           that tells if the generator is free (since we don't want an
@@ -683,6 +688,8 @@ PDFGenerator::PDFGenerator(QObject *parent, const QVariantList &args)
     setFeature(TiledRendering);
     setFeature(SwapBackingFile);
     setFeature(SupportsCancelling);
+    setFeature(ParallelRendering);
+    setFeature(RotatedRendering);
 
     // You only need to do it once not for each of the documents but it is cheap enough
     // so doing it all the time won't hurt either
@@ -718,6 +725,8 @@ Okular::Document::OpenResult PDFGenerator::loadDocumentWithPassword(const QStrin
 #endif
     // create PDFDoc for the given file
     pdfdoc = Poppler::Document::load(filePath, nullptr, nullptr);
+    documentFilePath = filePath;
+    documentFileData.clear();
     return init(pagesVector, password);
 }
 
@@ -731,6 +740,8 @@ Okular::Document::OpenResult PDFGenerator::loadDocumentFromDataWithPassword(cons
 #endif
     // create PDFDoc for the given file
     pdfdoc = Poppler::Document::loadFromData(fileData, nullptr, nullptr);
+    documentFilePath.clear();
+    documentFileData = fileData;
     return init(pagesVector, password);
 }
 
@@ -740,12 +751,15 @@ Okular::Document::OpenResult PDFGenerator::init(QVector<Okular::Page *> &pagesVe
         return Okular::Document::OpenError;
     }
 
+    documentPassword.clear();
     if (pdfdoc->isLocked()) {
-        pdfdoc->unlock(password.toLatin1(), password.toLatin1());
+        documentPassword = password.toLatin1();
+        pdfdoc->unlock(documentPassword, documentPassword);
         documentHasPassword = !password.isEmpty();
 
         if (pdfdoc->isLocked()) {
-            pdfdoc->unlock(password.toUtf8(), password.toUtf8());
+            documentPassword = password.toUtf8();
+            pdfdoc->unlock(documentPassword, documentPassword);
 
             if (pdfdoc->isLocked()) {
                 pdfdoc.reset();
@@ -781,7 +795,16 @@ Okular::Document::OpenResult PDFGenerator::init(QVector<Okular::Page *> &pagesVe
     reparseConfig();
 
     // create annotation proxy
-    annotProxy = new PopplerAnnotationProxy(pdfdoc.get(), userMutex(), &annotationsOnOpenHash);
+    annotProxy = new PopplerAnnotationProxy(pdfdoc.get(), userMutex(), &annotationsOnOpenHash, [this] { invalidateRenderDocuments(true); });
+
+    // The copies of the document used for parallel rendering can't follow the changes done to
+    // form fields so only use them for documents without forms
+    renderDocumentsMutex.lock();
+    renderDocumentsEnabled = pdfdoc->formType() == Poppler::Document::NoForm;
+    renderDocumentsMutex.unlock();
+    if (pdfdoc->hasOptionalContent()) {
+        connect(pdfdoc->optionalContentModel(), &QAbstractItemModel::dataChanged, this, [this] { invalidateRenderDocuments(true); });
+    }
 
 #if POPPLER_VERSION_MACRO >= QT_VERSION_CHECK(24, 07, 0)
     setAdditionalDocumentAction(Okular::Document::CloseDocument, createLinkFromPopplerLink(pdfdoc->additionalAction(Poppler::Document::CloseDocument)));
@@ -842,6 +865,8 @@ PDFGenerator::SwapBackingFileResult PDFGenerator::swapBackingFile(QString const
 
 bool PDFGenerator::doCloseDocument()
 {
+    invalidateRenderDocuments(true);
+
     // remove internal objects
     userMutex()->lock();
     delete annotProxy;
@@ -1198,11 +1223,13 @@ Okular::BackendOpaqueAction::OpaqueActionResult PDFGenerator::opaqueAction(const
 {
     const Poppler::Link *popplerLink = static_cast<const Poppler::Link *>(action->nativeHandle());
     if (const Poppler::LinkOCGState *ocgLink = dynamic_cast<const Poppler::LinkOCGState *>(popplerLink)) {
+        invalidateRenderDocuments(true);
         pdfdoc->optionalContentModel()->applyLink(const_cast<Poppler::LinkOCGState *>(ocgLink));
         return Okular::BackendOpaqueAction::DoNothing;
     }
 #if POPPLER_VERSION_MACRO >= QT_VERSION_CHECK(24, 07, 0)
     else if (const Poppler::LinkResetForm *resetFormLink = dynamic_cast<const Poppler::LinkResetForm *>(popplerLink)) {
+        invalidateRenderDocuments(true);
         pdfdoc->applyResetFormsLink(*resetFormLink);
         return Okular::BackendOpaqueAction::RefreshForms;
     }
@@ -1289,27 +1316,36 @@ QImage PDFGenerator::image(Okular::PixmapRequest *request)
 
     double pageWidth = page->width(), pageHeight = page->height();
 
-    if (page->rotation() % 2) {
+    // the size of the page is the one of the rotated page, the request may be unrotated
+    if ((page->rotation() + request->rotation()) % 2) {
         std::swap(pageWidth, pageHeight);
     }
 
+    const Poppler::Page::Rotation rotation = static_cast<Poppler::Page::Rotation>(request->rotation());
+
     qreal fakeDpiX = request->width() / pageWidth * dpi().width();
     qreal fakeDpiY = request->height() / pageHeight * dpi().height();
 
-    // generate links rects only the first time
-    bool genObjectRects = !rectsGenerated.at(page->number());
+    // render with a document of our own if other pages are being rendered at the same time
+    RenderDocument renderDocument = acquireRenderDocument();
+    const auto renderDocumentReleaser = qScopeGuard([this, &renderDocument] { releaseRenderDocument(renderDocument); });
+    Poppler::Document *doc = renderDocument.document ? renderDocument.document.get() : pdfdoc.get();
 
     // 0. LOCK [waits for the thread end]
-    userMutex()->lock();
+    if (!renderDocument.document) {
+        userMutex()->lock();
+    }
 
     if (request->shouldAbortRender()) {
-        userMutex()->unlock();
+        if (!renderDocument.document) {
+            userMutex()->unlock();
+        }
         return QImage();
     }
 
     // 1. Set OutputDev parameters and Generate contents
     // note: thread safety is set on 'false' for the GUI (this) thread
-    std::unique_ptr<Poppler::Page> p = pdfdoc->page(page->number());
+    std::unique_ptr<Poppler::Page> p = doc->page(page->number());
 
     // 2. Take data from outputdev and attach it to the Page
     QImage img;
@@ -1319,18 +1355,18 @@ QImage PDFGenerator::image(Okular::PixmapRequest *request)
             if (request->partialUpdatesWanted()) {
                 RenderImagePayload payload(this, request);
                 img = p->renderToImage(
-                    fakeDpiX, fakeDpiY, rect.x(), rect.y(), rect.width(), rect.height(), Poppler::Page::Rotate0, partialUpdateCallback, shouldDoPartialUpdateCallback, shouldAbortRenderCallback, QVariant::fromValue(&payload));
+                    fakeDpiX, fakeDpiY, rect.x(), rect.y(), rect.width(), rect.height(), rotation, partialUpdateCallback, shouldDoPartialUpdateCallback, shouldAbortRenderCallback, QVariant::fromValue(&payload));
             } else {
                 RenderImagePayload payload(this, request);
-                img = p->renderToImage(fakeDpiX, fakeDpiY, rect.x(), rect.y(), rect.width(), rect.height(), Poppler::Page::Rotate0, nullptr, nullptr, shouldAbortRenderCallback, QVariant::fromValue(&payload));
+                img = p->renderToImage(fakeDpiX, fakeDpiY, rect.x(), rect.y(), rect.width(), rect.height(), rotation, nullptr, nullptr, shouldAbortRenderCallback, QVariant::fromValue(&payload));
             }
         } else {
             if (request->partialUpdatesWanted()) {
                 RenderImagePayload payload(this, request);
-                img = p->renderToImage(fakeDpiX, fakeDpiY, -1, -1, -1, -1, Poppler::Page::Rotate0, partialUpdateCallback, shouldDoPartialUpdateCallback, shouldAbortRenderCallback, QVariant::fromValue(&payload));
+                img = p->renderToImage(fakeDpiX, fakeDpiY, -1, -1, -1, -1, rotation, partialUpdateCallback, shouldDoPartialUpdateCallback, shouldAbortRenderCallback, QVariant::fromValue(&payload));
             } else {
                 RenderImagePayload payload(this, request);
-                img = p->renderToImage(fakeDpiX, fakeDpiY, -1, -1, -1, -1, Poppler::Page::Rotate0, nullptr, nullptr, shouldAbortRenderCallback, QVariant::fromValue(&payload));
+                img = p->renderToImage(fakeDpiX, fakeDpiY, -1, -1, -1, -1, rotation, nullptr, nullptr, shouldAbortRenderCallback, QVariant::fromValue(&payload));
             }
         }
     } else {
@@ -1338,7 +1374,19 @@ QImage PDFGenerator::image(Okular::PixmapRequest *request)
         img.fill(Qt::white);
     }
 
-    if (p && genObjectRects) {
+    // links must always come from pdfdoc, they are used by the GUI thread
+    if (renderDocument.document) {
+        const bool hasPage = p != nullptr;
+        p.reset();
+        releaseRenderDocument(renderDocument);
+        userMutex()->lock();
+        if (hasPage && pdfdoc && !rectsGenerated.at(page->number())) {
+            p = pdfdoc->page(page->number());
+        }
+    }
+
+    // generate links rects only the first time
+    if (p && !rectsGenerated.at(page->number())) {
         // TODO previously we extracted Image type rects too, but that needed porting to poppler
         // and as we are not doing anything with Image type rects i did not port it, have a look at
         // dead gp_outputdev.cpp on image extraction
@@ -1354,6 +1402,98 @@ QImage PDFGenerator::image(Okular::PixmapRequest *request)
     return img;
 }
 
+PDFGenerator::RenderDocument PDFGenerator::acquireRenderDocument()
+{
+    QMutexLocker locker(&renderDocumentsMutex);
+
+    // pdfdoc itself is used when nobody else is rendering with it
+    if (!renderDocumentsEnabled || !mainDocumentRendering) {
+        mainDocumentRendering = true;
+        RenderDocument renderDocument;
+        renderDocument.mainDocument = true;
+        return renderDocument;
+    }
+
+    if (!renderDocuments.empty()) {
+        RenderDocument renderDocument = std::move(renderDocuments.back());
+        renderDocuments.pop_back();
+        return renderDocument;
+    }
+
+    RenderDocument renderDocument;
+    renderDocument.generation = renderDocumentsGeneration;
+    locker.unlock();
+
+    // loading the document can take a while, don't block the other threads
+    renderDocument.document = loadRenderDocument();
+    return renderDocument;
+}
+
+void PDFGenerator::releaseRenderDocument(RenderDocument &renderDocument)
+{
+    QMutexLocker locker(&renderDocumentsMutex);
+
+    // a render whose copy failed to load used pdfdoc under the user mutex
+    // without being handed it, so it must not mark pdfdoc as free
+    if (renderDocument.mainDocument) {
+        mainDocumentRendering = false;
+    } else if (renderDocument.document && renderDocumentsEnabled && renderDocument.generation == renderDocumentsGeneration) {
+        // documents with outdated settings or contents are just dropped
+        renderDocuments.push_back(std::move(renderDocument));
+    }
+
+    renderDocument = RenderDocument();
+}
+
+void PDFGenerator::invalidateRenderDocuments(bool documentModified)
+{
+    QMutexLocker locker(&renderDocumentsMutex);
+
+    renderDocuments.clear();
+    ++renderDocumentsGeneration;
+    if (documentModified) {
+        renderDocumentsEnabled = false;
+    }
+}
+
+std::unique_ptr<Poppler::Document> PDFGenerator::loadRenderDocument()
+{
+    std::unique_ptr<Poppler::Document> doc;
+    if (!documentFileData.isEmpty()) {
+        doc = Poppler::Document::loadFromData(documentFileData, documentPassword, documentPassword);
+    } else {
+        doc = Poppler::Document::load(documentFilePath, documentPassword, documentPassword);
+    }
+
+    if (!doc || doc->isLocked()) {
+        return nullptr;
+    }
+
+    static const Poppler::Document::RenderHint renderHints[] = {
+        Poppler::Document::Antialiasing,
+        Poppler::Document::TextAntialiasing,
+        Poppler::Document::TextHinting,
+        Poppler::Document::ThinLineSolid,
+        Poppler::Document::ThinLineShape,
+#if POPPLER_VERSION_MACRO >= QT_VERSION_CHECK(23, 07, 0)
+        Poppler::Document::OverprintPreview,
+#endif
+    };
+
+    QMutexLocker locker(userMutex());
+    if (!pdfdoc) {
+        return nullptr;
+    }
+
+    doc->setPaperColor(pdfdoc->paperColor());
+    const Poppler::Document::RenderHints hints = pdfdoc->renderHints();
+    for (const Poppler::Document::RenderHint hint : renderHints) {
+        doc->setRenderHint(hint, hints.testFlag(hint));
+    }
+
+    return doc;
+}
+
 template<typename PopplerLinkType, typename OkularLinkType, typename PopplerAnnotationType, typename OkularAnnotationType>
 void resolveMediaLinks(Okular::Action *action, enum Okular::Annotation::SubType subType, QHash<Okular::Annotation *, Poppler::Annotation *> &annotationsHash)
 {
@@ -1717,6 +1857,10 @@ bool PDFGenerator::reparseConfig()
     }
     bool aaChanged = setDocumentRenderHints();
     somethingchanged = somethingchanged || aaChanged;
+    if (somethingchanged) {
+        // the render documents will be recreated with the new settings
+        invalidateRenderDocuments(false);
+    }
     return somethingchanged;
 }
 
@@ -19,6 +19,7 @@
 #define POPPLER_VERSION_MACRO ((POPPLER_VERSION_MAJOR << 16) | (POPPLER_VERSION_MINOR << 8) | (POPPLER_VERSION_MICRO))
 
 #include <QBitArray>
+#include <QMutex>
 #include <QPointer>
 
 #include <core/annotations.h>
@@ -30,6 +31,7 @@
 #include <interfaces/saveinterface.h>
 
 #include <unordered_map>
+#include <vector>
 
 class PDFOptionsPage;
 class PopplerAnnotationProxy;
@@ -149,6 +151,28 @@ private:
     // poppler dependent stuff
     std::unique_ptr<Poppler::Document> pdfdoc;
 
+    // Extra copies of pdfdoc so several pages can be rendered at the same time.
+    // Each of them is used by a single thread at a time, see acquireRenderDocument()
+    struct RenderDocument {
+        std::unique_ptr<Poppler::Document> document; // null means pdfdoc has to be used
+        int generation = 0;
+        bool mainDocument = false; // pdfdoc was handed out, see mainDocumentRendering
+    };
+    RenderDocument acquireRenderDocument();
+    // Gives renderDocument back and leaves it empty, so releasing it again does nothing
+    void releaseRenderDocument(RenderDocument &renderDocument);
+    void invalidateRenderDocuments(bool documentModified);
+    std::unique_ptr<Poppler::Document> loadRenderDocument();
+
+    QMutex renderDocumentsMutex;
+    std::vector<RenderDocument> renderDocuments;
+    int renderDocumentsGeneration = 0;
+    bool renderDocumentsEnabled = false;
+    bool mainDocumentRendering = false;
+    QString documentFilePath;
+    QByteArray documentFileData;
+    QByteArray documentPassword;
+
     void xrefReconstructionHandler();
 
     // misc variables for document info and synopsis caching
@@ -0,0 +1,158 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <vector>
+
+#include "../tiffdecoder.h"
+
+class TiffDecoderTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testRegionMatchesWhole_data();
+    void testRegionMatchesWhole();
+    void testSingleStrip();
+
+private:
+    QTemporaryDir m_dir;
+};
+
+// neither is a multiple of the tile or strip sizes, so the last ones are partial
+static const uint32_t kWidth = 300;
+static const uint32_t kHeight = 200;
+
+static void pixel(uint32_t x, uint32_t y, uint8_t *rgb)
+{
+    rgb[0] = x % 256;
+    rgb[1] = y % 256;
+    rgb[2] = (x * 7 + y * 3) % 256;
+}
+
+static void setFields(TIFF *tiff)
+{
+    TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, kWidth);
+    TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, kHeight);
+    TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, 8);
+    TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, 3);
+    TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+    TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+    TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_NONE);
+    TIFFSetField(tiff, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
+}
+
+static bool writeTiled(const QString &fileName, uint32_t tileWidth, uint32_t tileHeight)
+{
+    TIFF *tiff = TIFFOpen(QFile::encodeName(fileName).constData(), "w");
+    if (!tiff) {
+        return false;
+    }
+    setFields(tiff);
+    TIFFSetField(tiff, TIFFTAG_TILEWIDTH, tileWidth);
+    TIFFSetField(tiff, TIFFTAG_TILELENGTH, tileHeight);
+
+    bool written = true;
+    std::vector<uint8_t> tile(size_t(tileWidth) * tileHeight * 3);
+    for (uint32_t y = 0; y < kHeight; y += tileHeight) {
+        for (uint32_t x = 0; x < kWidth; x += tileWidth) {
+            for (uint32_t row = 0; row < tileHeight; ++row) {
+                for (uint32_t column = 0; column < tileWidth; ++column) {
+                    pixel(x + column, y + row, tile.data() + (size_t(row) * tileWidth + column) * 3);
+                }
+            }
+            written = written && TIFFWriteTile(tiff, tile.data(), x, y, 0, 0) >= 0;
+        }
+    }
+    TIFFClose(tiff);
+    return written;
+}
+
+static bool writeStripped(const QString &fileName, uint32_t rowsPerStrip)
+{
+    TIFF *tiff = TIFFOpen(QFile::encodeName(fileName).constData(), "w");
+    if (!tiff) {
+        return false;
+    }
+    setFields(tiff);
+    TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, rowsPerStrip);
+
+    bool written = true;
+    std::vector<uint8_t> line(size_t(kWidth) * 3);
+    for (uint32_t y = 0; y < kHeight; ++y) {
+        for (uint32_t x = 0; x < kWidth; ++x) {
+            pixel(x, y, line.data() + size_t(x) * 3);
+        }
+        written = written && TIFFWriteScanline(tiff, line.data(), y, 0) >= 0;
+    }
+    TIFFClose(tiff);
+    return written;
+}
+
+void TiffDecoderTest::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    QVERIFY(writeTiled(m_dir.filePath(QStringLiteral("tiled.tif")), 64, 48));
+    QVERIFY(writeStripped(m_dir.filePath(QStringLiteral("stripped.tif")), 7));
+    QVERIFY(writeStripped(m_dir.filePath(QStringLiteral("single-strip.tif")), kHeight));
+}
+
+void TiffDecoderTest::testRegionMatchesWhole_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<QRect>("region");
+
+    for (const char *fileName : {"tiled.tif", "stripped.tif"}) {
+        QTest::addRow("%s, inside a block", fileName) << QString::fromLatin1(fileName) << QRect(10, 10, 20, 20);
+        QTest::addRow("%s, across blocks", fileName) << QString::fromLatin1(fileName) << QRect(60, 40, 80, 30);
+        QTest::addRow("%s, last blocks", fileName) << QString::fromLatin1(fileName) << QRect(250, 150, 50, 50);
+        QTest::addRow("%s, corner", fileName) << QString::fromLatin1(fileName) << QRect(290, 195, 10, 5);
+        QTest::addRow("%s, last column", fileName) << QString::fromLatin1(fileName) << QRect(kWidth - 1, 0, 1, 40);
+        QTest::addRow("%s, last row", fileName) << QString::fromLatin1(fileName) << QRect(0, kHeight - 1, 120, 1);
+    }
+}
+
+// The part decoded from the tiles or strips is the same as that part of the whole image
+void TiffDecoderTest::testRegionMatchesWhole()
+{
+    QFETCH(QString, fileName);
+    QFETCH(QRect, region);
+
+    TIFF *tiff = TIFFOpen(QFile::encodeName(m_dir.filePath(fileName)).constData(), "r");
+    QVERIFY(tiff);
+    const TiffLevel level = {0, 0, kWidth, kHeight};
+
+    const QImage whole = TiffDecoder::decodeLevel(tiff, level);
+    const QImage part = TiffDecoder::decodeRegion(tiff, level, region);
+    TIFFClose(tiff);
+
+    QCOMPARE(whole.size(), QSize(kWidth, kHeight));
+    uint8_t rgb[3];
+    pixel(123, 45, rgb);
+    QCOMPARE(whole.pixel(123, 45), qRgb(rgb[0], rgb[1], rgb[2]));
+
+    QVERIFY(!part.isNull());
+    QCOMPARE(part, whole.copy(region));
+}
+
+// Decoding a part of a single strip would decode the whole image, so it's not done
+void TiffDecoderTest::testSingleStrip()
+{
+    TIFF *tiff = TIFFOpen(QFile::encodeName(m_dir.filePath(QStringLiteral("single-strip.tif"))).constData(), "r");
+    QVERIFY(tiff);
+    const TiffLevel level = {0, 0, kWidth, kHeight};
+
+    QVERIFY(TiffDecoder::decodeRegion(tiff, level, QRect(10, 10, 20, 20)).isNull());
+    QCOMPARE(TiffDecoder::decodeLevel(tiff, level).size(), QSize(kWidth, kHeight));
+    TIFFClose(tiff);
+}
+
+QTEST_GUILESS_MAIN(TiffDecoderTest)
+#include "tiffdecodertest.moc"
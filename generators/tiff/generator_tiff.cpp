@@ -7,18 +7,22 @@
 #include "generator_tiff.h"
 
 #include <QBuffer>
+#include <QCache>
 #include <QDateTime>
 #include <QFile>
 #include <QFileInfo>
 #include <QImage>
 #include <QList>
+#include <QMutexLocker>
 #include <QPainter>
 #include <QPrinter>
+#include <QTransform>
 
 #include <KAboutData>
 #include <KLocalizedString>
 #include <QDebug>
 
+#include <core/area.h>
 #include <core/document.h>
 #include <core/fileprinter.h>
 #include <core/page.h>
@@ -27,8 +31,15 @@
 #include <tiff.h>
 #include <tiffio.h>
 
+#include <algorithm>
+
+#include "tiffdecoder.h"
+
 #define TiffDebug 4714
 
+// the cost of the decoded pages cache is in kilobytes
+static const int kDecodedPagesCacheSize = 64 * 1024;
+
 tsize_t okular_tiffReadProc(thandle_t handle, tdata_t buf, tsize_t size)
 {
     QIODevice *device = static_cast<QIODevice *>(handle);
@@ -86,14 +97,40 @@ public:
     Private()
         : tiff(nullptr)
         , dev(nullptr)
+        , decodedPages(kDecodedPagesCacheSize)
+        , largeImageKey(-1, -1)
     {
     }
 
     TIFF *tiff;
     QByteArray data;
     QIODevice *dev;
+    // the images of each page, the largest first and the smallest last
+    QList<QList<TiffLevel>> levels;
+    // whole decoded images, keyed by page and level
+    QCache<std::pair<int, int>, QImage> decodedPages;
+    // the last whole image too large for decodedPages, scaled down to the
+    // size of the page asked for when that is smaller; it stays until the
+    // next one, so the other tiles of its page don't decode it again
+    std::pair<int, int> largeImageKey;
+    QImage largeImage;
 };
 
+// Returns @p rect, normalized on a page turned clockwise by @p rotation quarters, on the upright page
+static QRectF uprightRect(const Okular::NormalizedRect &rect, int rotation)
+{
+    switch (rotation) {
+    case Okular::Rotation90:
+        return QRectF(QPointF(rect.top, 1 - rect.right), QPointF(rect.bottom, 1 - rect.left));
+    case Okular::Rotation180:
+        return QRectF(QPointF(1 - rect.right, 1 - rect.bottom), QPointF(1 - rect.left, 1 - rect.top));
+    case Okular::Rotation270:
+        return QRectF(QPointF(1 - rect.bottom, rect.left), QPointF(1 - rect.top, rect.right));
+    default:
+        return QRectF(QPointF(rect.left, rect.top), QPointF(rect.right, rect.bottom));
+    }
+}
+
 static QDateTime convertTIFFDateTime(const char *tiffdate)
 {
     if (!tiffdate) {
@@ -162,6 +199,8 @@ TIFFGenerator::TIFFGenerator(QObject *parent, const QVariantList &args)
     , d(new Private)
 {
     setFeature(Threaded);
+    setFeature(RotatedRendering);
+    setFeature(TiledRendering);
     setFeature(PrintNative);
     setFeature(PrintToFile);
     setFeature(ReadRawData);
@@ -220,6 +259,10 @@ bool TIFFGenerator::doCloseDocument()
         d->dev = nullptr;
         d->data.clear();
         m_pageMapping.clear();
+        d->levels.clear();
+        d->decodedPages.clear();
+        d->largeImageKey = {-1, -1};
+        d->largeImage = QImage();
     }
 
     return true;
@@ -227,47 +270,84 @@ bool TIFFGenerator::doCloseDocument()
 
 QImage TIFFGenerator::image(Okular::PixmapRequest *request)
 {
-    bool generated = false;
+    QMutexLocker locker(userMutex());
     QImage img;
 
-    if (TIFFSetDirectory(d->tiff, mapPage(request->page()->number()))) {
-        int rotation = request->page()->rotation();
-        uint32_t width = 1;
-        uint32_t height = 1;
-        uint32_t orientation = 0;
-        TIFFGetField(d->tiff, TIFFTAG_IMAGEWIDTH, &width);
-        TIFFGetField(d->tiff, TIFFTAG_IMAGELENGTH, &height);
-
-        if (!TIFFGetField(d->tiff, TIFFTAG_ORIENTATION, &orientation)) {
-            orientation = ORIENTATION_TOPLEFT;
+    const int page = request->page()->number();
+    const int rotation = request->rotation();
+    if (page >= 0 && page < d->levels.count()) {
+        // libtiff decodes upright, the image is turned at the end
+        int reqwidth = request->width();
+        int reqheight = request->height();
+        if (rotation % 2 == 1) {
+            std::swap(reqwidth, reqheight);
         }
 
-        QImage image(width, height, QImage::Format_RGB32);
-        uint32_t *data = reinterpret_cast<uint32_t *>(image.bits());
-
-        // read data
-        if (TIFFReadRGBAImageOriented(d->tiff, width, height, data, orientation) != 0) {
-            // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
-            uint32_t size = width * height;
-            for (uint32_t i = 0; i < size; ++i) {
-                uint32_t red = (data[i] & 0x00FF0000) >> 16;
-                uint32_t blue = (data[i] & 0x000000FF) << 16;
-                data[i] = (data[i] & 0xFF00FF00) + red + blue;
+        // the smallest image of the page that is still as large as asked for
+        const QList<TiffLevel> &levels = d->levels.at(page);
+        int level = 0;
+        while (level + 1 < levels.count() && int(levels.at(level + 1).width) >= reqwidth && int(levels.at(level + 1).height) >= reqheight) {
+            ++level;
+        }
+        const TiffLevel &tiffLevel = levels.at(level);
+
+        // the part of the page asked for, upright and in pixels of the level
+        const QRectF area = request->isTile() ? uprightRect(request->normalizedRect(), rotation) : QRectF(0, 0, 1, 1);
+        const QRectF source(area.x() * tiffLevel.width, area.y() * tiffLevel.height, area.width() * tiffLevel.width, area.height() * tiffLevel.height);
+        const QRect region = source.toAlignedRect() & QRect(0, 0, tiffLevel.width, tiffLevel.height);
+
+        // the pixels of the level covered by the decoded image, which may be scaled down
+        const QSize wantedSize(qMin<int>(reqwidth, tiffLevel.width), qMin<int>(reqheight, tiffLevel.height));
+        QImage decoded;
+        QRect decodedArea(0, 0, tiffLevel.width, tiffLevel.height);
+        if (const QImage *cached = d->decodedPages.object({page, level})) {
+            decoded = *cached;
+        } else if (d->largeImageKey == std::make_pair(page, level) && d->largeImage.width() >= wantedSize.width() && d->largeImage.height() >= wantedSize.height()) {
+            decoded = d->largeImage;
+        } else if (request->isTile() && !region.isEmpty()) {
+            decoded = TiffDecoder::decodeRegion(d->tiff, tiffLevel, region);
+            decodedArea = region;
+        }
+        if (decoded.isNull()) {
+            // whole images are kept, the next tiles of the page come from them
+            decoded = TiffDecoder::decodeLevel(d->tiff, tiffLevel);
+            decodedArea = QRect(0, 0, tiffLevel.width, tiffLevel.height);
+            const qsizetype cost = qMax<qsizetype>(1, decoded.sizeInBytes() / 1024);
+            if (!decoded.isNull() && cost <= d->decodedPages.maxCost()) {
+                d->decodedPages.insert({page, level}, new QImage(decoded), cost);
+            } else if (!decoded.isNull()) {
+                // too large for the cache, but decoding it for every tile would be worse
+                if (decoded.size() != wantedSize) {
+                    decoded = decoded.scaled(wantedSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+                }
+                d->largeImageKey = {page, level};
+                d->largeImage = decoded;
             }
+        }
 
-            int reqwidth = request->width();
-            int reqheight = request->height();
-            if (rotation % 2 == 1) {
-                std::swap(reqwidth, reqheight);
+        if (!decoded.isNull()) {
+            if (request->isTile()) {
+                const QRect tile = request->normalizedRect().geometry(request->width(), request->height());
+                img = QImage(rotation % 2 == 1 ? tile.height() : tile.width(), rotation % 2 == 1 ? tile.width() : tile.height(), QImage::Format_RGB32);
+                img.fill(Qt::white);
+
+                QPainter p(&img);
+                p.setRenderHint(QPainter::SmoothPixmapTransform);
+                const QTransform toDecoded = QTransform::fromTranslate(-decodedArea.x(), -decodedArea.y()) * QTransform::fromScale(qreal(decoded.width()) / decodedArea.width(), qreal(decoded.height()) / decodedArea.height());
+                p.drawImage(QRectF(img.rect()), decoded, toDecoded.mapRect(source));
+            } else {
+                img = decoded.scaled(reqwidth, reqheight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            }
+            if (rotation != Okular::Rotation0) {
+                // libtiff decodes upright, turn the scaled image here rather than the pixmap in a RotationJob
+                img = img.transformed(QTransform().rotate(rotation * 90));
             }
-            img = image.scaled(reqwidth, reqheight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-
-            generated = true;
         }
     }
 
-    if (!generated) {
-        img = QImage(request->width(), request->height(), QImage::Format_RGB32);
+    if (img.isNull()) {
+        const QSize size = request->isTile() ? request->normalizedRect().geometry(request->width(), request->height()).size() : QSize(request->width(), request->height());
+        img = QImage(size, QImage::Format_RGB32);
         img.fill(qRgb(255, 255, 255));
     }
 
@@ -276,6 +356,7 @@ QImage TIFFGenerator::image(Okular::PixmapRequest *request)
 
 Okular::DocumentInfo TIFFGenerator::generateDocumentInfo(const QSet<Okular::DocumentInfo::Key> &keys) const
 {
+    QMutexLocker locker(userMutex());
     Okular::DocumentInfo docInfo;
     if (d->tiff) {
         if (keys.contains(Okular::DocumentInfo::MimeType)) {
@@ -330,6 +411,8 @@ void TIFFGenerator::loadPages(QVector<Okular::Page *> &pagesVector)
     uint32_t width = 0;
     uint32_t height = 0;
 
+    d->levels.clear();
+
     const QSizeF dpi = Okular::Utils::realDpi(nullptr);
     for (tdir_t i = 0; i < dirs; ++i) {
         if (!TIFFSetDirectory(d->tiff, i)) {
@@ -340,6 +423,24 @@ void TIFFGenerator::loadPages(QVector<Okular::Page *> &pagesVector)
             continue;
         }
 
+        // a reduced-resolution version of the previous page isn't a page
+        uint32_t subFileType = 0;
+        TIFFGetFieldDefaulted(d->tiff, TIFFTAG_SUBFILETYPE, &subFileType);
+        if ((subFileType & FILETYPE_REDUCEDIMAGE) && realdirs > 0) {
+            d->levels.last().append({i, 0, width, height});
+            continue;
+        }
+
+        QList<TiffLevel> levels = {{i, 0, width, height}};
+
+        // and neither are its SubIFDs, the offsets are read before leaving the directory
+        uint16_t subIfdCount = 0;
+        uint64_t *subIfdOffsets = nullptr;
+        QList<uint64_t> subIfds;
+        if (TIFFGetField(d->tiff, TIFFTAG_SUBIFD, &subIfdCount, &subIfdOffsets) && subIfdOffsets) {
+            subIfds = QList<uint64_t>(subIfdOffsets, subIfdOffsets + subIfdCount);
+        }
+
         adaptSizeToResolution(d->tiff, TIFFTAG_XRESOLUTION, dpi.width(), &width);
         adaptSizeToResolution(d->tiff, TIFFTAG_YRESOLUTION, dpi.height(), &height);
 
@@ -348,10 +449,26 @@ void TIFFGenerator::loadPages(QVector<Okular::Page *> &pagesVector)
 
         m_pageMapping[realdirs] = i;
 
+        for (uint64_t subIfd : std::as_const(subIfds)) {
+            uint32_t subIfdWidth = 0;
+            uint32_t subIfdHeight = 0;
+            uint32_t subIfdType = 0;
+            if (TIFFSetSubDirectory(d->tiff, subIfd) && TIFFGetField(d->tiff, TIFFTAG_IMAGEWIDTH, &subIfdWidth) == 1 && TIFFGetField(d->tiff, TIFFTAG_IMAGELENGTH, &subIfdHeight) == 1
+                && TIFFGetFieldDefaulted(d->tiff, TIFFTAG_SUBFILETYPE, &subIfdType) && (subIfdType & FILETYPE_REDUCEDIMAGE)) {
+                levels.append({i, subIfd, subIfdWidth, subIfdHeight});
+            }
+        }
+        d->levels.append(levels);
+
         ++realdirs;
     }
 
     pagesVector.resize(realdirs);
+
+    // the largest images first
+    for (QList<TiffLevel> &levels : d->levels) {
+        std::stable_sort(levels.begin() + 1, levels.end(), [](const TiffLevel &first, const TiffLevel &second) { return first.width > second.width; });
+    }
 }
 
 Okular::Document::PrintError TIFFGenerator::print(QPrinter &printer)
@@ -363,6 +480,7 @@ Okular::Document::PrintError TIFFGenerator::print(QPrinter &printer)
 
     QList<int> pageList = Okular::FilePrinter::pageList(printer, document()->pages(), document()->currentPage() + 1, document()->bookmarkedPageList());
 
+    QMutexLocker locker(userMutex());
     for (int i = 0; i < pageList.count(); ++i) {
         if (!TIFFSetDirectory(d->tiff, mapPage(pageList[i] - 1))) {
             continue;
@@ -378,12 +496,7 @@ Okular::Document::PrintError TIFFGenerator::print(QPrinter &printer)
         // read data
         if (TIFFReadRGBAImageOriented(d->tiff, width, height, data, ORIENTATION_TOPLEFT) != 0) {
             // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
-            uint32_t size = width * height;
-            for (uint32_t j = 0; j < size; ++j) {
-                uint32_t red = (data[j] & 0x00FF0000) >> 16;
-                uint32_t blue = (data[j] & 0x000000FF) << 16;
-                data[j] = (data[j] & 0xFF00FF00) + red + blue;
-            }
+            TiffDecoder::abgrToArgb(data, qsizetype(width) * height);
         }
 
         if (i != 0) {
@@ -0,0 +1,151 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "tiffdecoder.h"
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace TiffDecoder
+{
+void abgrToArgb(uint32_t *data, qsizetype pixels)
+{
+    qsizetype i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= pixels; i += 8) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        const __m256i redBlue = _mm256_and_si256(v, _mm256_set1_epi32(0x00ff00ff));
+        const __m256i swapped = _mm256_or_si256(_mm256_slli_epi32(redBlue, 16), _mm256_srli_epi32(redBlue, 16));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(data + i), _mm256_or_si256(_mm256_and_si256(v, _mm256_set1_epi32(0xff00ff00)), swapped));
+    }
+#endif
+#if defined(__SSE2__)
+    for (; i + 4 <= pixels; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        // 0x00BB00RR becomes 0x00RR00BB, the shifts drop the other byte
+        const __m128i redBlue = _mm_and_si128(v, _mm_set1_epi32(0x00ff00ff));
+        const __m128i swapped = _mm_or_si128(_mm_slli_epi32(redBlue, 16), _mm_srli_epi32(redBlue, 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), _mm_or_si128(_mm_and_si128(v, _mm_set1_epi32(0xff00ff00)), swapped));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 16 <= pixels; i += 16) {
+        // the bytes are red, green, blue, alpha
+        uint8x16x4_t v = vld4q_u8(reinterpret_cast<const uint8_t *>(data + i));
+        std::swap(v.val[0], v.val[2]);
+        vst4q_u8(reinterpret_cast<uint8_t *>(data + i), v);
+    }
+#endif
+    for (; i < pixels; ++i) {
+        const uint32_t red = (data[i] & 0x00FF0000) >> 16;
+        const uint32_t blue = (data[i] & 0x000000FF) << 16;
+        data[i] = (data[i] & 0xFF00FF00) + red + blue;
+    }
+}
+
+bool setLevel(TIFF *tiff, const TiffLevel &level)
+{
+    if (!TIFFSetDirectory(tiff, level.directory)) {
+        return false;
+    }
+    return level.subDirectory == 0 || TIFFSetSubDirectory(tiff, level.subDirectory);
+}
+
+QImage decodeLevel(TIFF *tiff, const TiffLevel &level)
+{
+    if (!setLevel(tiff, level)) {
+        return QImage();
+    }
+
+    uint32_t orientation = 0;
+    if (!TIFFGetField(tiff, TIFFTAG_ORIENTATION, &orientation)) {
+        orientation = ORIENTATION_TOPLEFT;
+    }
+
+    QImage image(level.width, level.height, QImage::Format_RGB32);
+    uint32_t *data = reinterpret_cast<uint32_t *>(image.bits());
+    if (image.isNull() || TIFFReadRGBAImageOriented(tiff, level.width, level.height, data, orientation) == 0) {
+        return QImage();
+    }
+
+    abgrToArgb(data, qsizetype(level.width) * level.height);
+    return image;
+}
+
+QImage decodeRegion(TIFF *tiff, const TiffLevel &level, const QRect &region)
+{
+    if (!setLevel(tiff, level)) {
+        return QImage();
+    }
+
+    // libtiff turns the tiles and strips bottom-up, but only flips the other
+    // orientations, without turning them
+    uint32_t orientation = 0;
+    if (TIFFGetField(tiff, TIFFTAG_ORIENTATION, &orientation) && orientation != ORIENTATION_TOPLEFT) {
+        return QImage();
+    }
+
+    uint32_t blockWidth = level.width;
+    uint32_t blockHeight = 0;
+    const bool tiled = TIFFIsTiled(tiff);
+    if (tiled) {
+        if (!TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &blockWidth) || !TIFFGetField(tiff, TIFFTAG_TILELENGTH, &blockHeight)) {
+            return QImage();
+        }
+    } else {
+        TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &blockHeight);
+        blockHeight = qMin(blockHeight, level.height);
+    }
+    if (blockWidth == 0 || blockHeight == 0) {
+        return QImage();
+    }
+
+    const int firstColumn = region.left() / blockWidth;
+    const int lastColumn = region.right() / blockWidth;
+    const int firstRow = region.top() / blockHeight;
+    const int lastRow = region.bottom() / blockHeight;
+    const qint64 decodedPixels = qint64(lastColumn - firstColumn + 1) * blockWidth * (lastRow - firstRow + 1) * blockHeight;
+    if (decodedPixels * 2 > qint64(level.width) * level.height) {
+        return QImage();
+    }
+
+    QImage image(region.size(), QImage::Format_RGB32);
+    if (image.isNull()) {
+        return QImage();
+    }
+    std::vector<uint32_t> block(size_t(blockWidth) * blockHeight);
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            const QRect blockRect(column * blockWidth, row * blockHeight, blockWidth, blockHeight);
+            const int read = tiled ? TIFFReadRGBATile(tiff, blockRect.x(), blockRect.y(), block.data()) : TIFFReadRGBAStrip(tiff, blockRect.y(), block.data());
+            if (!read) {
+                return QImage();
+            }
+
+            // the last strip only has the rows left, the tiles always have all of theirs
+            const int blockRows = tiled ? blockHeight : qMin<int>(blockHeight, level.height - blockRect.y());
+            const QRect copied = blockRect & region;
+            for (int y = copied.top(); y <= copied.bottom(); ++y) {
+                const uint32_t *source = block.data() + size_t(blockRows - 1 - (y - blockRect.y())) * blockWidth + (copied.x() - blockRect.x());
+                uint32_t *destination = reinterpret_cast<uint32_t *>(image.scanLine(y - region.y())) + (copied.x() - region.x());
+                std::copy(source, source + copied.width(), destination);
+            }
+        }
+    }
+
+    abgrToArgb(reinterpret_cast<uint32_t *>(image.bits()), qsizetype(image.width()) * image.height());
+    return image;
+}
+}
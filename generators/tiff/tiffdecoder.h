@@ -0,0 +1,53 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _TIFF_TIFFDECODER_H_
+#define _TIFF_TIFFDECODER_H_
+
+#include <QImage>
+#include <QRect>
+
+#include <tiffio.h>
+
+/**
+ * An image of a page: the page itself, or one of its reduced-resolution
+ * versions, either in a directory following the one of the page or in a
+ * SubIFD of it.
+ */
+struct TiffLevel {
+    tdir_t directory;
+    // the offset of the SubIFD, 0 if the image is the directory itself
+    uint64_t subDirectory;
+    uint32_t width;
+    uint32_t height;
+};
+
+namespace TiffDecoder
+{
+/**
+ * Turns the ABGR pixels libtiff decodes into ARGB ones, swapping red and blue.
+ */
+void abgrToArgb(uint32_t *data, qsizetype pixels);
+
+/**
+ * Makes the image of @p level the current one of @p tiff.
+ */
+bool setLevel(TIFF *tiff, const TiffLevel &level);
+
+/**
+ * Decodes the whole image of @p level.
+ */
+QImage decodeLevel(TIFF *tiff, const TiffLevel &level);
+
+/**
+ * Decodes only the part @p region of the image of @p level, from the tiles or
+ * the strips it overlaps. Returns a null image if that can't be done, or if
+ * it's about as much work as decoding the whole image.
+ */
+QImage decodeRegion(TIFF *tiff, const TiffLevel &level, const QRect &region);
+}
+
+#endif
@@ -0,0 +1,129 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QRandomGenerator>
+#include <QTemporaryFile>
+#include <QTest>
+
+#include "../mappeddocument.h"
+
+using Row = Txt::MappedDocument::Row;
+
+class MappedDocumentTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testPaginate_data();
+    void testPaginate();
+
+private:
+    QTemporaryFile m_file;
+    QString m_text;
+};
+
+// Lines of ASCII, tabs, two byte, wide three byte and wide four byte characters,
+// some of them ending in \r\n, some longer than a row
+void MappedDocumentTest::initTestCase()
+{
+    const QStringList pieces = {QStringLiteral("word"), QStringLiteral(" "), QStringLiteral("\t"), QStringLiteral("é"), QStringLiteral("中"), QStringLiteral("😀"), QStringLiteral("x")};
+
+    QRandomGenerator random(42);
+    QByteArray data;
+    // several chunks of the parallel scan, whose boundaries fall in the middle of lines
+    while (data.size() < 12 * 1024 * 1024) {
+        QString line;
+        const int length = random.bounded(10) == 0 ? random.bounded(2000) : random.bounded(60);
+        for (int i = 0; i < length; ++i) {
+            line += pieces.at(random.bounded(pieces.count()));
+        }
+        line += random.bounded(4) == 0 ? QStringLiteral("\r\n") : QStringLiteral("\n");
+        data += line.toUtf8();
+    }
+    // the last line has no line feed
+    data += QStringLiteral("end\twithout line feed").toUtf8();
+
+    QVERIFY(m_file.open());
+    QCOMPARE(m_file.write(data), data.size());
+    m_file.close();
+    m_text = QString::fromUtf8(data);
+}
+
+// Wraps the lines one after the other
+static QList<Row> expectedRows(const QString &text, int columnsPerRow)
+{
+    QList<Row> rows;
+    const QStringList lines = text.split(QLatin1Char('\n'));
+    for (QString line : lines) {
+        if (line.endsWith(QLatin1Char('\r'))) {
+            line.chop(1);
+        }
+
+        Row row {QString(), false};
+        int column = 0;
+        for (int i = 0; i < line.size(); ++i) {
+            QString character = line.mid(i, 1);
+            char32_t ucs4 = line.at(i).unicode();
+            if (line.at(i).isHighSurrogate()) {
+                ucs4 = QChar::surrogateToUcs4(line.at(i), line.at(i + 1));
+                character = line.mid(i++, 2);
+            }
+
+            int columns = Txt::MappedDocument::characterColumns(ucs4, column);
+            if (column + columns > columnsPerRow && !row.text.isEmpty()) {
+                rows.append(row);
+                row.text.clear();
+                column = 0;
+                columns = Txt::MappedDocument::characterColumns(ucs4, column);
+            }
+            row.text += ucs4 == U'\t' ? QString(columns, QLatin1Char(' ')) : character;
+            column += columns;
+        }
+        row.endsLine = true;
+        rows.append(row);
+    }
+    return rows;
+}
+
+void MappedDocumentTest::testPaginate_data()
+{
+    QTest::addColumn<int>("rowsPerPage");
+    QTest::addColumn<int>("columnsPerRow");
+
+    QTest::newRow("narrow") << 7 << 5;
+    QTest::newRow("page") << 52 << 80;
+    QTest::newRow("one row per page") << 1 << 120;
+}
+
+// The pages found by the parallel scan hold the same rows as a serial wrap of the text
+void MappedDocumentTest::testPaginate()
+{
+    QFETCH(int, rowsPerPage);
+    QFETCH(int, columnsPerRow);
+
+    Txt::MappedDocument document;
+    QVERIFY(document.open(m_file.fileName()));
+    document.paginate(rowsPerPage, columnsPerRow);
+
+    const QList<Row> expected = expectedRows(m_text, columnsPerRow);
+    QCOMPARE(document.pageCount(), (expected.count() + rowsPerPage - 1) / rowsPerPage);
+
+    int index = 0;
+    for (int page = 0; page < document.pageCount(); ++page) {
+        const QList<Row> rows = document.pageRows(page);
+        QCOMPARE(rows.count(), qMin(rowsPerPage, int(expected.count()) - index));
+        for (const Row &row : rows) {
+            QCOMPARE(row.text, expected.at(index).text);
+            QCOMPARE(row.endsLine, expected.at(index).endsLine);
+            ++index;
+        }
+    }
+    QCOMPARE(index, expected.count());
+}
+
+QTEST_GUILESS_MAIN(MappedDocumentTest)
+#include "mappeddocumenttest.moc"
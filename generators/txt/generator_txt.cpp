@@ -6,18 +6,199 @@
 
 #include "generator_txt.h"
 #include "converter.h"
+#include "debug_txt.h"
+#include "mappeddocument.h"
+
+#include <QFile>
+#include <QFontDatabase>
+#include <QFontInfo>
+#include <QFontMetricsF>
+#include <QPainter>
 
 #include <KAboutData>
 #include <KConfigDialog>
 #include <KLocalizedString>
 
+#include <core/page.h>
+#include <core/textdocumentsettings.h>
+#include <core/textpage.h>
+
 OKULAR_EXPORT_PLUGIN(TxtGenerator, "libokularGenerator_txt.json")
 
+// same page geometry as the one Txt::Converter gives the QTextDocument
+static const int kPageWidth = 600;
+static const int kPageHeight = 800;
+static const int kPageMargin = 20;
+
 TxtGenerator::TxtGenerator(QObject *parent, const QVariantList &args)
     : Okular::TextDocumentGenerator(new Txt::Converter, QStringLiteral("okular_txt_generator_settings"), parent, args)
+    , m_mappedLineSpacing(0)
+    , m_mappedAscent(0)
 {
 }
 
+TxtGenerator::~TxtGenerator()
+{
+}
+
+Okular::Document::OpenResult TxtGenerator::loadDocumentWithPassword(const QString &fileName, QVector<Okular::Page *> &pagesVector, const QString &password)
+{
+    if (Txt::MappedDocument::shouldMap(fileName)) {
+        std::unique_ptr<Txt::MappedDocument> mappedDocument = std::make_unique<Txt::MappedDocument>();
+        if (mappedDocument->open(fileName)) {
+            m_mappedFont = generalSettings()->font();
+            if (!QFontInfo(m_mappedFont).fixedPitch()) {
+                // the rows are wrapped by counting columns, which only fit the page with a fixed pitch font
+                const QFont configuredFont = m_mappedFont;
+                m_mappedFont = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+                if (configuredFont.pointSizeF() > 0) {
+                    m_mappedFont.setPointSizeF(configuredFont.pointSizeF());
+                } else {
+                    m_mappedFont.setPixelSize(configuredFont.pixelSize());
+                }
+            }
+            if (m_mappedFont.pointSizeF() > 0) {
+                // the pages are painted on images, whose resolution does not depend on the screen
+                m_mappedFont.setPixelSize(qMax(1, qRound(m_mappedFont.pointSizeF() * 96 / 72)));
+            }
+            const QFontMetricsF metrics(m_mappedFont);
+            m_mappedLineSpacing = metrics.lineSpacing();
+            m_mappedAscent = metrics.ascent();
+
+            const int rowsPerPage = int((kPageHeight - 2 * kPageMargin) / m_mappedLineSpacing);
+            const int columnsPerRow = int((kPageWidth - 2 * kPageMargin) / metrics.horizontalAdvance(QLatin1Char('M')));
+            mappedDocument->paginate(rowsPerPage, columnsPerRow);
+
+            pagesVector.resize(mappedDocument->pageCount());
+            for (int i = 0; i < pagesVector.count(); ++i) {
+                pagesVector[i] = new Okular::Page(i, kPageWidth, kPageHeight, Okular::Rotation0);
+            }
+            m_mappedDocument = std::move(mappedDocument);
+
+            // unlike QTextDocument, the mapped document can be painted from several threads
+            setFeature(Threaded);
+            setFeature(ParallelRendering);
+            setFeature(PrintNative, false);
+            setFeature(PrintToFile, false);
+
+            return Okular::Document::OpenSuccess;
+        }
+
+        qCDebug(OkularTxtDebug) << "Loading" << fileName << "in memory instead";
+    }
+
+    return TextDocumentGenerator::loadDocumentWithPassword(fileName, pagesVector, password);
+}
+
+bool TxtGenerator::doCloseDocument()
+{
+    if (m_mappedDocument) {
+        m_mappedDocument.reset();
+
+        setFeature(Threaded, false);
+        setFeature(ParallelRendering, false);
+        setFeature(PrintNative);
+        setFeature(PrintToFile);
+    }
+
+    return TextDocumentGenerator::doCloseDocument();
+}
+
+QImage TxtGenerator::image(Okular::PixmapRequest *request)
+{
+    if (!m_mappedDocument) {
+        return TextDocumentGenerator::image(request);
+    }
+
+    const QList<Txt::MappedDocument::Row> rows = m_mappedDocument->pageRows(request->pageNumber());
+
+    QImage image(request->width(), request->height(), QImage::Format_ARGB32);
+    image.fill(Qt::white);
+
+    QPainter p(&image);
+    p.scale(request->width() / qreal(kPageWidth), request->height() / qreal(kPageHeight));
+    p.setClipRect(QRectF(kPageMargin, kPageMargin, kPageWidth - 2 * kPageMargin, kPageHeight - 2 * kPageMargin));
+    p.setFont(m_mappedFont);
+    p.setPen(Qt::black);
+    for (int i = 0; i < rows.count(); ++i) {
+        p.drawText(QPointF(kPageMargin, kPageMargin + m_mappedAscent + i * m_mappedLineSpacing), rows.at(i).text);
+    }
+    p.end();
+
+    return image;
+}
+
+Okular::TextPage *TxtGenerator::textPage(Okular::TextRequest *request)
+{
+    if (!m_mappedDocument) {
+        return TextDocumentGenerator::textPage(request);
+    }
+
+    const QList<Txt::MappedDocument::Row> rows = m_mappedDocument->pageRows(request->page()->number());
+    const QFontMetricsF metrics(m_mappedFont);
+
+    Okular::TextPage *textPage = new Okular::TextPage;
+    for (int i = 0; i < rows.count(); ++i) {
+        const Txt::MappedDocument::Row &row = rows.at(i);
+        const qreal top = (kPageMargin + i * m_mappedLineSpacing) / kPageHeight;
+        const qreal bottom = (kPageMargin + (i + 1) * m_mappedLineSpacing) / kPageHeight;
+
+        qreal x = kPageMargin;
+        for (int c = 0; c < row.text.size();) {
+            const int length = row.text.at(c).isHighSurrogate() && c + 1 < row.text.size() ? 2 : 1;
+            const QString character = row.text.mid(c, length);
+            const qreal advance = metrics.horizontalAdvance(character);
+            textPage->append(character, Okular::NormalizedRect(x / kPageWidth, top, (x + advance) / kPageWidth, bottom));
+            x += advance;
+            c += length;
+        }
+
+        if (row.endsLine) {
+            textPage->append(QStringLiteral("\n"), Okular::NormalizedRect(x / kPageWidth, top, x / kPageWidth, bottom));
+        }
+    }
+
+    return textPage;
+}
+
+Okular::ExportFormat::List TxtGenerator::exportFormats() const
+{
+    if (!m_mappedDocument) {
+        return TextDocumentGenerator::exportFormats();
+    }
+
+    return {Okular::ExportFormat::standardFormat(Okular::ExportFormat::PlainText)};
+}
+
+bool TxtGenerator::exportTo(const QString &fileName, const Okular::ExportFormat &format)
+{
+    if (!m_mappedDocument) {
+        return TextDocumentGenerator::exportTo(fileName, format);
+    }
+
+    if (format.mimeType().name() != QLatin1String("text/plain")) {
+        return false;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    return file.write(reinterpret_cast<const char *>(m_mappedDocument->data()), m_mappedDocument->size()) == m_mappedDocument->size();
+}
+
+Okular::DocumentInfo TxtGenerator::generateDocumentInfo(const QSet<Okular::DocumentInfo::Key> &keys) const
+{
+    if (!m_mappedDocument) {
+        return TextDocumentGenerator::generateDocumentInfo(keys);
+    }
+
+    Okular::DocumentInfo info;
+    info.set(Okular::DocumentInfo::MimeType, QStringLiteral("text/plain"));
+    return info;
+}
+
 void TxtGenerator::addPages(KConfigDialog *dlg)
 {
     Okular::TextDocumentSettingsWidget *widget = new Okular::TextDocumentSettingsWidget();
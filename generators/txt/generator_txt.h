@@ -9,6 +9,15 @@
 
 #include <core/textdocumentgenerator.h>
 
+#include <QFont>
+
+#include <memory>
+
+namespace Txt
+{
+class MappedDocument;
+}
+
 class TxtGenerator : public Okular::TextDocumentGenerator
 {
     Q_OBJECT
@@ -16,11 +25,29 @@ class TxtGenerator : public Okular::TextDocumentGenerator
 
 public:
     TxtGenerator(QObject *parent, const QVariantList &args);
-    ~TxtGenerator() override
-    {
-    }
+    ~TxtGenerator() override;
+
+    Okular::Document::OpenResult loadDocumentWithPassword(const QString &fileName, QVector<Okular::Page *> &pagesVector, const QString &password) override;
+
+    Okular::ExportFormat::List exportFormats() const override;
+    bool exportTo(const QString &fileName, const Okular::ExportFormat &format) override;
+
+    Okular::DocumentInfo generateDocumentInfo(const QSet<Okular::DocumentInfo::Key> &keys) const override;
 
     void addPages(KConfigDialog *dlg) override;
+
+protected:
+    bool doCloseDocument() override;
+    QImage image(Okular::PixmapRequest *request) override;
+    Okular::TextPage *textPage(Okular::TextRequest *request) override;
+
+private:
+    // big files are memory mapped and laid out one page at a time
+    std::unique_ptr<Txt::MappedDocument> m_mappedDocument;
+    // the layout of the mapped document is fixed when it is opened
+    QFont m_mappedFont;
+    qreal m_mappedLineSpacing;
+    qreal m_mappedAscent;
 };
 
 #endif
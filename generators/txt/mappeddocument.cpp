@@ -0,0 +1,303 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "mappeddocument.h"
+
+#include <QStringConverter>
+#include <QThread>
+#include <QThreadPool>
+
+#include <cstring>
+
+#include "debug_txt.h"
+
+using namespace Txt;
+
+// smaller files are loaded in a QTextDocument, which lays them out better
+static const qint64 kMappingThreshold = 32 * 1024 * 1024;
+// the scan is split in chunks of at least this size
+static const qint64 kMinimumChunkSize = 4 * 1024 * 1024;
+static const int kTabWidth = 8;
+
+MappedDocument::MappedDocument()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_textStart(0)
+    , m_rowsPerPage(1)
+    , m_columnsPerRow(1)
+{
+}
+
+MappedDocument::~MappedDocument()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar *>(m_data));
+    }
+}
+
+bool MappedDocument::shouldMap(const QString &fileName)
+{
+    QFile file(fileName);
+    if (file.size() < kMappingThreshold || !file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // same detection as Document::toUnicode(), which only looks at the beginning
+    const auto encoding = QStringConverter::encodingForHtml(file.read(4096));
+    return encoding.value_or(QStringConverter::Utf8) == QStringConverter::Utf8;
+}
+
+bool MappedDocument::open(const QString &fileName)
+{
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qCDebug(OkularTxtDebug) << "Can't open file" << fileName;
+        return false;
+    }
+
+    m_size = m_file.size();
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        qCDebug(OkularTxtDebug) << "Can't map file" << fileName << m_file.errorString();
+        m_size = 0;
+        return false;
+    }
+
+    // skip the byte order mark
+    m_textStart = (m_size >= 3 && m_data[0] == 0xEF && m_data[1] == 0xBB && m_data[2] == 0xBF) ? 3 : 0;
+    return true;
+}
+
+int MappedDocument::characterColumns(char32_t character, int column)
+{
+    if (character == U'\t') {
+        return kTabWidth - column % kTabWidth;
+    }
+    if (character == U'\r') {
+        return 0;
+    }
+
+    // the East Asian wide and fullwidth characters take two cells of a fixed pitch font
+    if ((character >= 0x1100 && character <= 0x115F) || (character >= 0x2E80 && character <= 0xA4CF && character != 0x303F)
+        || (character >= 0xAC00 && character <= 0xD7A3) || (character >= 0xF900 && character <= 0xFAFF) || (character >= 0xFE30 && character <= 0xFE4F)
+        || (character >= 0xFF00 && character <= 0xFF60) || (character >= 0xFFE0 && character <= 0xFFE6) || (character >= 0x1F300 && character <= 0x1F64F)
+        || (character >= 0x20000 && character <= 0x3FFFD)) {
+        return 2;
+    }
+    return 1;
+}
+
+qint64 MappedDocument::rowEnd(qint64 start, qint64 *next) const
+{
+    int column = 0;
+    qint64 position = start;
+    while (position < m_size) {
+        const uchar byte = m_data[position];
+        if (byte == '\n') {
+            *next = position + 1;
+            return position;
+        }
+
+        // decode the UTF-8 sequence, a byte that doesn't start one is a character of its own
+        char32_t character = byte;
+        qint64 length = 1;
+        if (byte >= 0xC0) {
+            const qint64 sequenceLength = qMin<qint64>(byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : 2, m_size - position);
+            character = byte & (0x3F >> (sequenceLength - 1));
+            // a truncated sequence ends before the first byte that doesn't continue it, like a line feed
+            for (; length < sequenceLength && (m_data[position + length] & 0xC0) == 0x80; ++length) {
+                character = (character << 6) | (m_data[position + length] & 0x3F);
+            }
+        }
+
+        const int columns = characterColumns(character, column);
+        if (columns > 0 && column + columns > m_columnsPerRow && position > start) {
+            // wrap the line before this character
+            *next = position;
+            return position;
+        }
+        column += columns;
+        position += length;
+    }
+
+    *next = m_size;
+    return m_size;
+}
+
+qint64 MappedDocument::firstLineStartAfter(qint64 offset) const
+{
+    if (offset <= m_textStart) {
+        return m_textStart;
+    }
+
+    const void *lineFeed = memchr(m_data + offset - 1, '\n', m_size - offset + 1);
+    return lineFeed ? static_cast<const uchar *>(lineFeed) - m_data + 1 : m_size;
+}
+
+qint64 MappedDocument::lineEnd(qint64 start) const
+{
+    const void *lineFeed = memchr(m_data + start, '\n', m_size - start);
+    return lineFeed ? static_cast<const uchar *>(lineFeed) - m_data : m_size;
+}
+
+bool MappedDocument::fitsInRow(qint64 start, qint64 end) const
+{
+    // no character takes more columns than it has bytes, but for the tabs
+    return end - start <= m_columnsPerRow && !memchr(m_data + start, '\t', end - start);
+}
+
+// Calls f(start, end) for every line starting in [begin, end), the last one may go past end
+template<typename F> void MappedDocument::forEachLine(qint64 begin, qint64 end, F f) const
+{
+    qint64 start = firstLineStartAfter(begin);
+    while (start < end && start < m_size) {
+        const qint64 lineEnd = this->lineEnd(start);
+        f(start, lineEnd);
+        start = lineEnd + 1;
+    }
+}
+
+void MappedDocument::paginate(int rowsPerPage, int columnsPerRow)
+{
+    m_rowsPerPage = qMax(1, rowsPerPage);
+    m_columnsPerRow = qMax(1, columnsPerRow);
+    m_pageStarts.clear();
+
+    const qint64 textSize = m_size - m_textStart;
+    const int chunkCount = int(qBound<qint64>(1, textSize / kMinimumChunkSize, 4 * QThread::idealThreadCount()));
+    std::vector<qint64> chunkBegins(chunkCount + 1);
+    for (int i = 0; i < chunkCount; ++i) {
+        chunkBegins[i] = m_textStart + textSize * i / chunkCount;
+    }
+    chunkBegins[chunkCount] = m_size;
+
+    QThreadPool pool;
+
+    // 1. count the rows of every chunk. Only the lines that may not fit in a row
+    // are decoded and wrapped, the starts of the rows they wrap to are kept.
+    std::vector<qint64> rowCounts(chunkCount, 0);
+    std::vector<std::vector<qint64>> chunkWrapStarts(chunkCount);
+    for (int i = 0; i < chunkCount; ++i) {
+        pool.start([this, i, &chunkBegins, &rowCounts, &chunkWrapStarts] {
+            qint64 rows = 0;
+            std::vector<qint64> &wrapStarts = chunkWrapStarts[i];
+            forEachLine(chunkBegins[i], chunkBegins[i + 1], [this, &rows, &wrapStarts](qint64 start, qint64 lineEnd) {
+                ++rows;
+                if (fitsInRow(start, lineEnd)) {
+                    return;
+                }
+                // the row wraps when it ends before the line, where the next one starts
+                qint64 next;
+                for (qint64 end = rowEnd(start, &next); end == next && end < lineEnd; end = rowEnd(start, &next)) {
+                    wrapStarts.push_back(next);
+                    ++rows;
+                    start = next;
+                }
+            });
+            rowCounts[i] = rows;
+        });
+    }
+    pool.waitForDone();
+
+    // 2. now that every chunk knows the number of its first row, find where the
+    // pages start, among the line starts and the wrap starts of the first pass
+    std::vector<std::vector<qint64>> chunkPageStarts(chunkCount);
+    qint64 firstRow = 0;
+    for (int i = 0; i < chunkCount; ++i) {
+        pool.start([this, i, firstRow, &chunkBegins, &chunkWrapStarts, &chunkPageStarts] {
+            qint64 row = firstRow;
+            std::vector<qint64> &pageStarts = chunkPageStarts[i];
+            const std::vector<qint64> &wrapStarts = chunkWrapStarts[i];
+            std::size_t wrap = 0;
+            forEachLine(chunkBegins[i], chunkBegins[i + 1], [this, &row, &pageStarts, &wrapStarts, &wrap](qint64 start, qint64 lineEnd) {
+                if (row++ % m_rowsPerPage == 0) {
+                    pageStarts.push_back(start);
+                }
+                for (; wrap < wrapStarts.size() && wrapStarts[wrap] < lineEnd; ++wrap) {
+                    if (row++ % m_rowsPerPage == 0) {
+                        pageStarts.push_back(wrapStarts[wrap]);
+                    }
+                }
+            });
+        });
+        firstRow += rowCounts[i];
+    }
+    pool.waitForDone();
+
+    for (const std::vector<qint64> &pageStarts : chunkPageStarts) {
+        m_pageStarts.insert(m_pageStarts.end(), pageStarts.begin(), pageStarts.end());
+    }
+    if (m_pageStarts.empty()) {
+        // an empty document still has an empty page
+        m_pageStarts.push_back(m_textStart);
+    }
+    m_pageStarts.push_back(m_size);
+
+    qCDebug(OkularTxtDebug) << "Split" << m_size << "bytes in" << firstRow << "rows and" << pageCount() << "pages";
+}
+
+int MappedDocument::pageCount() const
+{
+    return m_pageStarts.empty() ? 0 : int(m_pageStarts.size() - 1);
+}
+
+QList<MappedDocument::Row> MappedDocument::pageRows(int page) const
+{
+    QList<Row> rows;
+    if (page < 0 || page >= pageCount()) {
+        return rows;
+    }
+
+    qint64 start = m_pageStarts[page];
+    const qint64 pageEnd = m_pageStarts[page + 1];
+    while (start < pageEnd && rows.count() < m_rowsPerPage) {
+        qint64 next;
+        qint64 end = rowEnd(start, &next);
+        const bool endsLine = !(next == end && end < m_size);
+        if (endsLine && end > start && m_data[end - 1] == '\r') {
+            --end;
+        }
+
+        const QString text = QString::fromUtf8(reinterpret_cast<const char *>(m_data + start), end - start);
+        Row row;
+        row.endsLine = endsLine;
+        if (text.contains(QLatin1Char('\t'))) {
+            // the tab stops are counted in columns, the same way rowEnd() wrapped the row
+            row.text.reserve(text.size() + kTabWidth);
+            int column = 0;
+            for (int i = 0; i < text.size(); ++i) {
+                char32_t character = text.at(i).unicode();
+                if (text.at(i).isHighSurrogate() && i + 1 < text.size() && text.at(i + 1).isLowSurrogate()) {
+                    character = QChar::surrogateToUcs4(text.at(i), text.at(i + 1));
+                    row.text.append(text.at(i++));
+                    row.text.append(text.at(i));
+                } else if (character == U'\t') {
+                    row.text.append(QString(characterColumns(character, column), QLatin1Char(' ')));
+                } else {
+                    row.text.append(text.at(i));
+                }
+                column += characterColumns(character, column);
+            }
+        } else {
+            row.text = text;
+        }
+        rows.append(row);
+
+        start = next;
+    }
+
+    return rows;
+}
+
+const uchar *MappedDocument::data() const
+{
+    return m_data;
+}
+
+qint64 MappedDocument::size() const
+{
+    return m_size;
+}
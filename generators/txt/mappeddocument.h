@@ -0,0 +1,99 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _TXT_MAPPEDDOCUMENT_H_
+#define _TXT_MAPPEDDOCUMENT_H_
+
+#include <QFile>
+#include <QList>
+#include <QString>
+
+#include <vector>
+
+namespace Txt
+{
+/**
+ * A plain text file too big to be loaded in a QTextDocument.
+ *
+ * The file is memory mapped and split in rows, a row being a line of the
+ * file or, for lines longer than a page is wide, a piece of it. The rows
+ * are measured in columns of a fixed pitch font, after expanding the tabs. Only the
+ * offset where each page starts is kept, the rows of a page are found and
+ * decoded from the mapped bytes when the page is asked for.
+ *
+ * Only UTF-8 (and so ASCII) files can be mapped, since the rows are found
+ * by looking for line feed bytes.
+ */
+class MappedDocument
+{
+public:
+    struct Row {
+        QString text;
+        bool endsLine; ///< false if the line goes on in the next row
+    };
+
+    MappedDocument();
+    ~MappedDocument();
+
+    MappedDocument(const MappedDocument &) = delete;
+    MappedDocument &operator=(const MappedDocument &) = delete;
+
+    /**
+     * Returns whether @p fileName is big enough to be worth mapping
+     * and in an encoding that can be mapped.
+     */
+    static bool shouldMap(const QString &fileName);
+
+    bool open(const QString &fileName);
+
+    /**
+     * Splits the document in pages of @p rowsPerPage rows of at most
+     * @p columnsPerRow columns. The file is scanned by several threads,
+     * only the lines that may be longer than a row are decoded.
+     */
+    void paginate(int rowsPerPage, int columnsPerRow);
+
+    int pageCount() const;
+
+    /**
+     * Returns the decoded rows of @p page, with the tabs expanded to spaces.
+     *
+     * Can be called from several threads at the same time.
+     */
+    QList<Row> pageRows(int page) const;
+
+    /**
+     * The bytes of the file, as they are on disk.
+     */
+    const uchar *data() const;
+    qint64 size() const;
+
+    /**
+     * Returns the number of columns @p character takes when it starts at @p column.
+     */
+    static int characterColumns(char32_t character, int column);
+
+private:
+    qint64 rowEnd(qint64 start, qint64 *next) const;
+    qint64 lineEnd(qint64 start) const;
+    qint64 firstLineStartAfter(qint64 offset) const;
+    // whether the line [start, end) fits in a row without being decoded
+    bool fitsInRow(qint64 start, qint64 end) const;
+    template<typename F> void forEachLine(qint64 begin, qint64 end, F f) const;
+
+    QFile m_file;
+    const uchar *m_data;
+    qint64 m_size;
+    qint64 m_textStart;
+    int m_rowsPerPage;
+    int m_columnsPerRow;
+    // where each page starts, followed by the end of the file
+    std::vector<qint64> m_pageStarts;
+};
+
+}
+
+#endif
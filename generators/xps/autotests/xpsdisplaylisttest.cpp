@@ -0,0 +1,88 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QPainter>
+#include <QTest>
+
+#include "../generator_xps.h"
+
+class XpsDisplayListTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testTextureCost();
+    void testReplay();
+};
+
+static QPainterPath square(qreal x, qreal y, qreal size)
+{
+    QPainterPath path;
+    path.addRect(x, y, size, size);
+    return path;
+}
+
+// A texture painted by several figures is counted once, another texture adds its own size
+void XpsDisplayListTest::testTextureCost()
+{
+    QImage texture(64, 64, QImage::Format_ARGB32);
+    texture.fill(Qt::red);
+    const QBrush brush(texture);
+
+    XpsDisplayList list;
+    const qint64 emptyCost = list.cost();
+    list.setBrush(brush);
+    list.drawPath(square(0, 0, 10));
+    const qint64 oneFigureCost = list.cost();
+    QVERIFY(oneFigureCost - emptyCost >= texture.sizeInBytes());
+
+    for (int i = 1; i < 10; ++i) {
+        list.setBrush(brush);
+        list.drawPath(square(i * 10, 0, 10));
+    }
+    QVERIFY(list.cost() - emptyCost < 2 * texture.sizeInBytes());
+
+    QImage otherTexture(32, 32, QImage::Format_ARGB32);
+    otherTexture.fill(Qt::blue);
+    const qint64 costBefore = list.cost();
+    list.setBrush(QBrush(otherTexture));
+    QVERIFY(list.cost() - costBefore >= otherTexture.sizeInBytes());
+}
+
+// The recorded operations paint the same as the painter calls they mirror, at any size
+void XpsDisplayListTest::testReplay()
+{
+    QImage texture(4, 4, QImage::Format_ARGB32);
+    texture.fill(Qt::blue);
+
+    XpsDisplayList list;
+    list.save();
+    list.setBrush(QBrush(Qt::red));
+    list.drawPath(square(0, 0, 10));
+    list.restore();
+    list.save();
+    list.setWorldTransform(QTransform::fromTranslate(10, 10));
+    list.setBrush(QBrush(texture));
+    list.drawPath(square(0, 0, 10));
+    list.restore();
+
+    for (int scale : {1, 3}) {
+        QImage image(20 * scale, 20 * scale, QImage::Format_ARGB32);
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        painter.setPen(Qt::NoPen);
+        painter.setWorldTransform(QTransform::fromScale(scale, scale));
+        list.replay(&painter);
+        painter.end();
+
+        QCOMPARE(image.pixel(5 * scale, 5 * scale), qRgb(255, 0, 0));
+        QCOMPARE(image.pixel(15 * scale, 15 * scale), qRgb(0, 0, 255));
+        QCOMPARE(image.pixel(15 * scale, 5 * scale), qRgb(255, 255, 255));
+    }
+}
+
+QTEST_MAIN(XpsDisplayListTest)
+#include "xpsdisplaylisttest.moc"
@@ -11,6 +11,7 @@
 #include <QBuffer>
 #include <QDateTime>
 #include <QFile>
+#include <QFontMetricsF>
 #include <QImageReader>
 #include <QList>
 #include <QMutex>
@@ -29,6 +30,9 @@ Q_DECLARE_METATYPE(QGradient *)
 Q_DECLARE_METATYPE(XpsPathFigure *)
 Q_DECLARE_METATYPE(XpsPathGeometry *)
 
+// how much memory the display lists of the recently used pages can take
+static const qint64 kDisplayListsCacheSize = 64 * 1024 * 1024;
+
 // From Qt4
 static int hex2int(char hex)
 {
@@ -686,7 +690,7 @@ static QString unicodeString(const QString &raw)
     return ret;
 }
 
-void XpsPage::processGlyph(QPainter *painter, const XpsRenderNode &node)
+void XpsPage::processGlyph(XpsDisplayList *list, const XpsRenderNode &node)
 {
     // TODO Currently ignored attributes: CaretStops, DeviceFontName, IsSideways, OpacityMask, Name, FixedPage.NavigateURI, xml:lang, x:key
     // TODO Indices is only partially implemented
@@ -695,19 +699,17 @@ void XpsPage::processGlyph(QPainter *painter, const XpsRenderNode &node)
 
     QString att;
 
-    painter->save();
-
     // Get font (doesn't work well because qt doesn't allow to load font from file)
-    // This works despite the fact that font size isn't specified in points as required by qt. It's because I set point size to be equal to drawing unit.
+    // The size is given in drawing units, so it is used as the pixel size of the font.
     float fontSize = node.attributes.value(QStringLiteral("FontRenderingEmSize")).toFloat();
     // qCWarning(OkularXpsDebug) << "Font Rendering EmSize:" << fontSize;
     // a value of 0.0 means the text is not visible (see XPS specs, chapter 12, "Glyphs")
     if (fontSize < 0.1) {
-        painter->restore();
         return;
     }
     const QString absoluteFileName = absolutePath(entryPath(fileName()), node.attributes.value(QStringLiteral("FontUri")).toString());
     QFont font = m_file->getFontByName(absoluteFileName, fontSize);
+    font.setPixelSize(qMax(1, qRound(fontSize)));
     att = node.attributes.value(QStringLiteral("StyleSimulations")).toString();
     if (!att.isEmpty()) {
         if (att == QLatin1String("ItalicSimulation")) {
@@ -719,10 +721,67 @@ void XpsPage::processGlyph(QPainter *painter, const XpsRenderNode &node)
             font.setBold(true);
         }
     }
-    painter->setFont(font);
+
+    XpsGlyphRun run;
+    run.font = font;
 
     // Origin
-    QPointF origin(node.attributes.value(QStringLiteral("OriginX")).toDouble(), node.attributes.value(QStringLiteral("OriginY")).toDouble());
+    run.origin = QPointF(node.attributes.value(QStringLiteral("OriginX")).toDouble(), node.attributes.value(QStringLiteral("OriginY")).toDouble());
+
+    // RenderTransform
+    QTransform renderTransform;
+    att = node.attributes.value(QStringLiteral("RenderTransform")).toString();
+    if (!att.isEmpty()) {
+        renderTransform = parseRscRefMatrix(att);
+    }
+    run.transform = renderTransform * list->worldTransform();
+
+    // Indices - partial handling only
+    att = node.attributes.value(QStringLiteral("Indices")).toString();
+    QList<qreal> advanceWidths;
+    if (!att.isEmpty()) {
+        const QStringList indicesElements = att.split(QLatin1Char(';'));
+        for (const QString &indicesElement : indicesElements) {
+            if (indicesElements.contains(QStringLiteral(","))) {
+                const QStringList parts = indicesElement.split(QLatin1Char(','));
+                if (parts.size() == 2) {
+                    // regular advance case, no offsets
+                    advanceWidths.append(parts.at(1).toDouble() * fontSize / 100.0);
+                } else if (parts.size() == 3) {
+                    // regular advance case, with uOffset
+                    qreal AdvanceWidth = parts.at(1).toDouble() * fontSize / 100.0;
+                    qreal uOffset = parts.at(2).toDouble() / 100.0;
+                    advanceWidths.append(AdvanceWidth + uOffset);
+                } else {
+                    // has vertical offset, but don't know how to handle that yet
+                    qCWarning(OkularXpsDebug) << "Unhandled Indices element: " << indicesElement;
+                    advanceWidths.append(-1.0);
+                }
+            } else {
+                // no special advance case
+                advanceWidths.append(-1.0);
+            }
+        }
+    }
+
+    // UnicodeString
+    run.text = unicodeString(node.attributes.value(QStringLiteral("UnicodeString")).toString());
+    run.positions.reserve(run.text.size() + 1);
+    qreal originAdvance = 0;
+    const QFontMetricsF metrics(font);
+    for (int i = 0; i < run.text.size(); ++i) {
+        run.positions.append(originAdvance);
+        const qreal advanceWidth = advanceWidths.value(i, qreal(-1.0));
+        if (advanceWidth > 0.0) {
+            originAdvance += advanceWidth;
+        } else {
+            originAdvance += metrics.horizontalAdvance(run.text.at(i));
+        }
+    }
+    run.positions.append(originAdvance);
+    // qCWarning(OkularXpsDebug) << "Glyphs: " << atts.value("Fill") << ", " << atts.value("FontUri");
+    // qCWarning(OkularXpsDebug) << "    Origin: " << atts.value("OriginX") << "," << atts.value("OriginY");
+    // qCWarning(OkularXpsDebug) << "    Unicode: " << atts.value("UnicodeString");
 
     // Fill
     QBrush brush;
@@ -734,36 +793,39 @@ void XpsPage::processGlyph(QPainter *painter, const XpsRenderNode &node)
         } else {
             // no "Fill" attribute and no "Glyphs.Fill" child, so show nothing
             // (see XPS specs, 5.10)
-            painter->restore();
+            list->addGlyphRun(run, false);
             return;
         }
     } else {
         brush = parseRscRefColorForBrush(att);
         if (brush.style() > Qt::NoBrush && brush.style() < Qt::LinearGradientPattern && brush.color().alpha() == 0) {
-            painter->restore();
+            list->addGlyphRun(run, false);
             return;
         }
     }
-    painter->setBrush(brush);
-    painter->setPen(QPen(brush, 0));
 
     // Opacity
+    double opacity = -1;
     att = node.attributes.value(QStringLiteral("Opacity")).toString();
     if (!att.isEmpty()) {
         bool ok = true;
-        double value = att.toDouble(&ok);
-        if (ok && value >= 0.1) {
-            painter->setOpacity(value);
-        } else {
-            painter->restore();
+        opacity = att.toDouble(&ok);
+        if (!ok || opacity < 0.1) {
+            list->addGlyphRun(run, false);
             return;
         }
     }
 
-    // RenderTransform
-    att = node.attributes.value(QStringLiteral("RenderTransform")).toString();
-    if (!att.isEmpty()) {
-        painter->setWorldTransform(parseRscRefMatrix(att), true);
+    list->save();
+
+    list->setFont(font);
+    list->setBrush(brush);
+    list->setPen(QPen(brush, 0));
+    if (opacity >= 0) {
+        list->setOpacity(opacity);
+    }
+    if (!renderTransform.isIdentity()) {
+        list->setWorldTransform(renderTransform);
     }
 
     // Clip
@@ -771,67 +833,24 @@ void XpsPage::processGlyph(QPainter *painter, const XpsRenderNode &node)
     if (!att.isEmpty()) {
         QPainterPath clipPath = parseRscRefPath(att);
         if (!clipPath.isEmpty()) {
-            painter->setClipPath(clipPath);
+            list->setClipPath(clipPath);
         }
     }
 
     // BiDiLevel - default Left-to-Right
-    painter->setLayoutDirection(Qt::LeftToRight);
+    Qt::LayoutDirection direction = Qt::LeftToRight;
     att = node.attributes.value(QStringLiteral("BiDiLevel")).toString();
     if (!att.isEmpty()) {
         if ((att.toInt() % 2) == 1) {
             // odd BiDiLevel, so Right-to-Left
-            painter->setLayoutDirection(Qt::RightToLeft);
+            direction = Qt::RightToLeft;
         }
     }
+    list->setLayoutDirection(direction);
 
-    // Indices - partial handling only
-    att = node.attributes.value(QStringLiteral("Indices")).toString();
-    QList<qreal> advanceWidths;
-    if (!att.isEmpty()) {
-        const QStringList indicesElements = att.split(QLatin1Char(';'));
-        for (const QString &indicesElement : indicesElements) {
-            if (indicesElements.contains(QStringLiteral(","))) {
-                const QStringList parts = indicesElement.split(QLatin1Char(','));
-                if (parts.size() == 2) {
-                    // regular advance case, no offsets
-                    advanceWidths.append(parts.at(1).toDouble() * fontSize / 100.0);
-                } else if (parts.size() == 3) {
-                    // regular advance case, with uOffset
-                    qreal AdvanceWidth = parts.at(1).toDouble() * fontSize / 100.0;
-                    qreal uOffset = parts.at(2).toDouble() / 100.0;
-                    advanceWidths.append(AdvanceWidth + uOffset);
-                } else {
-                    // has vertical offset, but don't know how to handle that yet
-                    qCWarning(OkularXpsDebug) << "Unhandled Indices element: " << indicesElement;
-                    advanceWidths.append(-1.0);
-                }
-            } else {
-                // no special advance case
-                advanceWidths.append(-1.0);
-            }
-        }
-    }
+    list->addGlyphRun(run, true);
 
-    // UnicodeString
-    QString stringToDraw(unicodeString(node.attributes.value(QStringLiteral("UnicodeString")).toString()));
-    QPointF originAdvance(0, 0);
-    QFontMetrics metrics = painter->fontMetrics();
-    for (int i = 0; i < stringToDraw.size(); ++i) {
-        QChar thisChar = stringToDraw.at(i);
-        painter->drawText(origin + originAdvance, QString(thisChar));
-        const qreal advanceWidth = advanceWidths.value(i, qreal(-1.0));
-        if (advanceWidth > 0.0) {
-            originAdvance.rx() += advanceWidth;
-        } else {
-            originAdvance.rx() += metrics.horizontalAdvance(thisChar);
-        }
-    }
-    // qCWarning(OkularXpsDebug) << "Glyphs: " << atts.value("Fill") << ", " << atts.value("FontUri");
-    // qCWarning(OkularXpsDebug) << "    Origin: " << atts.value("OriginX") << "," << atts.value("OriginY");
-    // qCWarning(OkularXpsDebug) << "    Unicode: " << atts.value("UnicodeString");
-
-    painter->restore();
+    list->restore();
 }
 
 void XpsPage::processFill(XpsRenderNode &node)
@@ -893,12 +912,12 @@ void XpsPage::processImageBrush(XpsRenderNode &node)
     node.data = QVariant::fromValue(brush);
 }
 
-void XpsPage::processPath(QPainter *painter, const XpsRenderNode &node)
+void XpsPage::processPath(XpsDisplayList *list, const XpsRenderNode &node)
 {
     // TODO Ignored attributes: Clip, OpacityMask, StrokeEndLineCap, StorkeStartLineCap, Name, FixedPage.NavigateURI, xml:lang, x:key, AutomationProperties.Name, AutomationProperties.HelpText, SnapsToDevicePixels
     // TODO Ignored child elements: RenderTransform, Clip, OpacityMask
     // Handled separately: RenderTransform
-    painter->save();
+    list->save();
 
     QString att;
     QVariant data;
@@ -914,7 +933,7 @@ void XpsPage::processPath(QPainter *painter, const XpsRenderNode &node)
     }
     if (!pathdata) {
         // nothing to draw
-        painter->restore();
+        list->restore();
         return;
     }
 
@@ -929,7 +948,7 @@ void XpsPage::processPath(QPainter *painter, const XpsRenderNode &node)
             brush = data.value<QBrush>();
         }
     }
-    painter->setBrush(brush);
+    list->setBrush(brush);
 
     // Stroke (pen)
     att = node.attributes.value(QStringLiteral("Stroke")).toString();
@@ -1010,31 +1029,31 @@ void XpsPage::processPath(QPainter *painter, const XpsRenderNode &node)
             pen.setMiterLimit(limit / 2);
         }
     }
-    painter->setPen(pen);
+    list->setPen(pen);
 
     // Opacity
     att = node.attributes.value(QStringLiteral("Opacity")).toString();
     if (!att.isEmpty()) {
-        painter->setOpacity(att.toDouble());
+        list->setOpacity(att.toDouble());
     }
 
     // RenderTransform
     att = node.attributes.value(QStringLiteral("RenderTransform")).toString();
     if (!att.isEmpty()) {
-        painter->setWorldTransform(parseRscRefMatrix(att), true);
+        list->setWorldTransform(parseRscRefMatrix(att));
     }
     if (!pathdata->transform.isIdentity()) {
-        painter->setWorldTransform(pathdata->transform, true);
+        list->setWorldTransform(pathdata->transform);
     }
 
     for (const XpsPathFigure *figure : std::as_const(pathdata->paths)) {
-        painter->setBrush(figure->isFilled ? brush : QBrush());
-        painter->drawPath(figure->path);
+        list->setBrush(figure->isFilled ? brush : QBrush());
+        list->drawPath(figure->path);
     }
 
     delete pathdata;
 
-    painter->restore();
+    list->restore();
 }
 
 void XpsPage::processPathData(XpsRenderNode &node)
@@ -1172,44 +1191,49 @@ void XpsPage::processPathFigure(XpsRenderNode &node)
     }
 }
 
-void XpsPage::processStartElement(QPainter *painter, const XpsRenderNode &node)
+void XpsPage::processStartElement(XpsDisplayList *list, const XpsRenderNode &node)
 {
     if (node.name == QLatin1String("Canvas")) {
-        painter->save();
+        list->save();
         QString att = node.attributes.value(QStringLiteral("RenderTransform")).toString();
         if (!att.isEmpty()) {
-            painter->setWorldTransform(parseRscRefMatrix(att), true);
+            list->setWorldTransform(parseRscRefMatrix(att));
         }
         att = node.attributes.value(QStringLiteral("Opacity")).toString();
         if (!att.isEmpty()) {
             double value = att.toDouble();
             if (value > 0.0 && value <= 1.0) {
-                painter->setOpacity(painter->opacity() * value);
+                list->setOpacity(list->opacity() * value);
             } else {
                 // setting manually to 0 is necessary to "disable"
                 // all the stuff inside
-                painter->setOpacity(0.0);
+                list->setOpacity(0.0);
             }
         }
+    } else if ((node.name == QLatin1String("Glyphs")) || (node.name == QLatin1String("Path"))) {
+        // keep a Glyphs.RenderTransform or Path.RenderTransform child from affecting the next elements
+        list->save();
     }
 }
 
-void XpsPage::processEndElement(QPainter *painter, XpsRenderNode &node)
+void XpsPage::processEndElement(XpsDisplayList *list, XpsRenderNode &node)
 {
     if (node.name == QLatin1String("Glyphs")) {
-        processGlyph(painter, node);
+        processGlyph(list, node);
+        list->restore();
     } else if (node.name == QLatin1String("Path")) {
-        processPath(painter, node);
+        processPath(list, node);
+        list->restore();
     } else if (node.name == QLatin1String("MatrixTransform")) {
         // TODO Ignoring x:key
         node.data = QVariant::fromValue(QTransform(attsToMatrix(node.attributes.value(QStringLiteral("Matrix")).toString())));
     } else if ((node.name == QLatin1String("Canvas.RenderTransform")) || (node.name == QLatin1String("Glyphs.RenderTransform")) || (node.name == QLatin1String("Path.RenderTransform"))) {
         QVariant data = node.getRequiredChildData(QStringLiteral("MatrixTransform"));
         if (data.canConvert<QTransform>()) {
-            painter->setWorldTransform(data.value<QTransform>(), true);
+            list->setWorldTransform(data.value<QTransform>());
         }
     } else if (node.name == QLatin1String("Canvas")) {
-        painter->restore();
+        list->restore();
     } else if ((node.name == QLatin1String("Path.Fill")) || (node.name == QLatin1String("Glyphs.Fill"))) {
         processFill(node);
     } else if (node.name == QLatin1String("Path.Stroke")) {
@@ -1286,13 +1310,161 @@ void XpsPage::processEndElement(QPainter *painter, XpsRenderNode &node)
     }
 }
 
+XpsDisplayList::XpsDisplayList()
+    : m_cost(0)
+{
+    m_state.opacity = 1.0;
+}
+
+void XpsDisplayList::addOperation(OperationType type, int argument)
+{
+    m_operations.append({type, argument});
+    m_cost += sizeof(Operation);
+}
+
+void XpsDisplayList::save()
+{
+    m_savedStates.push(m_state);
+    addOperation(Save);
+}
+
+void XpsDisplayList::restore()
+{
+    if (m_savedStates.isEmpty()) {
+        qCWarning(OkularXpsDebug) << "Unbalanced restore in display list";
+        return;
+    }
+    m_state = m_savedStates.pop();
+    addOperation(Restore);
+}
+
+void XpsDisplayList::setWorldTransform(const QTransform &matrix)
+{
+    m_state.transform = matrix * m_state.transform;
+    m_transforms.append(matrix);
+    addOperation(Transform, m_transforms.count() - 1);
+}
+
+QTransform XpsDisplayList::worldTransform() const
+{
+    return m_state.transform;
+}
+
+qreal XpsDisplayList::opacity() const
+{
+    return m_state.opacity;
+}
+
+void XpsDisplayList::setOpacity(qreal opacity)
+{
+    m_state.opacity = opacity;
+    m_opacities.append(opacity);
+    addOperation(Opacity, m_opacities.count() - 1);
+}
+
+void XpsDisplayList::setClipPath(const QPainterPath &path)
+{
+    m_paths.append(path);
+    m_cost += path.elementCount() * sizeof(QPainterPath::Element);
+    addOperation(ClipPath, m_paths.count() - 1);
+}
+
+void XpsDisplayList::setLayoutDirection(Qt::LayoutDirection direction)
+{
+    addOperation(LayoutDirection, direction);
+}
+
+void XpsDisplayList::setFont(const QFont &font)
+{
+    m_fonts.append(font);
+    addOperation(Font, m_fonts.count() - 1);
+}
+
+void XpsDisplayList::setBrush(const QBrush &brush)
+{
+    m_brushes.append(brush);
+    if (brush.style() == Qt::TexturePattern) {
+        // the brushes of a texture share its image, it is in memory once
+        const QImage texture = brush.textureImage();
+        if (!m_textureKeys.contains(texture.cacheKey())) {
+            m_textureKeys.insert(texture.cacheKey());
+            m_cost += texture.sizeInBytes();
+        }
+    }
+    addOperation(Brush, m_brushes.count() - 1);
+}
+
+void XpsDisplayList::setPen(const QPen &pen)
+{
+    m_pens.append(pen);
+    addOperation(Pen, m_pens.count() - 1);
+}
+
+void XpsDisplayList::drawPath(const QPainterPath &path)
+{
+    m_paths.append(path);
+    m_cost += path.elementCount() * sizeof(QPainterPath::Element);
+    addOperation(DrawPath, m_paths.count() - 1);
+}
+
+void XpsDisplayList::addGlyphRun(const XpsGlyphRun &run, bool visible)
+{
+    m_glyphRuns.append(run);
+    m_cost += run.text.size() * sizeof(QChar) + run.positions.size() * sizeof(qreal);
+    if (visible) {
+        addOperation(DrawGlyphRun, m_glyphRuns.count() - 1);
+    }
+}
+
+void XpsDisplayList::replay(QPainter *painter) const
+{
+    for (const Operation &operation : m_operations) {
+        switch (operation.type) {
+        case Save:
+            painter->save();
+            break;
+        case Restore:
+            painter->restore();
+            break;
+        case Transform:
+            painter->setWorldTransform(m_transforms.at(operation.argument), true);
+            break;
+        case Opacity:
+            painter->setOpacity(m_opacities.at(operation.argument));
+            break;
+        case ClipPath:
+            painter->setClipPath(m_paths.at(operation.argument));
+            break;
+        case LayoutDirection:
+            painter->setLayoutDirection(static_cast<Qt::LayoutDirection>(operation.argument));
+            break;
+        case Font:
+            painter->setFont(m_fonts.at(operation.argument));
+            break;
+        case Brush:
+            painter->setBrush(m_brushes.at(operation.argument));
+            break;
+        case Pen:
+            painter->setPen(m_pens.at(operation.argument));
+            break;
+        case DrawPath:
+            painter->drawPath(m_paths.at(operation.argument));
+            break;
+        case DrawGlyphRun: {
+            const XpsGlyphRun &run = m_glyphRuns.at(operation.argument);
+            for (int i = 0; i < run.text.size(); ++i) {
+                painter->drawText(run.origin + QPointF(run.positions.at(i), 0), QString(run.text.at(i)));
+            }
+            break;
+        }
+        }
+    }
+}
+
 XpsPage::XpsPage(XpsFile *file, const QString &fileName)
     : m_file(file)
     , m_fileName(fileName)
-    , m_pageIsRendered(false)
 {
-    m_pageImage = nullptr;
-
     // qCWarning(OkularXpsDebug) << "page file name: " << fileName;
 
     const KZipFileEntry *pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry(fileName));
@@ -1315,42 +1487,60 @@ XpsPage::XpsPage(XpsFile *file, const QString &fileName)
 
 XpsPage::~XpsPage()
 {
-    delete m_pageImage;
 }
 
-bool XpsPage::renderToImage(QImage *p)
+QImage XpsPage::renderToImage(const QSize &size, const QRect &rect)
 {
-    if ((m_pageImage == nullptr) || (m_pageImage->size() != p->size())) {
-        delete m_pageImage;
-        m_pageImage = new QImage(p->size(), QImage::Format_ARGB32);
-        // Set one point = one drawing unit. Useful for fonts, because xps specifies font size using drawing units, not points as usual
-        m_pageImage->setDotsPerMeterX(2835);
-        m_pageImage->setDotsPerMeterY(2835);
+    QImage image(rect.size(), QImage::Format_ARGB32);
+    image.fill(qRgba(255, 255, 255, 255));
 
-        m_pageIsRendered = false;
-    }
-    if (!m_pageIsRendered) {
-        m_pageImage->fill(qRgba(255, 255, 255, 255));
-        QPainter painter(m_pageImage);
-        renderToPainter(&painter);
-        m_pageIsRendered = true;
-    }
+    QPainter painter(&image);
+    painter.translate(-rect.topLeft());
+    painter.scale((qreal)size.width() / m_pageSize.width(), (qreal)size.height() / m_pageSize.height());
+    displayList()->replay(&painter);
 
-    *p = *m_pageImage;
-
-    return true;
+    return image;
 }
 
 bool XpsPage::renderToPainter(QPainter *painter)
 {
     painter->setWorldTransform(QTransform().scale((qreal)painter->device()->width() / size().width(), (qreal)painter->device()->height() / size().height()));
+    displayList()->replay(painter);
+
+    return true;
+}
+
+const XpsDisplayList *XpsPage::displayList()
+{
+    if (!m_displayList) {
+        m_displayList = compileDisplayList();
+    }
+    m_file->displayListUsed(this);
+
+    return m_displayList.get();
+}
+
+void XpsPage::releaseDisplayList()
+{
+    m_displayList.reset();
+}
+
+qint64 XpsPage::displayListCost() const
+{
+    return m_displayList ? m_displayList->cost() : 0;
+}
+
+std::unique_ptr<XpsDisplayList> XpsPage::compileDisplayList()
+{
+    auto list = std::make_unique<XpsDisplayList>();
+
     const KZipFileEntry *pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry(m_fileName));
     QByteArray data = readFileOrDirectoryParts(pageFile);
     QXmlStreamReader reader(data);
 
     while (!reader.atEnd()) {
         reader.readNext();
-        // parse data and paint it to painter
+        // parse data and record how to paint it
         if (reader.isStartDocument()) {
             XpsRenderNode node;
             node.name = QStringLiteral("document");
@@ -1359,14 +1549,14 @@ bool XpsPage::renderToPainter(QPainter *painter)
             XpsRenderNode node;
             node.name = reader.name().toString();
             node.attributes = reader.attributes();
-            processStartElement(painter, node);
+            processStartElement(list.get(), node);
             m_nodes.push(node);
         } else if (reader.isEndElement()) {
             XpsRenderNode node = m_nodes.pop();
             if (node.name != reader.name().toString()) {
                 qCWarning(OkularXpsDebug) << "Name doesn't match" << node.name << " and next from document: " << reader.name().toString();
             }
-            processEndElement(painter, node);
+            processEndElement(list.get(), node);
             node.children.clear();
             m_nodes.top().children.append(node);
         }
@@ -1377,8 +1567,9 @@ bool XpsPage::renderToPainter(QPainter *painter)
         // Error handling
     }
     qCWarning(OkularXpsDebug) << "Parse result: " << ok;
+    m_nodes.clear();
 
-    return true;
+    return list;
 }
 
 QSizeF XpsPage::size() const
@@ -1461,6 +1652,24 @@ KZip *XpsFile::xpsArchive()
     return m_xpsArchive.get();
 }
 
+void XpsFile::displayListUsed(XpsPage *page)
+{
+    m_displayListPages.removeOne(page);
+    m_displayListPages.prepend(page);
+
+    qint64 totalCost = 0;
+    for (XpsPage *listPage : std::as_const(m_displayListPages)) {
+        totalCost += listPage->displayListCost();
+    }
+
+    // the display list of page is never released here, it is about to be used
+    while (totalCost > kDisplayListsCacheSize && m_displayListPages.count() > 1) {
+        XpsPage *leastRecentlyUsed = m_displayListPages.takeLast();
+        totalCost -= leastRecentlyUsed->displayListCost();
+        leastRecentlyUsed->releaseDisplayList();
+    }
+}
+
 QImage XpsPage::loadImageFromFile(const QString &fileName)
 {
     // qCWarning(OkularXpsDebug) << "image file name: " << fileName;
@@ -1514,92 +1723,18 @@ Okular::TextPage *XpsPage::textPage()
 
     Okular::TextPage *textPage = new Okular::TextPage();
 
-    const KZipFileEntry *pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry(m_fileName));
-    QXmlStreamReader xml;
-    xml.addData(readFileOrDirectoryParts(pageFile));
-
-    QTransform matrix = QTransform();
-    QStack<QTransform> matrices;
-    matrices.push(QTransform());
-    bool useMatrix = false;
-    QXmlStreamAttributes glyphsAtts;
-
-    while (!xml.atEnd()) {
-        xml.readNext();
-        if (xml.isStartElement()) {
-            if (xml.name() == QStringLiteral("Canvas")) {
-                matrices.push(matrix);
+    const QVector<XpsGlyphRun> &glyphRuns = displayList()->glyphRuns();
+    for (const XpsGlyphRun &run : glyphRuns) {
+        const QFontMetricsF metrics(run.font);
+        const qreal top = run.origin.y() - metrics.ascent();
+        const qreal bottom = run.origin.y() + metrics.descent();
 
-                QString att = xml.attributes().value(QStringLiteral("RenderTransform")).toString();
-                if (!att.isEmpty()) {
-                    matrix = parseRscRefMatrix(att) * matrix;
-                }
-            } else if ((xml.name() == QStringLiteral("Canvas.RenderTransform")) || (xml.name() == QStringLiteral("Glyphs.RenderTransform"))) {
-                useMatrix = true;
-            } else if (xml.name() == QStringLiteral("MatrixTransform")) {
-                if (useMatrix) {
-                    matrix = attsToMatrix(xml.attributes().value(QStringLiteral("Matrix")).toString()) * matrix;
-                }
-            } else if (xml.name() == QStringLiteral("Glyphs")) {
-                matrices.push(matrix);
-                glyphsAtts = xml.attributes();
-            } else if ((xml.name() == QStringLiteral("Path")) || (xml.name() == QStringLiteral("Path.Fill")) || (xml.name() == QStringLiteral("SolidColorBrush")) || (xml.name() == QStringLiteral("ImageBrush")) ||
-                       (xml.name() == QStringLiteral("ImageBrush.Transform")) || (xml.name() == QStringLiteral("Path.OpacityMask")) || (xml.name() == QStringLiteral("Path.Data")) || (xml.name() == QStringLiteral("PathGeometry")) ||
-                       (xml.name() == QStringLiteral("PathFigure")) || (xml.name() == QStringLiteral("PolyLineSegment"))) {
-                // those are only graphical - no use in text handling
-            } else if ((xml.name() == QStringLiteral("FixedPage")) || (xml.name() == QStringLiteral("FixedPage.Resources"))) {
-                // not useful for text extraction
-            } else {
-                qCWarning(OkularXpsDebug) << "Unhandled element in Text Extraction start: " << xml.name().toString();
-            }
-        } else if (xml.isEndElement()) {
-            if (xml.name() == QStringLiteral("Canvas")) {
-                matrix = matrices.pop();
-            } else if ((xml.name() == QStringLiteral("Canvas.RenderTransform")) || (xml.name() == QStringLiteral("Glyphs.RenderTransform"))) {
-                useMatrix = false;
-            } else if (xml.name() == QStringLiteral("MatrixTransform")) {
-                // not clear if we need to do anything here yet.
-            } else if (xml.name() == QStringLiteral("Glyphs")) {
-                QString att = glyphsAtts.value(QStringLiteral("RenderTransform")).toString();
-                if (!att.isEmpty()) {
-                    matrix = parseRscRefMatrix(att) * matrix;
-                }
-                QString text = unicodeString(glyphsAtts.value(QStringLiteral("UnicodeString")).toString());
-
-                // Get font (doesn't work well because qt doesn't allow to load font from file)
-                const QString absoluteFileName = absolutePath(entryPath(m_fileName), glyphsAtts.value(QStringLiteral("FontUri")).toString());
-                QFont font = m_file->getFontByName(absoluteFileName, glyphsAtts.value(QStringLiteral("FontRenderingEmSize")).toString().toFloat() * 72 / 96);
-                QFontMetrics metrics = QFontMetrics(font);
-                // Origin
-                QPointF origin(glyphsAtts.value(QStringLiteral("OriginX")).toString().toDouble(), glyphsAtts.value(QStringLiteral("OriginY")).toString().toDouble());
-
-                int lastWidth = 0;
-                for (int i = 0; i < text.length(); i++) {
-                    const int width = metrics.horizontalAdvance(text, i + 1);
-
-                    Okular::NormalizedRect rect =
-                        Okular::NormalizedRect((origin.x() + lastWidth) / m_pageSize.width(), (origin.y() - metrics.height()) / m_pageSize.height(), (origin.x() + width) / m_pageSize.width(), origin.y() / m_pageSize.height());
-                    rect.transform(matrix);
-                    textPage->append(text.mid(i, 1), rect);
-
-                    lastWidth = width;
-                }
-
-                matrix = matrices.pop();
-            } else if ((xml.name() == QStringLiteral("Path")) || (xml.name() == QStringLiteral("Path.Fill")) || (xml.name() == QStringLiteral("SolidColorBrush")) || (xml.name() == QStringLiteral("ImageBrush")) ||
-                       (xml.name() == QStringLiteral("ImageBrush.Transform")) || (xml.name() == QStringLiteral("Path.OpacityMask")) || (xml.name() == QStringLiteral("Path.Data")) || (xml.name() == QStringLiteral("PathGeometry")) ||
-                       (xml.name() == QStringLiteral("PathFigure")) || (xml.name() == QStringLiteral("PolyLineSegment"))) {
-                // those are only graphical - no use in text handling
-            } else if ((xml.name() == QStringLiteral("FixedPage")) || (xml.name() == QStringLiteral("FixedPage.Resources"))) {
-                // not useful for text extraction
-            } else {
-                qCWarning(OkularXpsDebug) << "Unhandled element in Text Extraction end: " << xml.name().toString();
-            }
+        for (int i = 0; i < run.text.length(); i++) {
+            const QRectF rect = run.transform.mapRect(QRectF(QPointF(run.origin.x() + run.positions.at(i), top), QPointF(run.origin.x() + run.positions.at(i + 1), bottom)));
+            textPage->append(run.text.mid(i, 1), Okular::NormalizedRect(rect.left() / m_pageSize.width(), rect.top() / m_pageSize.height(), rect.right() / m_pageSize.width(), rect.bottom() / m_pageSize.height()));
         }
     }
-    if (xml.error()) {
-        qCWarning(OkularXpsDebug) << "Error parsing XpsPage text: " << xml.errorString();
-    }
+
     return textPage;
 }
 
@@ -1928,6 +2063,7 @@ Okular::DocumentInfo XpsFile::generateDocumentInfo() const
 
 bool XpsFile::closeDocument()
 {
+    m_displayListPages.clear();
     m_documents.clear();
 
     return true;
@@ -1961,6 +2097,7 @@ XpsGenerator::XpsGenerator(QObject *parent, const QVariantList &args)
     setFeature(PrintNative);
     setFeature(PrintToFile);
     setFeature(Threaded);
+    setFeature(TiledRendering);
     userMutex();
 }
 
@@ -2005,10 +2142,9 @@ QImage XpsGenerator::image(Okular::PixmapRequest *request)
 {
     QMutexLocker lock(userMutex());
     QSize size((int)request->width(), (int)request->height());
-    QImage image(size, QImage::Format_RGB32);
+    const QRect rect = request->isTile() ? request->normalizedRect().geometry(size.width(), size.height()) : QRect(QPoint(0, 0), size);
     XpsPage *pageToRender = m_xpsFile->page(request->page()->number());
-    pageToRender->renderToImage(&image);
-    return image;
+    return pageToRender->renderToImage(size, rect);
 }
 
 Okular::TextPage *XpsGenerator::textPage(Okular::TextRequest *request)
@@ -2060,6 +2196,8 @@ bool XpsGenerator::exportTo(const QString &fileName, const Okular::ExportFormat
             return false;
         }
 
+        // the display lists are shared with the rendering thread
+        QMutexLocker lock(userMutex());
         QTextStream ts(&f);
         for (int i = 0; i < m_xpsFile->numPages(); ++i) {
             Okular::TextPage *textPage = m_xpsFile->page(i)->textPage();
@@ -2082,6 +2220,7 @@ Okular::Document::PrintError XpsGenerator::print(QPrinter &printer)
 
     QPainter painter(&printer);
 
+    QMutexLocker lock(userMutex());
     for (int i = 0; i < pageList.count(); ++i) {
         if (i != 0) {
             printer.newPage();
@@ -10,17 +10,25 @@
 #include <core/generator.h>
 #include <core/textpage.h>
 
+#include <QBrush>
 #include <QColor>
 #include <QDomDocument>
+#include <QFont>
 #include <QFontDatabase>
 #include <QImage>
 #include <QLoggingCategory>
+#include <QPainterPath>
+#include <QPen>
+#include <QSet>
 #include <QStack>
+#include <QTransform>
 #include <QVariant>
 #include <QXmlStreamReader>
 
 #include <kzip.h>
 
+#include <memory>
+
 typedef enum { abtCommand, abtNumber, abtComma, abtEOF } AbbPathTokenType;
 
 class AbbPathToken
@@ -97,6 +105,101 @@ struct XpsPathGeometry {
     XpsMatrixTransform transform;
 };
 
+/**
+    A run of text of a page, with the position of each of its characters
+*/
+struct XpsGlyphRun {
+    QFont font;
+    QPointF origin;
+    QString text;
+    /// offset from the origin of each character, followed by the end of the run
+    QVector<qreal> positions;
+    /// from the coordinates of the run to the ones of the page
+    QTransform transform;
+};
+
+/**
+    The painter operations that draw a page, recorded once when the page XML
+    is parsed and replayed for every render of the page, at any size.
+
+    The recording methods mirror the QPainter ones used to draw the page.
+    The display list also keeps every run of text of the page, including
+    the ones that are not painted, for text extraction.
+*/
+class XpsDisplayList
+{
+public:
+    XpsDisplayList();
+
+    void save();
+    void restore();
+    /// combines @p matrix with the current transformation
+    void setWorldTransform(const QTransform &matrix);
+    QTransform worldTransform() const;
+    qreal opacity() const;
+    void setOpacity(qreal opacity);
+    void setClipPath(const QPainterPath &path);
+    void setLayoutDirection(Qt::LayoutDirection direction);
+    void setFont(const QFont &font);
+    void setBrush(const QBrush &brush);
+    void setPen(const QPen &pen);
+    void drawPath(const QPainterPath &path);
+    /// adds @p run to the text of the page, painting it unless @p visible is false
+    void addGlyphRun(const XpsGlyphRun &run, bool visible);
+
+    /**
+       paint the recorded operations to @p painter, whose world transform
+       must map the page units to the device
+    */
+    void replay(QPainter *painter) const;
+
+    const QVector<XpsGlyphRun> &glyphRuns() const
+    {
+        return m_glyphRuns;
+    }
+
+    /**
+       approximated amount of memory used by the display list, in bytes
+    */
+    qint64 cost() const
+    {
+        return m_cost;
+    }
+
+private:
+    enum OperationType : quint8 { Save, Restore, Transform, Opacity, ClipPath, LayoutDirection, Font, Brush, Pen, DrawPath, DrawGlyphRun };
+
+    struct Operation {
+        OperationType type;
+        /// index of the argument of the operation in the array for its type
+        int argument;
+    };
+
+    struct State {
+        QTransform transform;
+        qreal opacity;
+    };
+
+    void addOperation(OperationType type, int argument = -1);
+
+    QVector<Operation> m_operations;
+    QVector<QTransform> m_transforms;
+    QVector<qreal> m_opacities;
+    QVector<QPainterPath> m_paths;
+    QVector<QFont> m_fonts;
+    QVector<QBrush> m_brushes;
+    QVector<QPen> m_pens;
+    QVector<XpsGlyphRun> m_glyphRuns;
+    // the images of the texture brushes counted in the cost
+    QSet<qint64> m_textureKeys;
+
+    // the state at the current point of the recording
+    State m_state;
+    QStack<State> m_savedStates;
+
+    qint64 m_cost;
+};
+
 class XpsPage;
 class XpsFile;
 
@@ -110,10 +213,21 @@ public:
     XpsPage &operator=(const XpsPage &) = delete;
 
     QSizeF size() const;
-    bool renderToImage(QImage *p);
+    /**
+       render the part @p rect of the page rendered at @p size
+    */
+    QImage renderToImage(const QSize &size, const QRect &rect);
     bool renderToPainter(QPainter *painter);
     Okular::TextPage *textPage();
 
+    /**
+       the display list of the page, parsed from the page XML if the page
+       was not used recently
+    */
+    const XpsDisplayList *displayList();
+    void releaseDisplayList();
+    qint64 displayListCost() const;
+
     QImage loadImageFromFile(const QString &filename);
     QString fileName() const
     {
@@ -121,11 +235,13 @@ public:
     }
 
 private:
+    std::unique_ptr<XpsDisplayList> compileDisplayList();
+
     // Methods for processing of different xml elements
-    void processStartElement(QPainter *painter, const XpsRenderNode &node);
-    void processEndElement(QPainter *painter, XpsRenderNode &node);
-    void processGlyph(QPainter *painter, const XpsRenderNode &node);
-    void processPath(QPainter *painter, const XpsRenderNode &node);
+    void processStartElement(XpsDisplayList *list, const XpsRenderNode &node);
+    void processEndElement(XpsDisplayList *list, XpsRenderNode &node);
+    void processGlyph(XpsDisplayList *list, const XpsRenderNode &node);
+    void processPath(XpsDisplayList *list, const XpsRenderNode &node);
     void processPathData(XpsRenderNode &node);
     void processFill(XpsRenderNode &node);
     void processStroke(XpsRenderNode &node);
@@ -143,8 +259,7 @@ private:
     bool m_thumbnailMightBeAvailable;
     QImage m_thumbnail;
 
-    QImage *m_pageImage;
-    bool m_pageIsRendered;
+    std::unique_ptr<XpsDisplayList> m_displayList;
 
     friend class XpsHandler;
     friend class XpsTextExtractionHandler;
@@ -252,6 +367,12 @@ public:
 
     KZip *xpsArchive();
 
+    /**
+       mark the display list of @p page as the most recently used one,
+       releasing the least recently used ones when they take too much memory
+    */
+    void displayListUsed(XpsPage *page);
+
 private:
     int loadFontByName(const QString &absoluteFileName);
 
@@ -269,6 +390,9 @@ private:
 
     QMap<QString, int> m_fontCache;
     QFontDatabase m_fontDatabase;
+
+    // the pages that have a display list, the most recently used first
+    QList<XpsPage *> m_displayListPages;
 };
 
 class XpsGenerator : public Okular::Generator
@@ -0,0 +1,151 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_COLORFILTERS_P_H_
+#define _OKULAR_COLORFILTERS_P_H_
+
+#include <QColor>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Per pixel kernels of the Change Colors feature. They work on the 32 bit
+// words of Format_ARGB32_Premultiplied images, which keep the alpha in the
+// highest byte and the blue in the lowest. The vector versions give the same
+// results as the scalar ones, which handle the pixels left over.
+namespace ColorFilters
+{
+inline void invertLightnessPixelsScalar(QRgb *data, int pixels)
+{
+    for (int i = 0; i < pixels; ++i) {
+        // Invert lightness of the pixel using the cylindric HSL color model.
+        // Algorithm is based on https://en.wikipedia.org/wiki/HSL_and_HSV#HSL_to_RGB (2019-03-17).
+        // Important simplifications are that inverting lightness does not change chroma and hue.
+        // This means the sector (of the chroma/hue plane) is not changed,
+        // so we can use a linear calculation after determining the sector using qMin() and qMax().
+        uchar R = qRed(data[i]);
+        uchar G = qGreen(data[i]);
+        uchar B = qBlue(data[i]);
+
+        // Get only the needed HSL components. These are chroma C and the common component m.
+        // Get common component m
+        uchar m = qMin(R, qMin(G, B));
+        // Remove m from color components
+        R -= m;
+        G -= m;
+        B -= m;
+        // Get chroma C
+        uchar C = qMax(R, qMax(G, B));
+
+        // Get common component m' after inverting lightness L.
+        // Hint: Lightness L = m + C / 2; L' = 255 - L = 255 - (m + C / 2) => m' = 255 - C - m
+        uchar m_ = 255 - C - m;
+
+        // Add m' to color compontents
+        R += m_;
+        G += m_;
+        B += m_;
+
+        // Save new color
+        const unsigned A = qAlpha(data[i]);
+        data[i] = qRgba(R, G, B, A);
+    }
+}
+
+inline void invertLightnessPixels(QRgb *data, int pixels)
+{
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i lowByte256 = _mm256_set1_epi32(0xff);
+    const __m256i colorBytes256 = _mm256_set1_epi32(0x00ffffff);
+    for (; i + 8 <= pixels; i += 8) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        const __m256i max = _mm256_and_si256(_mm256_max_epu8(_mm256_max_epu8(v, _mm256_srli_epi32(v, 8)), _mm256_srli_epi32(v, 16)), lowByte256);
+        const __m256i min = _mm256_and_si256(_mm256_min_epu8(_mm256_min_epu8(v, _mm256_srli_epi32(v, 8)), _mm256_srli_epi32(v, 16)), lowByte256);
+        const __m256i d = _mm256_sub_epi8(_mm256_xor_si256(max, lowByte256), min);
+        const __m256i delta = _mm256_and_si256(_mm256_or_si256(d, _mm256_or_si256(_mm256_slli_epi32(d, 8), _mm256_slli_epi32(d, 16))), colorBytes256);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(data + i), _mm256_add_epi8(v, delta));
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i lowByte = _mm_set1_epi32(0xff);
+    const __m128i colorBytes = _mm_set1_epi32(0x00ffffff);
+    for (; i + 4 <= pixels; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        // maximum and minimum of the color components, in the lowest byte of each pixel
+        const __m128i max = _mm_and_si128(_mm_max_epu8(_mm_max_epu8(v, _mm_srli_epi32(v, 8)), _mm_srli_epi32(v, 16)), lowByte);
+        const __m128i min = _mm_and_si128(_mm_min_epu8(_mm_min_epu8(v, _mm_srli_epi32(v, 8)), _mm_srli_epi32(v, 16)), lowByte);
+        // 255 - max - min (modulo 256) in each color byte, 0 in the alpha one
+        const __m128i d = _mm_sub_epi8(_mm_xor_si128(max, lowByte), min);
+        const __m128i delta = _mm_and_si128(_mm_or_si128(d, _mm_or_si128(_mm_slli_epi32(d, 8), _mm_slli_epi32(d, 16))), colorBytes);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), _mm_add_epi8(v, delta));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 16 <= pixels; i += 16) {
+        uint8x16x4_t v = vld4q_u8(reinterpret_cast<const uint8_t *>(data + i));
+        const uint8x16_t max = vmaxq_u8(vmaxq_u8(v.val[0], v.val[1]), v.val[2]);
+        const uint8x16_t min = vminq_u8(vminq_u8(v.val[0], v.val[1]), v.val[2]);
+        const uint8x16_t delta = vsubq_u8(vmvnq_u8(max), min);
+        v.val[0] = vaddq_u8(v.val[0], delta);
+        v.val[1] = vaddq_u8(v.val[1], delta);
+        v.val[2] = vaddq_u8(v.val[2], delta);
+        vst4q_u8(reinterpret_cast<uint8_t *>(data + i), v);
+    }
+#endif
+    invertLightnessPixelsScalar(data + i, pixels - i);
+}
+
+// Moves the blue to the red, the red to the green and the green to the blue (Shift = 16),
+// or the other way around (Shift = 8)
+template<int Shift> inline void rotateColorPixelsScalar(QRgb *data, int pixels)
+{
+    for (int i = 0; i < pixels; ++i) {
+        const QRgb color = data[i] & 0x00ffffff;
+        data[i] = (data[i] & 0xff000000) | (((color << Shift) | (color >> (24 - Shift))) & 0x00ffffff);
+    }
+}
+
+template<int Shift> inline void rotateColorPixels(QRgb *data, int pixels)
+{
+    int i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= pixels; i += 8) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        const __m256i color = _mm256_and_si256(v, _mm256_set1_epi32(0x00ffffff));
+        const __m256i rotated = _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi32(color, Shift), _mm256_srli_epi32(color, 24 - Shift)), _mm256_set1_epi32(0x00ffffff));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(data + i), _mm256_or_si256(_mm256_andnot_si256(_mm256_set1_epi32(0x00ffffff), v), rotated));
+    }
+#endif
+#if defined(__SSE2__)
+    for (; i + 4 <= pixels; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const __m128i color = _mm_and_si128(v, _mm_set1_epi32(0x00ffffff));
+        const __m128i rotated = _mm_and_si128(_mm_or_si128(_mm_slli_epi32(color, Shift), _mm_srli_epi32(color, 24 - Shift)), _mm_set1_epi32(0x00ffffff));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), _mm_or_si128(_mm_andnot_si128(_mm_set1_epi32(0x00ffffff), v), rotated));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 16 <= pixels; i += 16) {
+        const uint8x16x4_t v = vld4q_u8(reinterpret_cast<const uint8_t *>(data + i));
+        uint8x16x4_t rotated = v;
+        // the bytes are blue, green, red, alpha
+        rotated.val[Shift == 16 ? 2 : 1] = v.val[0];
+        rotated.val[Shift == 16 ? 0 : 2] = v.val[1];
+        rotated.val[Shift == 16 ? 1 : 0] = v.val[2];
+        vst4q_u8(reinterpret_cast<uint8_t *>(data + i), rotated);
+    }
+#endif
+    rotateColorPixelsScalar<Shift>(data + i, pixels - i);
+}
+}
+
+#endif
@@ -8,8 +8,11 @@
 
 // qt / kde includes
 #include <QApplication>
+#include <QCache>
 #include <QDebug>
 #include <QIcon>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QPainter>
 #include <QPalette>
 #include <QPixmap>
@@ -21,6 +24,7 @@
 #include <math.h>
 
 // local includes
+#include "colorfilters_p.h"
 #include "core/annotations.h"
 #include "core/observer.h"
 #include "core/page.h"
@@ -33,6 +37,10 @@
 #include "settings_core.h"
 
 Q_GLOBAL_STATIC_WITH_ARGS(QPixmap, busyPixmap, (QIcon::fromTheme(QLatin1String("okular")).pixmap(48)))
+// renders with the Change Colors render mode applied, the cost is in kilobytes
+Q_GLOBAL_STATIC(QCache<QString, QImage>, filteredImageCache)
+// pages are painted from the thumbnails and the mobile page items too, not only from the page view
+Q_GLOBAL_STATIC(QMutex, filteredImageCacheMutex)
 
 #define TEXTANNOTATION_ICONSIZE 24
 
@@ -75,7 +83,7 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
     int dScaledHeight = ceil(scaledHeight * dpr);
     const QRect dLimits(QRectF(limits.x() * dpr, limits.y() * dpr, limits.width() * dpr, limits.height() * dpr).toAlignedRect());
 
-    QColor paperColor = Qt::white;
+    QColor paperColor = PagePainter::paperColor();
     QColor backgroundColor = paperColor;
     if (Okular::SettingsCore::changeColors()) {
         switch (Okular::SettingsCore::renderMode()) {
@@ -86,7 +94,6 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
             backgroundColor = Qt::black;
             break;
         case Okular::SettingsCore::EnumRenderMode::Paper:
-            paperColor = Okular::SettingsCore::paperColor();
             backgroundColor = paperColor;
             break;
         case Okular::SettingsCore::EnumRenderMode::Recolor:
@@ -98,20 +105,16 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
     destPainter->fillRect(limits, backgroundColor);
 
     const bool hasTilesManager = page->hasTilesManager(observer);
-    QPixmap pixmap;
+    QImage pageImage;
 
     if (!hasTilesManager) {
-        /** 1 - RETRIEVE THE 'PAGE+ID' PIXMAP OR A SIMILAR 'PAGE' ONE **/
-        const QPixmap *p = page->_o_nearestPixmap(observer, dScaledWidth, dScaledHeight);
+        /** 1 - RETRIEVE THE 'PAGE+ID' IMAGE OR A SIMILAR 'PAGE' ONE **/
+        pageImage = page->_o_nearestImage(observer, dScaledWidth, dScaledHeight);
 
-        if (p != nullptr) {
-            pixmap = *p;
-        }
-
-        /** 1B - IF NO PIXMAP, DRAW EMPTY PAGE **/
-        double pixmapRescaleRatio = !pixmap.isNull() ? dScaledWidth / (double)pixmap.width() : -1;
-        long pixmapPixels = !pixmap.isNull() ? (long)pixmap.width() * (long)pixmap.height() : 0;
-        if (pixmap.isNull() || pixmapRescaleRatio > 20.0 || pixmapRescaleRatio < 0.25 || (dScaledWidth > pixmap.width() && pixmapPixels > 60000000L)) {
+        /** 1B - IF NO IMAGE, DRAW EMPTY PAGE **/
+        double pixmapRescaleRatio = !pageImage.isNull() ? dScaledWidth / (double)pageImage.width() : -1;
+        long pixmapPixels = !pageImage.isNull() ? (long)pageImage.width() * (long)pageImage.height() : 0;
+        if (pageImage.isNull() || pixmapRescaleRatio > 20.0 || pixmapRescaleRatio < 0.25 || (dScaledWidth > pageImage.width() && pixmapPixels > 60000000L)) {
             // draw something on the blank page: the okular icon or a cross (as a fallback)
             if (!busyPixmap()->isNull()) {
                 busyPixmap->setDevicePixelRatio(dpr);
@@ -253,18 +256,18 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
                 QRect dLimitsInTile = dLimits & dTileRect;
 
                 if (!limitsInTile.isEmpty()) {
-                    QPixmap *tilePixmap = tile.pixmap();
+                    const QImage tileImage = tile.image();
 
-                    if (tilePixmap->width() == dTileRect.width() && tilePixmap->height() == dTileRect.height()) {
-                        destPainter->drawPixmap(limitsInTile, *tilePixmap, dLimitsInTile.translated(-dTileRect.topLeft()));
+                    if (tileImage.width() == dTileRect.width() && tileImage.height() == dTileRect.height()) {
+                        destPainter->drawImage(limitsInTile, tileImage, dLimitsInTile.translated(-dTileRect.topLeft()));
                     } else {
-                        destPainter->drawPixmap(tileRect, *tilePixmap, tilePixmap->rect());
+                        destPainter->drawImage(tileRect, tileImage, tileImage.rect());
                     }
                 }
                 tIt++;
             }
         } else {
-            destPainter->drawPixmap(limits, pixmap.scaled(dScaledWidth, dScaledHeight), dLimitsInPixmap);
+            destPainter->drawImage(limits, pageImage.scaled(dScaledWidth, dScaledHeight), dLimitsInPixmap);
         }
 
         // 4A.2. active painter is the one passed to this method
@@ -275,7 +278,7 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
         // the image over which we are going to draw
         QImage backImage = QImage(dLimits.width(), dLimits.height(), QImage::Format_ARGB32_Premultiplied);
         backImage.setDevicePixelRatio(dpr);
-        backImage.fill(paperColor);
+        backImage.fill(bufferAccessibility ? accessibilityFilteredColor(paperColor) : paperColor);
         QPainter p(&backImage);
 
         if (hasTilesManager) {
@@ -290,58 +293,32 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
                 QRect dLimitsInTile = dLimits & dTileRect;
 
                 if (!limitsInTile.isEmpty()) {
-                    QPixmap *tilePixmap = tile.pixmap();
+                    // 4B.2. modify image following accessibility settings
+                    QImage tileImage = tile.image();
+                    if (bufferAccessibility) {
+                        tileImage = accessibilityFilteredImage(tileImage, tileImage.size(), paperColor);
+                    }
 
-                    if (tilePixmap->width() == dTileRect.width() && tilePixmap->height() == dTileRect.height()) {
-                        p.drawPixmap(limitsInTile.translated(-limits.topLeft()), *tilePixmap, dLimitsInTile.translated(-dTileRect.topLeft()));
+                    if (tileImage.width() == dTileRect.width() && tileImage.height() == dTileRect.height()) {
+                        p.drawImage(limitsInTile.translated(-limits.topLeft()), tileImage, dLimitsInTile.translated(-dTileRect.topLeft()));
                     } else {
-                        double xScale = tilePixmap->width() / (double)dTileRect.width();
-                        double yScale = tilePixmap->height() / (double)dTileRect.height();
+                        double xScale = tileImage.width() / (double)dTileRect.width();
+                        double yScale = tileImage.height() / (double)dTileRect.height();
                         QTransform transform(xScale, 0, 0, yScale, 0, 0);
-                        p.drawPixmap(limitsInTile.translated(-limits.topLeft()), *tilePixmap, transform.mapRect(dLimitsInTile).translated(-transform.mapRect(dTileRect).topLeft()));
+                        p.drawImage(limitsInTile.translated(-limits.topLeft()), tileImage, transform.mapRect(dLimitsInTile).translated(-transform.mapRect(dTileRect).topLeft()));
                     }
                 }
                 ++tIt;
             }
         } else {
-            // 4B.1. draw the page pixmap: normal or scaled
-
-            p.drawPixmap(QRectF(0, 0, limits.width(), limits.height()), pixmap.scaled(dScaledWidth, dScaledHeight), dLimitsInPixmap);
+            // 4B.1. draw the page image: normal or scaled
+            // 4B.2. modify image following accessibility settings
+            const QImage scaledImage = bufferAccessibility ? accessibilityFilteredImage(pageImage, QSize(dScaledWidth, dScaledHeight), paperColor) : pageImage.scaled(dScaledWidth, dScaledHeight);
+            p.drawImage(QRectF(0, 0, limits.width(), limits.height()), scaledImage, dLimitsInPixmap);
         }
 
         p.end();
 
-        // 4B.2. modify pixmap following accessibility settings
-        if (bufferAccessibility) {
-            switch (Okular::SettingsCore::renderMode()) {
-            case Okular::SettingsCore::EnumRenderMode::Inverted:
-                // Invert image pixels using QImage internal function
-                backImage.invertPixels(QImage::InvertRgb);
-                break;
-            case Okular::SettingsCore::EnumRenderMode::Recolor:
-                recolor(&backImage, Okular::Settings::recolorForeground(), Okular::Settings::recolorBackground());
-                break;
-            case Okular::SettingsCore::EnumRenderMode::BlackWhite:
-                blackWhite(&backImage, Okular::Settings::bWContrast(), Okular::Settings::bWThreshold());
-                break;
-            case Okular::SettingsCore::EnumRenderMode::InvertLightness:
-                invertLightness(&backImage);
-                break;
-            case Okular::SettingsCore::EnumRenderMode::InvertLuma:
-                invertLuma(&backImage, 0.2126, 0.7152, 0.0722); // sRGB / Rec. 709 luma coefficients
-                break;
-            case Okular::SettingsCore::EnumRenderMode::InvertLumaSymmetric:
-                invertLuma(&backImage, 0.3333, 0.3334, 0.3333); // Symmetric coefficients, to keep colors saturated.
-                break;
-            case Okular::SettingsCore::EnumRenderMode::HueShiftPositive:
-                hueShiftPositive(&backImage);
-                break;
-            case Okular::SettingsCore::EnumRenderMode::HueShiftNegative:
-                hueShiftNegative(&backImage);
-                break;
-            }
-        }
-
         // 4B.3. highlight rects in page
         if (bufferedHighlights) {
             // draw highlights that are inside the 'limits' paint region
@@ -686,6 +663,140 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
     delete unbufferedAnnotations;
 }
 
+void PagePainter::applyAccessibilityFilter(QImage *image)
+{
+    switch (Okular::SettingsCore::renderMode()) {
+    case Okular::SettingsCore::EnumRenderMode::Inverted:
+        // Invert image pixels using QImage internal function
+        image->invertPixels(QImage::InvertRgb);
+        break;
+    case Okular::SettingsCore::EnumRenderMode::Recolor:
+        recolor(image, Okular::Settings::recolorForeground(), Okular::Settings::recolorBackground());
+        break;
+    case Okular::SettingsCore::EnumRenderMode::BlackWhite:
+        blackWhite(image, Okular::Settings::bWContrast(), Okular::Settings::bWThreshold());
+        break;
+    case Okular::SettingsCore::EnumRenderMode::InvertLightness:
+        invertLightness(image);
+        break;
+    case Okular::SettingsCore::EnumRenderMode::InvertLuma:
+        invertLuma(image, 0.2126, 0.7152, 0.0722); // sRGB / Rec. 709 luma coefficients
+        break;
+    case Okular::SettingsCore::EnumRenderMode::InvertLumaSymmetric:
+        invertLuma(image, 0.3333, 0.3334, 0.3333); // Symmetric coefficients, to keep colors saturated.
+        break;
+    case Okular::SettingsCore::EnumRenderMode::HueShiftPositive:
+        hueShiftPositive(image);
+        break;
+    case Okular::SettingsCore::EnumRenderMode::HueShiftNegative:
+        hueShiftNegative(image);
+        break;
+    }
+}
+
+QImage PagePainter::pageImage(const Okular::Page *page, Okular::DocumentObserver *observer, int flags, int dScaledWidth, int dScaledHeight)
+{
+    if (page->hasTilesManager(observer)) {
+        return QImage();
+    }
+
+    const QImage image = page->_o_nearestImage(observer, dScaledWidth, dScaledHeight);
+    if (image.isNull()) {
+        return image;
+    }
+
+    const bool accessibility = (flags & Accessibility) && Okular::SettingsCore::changeColors() && (Okular::SettingsCore::renderMode() != Okular::SettingsCore::EnumRenderMode::Paper);
+    return accessibility ? accessibilityFilteredImage(image, image.size(), paperColor()) : image;
+}
+
+QList<QPair<QColor, Okular::NormalizedRect>> PagePainter::highlightRects(const Okular::Page *page, int flags)
+{
+    QList<QPair<QColor, Okular::NormalizedRect>> rects;
+    if (flags & Highlights) {
+        for (const Okular::HighlightAreaRect *highlight : page->m_highlights) {
+            for (const Okular::NormalizedRect &rect : *highlight) {
+                rects.append(qMakePair(highlight->color, rect));
+            }
+        }
+    }
+
+    const Okular::RegularAreaRect *textSelection = page->textSelection();
+    if ((flags & TextSelection) && textSelection) {
+        for (const Okular::NormalizedRect &rect : *textSelection) {
+            rects.append(qMakePair(page->textSelectionColor(), rect));
+        }
+    }
+
+    return rects;
+}
+
+QColor PagePainter::accessibilityFilteredColor(const QColor &color)
+{
+    QImage image(1, 1, QImage::Format_ARGB32_Premultiplied);
+    image.fill(color);
+    applyAccessibilityFilter(&image);
+    return image.pixelColor(0, 0);
+}
+
+QColor PagePainter::paperColor()
+{
+    const bool paperMode = Okular::SettingsCore::changeColors() && Okular::SettingsCore::renderMode() == Okular::SettingsCore::EnumRenderMode::Paper;
+    return paperMode ? Okular::SettingsCore::paperColor() : QColor(Qt::white);
+}
+
+QImage PagePainter::accessibilityFilteredImage(const QImage &pageImage, const QSize &size, const QColor &paperColor)
+{
+    // the key changes with the image, so it also identifies the page and the observer
+    QString key = QStringLiteral("%1-%2x%3-%4-%5").arg(pageImage.cacheKey()).arg(size.width()).arg(size.height()).arg(Okular::SettingsCore::renderMode()).arg(paperColor.rgba());
+    switch (Okular::SettingsCore::renderMode()) {
+    case Okular::SettingsCore::EnumRenderMode::Recolor:
+        key += QStringLiteral("-%1-%2").arg(Okular::Settings::recolorForeground().rgb()).arg(Okular::Settings::recolorBackground().rgb());
+        break;
+    case Okular::SettingsCore::EnumRenderMode::BlackWhite:
+        key += QStringLiteral("-%1-%2").arg(Okular::Settings::bWContrast()).arg(Okular::Settings::bWThreshold());
+        break;
+    default:;
+    }
+
+    {
+        QMutexLocker locker(filteredImageCacheMutex());
+        if (const QImage *cached = filteredImageCache->object(key)) {
+            return *cached;
+        }
+    }
+
+    // the filter is applied on the page as painted over the paper, the scaling is not
+    // smooth so it can be done before without changing the result
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(paperColor);
+    {
+        QPainter p(&image);
+        const QImage scaledImage = pageImage.scaled(size);
+        p.drawImage(QRect(QPoint(0, 0), size), scaledImage, scaledImage.rect());
+    }
+    applyAccessibilityFilter(&image);
+
+    int maxCost = 0;
+    switch (Okular::SettingsCore::memoryLevel()) {
+    case Okular::SettingsCore::EnumMemoryLevel::Low:
+        break;
+    case Okular::SettingsCore::EnumMemoryLevel::Normal:
+        maxCost = 128 * 1024;
+        break;
+    case Okular::SettingsCore::EnumMemoryLevel::Aggressive:
+        maxCost = 256 * 1024;
+        break;
+    case Okular::SettingsCore::EnumMemoryLevel::Greedy:
+        maxCost = 512 * 1024;
+        break;
+    }
+    QMutexLocker locker(filteredImageCacheMutex());
+    filteredImageCache->setMaxCost(maxCost);
+    filteredImageCache->insert(key, new QImage(image), qMax<qsizetype>(1, image.sizeInBytes() / 1024));
+
+    return image;
+}
+
 void PagePainter::recolor(QImage *image, const QColor &foreground, const QColor &background)
 {
     if (image->format() != QImage::Format_ARGB32_Premultiplied) {
@@ -703,18 +814,21 @@ void PagePainter::recolor(QImage *image, const QColor &foreground, const QColor
     const int foreground_green = foreground.green();
     const int foreground_blue = foreground.blue();
 
-    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
-    const int pixels = image->width() * image->height();
-
-    for (int i = 0; i < pixels; ++i) {
-        const int lightness = qGray(data[i]);
-
+    // the color only depends on the lightness, compute it once for each
+    QRgb colors[256];
+    for (int lightness = 0; lightness < 256; ++lightness) {
         const float r = scaleRed * lightness + foreground_red;
         const float g = scaleGreen * lightness + foreground_green;
         const float b = scaleBlue * lightness + foreground_blue;
 
-        const unsigned a = qAlpha(data[i]);
-        data[i] = qRgba(r, g, b, a);
+        colors[lightness] = qRgba(r, g, b, 0);
+    }
+
+    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
+    const int pixels = image->width() * image->height();
+
+    for (int i = 0; i < pixels; ++i) {
+        data[i] = colors[qGray(data[i])] | (data[i] & 0xff000000);
     }
 }
 
@@ -724,10 +838,11 @@ void PagePainter::blackWhite(QImage *image, int contrast, int threshold)
     int con = contrast;
     int thr = 255 - threshold;
 
-    int pixels = image->width() * image->height();
-    for (int i = 0; i < pixels; ++i) {
+    // the result only depends on the gray value, compute it once for each
+    unsigned int grays[256];
+    for (int gray = 0; gray < 256; ++gray) {
         // Piecewise linear function of val, through (0, 0), (thr, 128), (255, 255)
-        int val = qGray(data[i]);
+        int val = gray;
         if (val > thr) {
             val = 128 + (127 * (val - thr)) / (255 - thr);
         } else if (val < thr) {
@@ -740,8 +855,12 @@ void PagePainter::blackWhite(QImage *image, int contrast, int threshold)
             val = qBound(0, val, 255);
         }
 
-        const unsigned a = qAlpha(data[i]);
-        data[i] = qRgba(val, val, val, a);
+        grays[gray] = qRgba(val, val, val, 0);
+    }
+
+    int pixels = image->width() * image->height();
+    for (int i = 0; i < pixels; ++i) {
+        data[i] = grays[qGray(data[i])] | (data[i] & 0xff000000);
     }
 }
 
@@ -754,41 +873,7 @@ void PagePainter::invertLightness(QImage *image)
 
     Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
 
-    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
-    int pixels = image->width() * image->height();
-    for (int i = 0; i < pixels; ++i) {
-        // Invert lightness of the pixel using the cylindric HSL color model.
-        // Algorithm is based on https://en.wikipedia.org/wiki/HSL_and_HSV#HSL_to_RGB (2019-03-17).
-        // Important simplifications are that inverting lightness does not change chroma and hue.
-        // This means the sector (of the chroma/hue plane) is not changed,
-        // so we can use a linear calculation after determining the sector using qMin() and qMax().
-        uchar R = qRed(data[i]);
-        uchar G = qGreen(data[i]);
-        uchar B = qBlue(data[i]);
-
-        // Get only the needed HSL components. These are chroma C and the common component m.
-        // Get common component m
-        uchar m = qMin(R, qMin(G, B));
-        // Remove m from color components
-        R -= m;
-        G -= m;
-        B -= m;
-        // Get chroma C
-        uchar C = qMax(R, qMax(G, B));
-
-        // Get common component m' after inverting lightness L.
-        // Hint: Lightness L = m + C / 2; L' = 255 - L = 255 - (m + C / 2) => m' = 255 - C - m
-        uchar m_ = 255 - C - m;
-
-        // Add m' to color compontents
-        R += m_;
-        G += m_;
-        B += m_;
-
-        // Save new color
-        const unsigned A = qAlpha(data[i]);
-        data[i] = qRgba(R, G, B, A);
-    }
+    ColorFilters::invertLightnessPixels(reinterpret_cast<QRgb *>(image->bits()), image->width() * image->height());
 }
 
 void PagePainter::invertLuma(QImage *image, float Y_R, float Y_G, float Y_B)
@@ -802,16 +887,24 @@ void PagePainter::invertLuma(QImage *image, float Y_R, float Y_G, float Y_B)
 
     QRgb *data = reinterpret_cast<QRgb *>(image->bits());
     int pixels = image->width() * image->height();
+    // pages are mostly runs of the same color, reuse the last result for them
+    QRgb lastColor = 0;
+    QRgb lastInvertedColor = 0xffffff;
     for (int i = 0; i < pixels; ++i) {
-        uchar R = qRed(data[i]);
-        uchar G = qGreen(data[i]);
-        uchar B = qBlue(data[i]);
+        const QRgb color = data[i] & 0x00ffffff;
+        if (color != lastColor) {
+            uchar R = qRed(color);
+            uchar G = qGreen(color);
+            uchar B = qBlue(color);
+
+            invertLumaPixel(R, G, B, Y_R, Y_G, Y_B);
 
-        invertLumaPixel(R, G, B, Y_R, Y_G, Y_B);
+            lastColor = color;
+            lastInvertedColor = qRgba(R, G, B, 0);
+        }
 
         // Save new color
-        const unsigned A = qAlpha(data[i]);
-        data[i] = qRgba(R, G, B, A);
+        data[i] = lastInvertedColor | (data[i] & 0xff000000);
     }
 }
 
@@ -908,17 +1001,7 @@ void PagePainter::hueShiftPositive(QImage *image)
 
     Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
 
-    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
-    int pixels = image->width() * image->height();
-    for (int i = 0; i < pixels; ++i) {
-        uchar R = qRed(data[i]);
-        uchar G = qGreen(data[i]);
-        uchar B = qBlue(data[i]);
-
-        // Save new color
-        const unsigned A = qAlpha(data[i]);
-        data[i] = qRgba(B, R, G, A);
-    }
+    ColorFilters::rotateColorPixels<16>(reinterpret_cast<QRgb *>(image->bits()), image->width() * image->height());
 }
 
 void PagePainter::hueShiftNegative(QImage *image)
@@ -930,17 +1013,7 @@ void PagePainter::hueShiftNegative(QImage *image)
 
     Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
 
-    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
-    int pixels = image->width() * image->height();
-    for (int i = 0; i < pixels; ++i) {
-        uchar R = qRed(data[i]);
-        uchar G = qGreen(data[i]);
-        uchar B = qBlue(data[i]);
-
-        // Save new color
-        const unsigned A = qAlpha(data[i]);
-        data[i] = qRgba(G, B, R, A);
-    }
+    ColorFilters::rotateColorPixels<8>(reinterpret_cast<QRgb *>(image->bits()), image->width() * image->height());
 }
 
 void PagePainter::drawShapeOnImage(QImage &image, const NormalizedPath &normPath, bool closeShape, const QPen &pen, const QBrush &brush, double penWidthMultiplier, RasterOperation op
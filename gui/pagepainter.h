@@ -68,8 +68,40 @@ public:
                                           const Okular::NormalizedRect &crop,
                                           Okular::NormalizedPoint *viewPortPoint);
 
+    /**
+     * Returns the render of @p page for @p observer closest to @p dScaledWidth x @p dScaledHeight
+     * device pixels, with the configured render mode applied if @p flags has Accessibility.
+     *
+     * Returns a null image if the page is rendered in tiles or not rendered yet, in which
+     * case it has to be painted with paintPageOnPainter().
+     */
+    static QImage pageImage(const Okular::Page *page, Okular::DocumentObserver *observer, int flags, int dScaledWidth, int dScaledHeight);
+
+    /**
+     * Returns the color and the rect of the highlights of @p page, and of its text selection
+     * if @p flags has TextSelection.
+     */
+    static QList<QPair<QColor, Okular::NormalizedRect>> highlightRects(const Okular::Page *page, int flags);
+
 private:
     // BEGIN Change Colors feature
+    /**
+     * Applies the configured render mode to @p image.
+     */
+    static void applyAccessibilityFilter(QImage *image);
+    /**
+     * Returns @p color with the configured render mode applied.
+     */
+    static QColor accessibilityFilteredColor(const QColor &color);
+    /**
+     * Returns the color of the paper the pages are painted over.
+     */
+    static QColor paperColor();
+    /**
+     * Returns @p pageImage scaled to @p size and painted over @p paperColor, with the configured
+     * render mode applied. The result is cached until the image or the settings change.
+     */
+    static QImage accessibilityFilteredImage(const QImage &pageImage, const QSize &size, const QColor &paperColor);
     /**
      * Collapse color space (from white to black) to a line from @p foreground to @p background.
      */
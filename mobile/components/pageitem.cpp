@@ -9,6 +9,9 @@
 
 #include <QPainter>
 #include <QQuickWindow>
+#include <QSGFlatColorMaterial>
+#include <QSGGeometryNode>
+#include <QSGSimpleRectNode>
 #include <QSGSimpleTextureNode>
 #include <QStyleOptionGraphicsItem>
 #include <QTimer>
@@ -20,6 +23,9 @@
 #include "gui/pagepainter.h"
 #include "gui/priorities.h"
 #include "settings.h"
+#include "settings_core.h"
+
+#include <algorithm>
 
 #define REDRAW_TIMEOUT 250
 
@@ -29,6 +35,9 @@ PageItem::PageItem(QQuickItem *parent)
     , m_page(nullptr)
     , m_bookmarked(false)
     , m_isThumbnail(false)
+    , m_bufferChanged(false)
+    , m_paperColor(Qt::white)
+    , m_highlightsChanged(false)
 {
     setFlag(QQuickItem::ItemHasContents, true);
 
@@ -273,21 +282,81 @@ void PageItem::geometryChange(const QRectF &newGeometry, const QRectF &oldGeomet
     }
 }
 
+static QSGNode *createHighlightNode(const QRectF &rect, const QColor &color)
+{
+    // PagePainter multiplies the highlight with the page, blending is the closest
+    // the scene graph gets without a custom material
+    QColor fillColor = color;
+    fillColor.setAlphaF(0.4);
+    QSGSimpleRectNode *fillNode = new QSGSimpleRectNode(rect, fillColor);
+
+    QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 4);
+    geometry->setDrawingMode(QSGGeometry::DrawLineLoop);
+    geometry->setLineWidth(1);
+    QSGGeometry::Point2D *points = geometry->vertexDataAsPoint2D();
+    points[0].set(rect.left(), rect.top());
+    points[1].set(rect.right(), rect.top());
+    points[2].set(rect.right(), rect.bottom());
+    points[3].set(rect.left(), rect.bottom());
+
+    QSGFlatColorMaterial *material = new QSGFlatColorMaterial();
+    material->setColor(color.darker(150));
+
+    QSGGeometryNode *frameNode = new QSGGeometryNode();
+    frameNode->setGeometry(geometry);
+    frameNode->setFlag(QSGNode::OwnsGeometry);
+    frameNode->setMaterial(material);
+    frameNode->setFlag(QSGNode::OwnsMaterial);
+    fillNode->appendChildNode(frameNode);
+
+    return fillNode;
+}
+
 QSGNode *PageItem::updatePaintNode(QSGNode *node, QQuickItem::UpdatePaintNodeData * /*data*/)
 {
     if (!window() || m_buffer.isNull()) {
         delete node;
         return nullptr;
     }
-    QSGSimpleTextureNode *n = static_cast<QSGSimpleTextureNode *>(node);
-    if (!n) {
-        n = new QSGSimpleTextureNode();
-        n->setOwnsTexture(true);
+
+    // the paper, with the page texture and then the highlights as children
+    QSGSimpleRectNode *paperNode = static_cast<QSGSimpleRectNode *>(node);
+    QSGSimpleTextureNode *textureNode;
+    if (!paperNode) {
+        paperNode = new QSGSimpleRectNode();
+        textureNode = new QSGSimpleTextureNode();
+        textureNode->setOwnsTexture(true);
+        paperNode->appendChildNode(textureNode);
+        paperNode->appendChildNode(new QSGNode());
+        m_bufferChanged = true;
+        m_highlightsChanged = true;
+    } else {
+        textureNode = static_cast<QSGSimpleTextureNode *>(paperNode->firstChild());
+    }
+
+    paperNode->setRect(boundingRect());
+    paperNode->setColor(m_paperColor);
+
+    if (m_bufferChanged) {
+        textureNode->setTexture(window()->createTextureFromImage(m_buffer));
+        m_bufferChanged = false;
     }
+    textureNode->setRect(boundingRect());
 
-    n->setTexture(window()->createTextureFromImage(m_buffer));
-    n->setRect(boundingRect());
-    return n;
+    if (m_highlightsChanged) {
+        QSGNode *highlightsNode = paperNode->lastChild();
+        paperNode->removeChildNode(highlightsNode);
+        delete highlightsNode;
+
+        highlightsNode = new QSGNode();
+        for (const auto &highlight : std::as_const(m_highlights)) {
+            highlightsNode->appendChildNode(createHighlightNode(highlight.second.geometryF(width(), height()), highlight.first));
+        }
+        paperNode->appendChildNode(highlightsNode);
+        m_highlightsChanged = false;
+    }
+
+    return paperNode;
 }
 
 void PageItem::requestPixmap()
@@ -295,6 +364,7 @@ void PageItem::requestPixmap()
     if (!m_documentItem || !m_page || !window() || width() <= 0 || height() < 0) {
         if (!m_buffer.isNull()) {
             m_buffer = QImage();
+            m_bufferChanged = true;
             update();
         }
         return;
@@ -323,18 +393,46 @@ void PageItem::requestPixmap()
 void PageItem::paint()
 {
     Observer *observer = m_isThumbnail ? m_documentItem.data()->thumbnailObserver() : m_documentItem.data()->pageviewObserver();
-    const int flags = PagePainter::Accessibility | PagePainter::Highlights | PagePainter::Annotations;
+    const int flags = PagePainter::Accessibility | PagePainter::Annotations;
 
     const qreal dpr = window()->devicePixelRatio();
     const QRect limits(QPoint(0, 0), QSize(width() * dpr, height() * dpr));
-    QPixmap pix(limits.size());
-    pix.setDevicePixelRatio(dpr);
-    QPainter p(&pix);
-    p.setRenderHint(QPainter::Antialiasing, false);
-    PagePainter::paintPageOnPainter(&p, m_page, observer, flags, width(), height(), limits);
-    p.end();
 
-    m_buffer = pix.toImage();
+    // the render of the page becomes the texture as it is, unless there are annotations
+    // to paint on it
+    const QList<Okular::Annotation *> annotations = m_page->annotations();
+    const bool hasAnnotations = std::any_of(annotations.cbegin(), annotations.cend(), [](const Okular::Annotation *annotation) {
+        return !(annotation->flags() & (Okular::Annotation::Hidden | Okular::Annotation::ExternallyDrawn));
+    });
+    QImage image;
+    if (!hasAnnotations) {
+        image = PagePainter::pageImage(m_page, observer, flags, limits.width(), limits.height());
+    }
+
+    if (image.isNull()) {
+        image = QImage(limits.size(), QImage::Format_ARGB32_Premultiplied);
+        image.setDevicePixelRatio(dpr);
+        QPainter p(&image);
+        p.setRenderHint(QPainter::Antialiasing, false);
+        PagePainter::paintPageOnPainter(&p, m_page, observer, flags, width(), height(), limits);
+        p.end();
+    }
+
+    if (image.cacheKey() != m_buffer.cacheKey()) {
+        m_buffer = image;
+        m_bufferChanged = true;
+    }
+
+    const bool paperMode = Okular::SettingsCore::changeColors() && Okular::SettingsCore::renderMode() == Okular::SettingsCore::EnumRenderMode::Paper;
+    m_paperColor = paperMode ? Okular::SettingsCore::paperColor() : QColor(Qt::white);
+
+    updateHighlights();
+}
+
+void PageItem::updateHighlights()
+{
+    m_highlights = PagePainter::highlightRects(m_page, PagePainter::Highlights);
+    m_highlightsChanged = true;
 
     update();
 }
@@ -349,6 +447,9 @@ void PageItem::pageHasChanged(int page, int flags)
         } else if (flags == Okular::DocumentObserver::Pixmap) {
             // if pixmaps have updated, just repaint .. don't bother updating pixmaps AGAIN
             paint();
+        } else if (flags == Okular::DocumentObserver::Highlights || flags == Okular::DocumentObserver::TextSelection) {
+            // the page texture stays as it is
+            updateHighlights();
         } else {
             m_redrawTimer->start();
         }
@@ -7,6 +7,7 @@
 #ifndef QPAGEITEM_H
 #define QPAGEITEM_H
 
+#include <QColor>
 #include <QImage>
 #include <QPointer>
 #include <QQuickItem>
@@ -138,6 +139,7 @@ private Q_SLOTS:
 
 private:
     void paint();
+    void updateHighlights();
     void refreshPage();
 
     const Okular::Page *m_page;
@@ -147,7 +149,13 @@ private:
     QTimer *m_redrawTimer;
     QPointer<QQuickItem> m_flickable;
     Okular::DocumentViewport m_viewPort;
+    // the render of the page, uploaded again only when it changes
     QImage m_buffer;
+    bool m_bufferChanged;
+    QColor m_paperColor;
+    // drawn as scene graph nodes over the page
+    QList<QPair<QColor, Okular::NormalizedRect>> m_highlights;
+    bool m_highlightsChanged;
 };
 
 #endif
@@ -12,6 +12,7 @@
 #include <QComboBox>
 #include <QFormLayout>
 #include <QLabel>
+#include <QSpinBox>
 
 #include "settings_core.h"
 
@@ -66,6 +67,23 @@ DlgPerformance::DlgPerformance(QWidget *parent)
     layout->addRow(QString(), useTextHinting);
     // END Checkboxes: rendering options
 
+    // BEGIN Spinbox: rendering threads
+    QSpinBox *renderThreads = new QSpinBox(this);
+    renderThreads->setSpecialValueText(i18nc("@item:inlistbox Config dialog, performance page, number of rendering threads", "Automatic"));
+    renderThreads->setObjectName(QStringLiteral("kcfg_RenderThreads"));
+    renderThreads->setToolTip(i18nc("@info:tooltip Config dialog, performance page", "How many pages can be rendered at the same time by backends that support it"));
+    layout->addRow(i18nc("@label:spinbox Config dialog, performance page", "Rendering threads:"), renderThreads);
+    // END Spinbox: rendering threads
+
+    // BEGIN Spinbox: thumbnail store
+    QSpinBox *thumbnailStoreSize = new QSpinBox(this);
+    thumbnailStoreSize->setSpecialValueText(i18nc("@item:inlistbox Config dialog, performance page, size of the thumbnail store", "Disabled"));
+    thumbnailStoreSize->setSuffix(i18nc("@item:valuesuffix Config dialog, performance page, size of the thumbnail store", " MiB"));
+    thumbnailStoreSize->setObjectName(QStringLiteral("kcfg_ThumbnailStoreSize"));
+    thumbnailStoreSize->setToolTip(i18nc("@info:tooltip Config dialog, performance page", "How much disk space can be used to keep the thumbnails of the documents already opened"));
+    layout->addRow(i18nc("@label:spinbox Config dialog, performance page", "Thumbnail storage:"), thumbnailStoreSize);
+    // END Spinbox: thumbnail store
+
     //    m_dlg->cpuLabel->setPixmap(QIcon::fromTheme(QStringLiteral("cpu")).pixmap(32));
     //    m_dlg->memoryLabel->setPixmap( QIcon::fromTheme( "kcmmemory" ).pixmap(  32 ) ); // TODO: enable again when proper icon is available TODO: Figure out a new place in the layout for these pixmaps
 }
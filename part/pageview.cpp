@@ -62,6 +62,7 @@
 #include <kwidgetsaddons_version.h>
 
 // system includes
+#include <algorithm>
 #include <array>
 #include <math.h>
 #include <stdlib.h>
@@ -151,12 +152,22 @@ public:
     OkularTTS *tts();
 #endif
     QString selectedText() const;
+    QPair<int, int> itemsInRows(double top, double bottom) const;
+    void resetLayoutIndex();
 
     // the document, pageviewItems and the 'visible cache'
     PageView *q;
     Okular::Document *document = nullptr;
     QVector<PageViewItem *> items;
     QList<PageViewItem *> visibleItems;
+    // the rows of shown items laid out by slotRelayoutPages, from top to bottom:
+    // their vertical extent and the index of their first item (plus the end index)
+    QVector<int> rowTops;
+    QVector<int> rowBottoms;
+    QVector<int> rowFirstItems;
+    // the items whose widgets may be inside the viewport, all of them after a relayout
+    int widgetItemsBegin = 0;
+    int widgetItemsEnd = 0;
     MagnifierView *magnifierView;
 
     // view layout (columns in Settings), zoom and mouse
@@ -987,6 +998,27 @@ QString PageViewPrivate::selectedText() const
     return text;
 }
 
+// Returns the range of items, first and one past the last, in the rows
+// that intersect the band between @p top and @p bottom in content coordinates
+QPair<int, int> PageViewPrivate::itemsInRows(double top, double bottom) const
+{
+    const int firstRow = std::upper_bound(rowBottoms.cbegin(), rowBottoms.cend(), floor(top)) - rowBottoms.cbegin();
+    const int endRow = std::lower_bound(rowTops.cbegin(), rowTops.cend(), ceil(bottom)) - rowTops.cbegin();
+    if (firstRow >= endRow) {
+        return qMakePair(0, 0);
+    }
+    return qMakePair(rowFirstItems[firstRow], qMin(rowFirstItems[endRow], (int)items.count()));
+}
+
+void PageViewPrivate::resetLayoutIndex()
+{
+    rowTops.clear();
+    rowBottoms.clear();
+    rowFirstItems.clear();
+    widgetItemsBegin = 0;
+    widgetItemsEnd = items.count();
+}
+
 QMimeData *PageView::getTableContents() const
 {
     QString selText;
@@ -1235,6 +1267,7 @@ void PageView::notifySetup(const QVector<Okular::Page *> &pageSet, int setupFlag
 
         createAnnotationsVideoWidgets(item, page->annotations());
     }
+    d->resetLayoutIndex();
 
     // invalidate layout so relayout/repaint will happen on next viewport change
     if (haspages) {
@@ -4624,9 +4657,19 @@ void PageView::slotRelayoutPages()
             insertX += colWidth[i];
         }
     }
+    d->resetLayoutIndex();
+    int lastIndexedRow = -1, indexedItemsEnd = 0;
     for (PageViewItem *item : std::as_const(d->items)) {
         int cWidth = colWidth[cIdx], rHeight = rowHeight[rIdx];
         if (continuousView || rIdx == pageRowIdx) {
+            if (rIdx != lastIndexedRow) {
+                const int rowTop = continuousView ? insertY : origInsertY;
+                d->rowTops.append(rowTop);
+                d->rowBottoms.append(rowTop + rHeight);
+                d->rowFirstItems.append(item->pageNumber());
+                lastIndexedRow = rIdx;
+            }
+            indexedItemsEnd = item->pageNumber() + 1;
             const bool reallyDoCenterFirst = item->pageNumber() == 0 && centerFirstPage;
             const bool reallyDoCenterLast = item->pageNumber() == pageCount - 1 && centerLastPage;
             int actualX = 0;
@@ -4670,6 +4713,10 @@ void PageView::slotRelayoutPages()
 #endif
     }
 
+    if (!d->rowTops.isEmpty()) {
+        d->rowFirstItems.append(indexedItemsEnd);
+    }
+
     delete[] colWidth;
     delete[] rowHeight;
 
@@ -4750,6 +4797,25 @@ static void slotRequestPreloadPixmap(PageView *pageView, const PageViewItem *i,
     }
 }
 
+static void moveItemWidgets(PageViewItem *i, const QRectF &viewportRect, const QRectF &viewportRectAtZeroZero)
+{
+    const QSet<FormWidgetIface *> formWidgetsList = i->formWidgets();
+    for (FormWidgetIface *fwi : formWidgetsList) {
+        Okular::NormalizedRect r = fwi->rect();
+        fwi->moveTo(qRound(i->uncroppedGeometry().left() + i->uncroppedWidth() * r.left) + 1 - viewportRect.left(), qRound(i->uncroppedGeometry().top() + i->uncroppedHeight() * r.top) + 1 - viewportRect.top());
+    }
+    const QHash<Okular::Movie *, VideoWidget *> videoWidgets = i->videoWidgets();
+    for (VideoWidget *vw : videoWidgets) {
+        const Okular::NormalizedRect r = vw->normGeometry();
+        vw->move(qRound(i->uncroppedGeometry().left() + i->uncroppedWidth() * r.left) + 1 - viewportRect.left(), qRound(i->uncroppedGeometry().top() + i->uncroppedHeight() * r.top) + 1 - viewportRect.top());
+
+        if (vw->isPlaying() && viewportRectAtZeroZero.intersected(vw->geometry()).isEmpty()) {
+            vw->stop();
+            vw->pageLeft();
+        }
+    }
+}
+
 void PageView::slotRequestVisiblePixmaps(int newValue)
 {
     // if requests are blocked (because raised by an unwanted event), exit
@@ -4770,26 +4836,25 @@ void PageView::slotRequestVisiblePixmaps(int newValue)
     // Margin (in pixels) around the viewport to preload
     const int pixelsToExpand = 512;
 
-    // iterate over all items
+    // only the items in the rows around the viewport can be visible or have
+    // widgets inside it, the ones that were there last time are moved away
+    const QPair<int, int> nearItems = d->itemsInRows(viewportRect.top() - pixelsToExpand, viewportRect.bottom() + pixelsToExpand);
+    const int widgetItemsEnd = qMin(d->widgetItemsEnd, (int)d->items.count());
+    for (int n = d->widgetItemsBegin; n < widgetItemsEnd; ++n) {
+        if (n < nearItems.first || n >= nearItems.second) {
+            moveItemWidgets(d->items[n], viewportRect, viewportRectAtZeroZero);
+        }
+    }
+    d->widgetItemsBegin = nearItems.first;
+    d->widgetItemsEnd = nearItems.second;
+
+    // iterate over the items near the viewport
     d->visibleItems.clear();
     QList<Okular::PixmapRequest *> requestedPixmaps;
     QVector<Okular::VisiblePageRect *> visibleRects;
-    for (PageViewItem *i : std::as_const(d->items)) {
-        const QSet<FormWidgetIface *> formWidgetsList = i->formWidgets();
-        for (FormWidgetIface *fwi : formWidgetsList) {
-            Okular::NormalizedRect r = fwi->rect();
-            fwi->moveTo(qRound(i->uncroppedGeometry().left() + i->uncroppedWidth() * r.left) + 1 - viewportRect.left(), qRound(i->uncroppedGeometry().top() + i->uncroppedHeight() * r.top) + 1 - viewportRect.top());
-        }
-        const QHash<Okular::Movie *, VideoWidget *> videoWidgets = i->videoWidgets();
-        for (VideoWidget *vw : videoWidgets) {
-            const Okular::NormalizedRect r = vw->normGeometry();
-            vw->move(qRound(i->uncroppedGeometry().left() + i->uncroppedWidth() * r.left) + 1 - viewportRect.left(), qRound(i->uncroppedGeometry().top() + i->uncroppedHeight() * r.top) + 1 - viewportRect.top());
-
-            if (vw->isPlaying() && viewportRectAtZeroZero.intersected(vw->geometry()).isEmpty()) {
-                vw->stop();
-                vw->pageLeft();
-            }
-        }
+    for (int n = nearItems.first; n < nearItems.second; ++n) {
+        PageViewItem *i = d->items[n];
+        moveItemWidgets(i, viewportRect, viewportRectAtZeroZero);
 
         if (!i->isVisible()) {
             continue;